@@ -2,6 +2,7 @@
 
 #include "../util/allocator.h"
 #include "../util/prettify_c.h"
+#include "calc_parse_cache.h"
 #include "func_const_ctx.h"
 #include "native_functions.h"
 
@@ -17,8 +18,9 @@ typedef struct XyValuesContext {
 } XyValuesContext;
 
 ExprValueResult xy_get_variable_val(XyValuesContext* this, StrSlice name);
+const ExprValue* xy_get_variable_ref(XyValuesContext* this, StrSlice name);
 ExprValueResult xy_call_function(XyValuesContext* this, StrSlice name,
-                                 vec_ExprValue* args);
+                                 vec_ExprValue args);
 /*
   // Parsing
   bool (*is_variable)(void* this, StrSlice var_name);
@@ -26,7 +28,8 @@ ExprValueResult xy_call_function(XyValuesContext* this, StrSlice name,
 
   // Computation
   ExprValueResult (*get_variable_val)(void*, StrSlice);
-  ExprValueResult (*call_function)(void*, StrSlice, vec_ExprValue*);
+  const ExprValue* (*get_variable_ref)(void*, StrSlice);
+  ExprValueResult (*call_function)(void*, StrSlice, vec_ExprValue);
 
   // Anasysis and compilation
   bool (*is_expr_const)(void* this, const Expr* expr);
@@ -36,6 +39,16 @@ ExprValueResult xy_call_function(XyValuesContext* this, StrSlice name,
   ExprFunctionInfo (*get_function_info)(void* this, StrSlice fun_name);
 */
 
+// expr_parse_string in the shape calc_parse_cache_parse stores
+static CalcExprResult parse_plot(ExprContext ctx, const char* text) {
+  ExprResult res = expr_parse_string(text, ctx);
+  if (not res.is_ok) return CalcExprErr(res.err_pos, res.err_text);
+  return CalcExprOk(((CalcExpr){
+      .type = CALC_EXPR_PLOT,
+      .expression = res.ok,
+  }));
+}
+
 ExprValueResult calc_calculate_expr(const char* text, double x, double y) {
   static const ExprContextVtable XY_CTX_VTABLE = {
       .get_expr_type = null,
@@ -46,14 +59,21 @@ ExprValueResult calc_calculate_expr(const char* text, double x, double y) {
 
       .get_variable_val =
           (ExprValueResult(*)(void*, StrSlice))xy_get_variable_val,
+      .get_variable_ref =
+          (const ExprValue* (*)(void*, StrSlice))xy_get_variable_ref,
       .call_function =
-          (ExprValueResult(*)(void*, StrSlice, vec_ExprValue*))xy_call_function,
+          (ExprValueResult(*)(void*, StrSlice, vec_ExprValue))xy_call_function,
   };
 
+  // Everything but the result is temporary
+  static MyArena arena = MY_ARENA_INIT;
+  my_arena_begin(&arena);
+
   CalcBackend backend = calc_backend_create();
   ExprContext ctx = calc_backend_get_context(&backend);
 
-  ExprResult expr = expr_parse_string(text, ctx);
+  // Repeated inputs skip parsing
+  CalcExprResult expr = calc_parse_cache_parse(parse_plot, ctx, text);
   ExprValueResult result;
   if (not expr.is_ok) {
     result = ExprValueErr(expr.err_pos, expr.err_text);
@@ -61,12 +81,31 @@ ExprValueResult calc_calculate_expr(const char* text, double x, double y) {
     XyValuesContext xy_ctx = {.x = x, .y = y, .parent = ctx};
     ExprContext local_ctx = {.data = &xy_ctx, .vtable = &XY_CTX_VTABLE};
 
-    result = expr_calculate(&expr.ok, local_ctx);
-    expr_free(expr.ok);
+    result = expr_calculate(&expr.ok.expression, local_ctx);
+    calc_expr_free(expr.ok);
   }
 
   calc_backend_free(backend);
-  return result;
+  my_arena_end(&arena);
+
+  // The result may share storage with the arena, it is copied out and freed
+  // to release the heap values it shares
+  ExprValueResult copy = expr_value_result_deep_clone(&result);
+  expr_value_result_free(result);
+  my_arena_reset(&arena);
+  return copy;
+}
+
+ExprValueResult calc_backend_calculate(CalcBackend* this, const Expr* expr) {
+  static MyArena arena = MY_ARENA_INIT;
+  my_arena_begin(&arena);
+  ExprValueResult result = expr_calculate(expr, calc_backend_get_context(this));
+  my_arena_end(&arena);
+
+  ExprValueResult copy = expr_value_result_deep_clone(&result);
+  expr_value_result_free(result);
+  my_arena_reset(&arena);
+  return copy;
 }
 
 ExprValueResult xy_get_variable_val(XyValuesContext* this, StrSlice name) {
@@ -80,8 +119,15 @@ ExprValueResult xy_get_variable_val(XyValuesContext* this, StrSlice name) {
     return this->parent.vtable->get_variable_val(this->parent.data, name);
 }
 
+const ExprValue* xy_get_variable_ref(XyValuesContext* this, StrSlice name) {
+  if (str_slice_eq_ccp(name, "x") or str_slice_eq_ccp(name, "y") or
+      not this->parent.vtable->get_variable_ref)
+    return null;
+  return this->parent.vtable->get_variable_ref(this->parent.data, name);
+}
+
 ExprValueResult xy_call_function(XyValuesContext* this, StrSlice name,
-                                 vec_ExprValue* args) {
+                                 vec_ExprValue args) {
   return this->parent.vtable->call_function(this->parent.data, name, args);
 }
 
@@ -93,12 +139,16 @@ ExprValueResult xy_call_function(XyValuesContext* this, StrSlice name,
 void calc_backend_free(CalcBackend this) {
   vec_CalcExpr_free(this.expressions);
   vec_CalcValue_free(this.values);
+  calc_symbols_free(this.symbols);
 }
 
 CalcBackend calc_backend_clone(const CalcBackend* this) {
+  // Index borrows names, so the clone builds its own
   return (CalcBackend){.parent = this->parent,
                        .expressions = vec_CalcExpr_clone(&this->expressions),
-                       .values = vec_CalcValue_clone(&this->values)};
+                       .values = vec_CalcValue_clone(&this->values),
+                       .symbols = calc_symbols_create(),
+                       .memo_capacity = this->memo_capacity};
 }
 
 // =====
@@ -118,6 +168,8 @@ CalcBackend calc_backend_create() {
       .parent = null,
       .expressions = vec_CalcExpr_create(),
       .values = vec_CalcValue_with_capacity(LEN(values)),
+      .symbols = calc_symbols_create(),
+      .memo_capacity = 0,
   };
 
   assert_m(LEN(names) == LEN(values));
@@ -140,7 +192,8 @@ bool calc_backend_is_expr_const(const CalcBackend* this, const Expr* expr) {
   bool result = false;
 
   if (expr->type is EXPR_VARIABLE) {
-    result = calc_backend_is_var_const(this, expr->variable.name.string);
+    result = calc_backend_is_var_const_sslice(
+        this, expr_symbol_slice(expr->variable.name));
 
   } else if (expr->type is EXPR_NUMBER) {
     result = true;
@@ -156,7 +209,8 @@ bool calc_backend_is_expr_const(const CalcBackend* this, const Expr* expr) {
              calc_backend_is_expr_const(this, expr->binary_operator.rhs);
 
   } else if (expr->type is EXPR_FUNCTION) {
-    result = calc_backend_is_func_const(this, expr->function.name.string) and
+    result = calc_backend_is_func_const_sslice(
+                 this, expr_symbol_slice(expr->function.name)) and
              calc_backend_is_expr_const(this, expr->function.argument);
 
   } else {
@@ -176,28 +230,96 @@ bool calc_backend_is_var_const(const CalcBackend* this, const char* name) {
   return calc_backend_is_var_const_sslice(this, slice);
 }
 
-bool calc_backend_is_func_const_sslice(const CalcBackend* this, StrSlice name) {
-  if (calculator_get_native_function(name)) return true;
+// -- Definitions analysis cache
 
-  CalcExpr* expr = calc_backend_get_function_sslice((CalcBackend*)this, name);
-  if (expr) {
-    ExprContext ctx =
-        calc_backend_get_fun_context_sslice((CalcBackend*)this, name);
-    assert_m(ctx.data);
+static CalcExpr* calc_backend_find_function(CalcBackend* this, StrSlice name,
+                                            CalcBackend** scope);
+static CalcExpr* calc_backend_find_variable(CalcBackend* this, StrSlice name,
+                                            CalcBackend** scope);
+
+static bool calc_backend_analyze_const(CalcBackend* scope, CalcExpr* def) {
+  ExprContext ctx = calc_backend_get_context(scope);
+
+  if (def->type is CALC_EXPR_FUNCTION) {
     FuncConstCtx func_ctx = {
         .parent = ctx,
-        .used_args = &expr->function.args,
+        .used_args = &def->function.args,
         .are_const = true,
     };
-
     ExprContext total_ctx = func_const_ctx_context(&func_ctx);
-
-    return total_ctx.vtable->is_expr_const(total_ctx.data, &expr->expression);
+    return total_ctx.vtable->is_expr_const(total_ctx.data, &def->expression);
   } else {
-    return false;
+    return ctx.vtable->is_expr_const(ctx.data, &def->expression);
   }
 }
 
+// `def` must be defined in `scope`
+static bool calc_backend_def_is_const(CalcBackend* scope, CalcExpr* def) {
+  CalcExprInfo* info = &def->info;
+
+  if (info->state is CALC_EXPR_INFO_CONST) return true;
+  // Definitions that reach themselves can never be calculated
+  if (info->state is_not CALC_EXPR_INFO_UNKNOWN) return false;
+
+  info->state = CALC_EXPR_INFO_IN_PROGRESS;
+  bool result = calc_backend_analyze_const(scope, def);
+
+  info->state = result ? CALC_EXPR_INFO_CONST : CALC_EXPR_INFO_NOT_CONST;
+  // Info outlives any arena scope it is computed in
+  my_arena_pause();
+  calc_expr_info_collect_names(def);
+  my_arena_resume();
+  return result;
+}
+
+// `def` must be a const variable defined in `scope`
+static const ExprValueResult* calc_backend_def_value(CalcBackend* scope,
+                                                     CalcExpr* def) {
+  CalcExprInfo* info = &def->info;
+  if (not info->has_value) {
+    my_arena_pause();
+    ExprValueResult value =
+        expr_calculate(&def->expression, calc_backend_get_context(scope));
+    my_arena_resume();
+    info->has_value = true;
+    info->value = value;
+  }
+  return &info->value;
+}
+
+void calc_backend_invalidate_name(CalcBackend* this, StrSlice name) {
+  vec_str_t changed = vec_str_t_create();
+  vec_str_t_push(&changed, str_slice_to_owned(name));
+
+  // Whatever used a changed definition has changed too
+  for (int n = 0; n < changed.length; n++) {
+    StrSlice changed_name = str_slice_from_str_t(&changed.data[n]);
+
+    for (int i = 0; i < this->expressions.length; i++) {
+      CalcExpr* item = &this->expressions.data[i];
+      if (item->info.state is CALC_EXPR_INFO_UNKNOWN or
+          not calc_expr_info_uses_name(&item->info, changed_name))
+        continue;
+
+      calc_expr_info_reset(&item->info);
+      if (item->type is CALC_EXPR_VARIABLE)
+        vec_str_t_push(&changed, str_borrow(&item->variable_name));
+      else if (item->type is CALC_EXPR_FUNCTION)
+        vec_str_t_push(&changed, str_borrow(&item->function.name));
+    }
+  }
+
+  vec_str_t_free(changed);
+}
+
+bool calc_backend_is_func_const_sslice(const CalcBackend* this, StrSlice name) {
+  if (calculator_get_native_function(name)) return true;
+
+  CalcBackend* scope = null;
+  CalcExpr* expr = calc_backend_find_function((CalcBackend*)this, name, &scope);
+  return expr and calc_backend_def_is_const(scope, expr);
+}
+
 bool calc_backend_is_func_const_ptr(const CalcBackend* this, CalcExpr* expr) {
   assert_m(expr->type is CALC_EXPR_FUNCTION);
   if (expr) {
@@ -225,19 +347,11 @@ bool calc_backend_is_func_const_ptr(const CalcBackend* this, CalcExpr* expr) {
 }
 
 bool calc_backend_is_var_const_sslice(const CalcBackend* this, StrSlice name) {
-  if (calc_backend_get_value_sslice((CalcBackend*)this, name)) {
-    return true;
-  } else {
-    CalcExpr* expr = calc_backend_get_variable_sslice((CalcBackend*)this, name);
-    if (expr) {
-      ExprContext ctx =
-          calc_backend_get_var_context_sslice((CalcBackend*)this, name);
-      assert_m(ctx.data);
-      return ctx.vtable->is_expr_const(ctx.data, &expr->expression);
-    } else {
-      return false;
-    }
-  }
+  if (calc_backend_get_value_sslice((CalcBackend*)this, name)) return true;
+
+  CalcBackend* scope = null;
+  CalcExpr* expr = calc_backend_find_variable((CalcBackend*)this, name, &scope);
+  return expr and calc_backend_def_is_const(scope, expr);
 }
 
 bool calc_backend_is_var_const_ptr(const CalcBackend* this, CalcExpr* expr) {
@@ -261,46 +375,53 @@ CalcExpr* calc_backend_get_variable(CalcBackend* this, const char* name) {
   return calc_backend_get_variable_sslice(this, str_slice_from_string(name));
 }
 
-CalcValue* calc_backend_get_value_sslice(CalcBackend* this, StrSlice name) {
-  for (int i = 0; i < this->values.length; i++)
-    if (str_slice_eq_ccp(name, this->values.data[i].name.string))
-      return &this->values.data[i];
-
-  if (this->parent)
-    return calc_backend_get_value_sslice(this->parent, name);
-  else
-    return null;
+static CalcSymbol calc_backend_find_local(CalcBackend* this, StrSlice name) {
+  return calc_symbols_lookup(&this->symbols, &this->values, &this->expressions,
+                             name);
 }
 
-CalcExpr* calc_backend_get_function_sslice(CalcBackend* this, StrSlice name) {
-  for (int i = 0; i < this->values.length; i++)
-    if (str_slice_eq_ccp(name, this->values.data[i].name.string)) return null;
-
-  for (int i = 0; i < this->expressions.length; i++) {
-    CalcExpr* item = &this->expressions.data[i];
+CalcValue* calc_backend_get_value_sslice(CalcBackend* this, StrSlice name) {
+  for (; this; this = this->parent) {
+    CalcSymbol symbol = calc_backend_find_local(this, name);
+    if (symbol.value >= 0) return &this->values.data[symbol.value];
+  }
+  return null;
+}
+
+static CalcExpr* calc_backend_find_function(CalcBackend* this, StrSlice name,
+                                            CalcBackend** scope) {
+  for (; this; this = this->parent) {
+    CalcSymbol symbol = calc_backend_find_local(this, name);
+    // Values (like function arguments) shadow functions
+    if (symbol.value >= 0) return null;
+    if (symbol.function >= 0) {
+      (*scope) = this;
+      return &this->expressions.data[symbol.function];
+    }
+  }
+  return null;
+}
 
-    if (item->type is CALC_EXPR_FUNCTION and
-        str_slice_eq_ccp(name, item->function.name.string))
-      return item;
+static CalcExpr* calc_backend_find_variable(CalcBackend* this, StrSlice name,
+                                            CalcBackend** scope) {
+  for (; this; this = this->parent) {
+    CalcSymbol symbol = calc_backend_find_local(this, name);
+    if (symbol.variable >= 0) {
+      (*scope) = this;
+      return &this->expressions.data[symbol.variable];
+    }
   }
+  return null;
+}
 
-  if (this->parent)
-    return calc_backend_get_function_sslice(this->parent, name);
-  else
-    return null;
+CalcExpr* calc_backend_get_function_sslice(CalcBackend* this, StrSlice name) {
+  CalcBackend* scope = null;
+  return calc_backend_find_function(this, name, &scope);
 }
-CalcExpr* calc_backend_get_variable_sslice(CalcBackend* this, StrSlice name) {
-  for (int i = 0; i < this->expressions.length; i++) {
-    CalcExpr* item = &this->expressions.data[i];
 
-    if (item->type is CALC_EXPR_VARIABLE and
-        str_slice_eq_ccp(name, item->variable_name.string))
-      return item;
-  }
-  if (this->parent)
-    return calc_backend_get_variable_sslice(this->parent, name);
-  else
-    return null;
+CalcExpr* calc_backend_get_variable_sslice(CalcBackend* this, StrSlice name) {
+  CalcBackend* scope = null;
+  return calc_backend_find_variable(this, name, &scope);
 }
 
 CalcExpr* calc_backend_last_expr(CalcBackend* this) {
@@ -322,21 +443,12 @@ ExprContext calc_backend_get_var_context(CalcBackend* this,
 
 ExprContext calc_backend_get_var_context_sslice(CalcBackend* this,
                                                 StrSlice var_name) {
-  for (int i = 0; i < this->values.length; i++)
-    if (str_slice_eq_ccp(var_name, this->values.data[i].name.string))
-      return calc_backend_get_context(this);
-
-  for (int i = 0; i < this->expressions.length; i++) {
-    CalcExpr* item = &this->expressions.data[i];
-    if (item->type is CALC_EXPR_VARIABLE and
-        str_slice_eq_ccp(var_name, item->variable_name.string))
+  for (; this; this = this->parent) {
+    CalcSymbol symbol = calc_backend_find_local(this, var_name);
+    if (symbol.value >= 0 or symbol.variable >= 0)
       return calc_backend_get_context(this);
   }
-
-  if (this->parent)
-    return calc_backend_get_var_context_sslice(this->parent, var_name);
-  else
-    return calc_backend_get_context(null);
+  return calc_backend_get_context(null);
 }
 
 ExprContext calc_backend_get_fun_context(CalcBackend* this,
@@ -346,17 +458,122 @@ ExprContext calc_backend_get_fun_context(CalcBackend* this,
 }
 ExprContext calc_backend_get_fun_context_sslice(CalcBackend* this,
                                                 StrSlice fun_name) {
+  for (; this; this = this->parent) {
+    CalcSymbol symbol = calc_backend_find_local(this, fun_name);
+    if (symbol.function >= 0) return calc_backend_get_context(this);
+  }
+  return calc_backend_get_context(null);
+}
+
+// =====
+// =
+// = Frames
+// =
+// =====
+
+// Scopes of the user function calls in progress: a backend with pi, e and
+// then the arguments of the call. Frames are kept between calls with their
+// vectors, so only the first call that goes this deep allocates
+typedef struct CalcFrame {
+  CalcBackend backend;
+  struct CalcFrame* next;  // While on the free list
+} CalcFrame;
+
+static CalcFrame* free_frames = null;
+
+// Arguments are moved into the frame, extra ones are dropped
+static CalcFrame* calc_frame_take(CalcBackend* parent, const vec_str_t* names,
+                                  vec_ExprValue* args) {
+  CalcFrame* frame = free_frames;
+  bool grows = not frame or frame->backend.values.length + names->length >
+                                frame->backend.values.capacity;
+
+  // Frames outlive the arena scope of the call that needs them first
+  if (grows) my_arena_pause();
+  if (frame) {
+    free_frames = frame->next;
+  } else {
+    frame = (CalcFrame*)MALLOC(sizeof(CalcFrame));
+    assert_alloc(frame);
+    frame->backend = calc_backend_create();
+  }
+
+  for (int i = 0; i < names->length; i++) {
+    CalcValue arg = {
+        .name = str_borrow(&names->data[i]),
+        .value = i < args->length ? args->data[i]
+                                  : (ExprValue){.type = EXPR_VALUE_NONE},
+    };
+    vec_CalcValue_push(&frame->backend.values, arg);
+  }
+  if (grows) my_arena_resume();
+
+  for (int i = names->length; i < args->length; i++)
+    expr_value_free(args->data[i]);
+  args->length = 0;
+
+  frame->backend.parent = parent;
+  return frame;
+}
+
+static void calc_frame_give_back(CalcFrame* frame, int args_count) {
+  vec_CalcValue* values = &frame->backend.values;
+  for (int i = values->length - args_count; i < values->length; i++)
+    expr_value_free(values->data[i].value);
+  values->length -= args_count;
+  // Names of the next call differ, the index has to forget these
+  if (frame->backend.symbols.table)
+    calc_symbols_sync(&frame->backend.symbols, values,
+                      &frame->backend.expressions);
+
+  frame->backend.parent = null;
+  frame->next = free_frames;
+  free_frames = frame;
+}
+
+void calc_backend_frames_free() {
+  while (free_frames) {
+    CalcFrame* frame = free_frames;
+    free_frames = frame->next;
+    calc_backend_free(frame->backend);
+    FREE(frame);
+  }
+}
+
+// =====
+// =
+// = Remembered results
+// =
+// =====
+void calc_backend_set_memo_capacity(CalcBackend* this, int capacity) {
+  assert_m(capacity >= 0);
+  this->memo_capacity = capacity;
+
+  // Tables of the old capacity are made again on the next call
   for (int i = 0; i < this->expressions.length; i++) {
-    CalcExpr* item = &this->expressions.data[i];
-    if (item->type is CALC_EXPR_FUNCTION and
-        str_slice_eq_ccp(fun_name, item->function.name.string))
-      return calc_backend_get_context(this);
+    CalcExprInfo* info = &this->expressions.data[i].info;
+    calc_memo_free(info->memo);
+    info->memo = null;
   }
+}
 
-  if (this->parent)
-    return calc_backend_get_fun_context_sslice(this->parent, fun_name);
-  else
-    return calc_backend_get_context(null);
+CalcMemoStats calc_backend_memo_stats(CalcBackend* this, StrSlice fun_name) {
+  CalcExpr* def = calc_backend_get_function_sslice(this, fun_name);
+  return calc_memo_stats(def ? def->info.memo : null);
+}
+
+// The table for a call of `def` from `this`, or null if the call may not
+// use one. Names a function body does not define are looked up through its
+// callers, so only calls right from the defining scope always agree
+static CalcMemo* calc_backend_call_memo(CalcBackend* this, CalcBackend* scope,
+                                        CalcExpr* def) {
+  if (scope->memo_capacity is 0 or this is_not scope or
+      not calc_backend_def_is_const(scope, def))
+    return null;
+
+  if (not def->info.memo)
+    def->info.memo = calc_memo_create(scope->memo_capacity);
+  return def->info.memo;
 }
 
 // =====
@@ -364,35 +581,62 @@ ExprContext calc_backend_get_fun_context_sslice(CalcBackend* this,
 // = CALL_FUNCTION
 // =
 // =====
+// Takes the arguments
+static ExprValueResult calc_backend_run_function(CalcBackend* this,
+                                                 CalcExpr* def,
+                                                 vec_ExprValue* args) {
+  const vec_str_t* names = &def->function.args;
+  CalcFrame* frame = calc_frame_take(this, names, args);
+
+  ExprValueResult result = expr_calculate(
+      &def->expression, calc_backend_get_context(&frame->backend));
+
+  calc_frame_give_back(frame, names->length);
+  return result;
+}
 
 ExprValueResult calc_backend_call_function(CalcBackend* this, StrSlice fun_name,
-                                           vec_ExprValue* args_values) {
+                                           vec_ExprValue args_values) {
   // 1. NATIVE
   const NativeFnPtr native_fn = calculator_get_native_function(fun_name);
-  if (native_fn) return native_fn(vec_ExprValue_clone(args_values));
+  if (native_fn) return native_fn(args_values);
 
-  CalcExpr* fn_calc_expr = calc_backend_get_function_sslice(this, fun_name);
+  CalcBackend* scope = null;
+  CalcExpr* fn_calc_expr = calc_backend_find_function(this, fun_name, &scope);
   ExprValueResult result;
 
   if (fn_calc_expr) {
-    // 2. Build local backend for function
-    CalcBackend nested_backend = calc_backend_create();
-    nested_backend.parent = this;
-
-    for (int i = 0; i < fn_calc_expr->function.args.length; i++) {
-      CalcValue arg = {
-          .name = str_borrow(&fn_calc_expr->function.args.data[i]),
-          .value = i < args_values->length
-                       ? expr_value_clone(&args_values->data[i])
-                       : (ExprValue){.type = EXPR_VALUE_NONE},
-      };
-      vec_CalcValue_push(&nested_backend.values, arg);
+    // A range is passed whole, see expr_value_into_args
+    if (args_values.length is 1 and
+        args_values.data[0].type is EXPR_VALUE_VEC and
+        args_values.data[0].vec.kind is EXPR_VEC_RANGE) {
+      ExprVec range = args_values.data[0].vec;
+      if (not expr_vec_can_store(range.length)) {
+        vec_ExprValue_free(args_values);
+        return expr_vec_too_long(range.length);
+      }
+      args_values.length = 0;
+      vec_ExprValue_free(args_values);
+      args_values = expr_vec_into_values(range);
     }
 
-    result = expr_calculate(&fn_calc_expr->expression,
-                            calc_backend_get_context(&nested_backend));
-
-    calc_backend_free(nested_backend);
+    // 2. A result remembered for these arguments
+    CalcMemo* memo = calc_backend_call_memo(this, scope, fn_calc_expr);
+    const ExprValueResult* known =
+        memo ? calc_memo_find(memo, &args_values) : null;
+
+    // 3. Or a frame for the call
+    if (known) {
+      result = expr_value_result_clone(known);
+    } else if (memo) {
+      // The frame takes the arguments, the table needs them afterwards
+      vec_ExprValue key = vec_ExprValue_clone(&args_values);
+      result = calc_backend_run_function(this, fn_calc_expr, &args_values);
+      calc_memo_store(memo, &key, &result);
+      vec_ExprValue_free(key);
+    } else {
+      result = calc_backend_run_function(this, fn_calc_expr, &args_values);
+    }
   } else {
     result = ExprValueErr(
         null,
@@ -400,6 +644,7 @@ ExprValueResult calc_backend_call_function(CalcBackend* this, StrSlice fun_name,
                   fun_name));
   }
 
+  vec_ExprValue_free(args_values);
   return result;
 }
 
@@ -408,7 +653,8 @@ ExprValueResult calc_backend_call_function(CalcBackend* this, StrSlice fun_name,
 // = GET TYPE
 // =
 // =====
-int calc_backend_get_expr_type(const CalcBackend* this, const Expr* expr) {
+static int calc_backend_calculate_type(const CalcBackend* this,
+                                       const Expr* expr) {
   int result = VALUE_TYPE_UNKNOWN;
 
   if (calc_backend_is_expr_const(this, expr)) {
@@ -426,6 +672,32 @@ int calc_backend_get_expr_type(const CalcBackend* this, const Expr* expr) {
 
   return result;
 }
+
+int calc_backend_get_expr_type(const CalcBackend* this, const Expr* expr) {
+  if (expr->type is_not EXPR_VARIABLE)
+    return calc_backend_calculate_type(this, expr);
+
+  StrSlice name = expr_symbol_slice(expr->variable.name);
+  CalcValue* value = calc_backend_get_value_sslice((CalcBackend*)this, name);
+  if (value) return value->value.type;
+
+  CalcBackend* scope = null;
+  CalcExpr* def = calc_backend_find_variable((CalcBackend*)this, name, &scope);
+  if (not def) return VALUE_TYPE_UNKNOWN;
+
+  if (not def->info.has_type) {
+    // Constness first: it fills `free_names`, so the type is invalidated too
+    if (calc_backend_def_is_const(scope, def)) {
+      const ExprValueResult* value = calc_backend_def_value(scope, def);
+      def->info.value_type = value->is_ok ? value->ok.type : VALUE_TYPE_UNKNOWN;
+    } else {
+      def->info.value_type =
+          calc_backend_calculate_type(scope, &def->expression);
+    }
+    def->info.has_type = true;
+  }
+  return def->info.value_type;
+}
 /*
   // Parsing
   bool (*is_variable)(void* this, StrSlice var_name);
@@ -433,7 +705,8 @@ int calc_backend_get_expr_type(const CalcBackend* this, const Expr* expr) {
 
   // Computation
   ExprValueResult (*get_variable_val)(void*, StrSlice);
-  ExprValueResult (*call_function)(void*, StrSlice, vec_ExprValue*);
+  const ExprValue* (*get_variable_ref)(void*, StrSlice);
+  ExprValueResult (*call_function)(void*, StrSlice, vec_ExprValue);
 
   // Anasysis and compilation
   bool (*is_expr_const)(void* this, const Expr* expr);
@@ -447,6 +720,7 @@ static bool cb_is_variable(CalcBackend* this, StrSlice var_name);
 static bool cb_is_function(CalcBackend* this, StrSlice fun_name);
 
 static ExprValueResult cb_get_variable_val(CalcBackend*, StrSlice);
+static const ExprValue* cb_get_variable_ref(CalcBackend*, StrSlice);
 // calc_backend_call_function
 
 static int cb_get_expr_type(CalcBackend* this, const Expr* expr);
@@ -474,19 +748,18 @@ static ExprValueResult cb_get_variable_val(CalcBackend* this,
   if (val) {
     result = ExprValueOk(expr_value_clone(&val->value));
   } else {
-    CalcExpr* expr = calc_backend_get_variable_sslice(this, var_name);
+    CalcBackend* scope = null;
+    CalcExpr* expr = calc_backend_find_variable(this, var_name, &scope);
 
     if (expr) {
-      // calculate
-      if (calc_backend_is_var_const_sslice(this, var_name)) {
-        ExprContext ctx = calc_backend_get_var_context_sslice(this, var_name);
-        assert_m(ctx.data);
-        result = expr_calculate(&expr->expression, ctx);
+      // Calculated once, until something it uses is redefined
+      if (calc_backend_def_is_const(scope, expr)) {
+        result = expr_value_result_clone(calc_backend_def_value(scope, expr));
       } else {
         result = ExprValueErr(
             null,
-            str_owned(
-                "Variable '%$slice' is not const and cannot be calculated"));
+            str_owned("Variable '%$slice' is not const and cannot be calculated",
+                      var_name));
       }
     } else {
       result = ExprValueErr(
@@ -496,6 +769,19 @@ static ExprValueResult cb_get_variable_val(CalcBackend* this,
 
   return result;
 }
+
+static const ExprValue* cb_get_variable_ref(CalcBackend* this,
+                                            StrSlice var_name) {
+  CalcValue* val = calc_backend_get_value_sslice(this, var_name);
+  if (val) return &val->value;
+
+  CalcBackend* scope = null;
+  CalcExpr* expr = calc_backend_find_variable(this, var_name, &scope);
+  if (not expr or not calc_backend_def_is_const(scope, expr)) return null;
+
+  const ExprValueResult* value = calc_backend_def_value(scope, expr);
+  return value->is_ok ? &value->ok : null;
+}
 // calc_backend_call_function
 
 static int cb_get_expr_type(CalcBackend* this, const Expr* expr) {
@@ -508,6 +794,7 @@ ExprContext calc_backend_get_context(CalcBackend* this) {
       .is_function = (void*)cb_is_function,
 
       .get_variable_val = (void*)cb_get_variable_val,
+      .get_variable_ref = (void*)cb_get_variable_ref,
       .call_function = (void*)calc_backend_call_function,
 
       .is_expr_const = (void*)calc_backend_is_expr_const,
@@ -547,11 +834,22 @@ ExprVariableInfo cb_get_variable_info(CalcBackend* this, StrSlice var_name) {
     }
   }
 
+  const ExprValue* value = val ? &val->value : null;
+  bool is_const = val or calc_backend_is_var_const_sslice(this, var_name);
+
+  if (not val and is_const) {
+    // Hand out the cached value, so callers do not calculate it again
+    CalcBackend* scope = null;
+    CalcExpr* def = calc_backend_find_variable(this, var_name, &scope);
+    const ExprValueResult* cached = calc_backend_def_value(scope, def);
+    if (cached->is_ok) value = &cached->ok;
+  }
+
   ExprVariableInfo result = {
       .expression = expr ? &expr->expression : null,
-      .value = val ? &val->value : null,
-      .is_const = val or calc_backend_is_var_const_sslice(this, var_name),
-      .value_type = VALUE_TYPE_UNKNOWN,
+      .value = value,
+      .is_const = is_const,
+      .value_type = value ? value->type : VALUE_TYPE_UNKNOWN,
       .correct_context = ctx,
   };
   return result;
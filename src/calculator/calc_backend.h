@@ -3,14 +3,19 @@
 
 #include "../util/better_io.h"
 #include "calc_expr.h"
+#include "calc_memo.h"
+#include "calc_symbols.h"
 #include "calc_value.h"
 
+// Temporaries live in an arena, see util/allocator.h
 ExprValueResult calc_calculate_expr(const char* text, double x, double y);
 
 typedef struct CalcBackend {
   struct CalcBackend* parent;
   vec_CalcExpr expressions;
   vec_CalcValue values;
+  CalcSymbols symbols;  // Index of `values` and `expressions` names
+  int memo_capacity;    // Per const function, 0 if results are not kept
 } CalcBackend;
 
 void calc_backend_free(CalcBackend);
@@ -18,11 +23,32 @@ CalcBackend calc_backend_clone(const CalcBackend*);
 CalcBackend calc_backend_create();
 
 ExprContext calc_backend_get_context(CalcBackend*);
+// expr_calculate with temporaries in an arena, released all at once
+ExprValueResult calc_backend_calculate(CalcBackend* this, const Expr* expr);
 
 str_t calc_backend_add_expr(CalcBackend* this, const char* text);
+// Text that calc_backend_add_expr reports for a parsed `expr`. The value of
+// a const variable is kept in its info
+str_t calc_backend_describe_expr(CalcBackend* this, CalcExpr* expr);
+// Appends an already parsed expression, taking ownership
+void calc_backend_push_expr(CalcBackend* this, CalcExpr expr);
+// Drops cached analysis of everything that depends on `name`
+void calc_backend_invalidate_name(CalcBackend* this, StrSlice name);
 
 bool calc_backend_is_expr_const(const CalcBackend* this, const Expr* expr);
 
+// Scopes kept for user function calls, see calc_backend_call_function
+void calc_backend_frames_free();
+
+// Keeps up to `capacity` results of every const function defined here, see
+// calc_memo.h. Only calls made right from this backend use them: inside
+// another function a call may see names of its callers. Tables are dropped
+// along with the rest of the info of a function when it or something it
+// uses is redefined. 0 turns it off
+void calc_backend_set_memo_capacity(CalcBackend* this, int capacity);
+// Zeros if the function keeps no results (yet)
+CalcMemoStats calc_backend_memo_stats(CalcBackend* this, StrSlice fun_name);
+
 bool calc_backend_is_func_const(const CalcBackend* this, const char* name);
 bool calc_backend_is_var_const(const CalcBackend* this, const char* name);
 bool calc_backend_is_func_const_sslice(const CalcBackend* this, StrSlice name);
@@ -51,8 +77,9 @@ ExprContext calc_backend_get_fun_context_sslice(CalcBackend* this,
 CalcExpr* calc_backend_last_expr(CalcBackend* this);
 int calc_backend_get_expr_type(const CalcBackend* this, const Expr* expr);
 
+// Takes ownership of the arguments
 ExprValueResult calc_backend_call_function(CalcBackend* this, StrSlice fun_name,
-                                           vec_ExprValue* args_values);
+                                           vec_ExprValue args_values);
 
 #define VECTOR_H CalcBackend
 #include "../util/vector.h"
@@ -10,37 +10,14 @@ str_t calc_backend_add_expr(CalcBackend* this, const char* text) {
   CalcExprResult res = calc_expr_parse(ctx, text);
   // debugln("Parsed : %d", res.is_ok);
 
-  str_t message = str_literal("");
+  str_t message;
   if (res.is_ok) {
-    // message = str_owned("Ok (%s)", );
-    int type = res.ok.type;
-    const char* type_text = calc_expr_type_text(type);
-
-    if ((type is CALC_EXPR_VARIABLE or type is CALC_EXPR_PLOT) and
-        calc_backend_is_expr_const(this, &res.ok.expression)) {
-      ExprContext ctx = calc_backend_get_context(this);
-      ExprValueResult val_res = expr_calculate(&res.ok.expression, ctx);
-      if (val_res.is_ok) {
-        message = str_owned("%$expr_value", val_res.ok);
-        expr_value_free(val_res.ok);
-      } else {
-        message = str_owned("Err: %s", val_res.err_text.string);
-        str_free(val_res.err_text);
-      }
-    } else if (type is CALC_EXPR_FUNCTION and
-               calc_backend_is_func_const_ptr(this, &res.ok)) {
-      message = str_owned("Const function");
-    }
-
-    if (strlen(message.string) is 0) {
-      str_free(message);
-      message = str_owned("%s", type_text);
-    }
-    vec_CalcExpr_push(&this->expressions, res.ok);
+    message = calc_backend_describe_expr(this, &res.ok);
+    calc_backend_push_expr(this, res.ok);
   } else {
-    str_free(message);
     if (res.err_pos) {
-      message = str_owned("Err (at '%.10s'): %s", res.err_pos, res.err_text);
+      message = str_owned("Err (at '%.10s'): %s", res.err_pos,
+                          res.err_text.string);
     } else {
       message = str_owned("Err: %s", res.err_text.string);
     }
@@ -48,4 +25,48 @@ str_t calc_backend_add_expr(CalcBackend* this, const char* text) {
   }
 
   return message;
-}
\ No newline at end of file
+}
+
+str_t calc_backend_describe_expr(CalcBackend* this, CalcExpr* expr) {
+  int type = expr->type;
+  str_t message = str_literal("");
+
+  if ((type is CALC_EXPR_VARIABLE or type is CALC_EXPR_PLOT) and
+      calc_backend_is_expr_const(this, &expr->expression)) {
+    ExprValueResult val_res = calc_backend_calculate(this, &expr->expression);
+    if (val_res.is_ok)
+      message = str_owned("%$expr_value", val_res.ok);
+    else
+      message = str_owned("Err: %s", val_res.err_text.string);
+
+    // Const before being added is const after it too, so keep the value
+    if (type is CALC_EXPR_VARIABLE)
+      calc_expr_info_set_value(expr, val_res);
+    else if (val_res.is_ok)
+      expr_value_free(val_res.ok);
+    else
+      str_free(val_res.err_text);
+  } else if (type is CALC_EXPR_FUNCTION and
+             calc_backend_is_func_const_ptr(this, expr)) {
+    message = str_owned("Const function");
+  }
+
+  if (strlen(message.string) is 0) {
+    str_free(message);
+    message = str_owned("%s", calc_expr_type_text(type));
+  }
+  return message;
+}
+
+void calc_backend_push_expr(CalcBackend* this, CalcExpr expr) {
+  vec_CalcExpr_push(&this->expressions, expr);
+  calc_symbols_sync(&this->symbols, &this->values, &this->expressions);
+
+  CalcExpr* added = calc_backend_last_expr(this);
+  if (added->type is CALC_EXPR_VARIABLE)
+    calc_backend_invalidate_name(this,
+                                 str_slice_from_str_t(&added->variable_name));
+  else if (added->type is CALC_EXPR_FUNCTION)
+    calc_backend_invalidate_name(this,
+                                 str_slice_from_str_t(&added->function.name));
+}
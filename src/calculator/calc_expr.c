@@ -1,8 +1,11 @@
 #include "calc_expr.h"
 
+#include <string.h>
+
 #include "../util/allocator.h"
 #include "../util/common_vecs.h"
 #include "../util/prettify_c.h"
+#include "calc_memo.h"
 
 #define VECTOR_C CalcExpr
 #define VECTOR_ITEM_DESTRUCTOR calc_expr_free
@@ -11,6 +14,7 @@
 
 void calc_expr_free(CalcExpr this) {
   expr_free(this.expression);
+  calc_expr_info_reset(&this.info);
 
   if (this.type is CALC_EXPR_VARIABLE) {
     str_free(this.variable_name);
@@ -29,6 +33,7 @@ void calc_expr_free(CalcExpr this) {
 }
 
 CalcExpr calc_expr_clone(const CalcExpr* source) {
+  // Info borrows from the source expression, so the clone starts unknown
   CalcExpr result = {
       .type = source->type,
       .expression = expr_clone(&source->expression),
@@ -80,3 +85,78 @@ void calc_expr_print(const CalcExpr* this, OutStream stream) {
 
   x_sprintf(stream, "(%$expr)", this->expression);
 }
+
+// =====
+// =
+// = CalcExprInfo
+// =
+// =====
+void calc_expr_info_reset(CalcExprInfo* this) {
+  vec_str_t_free(this->free_names);
+  if (this->has_value and this->value.is_ok)
+    expr_value_free(this->value.ok);
+  else if (this->has_value)
+    str_free(this->value.err_text);
+  calc_memo_free(this->memo);
+
+  (*this) = (CalcExprInfo){.state = CALC_EXPR_INFO_UNKNOWN};
+}
+
+// All the names are interned texts, equal names are equal pointers
+static void push_free_name(vec_str_t* names, ExprSymbol name) {
+  const char* text = expr_symbol_text(name);
+  for (int i = 0; i < names->length; i++)
+    if (names->data[i].string is text) return;
+
+  vec_str_t_push(names, str_literal(text));
+}
+
+static void collect_names(const Expr* expr, vec_str_t* names) {
+  if (expr->type is EXPR_NUMBER) {
+    // nothing
+  } else if (expr->type is EXPR_VARIABLE) {
+    push_free_name(names, expr->variable.name);
+  } else if (expr->type is EXPR_FUNCTION) {
+    push_free_name(names, expr->function.name);
+    collect_names(expr->function.argument, names);
+  } else if (expr->type is EXPR_VECTOR) {
+    for (int i = 0; i < expr->vector.arguments.length; i++)
+      collect_names(&expr->vector.arguments.data[i], names);
+  } else if (expr->type is EXPR_BINARY_OP) {
+    collect_names(expr->binary_operator.lhs, names);
+    collect_names(expr->binary_operator.rhs, names);
+  } else {
+    panic("Unknown Expr type: %d", expr->type);
+  }
+}
+
+void calc_expr_collect_names(const CalcExpr* this, vec_str_t* names) {
+  collect_names(&this->expression, names);
+}
+
+// Function arguments are collected too: they only make invalidation a bit
+// more eager, never miss one
+void calc_expr_info_collect_names(CalcExpr* this) {
+  vec_str_t_free(this->info.free_names);
+  this->info.free_names = vec_str_t_create();
+  calc_expr_collect_names(this, &this->info.free_names);
+}
+
+void calc_expr_info_set_value(CalcExpr* this, ExprValueResult value) {
+  assert_m(this->type is CALC_EXPR_VARIABLE);
+  calc_expr_info_reset(&this->info);
+
+  this->info.state = CALC_EXPR_INFO_CONST;
+  calc_expr_info_collect_names(this);
+  this->info.has_value = true;
+  this->info.value = value;
+  this->info.has_type = true;
+  this->info.value_type = value.is_ok ? value.ok.type : VALUE_TYPE_UNKNOWN;
+}
+
+bool calc_expr_info_uses_name(const CalcExprInfo* this, StrSlice name) {
+  for (int i = 0; i < this->free_names.length; i++)
+    if (str_slice_eq_ccp(name, this->free_names.data[i].string)) return true;
+
+  return false;
+}
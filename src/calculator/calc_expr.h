@@ -9,8 +9,27 @@
 #define CALC_EXPR_PLOT 22      // just expression
 #define CALC_EXPR_ACTION 23
 
+// Analysis of a definition that CalcBackend computes once and keeps until one
+// of `free_names` gets (re)defined. Zero-initialized info is "unknown"
+#define CALC_EXPR_INFO_UNKNOWN 0
+#define CALC_EXPR_INFO_IN_PROGRESS 1  // Met again while analyzing - a cycle
+#define CALC_EXPR_INFO_CONST 2
+#define CALC_EXPR_INFO_NOT_CONST 3
+
+typedef struct CalcExprInfo {
+  int state;
+  bool has_type;
+  int value_type;
+  bool has_value;
+  ExprValueResult value;  // Of a const variable, cloned out on every read
+  vec_str_t free_names;   // Borrowed from the expression
+  // Results of a const function, if its backend remembers them
+  struct CalcMemo* memo;
+} CalcExprInfo;
+
 typedef struct CalcExpr {
   Expr expression;
+  CalcExprInfo info;
   int type;
   union {
     str_t variable_name;
@@ -46,6 +65,15 @@ CalcExpr calc_expr_clone(const CalcExpr* source);
 const char* calc_expr_type_text(int type);
 void calc_expr_print(const CalcExpr* this, OutStream stream);
 
+// Pushes every name the expression uses once, borrowed from it
+void calc_expr_collect_names(const CalcExpr* this, vec_str_t* names);
+
+void calc_expr_info_reset(CalcExprInfo* this);
+void calc_expr_info_collect_names(CalcExpr* this);
+// Records `value` (taking ownership) as the value of a const variable
+void calc_expr_info_set_value(CalcExpr* this, ExprValueResult value);
+bool calc_expr_info_uses_name(const CalcExprInfo* this, StrSlice name);
+
 CalcExprResult calc_expr_parse(ExprContext ctx, const char* text);
 CalcExprResult calc_expr_parse_tt(ExprContext ctx, TokenTree tree);
 
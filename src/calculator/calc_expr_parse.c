@@ -1,10 +1,8 @@
-#include <stdint.h>
-
 #include "../util/allocator.h"
-#include "../util/common_vecs.h"
 #include "../util/prettify_c.h"
 #include "calc_backend.h"
 #include "calc_expr.h"
+#include "calc_parse_cache.h"
 #include "func_const_ctx.h"
 
 static bool is_action(TokenTree* tree);
@@ -16,24 +14,37 @@ static CalcExprResult parse_variable(ExprContext ctx, TokenTree tree);
 static CalcExprResult parse_function(ExprContext ctx, TokenTree tree);
 static CalcExprResult parse_plot(ExprContext ctx, TokenTree tree);
 
-#define ASCII_MAX 127
-bool vec_char_contains(vec_char* this, char item);
-static str_t check_forbidden_symbols(const char* text);
-
-CalcExprResult calc_expr_parse(ExprContext ctx, const char* text) {
-  str_t forbidden = check_forbidden_symbols(text);
-  if (strlen(forbidden.string) > 0) return CalcExprErr(null, forbidden);
-  str_free(forbidden);
-
+static CalcExprResult parse_uncached(ExprContext ctx, const char* text) {
   TtContext tt_ctx = {
       .data = ctx.data,
       .is_function = ctx.vtable->is_function,
+      .check_symbols = true,
   };
+
+  // Tokens and trees are temporaries, only the result is copied out
+  static MyArena arena = MY_ARENA_INIT;
+  my_arena_begin(&arena);
+
+  CalcExprResult result;
   TokenTreeResult res = token_tree_parse(text, tt_ctx);
   // debugln("Got token tree: %$token_tree", res.ok);
+  if (not res.is_ok)
+    result = CalcExprErr(res.err.text_pos, res.err.text);
+  else
+    result = calc_expr_parse_tt(ctx, res.ok);
 
-  if (not res.is_ok) return CalcExprErr(res.err.text_pos, res.err.text);
-  return calc_expr_parse_tt(ctx, res.ok);
+  my_arena_end(&arena);
+  if (result.is_ok)
+    result.ok = calc_expr_clone(&result.ok);
+  else
+    result.err_text = str_clone(&result.err_text);
+  my_arena_reset(&arena);
+
+  return result;
+}
+
+CalcExprResult calc_expr_parse(ExprContext ctx, const char* text) {
+  return calc_parse_cache_parse(parse_uncached, ctx, text);
 }
 
 CalcExprResult calc_expr_parse_tt(ExprContext ctx, TokenTree tree) {
@@ -51,30 +62,6 @@ CalcExprResult calc_expr_parse_tt(ExprContext ctx, TokenTree tree) {
   return result;
 }
 
-static str_t check_forbidden_symbols(const char* text) {
-  vec_char forbidden_chars = vec_char_create();
-  for (int i = 0; text[i] != '\0'; i++)
-    if (not tk_is_symbol_allowed(text[i]) and
-        not vec_char_contains(&forbidden_chars, text[i]))
-      vec_char_push(&forbidden_chars,
-                    (uint8_t)text[i] > (uint8_t)ASCII_MAX ? '?' : text[i]);
-
-  str_t result = str_literal("");
-  if (forbidden_chars.length > 0) {
-    result = str_owned("Forbidden symbols: %.*s", forbidden_chars.length,
-                       forbidden_chars.data);
-  }
-  vec_char_free(forbidden_chars);
-  return result;
-}
-
-bool vec_char_contains(vec_char* this, char item) {
-  for (int i = 0; i < this->length; i++)
-    if (this->data[i] == item) return true;
-
-  return false;
-}
-
 // =====
 
 static bool is_action_operator(StrSlice op_text);
@@ -0,0 +1,165 @@
+#include "calc_memo.h"
+
+#include "../util/allocator.h"
+#include "../util/prettify_c.h"
+
+// =====
+// =
+// = Helpers
+// =
+// =====
+static uint32_t args_hash(const vec_ExprValue* args) {
+  uint32_t hash = 2166136261u ^ (uint32_t)args->length;
+  for (int i = 0; i < args->length; i++)
+    hash = (hash * 16777619u) ^ expr_value_hash(&args->data[i]);
+  return hash;
+}
+
+static bool are_args_equal(const vec_ExprValue* a, const vec_ExprValue* b) {
+  if (a->length is_not b->length) return false;
+  for (int i = 0; i < a->length; i++)
+    if (not expr_value_equal(&a->data[i], &b->data[i])) return false;
+  return true;
+}
+
+static int* bucket_of(CalcMemo* this, uint32_t hash) {
+  return &this->buckets[hash & (this->buckets_count - 1)];
+}
+
+// -- Use order
+
+static void unlink_used(CalcMemo* this, int index) {
+  CalcMemoEntry* entry = &this->entries[index];
+  if (entry->newer >= 0)
+    this->entries[entry->newer].older = entry->older;
+  else
+    this->newest = entry->older;
+  if (entry->older >= 0)
+    this->entries[entry->older].newer = entry->newer;
+  else
+    this->oldest = entry->newer;
+}
+
+static void link_newest(CalcMemo* this, int index) {
+  CalcMemoEntry* entry = &this->entries[index];
+  entry->newer = -1;
+  entry->older = this->newest;
+  if (this->newest >= 0) this->entries[this->newest].newer = index;
+  this->newest = index;
+  if (this->oldest < 0) this->oldest = index;
+}
+
+// -- Buckets
+
+static void unlink_bucket(CalcMemo* this, int index) {
+  int* link = bucket_of(this, this->entries[index].hash);
+  while (*link is_not index) link = &this->entries[*link].bucket_next;
+  *link = this->entries[index].bucket_next;
+}
+
+static void entry_free(CalcMemoEntry* entry) {
+  vec_ExprValue_free(entry->args);
+  expr_value_result_free(entry->result);
+}
+
+// =====
+// =
+// = CalcMemo
+// =
+// =====
+CalcMemo* calc_memo_create(int capacity) {
+  assert_m(capacity > 0);
+  // The table outlives any arena scope the caller is in
+  my_arena_pause();
+  CalcMemo* this = (CalcMemo*)MALLOC(sizeof(CalcMemo));
+  assert_alloc(this);
+
+  int buckets_count = 1;
+  while (buckets_count < capacity * 2) buckets_count *= 2;
+  *this = (CalcMemo){
+      .capacity = capacity,
+      .length = 0,
+      .entries = (CalcMemoEntry*)MALLOC(sizeof(CalcMemoEntry) * capacity),
+      .buckets = (int*)MALLOC(sizeof(int) * buckets_count),
+      .buckets_count = buckets_count,
+      .newest = -1,
+      .oldest = -1,
+  };
+  assert_alloc(this->entries);
+  assert_alloc(this->buckets);
+  my_arena_resume();
+
+  for (int i = 0; i < buckets_count; i++) this->buckets[i] = -1;
+  return this;
+}
+
+void calc_memo_free(CalcMemo* this) {
+  if (not this) return;
+
+  for (int i = 0; i < this->length; i++) entry_free(&this->entries[i]);
+  FREE(this->entries);
+  FREE(this->buckets);
+  FREE(this);
+}
+
+const ExprValueResult* calc_memo_find(CalcMemo* this,
+                                      const vec_ExprValue* args) {
+  uint32_t hash = args_hash(args);
+
+  for (int i = *bucket_of(this, hash); i >= 0;
+       i = this->entries[i].bucket_next) {
+    CalcMemoEntry* entry = &this->entries[i];
+    if (entry->hash is_not hash or not are_args_equal(&entry->args, args))
+      continue;
+
+    this->hits++;
+    unlink_used(this, i);
+    link_newest(this, i);
+    return &entry->result;
+  }
+
+  this->misses++;
+  return null;
+}
+
+void calc_memo_store(CalcMemo* this, const vec_ExprValue* args,
+                     const ExprValueResult* result) {
+  int index;
+  if (this->length < this->capacity) {
+    index = this->length++;
+  } else {
+    index = this->oldest;
+    unlink_used(this, index);
+    unlink_bucket(this, index);
+    entry_free(&this->entries[index]);
+  }
+
+  my_arena_pause();
+  vec_ExprValue args_copy = vec_ExprValue_with_capacity(args->length);
+  for (int i = 0; i < args->length; i++)
+    vec_ExprValue_push(&args_copy, expr_value_deep_clone(&args->data[i]));
+  ExprValueResult result_copy = expr_value_result_deep_clone(result);
+  // Positions point into texts the table does not keep
+  if (not result_copy.is_ok) result_copy.err_pos = null;
+  my_arena_resume();
+
+  uint32_t hash = args_hash(args);
+  int* bucket = bucket_of(this, hash);
+  this->entries[index] = (CalcMemoEntry){
+      .hash = hash,
+      .args = args_copy,
+      .result = result_copy,
+      .bucket_next = *bucket,
+  };
+  *bucket = index;
+  link_newest(this, index);
+}
+
+CalcMemoStats calc_memo_stats(const CalcMemo* this) {
+  if (not this) return (CalcMemoStats){0};
+  return (CalcMemoStats){
+      .hits = this->hits,
+      .misses = this->misses,
+      .length = this->length,
+  };
+}
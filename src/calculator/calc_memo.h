@@ -0,0 +1,60 @@
+#ifndef SRC_CALCULATOR_CALC_MEMO_H_
+#define SRC_CALCULATOR_CALC_MEMO_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../parser/expr_value.h"
+
+// Results of one const user function by its arguments. Entries are found by
+// the hash of the arguments and dropped least recently used first once the
+// table is full. The table lives outside of any arena scope: it keeps deep
+// copies of what it is given.
+//
+//   const ExprValueResult* known = calc_memo_find(memo, &args);
+//   if (not known) calc_memo_store(memo, &args, &result);
+
+// Entries of the tables CalcBackend makes, see calc_backend_set_memo_capacity
+#define CALC_MEMO_DEFAULT_CAPACITY 64
+
+typedef struct CalcMemoEntry {
+  uint32_t hash;
+  vec_ExprValue args;
+  ExprValueResult result;
+  int bucket_next;  // Next entry with the same bucket, -1 at the end
+  int newer;        // Use order, -1 at the ends
+  int older;
+} CalcMemoEntry;
+
+typedef struct CalcMemoStats {
+  size_t hits;
+  size_t misses;
+  int length;
+} CalcMemoStats;
+
+typedef struct CalcMemo {
+  int capacity;
+  int length;
+  CalcMemoEntry* entries;
+  int* buckets;  // First entry of each bucket, -1 if none
+  int buckets_count;
+  int newest;
+  int oldest;
+  size_t hits;
+  size_t misses;
+} CalcMemo;
+
+CalcMemo* calc_memo_create(int capacity);
+void calc_memo_free(CalcMemo* this);
+
+// What was stored for `args`, or null. Counts a hit or a miss. The result
+// stays owned by the table, and valid until the next calc_memo_store
+const ExprValueResult* calc_memo_find(CalcMemo* this,
+                                      const vec_ExprValue* args);
+// Takes copies of both, evicting the least recently used entry when full
+void calc_memo_store(CalcMemo* this, const vec_ExprValue* args,
+                     const ExprValueResult* result);
+
+CalcMemoStats calc_memo_stats(const CalcMemo* this);
+
+#endif  // SRC_CALCULATOR_CALC_MEMO_H_
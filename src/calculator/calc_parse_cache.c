@@ -0,0 +1,222 @@
+#include "calc_parse_cache.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include "../parser/tokenizer.h"
+#include "../util/allocator.h"
+#include "../util/prettify_c.h"
+
+// Direct-mapped: a new key takes the place of whatever had its slot. That is
+// plenty for the lines of a worksheet and the last few calculator inputs
+#define CALC_PARSE_CACHE_SIZE 256
+
+#define KIND_FUNCTION 'f'
+#define KIND_VARIABLE 'v'
+#define KIND_UNKNOWN '-'
+// Between the kinds and the text, which never has it
+#define KEY_SEPARATOR '\n'
+
+typedef struct CacheEntry {
+  CalcParseFn parse;  // null if the slot is empty
+  char* key;
+  size_t key_length;
+  uint32_t hash;
+
+  CalcExprResult result;
+  // Where err_pos was in the normalized text, -1 if it was null
+  ptrdiff_t err_offset;
+} CacheEntry;
+
+static CacheEntry entries[CALC_PARSE_CACHE_SIZE];
+static CalcParseCacheStats stats;
+
+// =====
+// =
+// = Keys
+// =
+// =====
+// The key of a text and where each symbol of the normalized text came from
+typedef struct CacheKey {
+  char* key;
+  size_t key_length;
+  size_t text_start;  // Of the normalized text inside the key
+  uint32_t hash;
+  const char** origins;  // One per normalized symbol, and the end of `text`
+} CacheKey;
+
+// Leading and trailing spaces dropped, runs of them collapsed to one. Spaces
+// only ever separate tokens, so this does not change how the text parses
+static size_t normalize_spaces(const char* text, char* out,
+                               const char** origins) {
+  size_t length = 0;
+  const char* pos = text;
+  while (*pos is ' ') pos++;
+
+  for (; *pos; pos++) {
+    if (*pos is ' ' and (pos[1] is ' ' or pos[1] is '\0')) continue;
+    origins[length] = pos;
+    out[length++] = *pos;
+  }
+  origins[length] = pos;
+  out[length] = '\0';
+  return length;
+}
+
+static char name_kind(ExprContext ctx, StrSlice name) {
+  if (ctx.vtable->is_function and ctx.vtable->is_function(ctx.data, name))
+    return KIND_FUNCTION;
+  if (ctx.vtable->is_variable and ctx.vtable->is_variable(ctx.data, name))
+    return KIND_VARIABLE;
+  return KIND_UNKNOWN;
+}
+
+static uint32_t hash_bytes(uint32_t hash, const void* bytes, size_t length) {
+  // FNV-1a
+  for (size_t i = 0; i < length; i++) {
+    hash ^= ((const unsigned char*)bytes)[i];
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+// False if the text does not tokenize, such texts are parsed every time
+static bool make_key(CalcParseFn parse, ExprContext ctx, const char* text,
+                     CacheKey* key) {
+  size_t text_length = strlen(text);
+  char* normalized = (char*)MALLOC(text_length + 1);
+  key->origins = (const char**)MALLOC((text_length + 1) * sizeof(char*));
+  size_t length = normalize_spaces(text, normalized, key->origins);
+
+  vec_Token tokens = vec_Token_create();
+  TokenizeResult tokenized = tk_tokenize(normalized, &tokens, false);
+  if (not tokenized.is_ok) {
+    str_free(tokenized.err_text);
+    vec_Token_free(tokens);
+    FREE(normalized);
+    FREE(key->origins);
+    return false;
+  }
+
+  int names = 0;
+  for (int i = 0; i < tokens.length; i++)
+    if (tokens.data[i].type is TOKEN_IDENT) names++;
+
+  key->text_start = names + 1;
+  key->key_length = key->text_start + length;
+  key->key = (char*)MALLOC(key->key_length + 1);
+
+  char* kinds = key->key;
+  for (int i = 0; i < tokens.length; i++)
+    if (tokens.data[i].type is TOKEN_IDENT)
+      *kinds++ = name_kind(ctx, tokens.data[i].data.ident_text);
+  *kinds++ = KEY_SEPARATOR;
+  memcpy(kinds, normalized, length + 1);
+
+  key->hash = hash_bytes(2166136261u, &parse, sizeof(parse));
+  key->hash = hash_bytes(key->hash, key->key, key->key_length);
+
+  vec_Token_free(tokens);
+  FREE(normalized);
+  return true;
+}
+
+static void free_key(CacheKey key) {
+  FREE(key.key);
+  FREE(key.origins);
+}
+
+// =====
+// =
+// = calc_parse_cache_parse
+// =
+// =====
+static CacheEntry* find_slot(uint32_t hash) {
+  return &entries[hash % CALC_PARSE_CACHE_SIZE];
+}
+
+static bool is_entry_of(const CacheEntry* entry, CalcParseFn parse,
+                        const CacheKey* key) {
+  return entry->parse is parse and entry->hash is key->hash and
+         entry->key_length is key->key_length and
+         memcmp(entry->key, key->key, key->key_length) is 0;
+}
+
+static CalcExprResult result_clone(const CalcExprResult* source,
+                                   const char* err_pos) {
+  if (source->is_ok) return CalcExprOk(calc_expr_clone(&source->ok));
+  return CalcExprErr(err_pos, str_clone(&source->err_text));
+}
+
+// The first normalized symbol at or after `pos`
+static ptrdiff_t offset_of(const CacheKey* key, const char* pos) {
+  size_t length = key->key_length - key->text_start;
+  ptrdiff_t offset = 0;
+  while ((size_t)offset < length and key->origins[offset] < pos) offset++;
+  return offset;
+}
+
+static void entry_free(CacheEntry* entry) {
+  if (not entry->parse) return;
+
+  FREE(entry->key);
+  if (entry->result.is_ok)
+    calc_expr_free(entry->result.ok);
+  else
+    str_free(entry->result.err_text);
+  *entry = (CacheEntry){.parse = null};
+}
+
+static void store(CacheEntry* entry, CalcParseFn parse, CacheKey* key,
+                  const CalcExprResult* result) {
+  // The cache outlives any arena scope the caller is in
+  my_arena_pause();
+  entry_free(entry);
+  *entry = (CacheEntry){
+      .parse = parse,
+      .key = (char*)MALLOC(key->key_length + 1),
+      .key_length = key->key_length,
+      .hash = key->hash,
+      .result = result_clone(result, null),
+      .err_offset = -1,
+  };
+  memcpy(entry->key, key->key, key->key_length + 1);
+  my_arena_resume();
+
+  if (not result->is_ok and result->err_pos)
+    entry->err_offset = offset_of(key, result->err_pos);
+}
+
+CalcExprResult calc_parse_cache_parse(CalcParseFn parse, ExprContext ctx,
+                                      const char* text) {
+  CacheKey key;
+  if (not make_key(parse, ctx, text, &key)) return parse(ctx, text);
+
+  CalcExprResult result;
+  CacheEntry* entry = find_slot(key.hash);
+  if (is_entry_of(entry, parse, &key)) {
+    stats.hits++;
+    const char* err_pos =
+        entry->err_offset < 0 ? null : key.origins[entry->err_offset];
+    result = result_clone(&entry->result, err_pos);
+  } else {
+    stats.misses++;
+    result = parse(ctx, text);
+    store(entry, parse, &key, &result);
+  }
+
+  free_key(key);
+  return result;
+}
+
+// =====
+// =
+// = Other
+// =
+// =====
+CalcParseCacheStats calc_parse_cache_stats() { return stats; }
+
+void calc_parse_cache_free() {
+  for (int i = 0; i < CALC_PARSE_CACHE_SIZE; i++) entry_free(&entries[i]);
+  stats = (CalcParseCacheStats){0};
+}
@@ -0,0 +1,32 @@
+#ifndef SRC_CALCULATOR_CALC_PARSE_CACHE_H_
+#define SRC_CALCULATOR_CALC_PARSE_CACHE_H_
+
+#include <stddef.h>
+
+#include "calc_expr.h"
+
+// Global cache of parse results. A text parses the same way as long as its
+// tokens are the same and every name in it is still the same kind (function,
+// variable or unknown), so that is the key: the text with runs of spaces
+// collapsed, plus one kind per name. Redefining a name changes the key of the
+// texts that use it, nothing has to be invalidated by hand.
+//
+//   calc_parse_cache_parse(parse_uncached, ctx, "f(x) = 2x");
+
+typedef CalcExprResult (*CalcParseFn)(ExprContext ctx, const char* text);
+
+// parse(ctx, text), or a copy of what it gave for the same key before. Error
+// positions point into `text` either way
+CalcExprResult calc_parse_cache_parse(CalcParseFn parse, ExprContext ctx,
+                                      const char* text);
+
+typedef struct CalcParseCacheStats {
+  size_t hits;
+  size_t misses;  // Parsed and stored
+} CalcParseCacheStats;
+
+CalcParseCacheStats calc_parse_cache_stats();
+
+void calc_parse_cache_free();
+
+#endif  // SRC_CALCULATOR_CALC_PARSE_CACHE_H_
@@ -0,0 +1,175 @@
+#include "calc_symbols.h"
+
+#include <string.h>
+
+#include "../util/allocator.h"
+#include "../util/prettify_c.h"
+
+// Scopes this small (like the arguments of a function call) are scanned
+// directly, hashing them would cost more than it saves
+#define CALC_SYMBOLS_SCAN_LIMIT 8
+#define CALC_SYMBOLS_MIN_CAPACITY 16
+
+static uint32_t calc_symbols_hash(StrSlice name) {
+  // FNV-1a
+  uint32_t hash = 2166136261u;
+  for (int i = 0; i < name.length; i++) {
+    hash ^= (unsigned char)name.start[i];
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+static CalcSymbol calc_symbol_empty(const char* name, uint32_t hash) {
+  return (CalcSymbol){
+      .name = name,
+      .hash = hash,
+      .value = CALC_SYMBOL_NONE,
+      .variable = CALC_SYMBOL_NONE,
+      .function = CALC_SYMBOL_NONE,
+  };
+}
+
+// =====
+// =
+// = BASICS
+// =
+// =====
+CalcSymbols calc_symbols_create() {
+  return (CalcSymbols){
+      .table = null,
+      .capacity = 0,
+      .count = 0,
+      .values_indexed = 0,
+      .expressions_indexed = 0,
+  };
+}
+
+void calc_symbols_free(CalcSymbols this) { FREE(this.table); }
+
+// =====
+// =
+// = TABLE
+// =
+// =====
+static CalcSymbol* calc_symbols_probe(const CalcSymbols* this, StrSlice name,
+                                      uint32_t hash) {
+  uint32_t mask = (uint32_t)this->capacity - 1;
+  for (uint32_t i = hash & mask;; i = (i + 1) & mask) {
+    CalcSymbol* item = &this->table[i];
+    if (not item->name or
+        (item->hash == hash and str_slice_eq_ccp(name, item->name)))
+      return item;
+  }
+}
+
+static void calc_symbols_grow(CalcSymbols* this) {
+  CalcSymbols old = *this;
+  this->capacity = old.capacity ? old.capacity * 2 : CALC_SYMBOLS_MIN_CAPACITY;
+  // Lookups sync lazily, the table may be grown inside an arena scope
+  my_arena_pause();
+  this->table = MALLOC(sizeof(CalcSymbol) * this->capacity);
+  my_arena_resume();
+  memset(this->table, 0, sizeof(CalcSymbol) * this->capacity);
+
+  for (int i = 0; i < old.capacity; i++) {
+    if (not old.table[i].name) continue;
+    StrSlice name = str_slice_from_string(old.table[i].name);
+    *calc_symbols_probe(this, name, old.table[i].hash) = old.table[i];
+  }
+  FREE(old.table);
+}
+
+static CalcSymbol* calc_symbols_entry(CalcSymbols* this, const char* name) {
+  // Keep load under 3/4 so probes stay short and always find an empty cell
+  if ((this->count + 1) * 4 > this->capacity * 3) calc_symbols_grow(this);
+
+  StrSlice slice = str_slice_from_string(name);
+  uint32_t hash = calc_symbols_hash(slice);
+  CalcSymbol* item = calc_symbols_probe(this, slice, hash);
+
+  if (not item->name) {
+    *item = calc_symbol_empty(name, hash);
+    this->count++;
+  }
+  return item;
+}
+
+// First definition wins, same as scanning the scope from its start
+static void calc_symbols_set(int* field, int index) {
+  if (*field is CALC_SYMBOL_NONE) *field = index;
+}
+
+void calc_symbols_sync(CalcSymbols* this, const vec_CalcValue* values,
+                       const vec_CalcExpr* expressions) {
+  if (values->length < this->values_indexed or
+      expressions->length < this->expressions_indexed) {
+    if (this->table)
+      memset(this->table, 0, sizeof(CalcSymbol) * this->capacity);
+    this->count = 0;
+    this->values_indexed = 0;
+    this->expressions_indexed = 0;
+  }
+
+  for (int i = this->values_indexed; i < values->length; i++) {
+    CalcSymbol* item = calc_symbols_entry(this, values->data[i].name.string);
+    calc_symbols_set(&item->value, i);
+  }
+  this->values_indexed = values->length;
+
+  for (int i = this->expressions_indexed; i < expressions->length; i++) {
+    const CalcExpr* expr = &expressions->data[i];
+
+    if (expr->type is CALC_EXPR_VARIABLE) {
+      CalcSymbol* item = calc_symbols_entry(this, expr->variable_name.string);
+      calc_symbols_set(&item->variable, i);
+    } else if (expr->type is CALC_EXPR_FUNCTION) {
+      CalcSymbol* item = calc_symbols_entry(this, expr->function.name.string);
+      calc_symbols_set(&item->function, i);
+    }
+  }
+  this->expressions_indexed = expressions->length;
+}
+
+// =====
+// =
+// = calc_symbols_lookup
+// =
+// =====
+static CalcSymbol calc_symbols_scan(const vec_CalcValue* values,
+                                    const vec_CalcExpr* expressions,
+                                    StrSlice name) {
+  CalcSymbol result = calc_symbol_empty(null, 0);
+
+  for (int i = 0; i < values->length; i++)
+    if (str_slice_eq_ccp(name, values->data[i].name.string))
+      calc_symbols_set(&result.value, i);
+
+  for (int i = 0; i < expressions->length; i++) {
+    const CalcExpr* expr = &expressions->data[i];
+
+    if (expr->type is CALC_EXPR_VARIABLE and
+        str_slice_eq_ccp(name, expr->variable_name.string))
+      calc_symbols_set(&result.variable, i);
+    else if (expr->type is CALC_EXPR_FUNCTION and
+             str_slice_eq_ccp(name, expr->function.name.string))
+      calc_symbols_set(&result.function, i);
+  }
+
+  return result;
+}
+
+CalcSymbol calc_symbols_lookup(CalcSymbols* this, const vec_CalcValue* values,
+                               const vec_CalcExpr* expressions, StrSlice name) {
+  if (not this->table and
+      values->length + expressions->length <= CALC_SYMBOLS_SCAN_LIMIT)
+    return calc_symbols_scan(values, expressions, name);
+
+  calc_symbols_sync(this, values, expressions);
+
+  uint32_t hash = calc_symbols_hash(name);
+  if (not this->table) return calc_symbol_empty(null, hash);
+
+  CalcSymbol* item = calc_symbols_probe(this, name, hash);
+  return item->name ? *item : calc_symbol_empty(null, hash);
+}
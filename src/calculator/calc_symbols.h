@@ -0,0 +1,44 @@
+#ifndef SRC_CALCULATOR_CALC_SYMBOLS_H_
+#define SRC_CALCULATOR_CALC_SYMBOLS_H_
+
+#include <stdint.h>
+
+#include "../util/better_string.h"
+#include "calc_expr.h"
+#include "calc_value.h"
+
+// Hash index over names of one CalcBackend scope. For every name it keeps the
+// index of the first value, variable and function with that name, so a scope
+// answers any lookup with one probe. The index follows the scope lazily:
+// items appended to `values` or `expressions` are indexed on the next lookup,
+// and if any were removed it is rebuilt.
+
+#define CALC_SYMBOL_NONE -1
+
+typedef struct CalcSymbol {
+  const char* name;  // Borrowed from the indexed CalcValue / CalcExpr
+  uint32_t hash;
+  int value;
+  int variable;
+  int function;
+} CalcSymbol;
+
+typedef struct CalcSymbols {
+  CalcSymbol* table;
+  int capacity;
+  int count;
+  int values_indexed;
+  int expressions_indexed;
+} CalcSymbols;
+
+CalcSymbols calc_symbols_create();
+void calc_symbols_free(CalcSymbols this);
+
+void calc_symbols_sync(CalcSymbols* this, const vec_CalcValue* values,
+                       const vec_CalcExpr* expressions);
+
+// Fields of the result are CALC_SYMBOL_NONE for kinds that are not defined
+CalcSymbol calc_symbols_lookup(CalcSymbols* this, const vec_CalcValue* values,
+                               const vec_CalcExpr* expressions, StrSlice name);
+
+#endif  // SRC_CALCULATOR_CALC_SYMBOLS_H_
@@ -0,0 +1,283 @@
+#include "calc_worksheet.h"
+
+#include <string.h>
+
+#include "../util/allocator.h"
+#include "../util/prettify_c.h"
+
+#define VECTOR_C CalcLine
+#define VECTOR_ITEM_DESTRUCTOR calc_line_free
+#include "../util/vector.h"
+
+void calc_line_free(CalcLine this) {
+  str_free(this.text);
+  str_free(this.descr);
+  vec_str_t_free(this.names);
+}
+
+CalcWorksheet calc_worksheet_create() {
+  CalcWorksheet result = {
+      .backend = calc_backend_create(),
+      .lines = vec_CalcLine_create(),
+  };
+  // Lines tend to call the same functions with the same arguments
+  calc_backend_set_memo_capacity(&result.backend, CALC_MEMO_DEFAULT_CAPACITY);
+  return result;
+}
+
+void calc_worksheet_free(CalcWorksheet this) {
+  // Lines borrow names from the backend
+  vec_CalcLine_free(this.lines);
+  calc_backend_free(this.backend);
+}
+
+static CalcExpr* line_expr(CalcBackend* backend, const CalcLine* line) {
+  if (line->expr_index < 0) return null;
+  return &backend->expressions.data[line->expr_index];
+}
+
+CalcExpr* calc_worksheet_line_expr(CalcWorksheet* this, int line_index) {
+  return line_expr(&this->backend, &this->lines.data[line_index]);
+}
+
+// =====
+// =
+// = Helpers
+// =
+// =====
+static bool is_blank(const char* text) {
+  for (int i = 0; text[i] != '\0'; i++)
+    if (text[i] is_not ' ') return false;
+
+  return true;
+}
+
+static const str_t* defined_name(const CalcExpr* expr) {
+  if (not expr) return null;
+
+  if (expr->type is CALC_EXPR_VARIABLE)
+    return &expr->variable_name;
+  else if (expr->type is CALC_EXPR_FUNCTION)
+    return &expr->function.name;
+  else
+    return null;
+}
+
+static bool set_contains(const vec_str_t* set, const char* name) {
+  for (int i = 0; i < set->length; i++)
+    if (strcmp(set->data[i].string, name) is 0) return true;
+
+  return false;
+}
+
+static void set_add(vec_str_t* set, const str_t* name) {
+  if (name and not set_contains(set, name->string))
+    vec_str_t_push(set, str_clone(name));
+}
+
+static bool set_intersects(const vec_str_t* set, const vec_str_t* names) {
+  for (int i = 0; i < names->length; i++)
+    if (set_contains(set, names->data[i].string)) return true;
+
+  return false;
+}
+
+// Same name, defined as the same kind of thing
+static bool same_definition(const CalcExpr* a, const CalcExpr* b) {
+  const str_t* a_name = defined_name(a);
+  const str_t* b_name = defined_name(b);
+
+  if (not a_name or not b_name) return a_name is b_name;
+  return a->type is b->type and strcmp(a_name->string, b_name->string) is 0;
+}
+
+static void collect_line_names(CalcLine* line, const CalcExpr* expr) {
+  vec_str_t_free(line->names);
+  line->names = vec_str_t_create();
+  if (not expr) return;
+
+  const str_t* name = defined_name(expr);
+  if (name) vec_str_t_push(&line->names, str_borrow(name));
+  calc_expr_collect_names(expr, &line->names);
+}
+
+// Parses the line from scratch and appends it to the backend
+static void add_line(CalcWorksheet* this, CalcLine* line) {
+  CalcBackend* backend = &this->backend;
+  line->expr_index = -1;
+  line->is_changed = true;
+
+  if (is_blank(line->text.string)) {
+    line->descr = str_literal("");
+  } else {
+    int prev_length = backend->expressions.length;
+    line->descr = calc_backend_add_expr(backend, line->text.string);
+    if (backend->expressions.length > prev_length)
+      line->expr_index = prev_length;
+  }
+
+  collect_line_names(line, line_expr(backend, line));
+}
+
+// Puts a line that was not re-parsed back into the backend. It is described
+// again only if it uses something that changed above it
+static void readd_line(CalcWorksheet* this, CalcLine* line, CalcExpr expr,
+                       vec_str_t* changed) {
+  CalcBackend* backend = &this->backend;
+
+  if (set_intersects(changed, &line->names)) {
+    calc_expr_info_reset(&expr.info);
+    str_free(line->descr);
+    line->descr = calc_backend_describe_expr(backend, &expr);
+    line->is_changed = true;
+    set_add(changed, defined_name(&expr));
+  }
+
+  line->expr_index = backend->expressions.length;
+  calc_backend_push_expr(backend, expr);
+}
+
+// =====
+// =
+// = calc_worksheet_update
+// =
+// =====
+// Lines are matched by text: the common head and tail of the old and the new
+// lists are kept, lines between them are removed and parsed anew. Names those
+// lines define form two sets. `redefined` have possibly changed what they are
+// (function, variable or nothing), so kept lines that mention them are parsed
+// again. `changed` may have a new value, so kept lines that use them are
+// described again, and add their own name to it.
+int calc_worksheet_update(CalcWorksheet* this, const vec_str_t* texts,
+                          CalcLineCallback callback, void* callback_data) {
+  vec_CalcLine* old = &this->lines;
+  CalcBackend* backend = &this->backend;
+  int old_len = old->length, new_len = texts->length;
+
+  for (int i = 0; i < old_len; i++) old->data[i].is_changed = false;
+
+  int head = 0;
+  while (head < old_len and head < new_len and
+         strcmp(old->data[head].text.string, texts->data[head].string) is 0)
+    head++;
+  if (head is old_len and head is new_len) return 0;
+
+  int tail = 0;
+  while (tail < old_len - head and tail < new_len - head and
+         strcmp(old->data[old_len - 1 - tail].text.string,
+                texts->data[new_len - 1 - tail].string) is 0)
+    tail++;
+
+  // 1. Take expressions of every line after the head out of the backend
+  int kept = backend->expressions.length;
+  for (int i = head; i < old_len and kept is backend->expressions.length; i++)
+    if (old->data[i].expr_index >= 0) kept = old->data[i].expr_index;
+
+  int taken_count = backend->expressions.length - kept;
+  CalcExpr* taken = null;
+  if (taken_count > 0) {
+    taken = (CalcExpr*)MALLOC(sizeof(CalcExpr) * taken_count);
+    assert_alloc(taken);
+    memcpy(taken, &backend->expressions.data[kept],
+           sizeof(CalcExpr) * taken_count);
+  }
+  backend->expressions.length = kept;
+  calc_symbols_sync(&backend->symbols, &backend->values, &backend->expressions);
+
+  // Head definitions may have used them
+  for (int i = 0; i < taken_count; i++) {
+    const str_t* name = defined_name(&taken[i]);
+    if (name) calc_backend_invalidate_name(backend, str_slice_from_str_t(name));
+  }
+
+  vec_CalcLine lines = vec_CalcLine_with_capacity(new_len);
+  for (int i = 0; i < head; i++) vec_CalcLine_push(&lines, old->data[i]);
+
+  // 2. Parse the edited lines
+  for (int i = head; i < new_len - tail; i++) {
+    CalcLine line = {.text = str_clone(&texts->data[i]),
+                     .names = vec_str_t_create()};
+    add_line(this, &line);
+    vec_CalcLine_push(&lines, line);
+    if (callback) callback(callback_data, backend, i, &lines.data[i]);
+  }
+
+  vec_str_t redefined = vec_str_t_create();
+  vec_str_t changed = vec_str_t_create();
+
+  for (int i = head; i < old_len - tail; i++) {
+    CalcLine* old_line = &old->data[i];
+    CalcExpr* old_expr =
+        old_line->expr_index >= 0 ? &taken[old_line->expr_index - kept] : null;
+    if (not old_expr) continue;
+
+    bool is_kept = false;
+    for (int j = head; j < new_len - tail and not is_kept; j++)
+      is_kept = same_definition(old_expr, line_expr(backend, &lines.data[j]));
+    if (not is_kept) set_add(&redefined, defined_name(old_expr));
+    set_add(&changed, defined_name(old_expr));
+  }
+  for (int j = head; j < new_len - tail; j++) {
+    CalcExpr* new_expr = line_expr(backend, &lines.data[j]);
+    if (not new_expr) continue;
+
+    bool is_kept = false;
+    for (int i = head; i < old_len - tail and not is_kept; i++) {
+      CalcLine* old_line = &old->data[i];
+      if (old_line->expr_index >= 0)
+        is_kept = same_definition(&taken[old_line->expr_index - kept], new_expr);
+    }
+    if (not is_kept) set_add(&redefined, defined_name(new_expr));
+    set_add(&changed, defined_name(new_expr));
+  }
+
+  for (int i = head; i < old_len - tail; i++) {
+    CalcLine* old_line = &old->data[i];
+    if (old_line->expr_index >= 0)
+      calc_expr_free(taken[old_line->expr_index - kept]);
+    calc_line_free(*old_line);
+  }
+
+  // 3. Put the tail back, re-parsing or re-describing what depends on edits
+  for (int i = new_len - tail; i < new_len; i++) {
+    CalcLine line = old->data[i - new_len + old_len];
+    CalcExpr* expr = line.expr_index >= 0 ? &taken[line.expr_index - kept] : null;
+
+    bool reparse = not is_blank(line.text.string) and
+                   (expr ? set_intersects(&redefined, &line.names)
+                         : redefined.length > 0);
+    if (reparse) {
+      str_free(line.descr);
+      add_line(this, &line);
+
+      CalcExpr* new_expr = line_expr(backend, &line);
+      if (not same_definition(expr, new_expr)) {
+        set_add(&redefined, defined_name(expr));
+        set_add(&redefined, defined_name(new_expr));
+      }
+      set_add(&changed, defined_name(expr));
+      set_add(&changed, defined_name(new_expr));
+      if (expr) calc_expr_free(*expr);
+    } else if (expr) {
+      readd_line(this, &line, *expr, &changed);
+    }
+
+    vec_CalcLine_push(&lines, line);
+    if (callback and line.is_changed)
+      callback(callback_data, backend, i, &lines.data[i]);
+  }
+
+  vec_str_t_free(redefined);
+  vec_str_t_free(changed);
+  if (taken) FREE(taken);
+
+  // Every old line was either moved into `lines` or freed
+  old->length = 0;
+  vec_CalcLine_free(*old);
+  this->lines = lines;
+
+  int changed_count = 0;
+  for (int i = 0; i < lines.length; i++)
+    if (lines.data[i].is_changed) changed_count++;
+  return changed_count;
+}
@@ -0,0 +1,47 @@
+#ifndef SRC_CALCULATOR_CALC_WORKSHEET_H_
+#define SRC_CALCULATOR_CALC_WORKSHEET_H_
+
+#include "../util/better_io.h"
+#include "../util/better_string.h"
+#include "calc_backend.h"
+
+// A list of text lines kept parsed in one CalcBackend. Each line sees only
+// the lines above it, same as adding them one by one with
+// calc_backend_add_expr. On update the worksheet finds the lines that were
+// edited, inserted or removed, re-parses only those, and re-describes only
+// the lines below that use (directly or through other definitions) a name
+// they define. Everything else is moved back into the backend as is.
+
+typedef struct CalcLine {
+  str_t text;
+  str_t descr;     // What calc_backend_add_expr reported for the line
+  int expr_index;  // Index in `backend.expressions`, or -1 if nothing added
+  vec_str_t names;  // Defined and used names, borrowed from the expression
+  bool is_changed;  // Was (re)calculated by the last update
+} CalcLine;
+
+void calc_line_free(CalcLine this);
+
+#define VECTOR_H CalcLine
+#include "../util/vector.h"
+
+// Called for every changed line right after it is added. At that moment
+// the backend contains only this line and the lines above it
+typedef void (*CalcLineCallback)(void* data, CalcBackend* backend,
+                                 int line_index, CalcLine* line);
+
+typedef struct CalcWorksheet {
+  CalcBackend backend;
+  vec_CalcLine lines;
+} CalcWorksheet;
+
+CalcWorksheet calc_worksheet_create();
+void calc_worksheet_free(CalcWorksheet this);
+
+// Returns the count of changed lines. `callback` may be null
+int calc_worksheet_update(CalcWorksheet* this, const vec_str_t* texts,
+                          CalcLineCallback callback, void* callback_data);
+
+CalcExpr* calc_worksheet_line_expr(CalcWorksheet* this, int line_index);
+
+#endif  // SRC_CALCULATOR_CALC_WORKSHEET_H_
@@ -0,0 +1,257 @@
+#include "expr_inline.h"
+
+#include "../util/allocator.h"
+#include "../util/prettify_c.h"
+#include "native_functions.h"
+
+// Arguments of the calls being inlined, innermost first. Their expressions
+// are already inlined, in terms of the outermost expression
+typedef struct InlineScope {
+  const CalcExpr* function;
+  const vec_str_t* names;
+  const Expr* values;
+  const struct InlineScope* caller;
+} InlineScope;
+
+typedef struct Inliner {
+  CalcBackend* backend;
+  const vec_str_t* slot_names;
+  bool is_function_body;
+  int growth;
+  // Set when the body being inlined turns out to differ from the call
+  bool is_failed;
+} Inliner;
+
+static Expr inline_node(Inliner* this, const Expr* expr,
+                        const InlineScope* scope);
+
+// =====
+// =
+// = Helpers
+// =
+// =====
+static int count_nodes(const Expr* expr) {
+  switch (expr->type) {
+    case EXPR_FUNCTION:
+      return 1 + count_nodes(expr->function.argument);
+    case EXPR_VECTOR: {
+      int count = 1;
+      for (int i = 0; i < expr->vector.arguments.length; i++)
+        count += count_nodes(&expr->vector.arguments.data[i]);
+      return count;
+    }
+    case EXPR_BINARY_OP:
+      return 1 + count_nodes(expr->binary_operator.lhs) +
+             count_nodes(expr->binary_operator.rhs);
+    default:
+      return 1;
+  }
+}
+
+static bool is_slot(const Inliner* this, StrSlice name) {
+  if (not this->slot_names) return false;
+
+  for (int i = 0; i < this->slot_names->length; i++)
+    if (str_slice_eq_ccp(name, this->slot_names->data[i].string)) return true;
+  return false;
+}
+
+// Surely a number when calculated, so never an error either
+static bool is_number(const Inliner* this, const Expr* expr) {
+  switch (expr->type) {
+    case EXPR_NUMBER:
+      return true;
+
+    case EXPR_VARIABLE: {
+      StrSlice name = expr_symbol_slice(expr->variable.name);
+      if (is_slot(this, name)) return not this->is_function_body;
+
+      CalcValue* value = calc_backend_get_value_sslice(this->backend, name);
+      if (value) return value->value.type is EXPR_VALUE_NUMBER;
+      return calc_backend_get_variable_sslice(this->backend, name) and
+             calc_backend_is_var_const_sslice(this->backend, name) and
+             calc_backend_get_expr_type(this->backend, expr) is
+                 EXPR_VALUE_NUMBER;
+    }
+
+    case EXPR_FUNCTION: {
+      StrSlice name = expr_symbol_slice(expr->function.name);
+      return calculator_get_native_scalar_function(name) and
+             is_number(this, expr->function.argument);
+    }
+
+    case EXPR_BINARY_OP:
+      return expr_operator_scalar_fn(expr->binary_operator.op) and
+             is_number(this, expr->binary_operator.lhs) and
+             is_number(this, expr->binary_operator.rhs);
+
+    default:
+      return false;
+  }
+}
+
+// =====
+// =
+// = Calls
+// =
+// =====
+// The arguments the function gets from `argument`, if they are all numbers
+static const Expr* number_args(const Inliner* this, const CalcExpr* function,
+                               const Expr* argument) {
+  int count = function->function.args.length;
+  if (count is 1) return is_number(this, argument) ? argument : null;
+
+  if (count is 0 or argument->type is_not EXPR_VECTOR or
+      argument->vector.arguments.length is_not count)
+    return null;
+  for (int i = 0; i < count; i++)
+    if (not is_number(this, &argument->vector.arguments.data[i])) return null;
+  return argument->vector.arguments.data;
+}
+
+static bool is_in_progress(const InlineScope* scope,
+                           const CalcExpr* function) {
+  for (; scope; scope = scope->caller)
+    if (scope->function is function) return true;
+  return false;
+}
+
+// The body of `function` for the call with `argument`, or false if the call
+// stays. `argument` is inlined already
+static bool inline_call(Inliner* this, const CalcExpr* function,
+                        const Expr* argument, const InlineScope* scope,
+                        Expr* body) {
+  if (is_in_progress(scope, function) or
+      count_nodes(&function->expression) > EXPR_INLINE_MAX_NODES)
+    return false;
+
+  const Expr* values = number_args(this, function, argument);
+  if (not values) return false;
+
+  InlineScope inner = {
+      .function = function,
+      .names = &function->function.args,
+      .values = values,
+      .caller = scope,
+  };
+  bool was_failed = this->is_failed;
+  this->is_failed = false;
+  *body = inline_node(this, &function->expression, &inner);
+
+  int nodes = count_nodes(body);
+  bool is_inlined = not this->is_failed and
+                    nodes <= EXPR_INLINE_MAX_NODES and
+                    this->growth + nodes <= EXPR_INLINE_MAX_GROWTH;
+  this->is_failed = was_failed;
+
+  if (is_inlined)
+    this->growth += nodes;
+  else
+    expr_free(*body);
+  return is_inlined;
+}
+
+static Expr inline_function(Inliner* this, const ExprFunction* func,
+                            const InlineScope* scope) {
+  Expr argument = inline_node(this, func->argument, scope);
+  StrSlice name = expr_symbol_slice(func->name);
+
+  const CalcExpr* function =
+      calculator_get_native_function(name)
+          ? null
+          : calc_backend_get_function_sslice(this->backend, name);
+  Expr body;
+  if (function and inline_call(this, function, &argument, scope, &body)) {
+    expr_free(argument);
+    return body;
+  }
+  // Called from an inlined body, the function would not see its arguments
+  if (function and scope) this->is_failed = true;
+
+  return (Expr){
+      .type = EXPR_FUNCTION,
+      .function = {.name = func->name,
+                   .argument = expr_move_to_heap(argument)},
+  };
+}
+
+static Expr inline_variable(Inliner* this, const Expr* expr,
+                            const InlineScope* scope) {
+  StrSlice name = expr_symbol_slice(expr->variable.name);
+
+  for (const InlineScope* s = scope; s; s = s->caller)
+    for (int i = 0; i < s->names->length; i++)
+      if (str_slice_eq_ccp(name, s->names->data[i].string))
+        return expr_clone(&s->values[i]);
+
+  // A body would get x and y of the point, which it does not see
+  if (scope and not this->is_function_body and is_slot(this, name))
+    this->is_failed = true;
+  return expr_clone(expr);
+}
+
+static Expr inline_node(Inliner* this, const Expr* expr,
+                        const InlineScope* scope) {
+  switch (expr->type) {
+    case EXPR_VARIABLE:
+      return inline_variable(this, expr, scope);
+
+    case EXPR_FUNCTION:
+      return inline_function(this, &expr->function, scope);
+
+    case EXPR_VECTOR: {
+      const vec_Expr* items = &expr->vector.arguments;
+      Expr result = {
+          .type = EXPR_VECTOR,
+          .vector.arguments = vec_Expr_with_capacity(items->length),
+      };
+      for (int i = 0; i < items->length; i++)
+        vec_Expr_push(&result.vector.arguments,
+                      inline_node(this, &items->data[i], scope));
+      return result;
+    }
+
+    case EXPR_BINARY_OP: {
+      const ExprBinaryOp* op = &expr->binary_operator;
+      Expr lhs = inline_node(this, op->lhs, scope);
+      Expr rhs = inline_node(this, op->rhs, scope);
+      return (Expr){
+          .type = EXPR_BINARY_OP,
+          .binary_operator = {.op = op->op,
+                              .lhs = expr_move_to_heap(lhs),
+                              .rhs = expr_move_to_heap(rhs)},
+      };
+    }
+
+    default:
+      return expr_clone(expr);
+  }
+}
+
+// =====
+// =
+// = expr_inline
+// =
+// =====
+Expr expr_inline(const Expr* expr, CalcBackend* backend,
+                 const vec_str_t* slot_names, bool is_function_body) {
+  assert_m(expr);
+  assert_m(backend);
+
+  Inliner inliner = {
+      .backend = backend,
+      .slot_names = slot_names,
+      .is_function_body = is_function_body,
+      .growth = 0,
+      .is_failed = false,
+  };
+  return inline_node(&inliner, expr, null);
+}
+
+void expr_inline_dump(const Expr* expr, CalcBackend* backend,
+                      const vec_str_t* slot_names, bool is_function_body,
+                      OutStream out) {
+  Expr inlined = expr_inline(expr, backend, slot_names, is_function_body);
+  x_sprintf(out, "%$expr\n", inlined);
+  expr_free(inlined);
+}
@@ -0,0 +1,41 @@
+#ifndef SRC_CALCULATOR_EXPR_INLINE_H_
+#define SRC_CALCULATOR_EXPR_INLINE_H_
+
+#include "../parser/expr.h"
+#include "../util/better_io.h"
+#include "calc_backend.h"
+
+// Replaces calls of small user functions with their bodies, where the
+// arguments are replaced with the expressions they were called with. Bodies
+// see the arguments of their callers, as in expr_calculate. A call is inlined
+// only if it gives exactly what the call would:
+//  - every argument is surely a number: a vector would be split by the call,
+//    and numbers are never errors, so an argument the body does not use can
+//    be dropped
+//  - every call in the body is inlined too, and the function does not call
+//    itself
+//  - in the outermost expression, the body does not use the slot names on
+//    its own: those are x and y of a point, which functions do not see
+// Bodies of more than EXPR_INLINE_MAX_NODES nodes are not inlined, before or
+// after their own calls are.
+//
+//   f(t) = t * e^t
+//   expr_inline("f(x + 1) + 2", backend, ["x"], false)
+//   // (x + 1) * e ^ (x + 1) + 2
+//
+// Slots of the outermost expression hold numbers. Slots of a function body
+// are arguments of the function and of its callers, of any type.
+
+#define EXPR_INLINE_MAX_NODES 64
+// Nodes added to one expression by inlining, all calls together
+#define EXPR_INLINE_MAX_GROWTH 1024
+
+// The result is a new Expr, `expr` is borrowed
+Expr expr_inline(const Expr* expr, CalcBackend* backend,
+                 const vec_str_t* slot_names, bool is_function_body);
+// What expr_inline gives, printed for debugging
+void expr_inline_dump(const Expr* expr, CalcBackend* backend,
+                      const vec_str_t* slot_names, bool is_function_body,
+                      OutStream out);
+
+#endif  // SRC_CALCULATOR_EXPR_INLINE_H_
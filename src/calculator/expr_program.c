@@ -0,0 +1,727 @@
+#include "expr_program.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "../util/allocator.h"
+#include "../util/prettify_c.h"
+#include "expr_inline.h"
+#include "func_const_ctx.h"
+
+#define VECTOR_C ExprInstr
+#include "../util/vector.h"
+
+static void expr_callee_free(ExprCallee this);
+
+#define VECTOR_C ExprCallee
+#define VECTOR_ITEM_DESTRUCTOR expr_callee_free
+#include "../util/vector.h"
+
+// =====
+// =
+// = expr_compile
+// =
+// =====
+
+// Registers are handed out as a stack: a node writes its value into `dst`,
+// and its operands use the registers right above it. An Expr is a tree, so
+// the stack depth is all the registers the program will ever need. Repeated
+// subtrees get registers below the stack, which no instruction takes from:
+// the first occurrence copies its value there, the others copy it back.
+typedef struct ExprCompiler {
+  ExprProgram* program;
+  CalcBackend* backend;
+  const vec_str_t* slot_names;
+  int registers_count;
+  ExprCse cse;
+  bool* is_shared_done;
+  // Of the user function being compiled, null for the outermost program
+  const CalcExpr* function;
+  const struct ExprCompiler* caller;
+} ExprCompiler;
+
+static ExprProgram compile_program(const Expr* expr, CalcBackend* backend,
+                                   const vec_str_t* slot_names,
+                                   const ExprCompiler* caller,
+                                   const CalcExpr* function);
+
+static void compile_node(ExprCompiler* this, const Expr* expr, int dst);
+static void compile_node_once(ExprCompiler* this, const Expr* expr, int dst);
+static void compile_variable(ExprCompiler* this, StrSlice name, int dst);
+static void compile_function(ExprCompiler* this, const ExprFunction* func,
+                             int dst);
+static void compile_vector(ExprCompiler* this, const ExprVector* vector,
+                           int dst);
+static void compile_binary_op(ExprCompiler* this, const ExprBinaryOp* op,
+                              int dst);
+
+static void emit(ExprCompiler* this, ExprInstr instr) {
+  if (instr.dst >= this->registers_count)
+    this->registers_count = instr.dst + 1;
+  vec_ExprInstr_push(&this->program->code, instr);
+}
+
+static int push_const(ExprCompiler* this, ExprValue value) {
+  vec_ExprValue_push(&this->program->consts, value);
+  return this->program->consts.length - 1;
+}
+
+static int push_name(ExprCompiler* this, StrSlice name) {
+  vec_str_t* names = &this->program->names;
+  for (int i = 0; i < names->length; i++)
+    if (str_slice_eq_ccp(name, names->data[i].string)) return i;
+
+  vec_str_t_push(names, str_slice_to_owned(name));
+  return names->length - 1;
+}
+
+static int find_slot(ExprCompiler* this, StrSlice name) {
+  if (not this->slot_names) return -1;
+
+  for (int i = 0; i < this->slot_names->length; i++)
+    if (str_slice_eq_ccp(name, this->slot_names->data[i].string)) return i;
+
+  return -1;
+}
+
+// Numbers, slots and constants are as cheap to load again as to copy
+static bool is_worth_sharing(void* data, const Expr* expr) {
+  ExprCompiler* this = (ExprCompiler*)data;
+  if (expr->type is EXPR_FUNCTION or expr->type is EXPR_BINARY_OP) return true;
+  if (expr->type is_not EXPR_VARIABLE) return false;
+
+  StrSlice name = expr_symbol_slice(expr->variable.name);
+  return find_slot(this, name) < 0 and
+         not calc_backend_get_value_sslice(this->backend, name) and
+         not(calc_backend_get_variable_sslice(this->backend, name) and
+             calc_backend_is_var_const_sslice(this->backend, name));
+}
+
+ExprProgram expr_compile(const Expr* expr, CalcBackend* backend,
+                         const vec_str_t* slot_names) {
+  assert_m(expr);
+  assert_m(backend);
+  return compile_program(expr, backend, slot_names, null, null);
+}
+
+static ExprProgram compile_program(const Expr* expr, CalcBackend* backend,
+                                   const vec_str_t* slot_names,
+                                   const ExprCompiler* caller,
+                                   const CalcExpr* function) {
+  ExprProgram result = {
+      .code = vec_ExprInstr_create(),
+      .consts = vec_ExprValue_create(),
+      .names = vec_str_t_create(),
+      .callees = vec_ExprCallee_create(),
+      .registers = vec_ExprValue_create(),
+      .result = 0,
+      .shared_count = 0,
+      .slots_count = slot_names ? slot_names->length : 0,
+      .ctx = calc_backend_get_context(backend),
+  };
+
+  ExprCompiler compiler = {
+      .program = &result,
+      .backend = backend,
+      .slot_names = slot_names,
+      .registers_count = 0,
+      .cse = expr_cse_create(),
+      .is_shared_done = null,
+      .function = function,
+      .caller = caller,
+  };
+  // Constant parts are computed here once, slots are never constant
+  vec_str_t no_slots = vec_str_t_create();
+  FuncConstCtx fctx = {
+      .parent = result.ctx,
+      .used_args = slot_names ? (vec_str_t*)slot_names : &no_slots,
+      .are_const = false,
+  };
+  Expr inlined = expr_inline(expr, backend, slot_names, function is_not null);
+  Expr optimized = expr_optimize(inlined, func_const_ctx_context(&fctx));
+
+  expr_cse_count(&compiler.cse, &optimized, is_worth_sharing, &compiler);
+  result.shared_count = compiler.cse.shared_count;
+  result.result = result.shared_count;
+  compiler.registers_count = result.shared_count;
+  if (result.shared_count > 0) {
+    compiler.is_shared_done =
+        (bool*)MALLOC(sizeof(bool) * result.shared_count);
+    assert_alloc(compiler.is_shared_done);
+    memset(compiler.is_shared_done, 0, sizeof(bool) * result.shared_count);
+  }
+
+  compile_node(&compiler, &optimized, result.result);
+  FREE(compiler.is_shared_done);
+  expr_cse_free(compiler.cse);
+  expr_free(optimized);
+  vec_str_t_free(no_slots);
+
+  result.is_numeric = true;
+  for (int i = 0; i < result.code.length; i++) {
+    const ExprInstr* instr = &result.code.data[i];
+    if ((instr->op is EXPR_INSTR_CONST and
+         result.consts.data[instr->a].type is_not EXPR_VALUE_NUMBER) or
+        (instr->op is EXPR_INSTR_BINARY and not instr->binary.scalar) or
+        (instr->op is EXPR_INSTR_NATIVE and not instr->native.scalar) or
+        instr->op is EXPR_INSTR_LOAD or instr->op is EXPR_INSTR_VECTOR or
+        instr->op is EXPR_INSTR_PUSH or instr->op is EXPR_INSTR_CALL or
+        instr->op is EXPR_INSTR_INVOKE)
+      result.is_numeric = false;
+  }
+
+  result.registers = vec_ExprValue_with_capacity(compiler.registers_count);
+  for (int i = 0; i < compiler.registers_count; i++)
+    vec_ExprValue_push(&result.registers,
+                       (ExprValue){.type = EXPR_VALUE_NONE});
+
+  return result;
+}
+
+static void compile_node(ExprCompiler* this, const Expr* expr, int dst) {
+  int shared = expr_cse_shared_id(&this->cse, expr);
+  if (shared < 0) {
+    compile_node_once(this, expr, dst);
+  } else if (this->is_shared_done[shared]) {
+    emit(this, (ExprInstr){.op = EXPR_INSTR_COPY, .dst = dst, .a = shared});
+  } else {
+    compile_node_once(this, expr, dst);
+    emit(this, (ExprInstr){.op = EXPR_INSTR_COPY, .dst = shared, .a = dst});
+    this->is_shared_done[shared] = true;
+  }
+}
+
+static void compile_node_once(ExprCompiler* this, const Expr* expr,
+                              int dst) {
+  if (expr->type is EXPR_NUMBER) {
+    emit(this, (ExprInstr){.op = EXPR_INSTR_NUMBER,
+                           .dst = dst,
+                           .number = expr->number.value});
+
+  } else if (expr->type is EXPR_VARIABLE) {
+    compile_variable(this, expr_symbol_slice(expr->variable.name), dst);
+
+  } else if (expr->type is EXPR_FUNCTION) {
+    compile_function(this, &expr->function, dst);
+
+  } else if (expr->type is EXPR_VECTOR) {
+    compile_vector(this, &expr->vector, dst);
+
+  } else if (expr->type is EXPR_BINARY_OP) {
+    compile_binary_op(this, &expr->binary_operator, dst);
+
+  } else {
+    panic("Invalid expr type");
+  }
+}
+
+static void compile_variable(ExprCompiler* this, StrSlice name, int dst) {
+  int slot = find_slot(this, name);
+  if (slot >= 0) {
+    emit(this, (ExprInstr){.op = EXPR_INSTR_SLOT, .dst = dst, .a = slot});
+    return;
+  }
+
+  // Constant variables never change between runs, so they are computed once
+  // here. Everything else (and constants that fail) is looked up at runtime,
+  // which gives exactly the value or error `expr_calculate` would give
+  CalcValue* value = calc_backend_get_value_sslice(this->backend, name);
+  if (value) {
+    int index = push_const(this, expr_value_clone(&value->value));
+    emit(this, (ExprInstr){.op = EXPR_INSTR_CONST, .dst = dst, .a = index});
+    return;
+  }
+
+  if (calc_backend_get_variable_sslice(this->backend, name) and
+      calc_backend_is_var_const_sslice(this->backend, name)) {
+    ExprContext ctx = this->program->ctx;
+    ExprValueResult res = ctx.vtable->get_variable_val(ctx.data, name);
+
+    if (res.is_ok) {
+      int index = push_const(this, res.ok);
+      emit(this, (ExprInstr){.op = EXPR_INSTR_CONST, .dst = dst, .a = index});
+      return;
+    }
+    str_free(res.err_text);
+  }
+
+  emit(this, (ExprInstr){
+                 .op = EXPR_INSTR_LOAD,
+                 .dst = dst,
+                 .a = push_name(this, name),
+             });
+}
+
+// Index of the callee for `function`, compiled on first use. -1 if the
+// function is being compiled already: such calls never finish anyway, and go
+// by name like before
+static int find_callee(ExprCompiler* this, const CalcExpr* function) {
+  vec_ExprCallee* callees = &this->program->callees;
+  for (int i = 0; i < callees->length; i++)
+    if (callees->data[i].function is function) return i;
+
+  for (const ExprCompiler* c = this; c; c = c->caller)
+    if (c->function is function) return -1;
+
+  // Arguments first, then everything this function sees itself
+  const vec_str_t* args = &function->function.args;
+  vec_str_t slot_names = vec_str_t_with_capacity(args->length + 1);
+  for (int i = 0; i < args->length; i++)
+    vec_str_t_push(&slot_names, str_borrow(&args->data[i]));
+  if (this->function)
+    for (int i = 0; i < this->slot_names->length; i++)
+      vec_str_t_push(&slot_names, str_borrow(&this->slot_names->data[i]));
+
+  ExprCallee callee = {
+      .function = function,
+      .program = (ExprProgram*)MALLOC(sizeof(ExprProgram)),
+      .args_count = args->length,
+      .frame = vec_ExprValue_with_capacity(slot_names.length),
+  };
+  assert_alloc(callee.program);
+  *callee.program = compile_program(&function->expression, this->backend,
+                                    &slot_names, this, function);
+  for (int i = 0; i < slot_names.length; i++)
+    vec_ExprValue_push(&callee.frame, (ExprValue){.type = EXPR_VALUE_NONE});
+  vec_str_t_free(slot_names);
+
+  vec_ExprCallee_push(callees, callee);
+  return callees->length - 1;
+}
+
+static void compile_function(ExprCompiler* this, const ExprFunction* func,
+                             int dst) {
+  StrSlice name = expr_symbol_slice(func->name);
+  compile_node(this, func->argument, dst);
+
+  const CalcExpr* function =
+      calculator_get_native_function(name)
+          ? null
+          : calc_backend_get_function_sslice(this->backend, name);
+  int callee = function ? find_callee(this, function) : -1;
+  if (callee >= 0) {
+    emit(this, (ExprInstr){
+                   .op = EXPR_INSTR_INVOKE,
+                   .dst = dst,
+                   .a = dst,
+                   .b = callee,
+               });
+    return;
+  }
+
+  NativeFnPtr native = calculator_get_native_function(name);
+  if (native) {
+    emit(this, (ExprInstr){
+                   .op = EXPR_INSTR_NATIVE,
+                   .dst = dst,
+                   .a = dst,
+                   .native.fn = native,
+                   .native.scalar = calculator_get_native_scalar_function(name),
+                   .native.batch = calculator_get_native_batch_function(name),
+               });
+  } else {
+    emit(this, (ExprInstr){
+                   .op = EXPR_INSTR_CALL,
+                   .dst = dst,
+                   .a = dst,
+                   .b = push_name(this, name),
+               });
+  }
+}
+
+static void compile_vector(ExprCompiler* this, const ExprVector* vector,
+                           int dst) {
+  const vec_Expr* args = &vector->arguments;
+  emit(this,
+       (ExprInstr){.op = EXPR_INSTR_VECTOR, .dst = dst, .b = args->length});
+
+  for (int i = 0; i < args->length; i++) {
+    compile_node(this, &args->data[i], dst + 1);
+    emit(this, (ExprInstr){.op = EXPR_INSTR_PUSH, .dst = dst, .a = dst + 1});
+  }
+}
+
+static void compile_binary_op(ExprCompiler* this, const ExprBinaryOp* op,
+                              int dst) {
+  OperatorFn fn = expr_operator_fn(op->op);
+  assert_m(fn);
+
+  compile_node(this, op->lhs, dst);
+  compile_node(this, op->rhs, dst + 1);
+  emit(this, (ExprInstr){
+                 .op = EXPR_INSTR_BINARY,
+                 .dst = dst,
+                 .a = dst,
+                 .b = dst + 1,
+                 .binary.fn = fn,
+                 .binary.scalar = expr_operator_scalar_fn(op->op),
+                 .binary.batch = expr_operator_batch_fn(op->op),
+             });
+}
+
+// =====
+// =
+// = expr_program_run
+// =
+// =====
+
+static ExprValue take_register(ExprProgram* this, int index) {
+  ExprValue value = this->registers.data[index];
+  this->registers.data[index] = (ExprValue){.type = EXPR_VALUE_NONE};
+  return value;
+}
+
+// Arguments go to the frame the way calc_backend_call_function takes them:
+// a vector is split, missing arguments are none, extra ones are dropped. A
+// number is the only argument, so scalar calls allocate nothing. A range has
+// to be short enough to store
+static void fill_args(ExprCallee* callee, ExprValue argument) {
+  ExprValue* frame = callee->frame.data;
+  if (argument.type is EXPR_VALUE_NUMBER and callee->args_count > 0) {
+    frame[0] = argument;
+    return;
+  }
+
+  vec_ExprValue args = expr_value_into_args(argument);
+  // A range is passed whole, see expr_value_into_args
+  if (args.length is 1 and args.data[0].type is EXPR_VALUE_VEC and
+      args.data[0].vec.kind is EXPR_VEC_RANGE) {
+    ExprVec range = args.data[0].vec;
+    args.length = 0;
+    vec_ExprValue_free(args);
+    args = expr_vec_into_values(range);
+  }
+
+  for (int i = 0; i < args.length; i++) {
+    if (i < callee->args_count)
+      frame[i] = args.data[i];
+    else
+      expr_value_free(args.data[i]);
+  }
+  args.length = 0;
+  vec_ExprValue_free(args);
+}
+
+static ExprValueResult run_callee(ExprCallee* callee, ExprValue argument,
+                                  const ExprValue* slots) {
+  if (argument.type is EXPR_VALUE_VEC and
+      not expr_vec_can_store(argument.vec.length)) {
+    expr_value_free(argument);
+    return expr_vec_too_long(argument.vec.length);
+  }
+
+  fill_args(callee, argument);
+  ExprValue* frame = callee->frame.data;
+  for (int i = callee->args_count; i < callee->frame.length; i++)
+    frame[i] = expr_value_clone(&slots[i - callee->args_count]);
+
+  ExprValueResult res = expr_program_run(callee->program, frame);
+
+  for (int i = 0; i < callee->frame.length; i++) {
+    expr_value_free(frame[i]);
+    frame[i] = (ExprValue){.type = EXPR_VALUE_NONE};
+  }
+  return res;
+}
+
+static ExprValueResult run_instr(ExprProgram* this, const ExprInstr* instr,
+                                 const ExprValue* slots) {
+  ExprValue* regs = this->registers.data;
+  ExprValueResult res = {.is_ok = true};
+
+  switch (instr->op) {
+    case EXPR_INSTR_NUMBER:
+      regs[instr->dst] =
+          (ExprValue){.type = EXPR_VALUE_NUMBER, .number = instr->number};
+      break;
+
+    case EXPR_INSTR_CONST:
+      regs[instr->dst] = expr_value_clone(&this->consts.data[instr->a]);
+      break;
+
+    case EXPR_INSTR_SLOT:
+      regs[instr->dst] = expr_value_clone(&slots[instr->a]);
+      break;
+
+    case EXPR_INSTR_LOAD:
+      res = this->ctx.vtable->get_variable_val(
+          this->ctx.data, str_slice_from_str_t(&this->names.data[instr->a]));
+      if (res.is_ok) regs[instr->dst] = res.ok;
+      break;
+
+    case EXPR_INSTR_VECTOR:
+      regs[instr->dst] = (ExprValue){
+          .type = EXPR_VALUE_VEC,
+          .vec = expr_vec_with_capacity(instr->b),
+      };
+      break;
+
+    case EXPR_INSTR_PUSH:
+      expr_vec_push(&regs[instr->dst].vec, take_register(this, instr->a));
+      break;
+
+    case EXPR_INSTR_BINARY:
+      if (instr->binary.scalar and regs[instr->a].type is EXPR_VALUE_NUMBER and
+          regs[instr->b].type is EXPR_VALUE_NUMBER) {
+        double value =
+            instr->binary.scalar(regs[instr->a].number, regs[instr->b].number);
+        regs[instr->b].type = EXPR_VALUE_NONE;
+        regs[instr->dst] =
+            (ExprValue){.type = EXPR_VALUE_NUMBER, .number = value};
+      } else {
+        ExprValue a = take_register(this, instr->a);
+        ExprValue b = take_register(this, instr->b);
+        res = instr->binary.fn(a, b);
+        if (res.is_ok) regs[instr->dst] = res.ok;
+      }
+      break;
+
+    case EXPR_INSTR_NATIVE:
+      if (instr->native.scalar and regs[instr->a].type is EXPR_VALUE_NUMBER) {
+        double value = instr->native.scalar(regs[instr->a].number);
+        regs[instr->dst] =
+            (ExprValue){.type = EXPR_VALUE_NUMBER, .number = value};
+      } else {
+        ExprValue args = take_register(this, instr->a);
+        res = instr->native.fn(expr_value_into_args(args));
+        if (res.is_ok) regs[instr->dst] = res.ok;
+      }
+      break;
+
+    case EXPR_INSTR_CALL: {
+      vec_ExprValue args = expr_value_into_args(take_register(this, instr->a));
+      res = this->ctx.vtable->call_function(
+          this->ctx.data, str_slice_from_str_t(&this->names.data[instr->b]),
+          args);
+      if (res.is_ok) regs[instr->dst] = res.ok;
+    } break;
+
+    case EXPR_INSTR_COPY:
+      regs[instr->dst] = expr_value_clone(&regs[instr->a]);
+      break;
+
+    case EXPR_INSTR_INVOKE:
+      res = run_callee(&this->callees.data[instr->b],
+                       take_register(this, instr->a), slots);
+      if (res.is_ok) regs[instr->dst] = res.ok;
+      break;
+
+    default:
+      panic("Unknown ExprInstr op: %d", instr->op);
+  }
+
+  return res;
+}
+
+ExprValueResult expr_program_run(ExprProgram* this, const ExprValue* slots) {
+  assert_m(this);
+  assert_m(slots or this->slots_count is 0);
+
+  ExprValueResult res = {.is_ok = true};
+  for (int i = 0; i < this->code.length and res.is_ok; i++)
+    res = run_instr(this, &this->code.data[i], slots);
+
+  if (res.is_ok) {
+    res.ok = take_register(this, this->result);
+    for (int i = 0; i < this->shared_count; i++)
+      expr_value_free(take_register(this, i));
+  } else {
+    // Leave registers empty for the next run
+    for (int i = 0; i < this->registers.length; i++)
+      expr_value_free(take_register(this, i));
+  }
+
+  return res;
+}
+
+// =====
+// =
+// = expr_eval_batch
+// =
+// =====
+
+// Points per pass: registers of a whole chunk stay in cache
+#define EXPR_BATCH_CHUNK 256
+
+static void run_numeric_chunk(ExprProgram* this, double* regs,
+                              const double* const* slots, int start, int n) {
+  for (int i = 0; i < this->code.length; i++) {
+    const ExprInstr* instr = &this->code.data[i];
+    double* dst = regs + instr->dst * EXPR_BATCH_CHUNK;
+    const double* a = regs + instr->a * EXPR_BATCH_CHUNK;
+    const double* b = regs + instr->b * EXPR_BATCH_CHUNK;
+
+    switch (instr->op) {
+      case EXPR_INSTR_NUMBER:
+        for (int k = 0; k < n; k++) dst[k] = instr->number;
+        break;
+
+      case EXPR_INSTR_CONST: {
+        double value = this->consts.data[instr->a].number;
+        for (int k = 0; k < n; k++) dst[k] = value;
+      } break;
+
+      case EXPR_INSTR_SLOT:
+        memcpy(dst, slots[instr->a] + start, sizeof(double) * n);
+        break;
+
+      case EXPR_INSTR_COPY:
+        memcpy(dst, a, sizeof(double) * n);
+        break;
+
+      case EXPR_INSTR_BINARY: {
+        ScalarOperatorFn fn = instr->binary.scalar;
+        if (instr->binary.batch)
+          instr->binary.batch(a, b, dst, n);
+        else
+          for (int k = 0; k < n; k++) dst[k] = fn(a[k], b[k]);
+      } break;
+
+      case EXPR_INSTR_NATIVE: {
+        NativeScalarFnPtr fn = instr->native.scalar;
+        if (instr->native.batch)
+          instr->native.batch(a, dst, n);
+        else
+          for (int k = 0; k < n; k++) dst[k] = fn(a[k]);
+      } break;
+
+      default:
+        panic("ExprInstr op %d is not numeric", instr->op);
+    }
+  }
+}
+
+static int eval_batch_numeric(ExprProgram* this, const double* const* slots,
+                              int count, double* out) {
+  int regs_count = this->registers.length;
+  double* regs =
+      (double*)MALLOC(sizeof(double) * regs_count * EXPR_BATCH_CHUNK);
+  assert_alloc(regs);
+
+  for (int start = 0; start < count; start += EXPR_BATCH_CHUNK) {
+    int n = count - start < EXPR_BATCH_CHUNK ? count - start : EXPR_BATCH_CHUNK;
+    run_numeric_chunk(this, regs, slots, start, n);
+    memcpy(out + start, regs + this->result * EXPR_BATCH_CHUNK,
+           sizeof(double) * n);
+  }
+
+  FREE(regs);
+  return 0;
+}
+
+static int eval_batch_by_point(ExprProgram* this, const double* const* slots,
+                               int count, double* out) {
+  int failed = 0;
+  vec_ExprValue point = vec_ExprValue_with_capacity(this->slots_count);
+  for (int s = 0; s < this->slots_count; s++)
+    vec_ExprValue_push(&point, (ExprValue){.type = EXPR_VALUE_NUMBER});
+
+  // Temporaries of a point are dropped all at once
+  static MyArena arena = MY_ARENA_INIT;
+
+  for (int i = 0; i < count; i++) {
+    for (int s = 0; s < this->slots_count; s++)
+      point.data[s].number = slots[s][i];
+
+    my_arena_begin(&arena);
+    ExprValueResult res = expr_program_run(this, point.data);
+    my_arena_end(&arena);
+
+    if (res.is_ok and res.ok.type is EXPR_VALUE_NUMBER) {
+      out[i] = res.ok.number;
+    } else {
+      out[i] = NAN;
+      failed++;
+    }
+    // Releases heap vectors the result shares
+    expr_value_result_free(res);
+    my_arena_reset(&arena);
+  }
+
+  vec_ExprValue_free(point);
+  return failed;
+}
+
+int expr_eval_batch(ExprProgram* this, const double* const* slots, int count,
+                    double* out) {
+  assert_m(this);
+  assert_m(slots or this->slots_count is 0);
+  assert_m(out or count is 0);
+
+  if (this->is_numeric)
+    return eval_batch_numeric(this, slots, count, out);
+  else
+    return eval_batch_by_point(this, slots, count, out);
+}
+
+// =====
+// =
+// = BASICS
+// =
+// =====
+
+void expr_program_free(ExprProgram this) {
+  vec_ExprInstr_free(this.code);
+  vec_ExprValue_free(this.consts);
+  vec_str_t_free(this.names);
+  vec_ExprCallee_free(this.callees);
+  vec_ExprValue_free(this.registers);
+}
+
+static void expr_callee_free(ExprCallee this) {
+  expr_program_free(*this.program);
+  FREE(this.program);
+  vec_ExprValue_free(this.frame);
+}
+
+void expr_program_print(const ExprProgram* this, OutStream out) {
+  for (int i = 0; i < this->code.length; i++) {
+    const ExprInstr* instr = &this->code.data[i];
+    x_sprintf(out, "%3d: r%d = ", i, instr->dst);
+
+    switch (instr->op) {
+      case EXPR_INSTR_NUMBER:
+        x_sprintf(out, "%lf", instr->number);
+        break;
+      case EXPR_INSTR_CONST:
+        x_sprintf(out, "const %$expr_value", this->consts.data[instr->a]);
+        break;
+      case EXPR_INSTR_SLOT:
+        x_sprintf(out, "slot %d", instr->a);
+        break;
+      case EXPR_INSTR_LOAD:
+        x_sprintf(out, "load '%s'", this->names.data[instr->a].string);
+        break;
+      case EXPR_INSTR_VECTOR:
+        x_sprintf(out, "vector (capacity %d)", instr->b);
+        break;
+      case EXPR_INSTR_PUSH:
+        x_sprintf(out, "push r%d", instr->a);
+        break;
+      case EXPR_INSTR_BINARY:
+        x_sprintf(out, "binary r%d r%d%s", instr->a, instr->b,
+                  instr->binary.scalar ? " (scalar)" : "");
+        break;
+      case EXPR_INSTR_NATIVE:
+        x_sprintf(out, "native r%d%s", instr->a,
+                  instr->native.scalar ? " (scalar)" : "");
+        break;
+      case EXPR_INSTR_CALL:
+        x_sprintf(out, "call '%s' r%d", this->names.data[instr->b].string,
+                  instr->a);
+        break;
+      case EXPR_INSTR_COPY:
+        x_sprintf(out, "copy r%d", instr->a);
+        break;
+      case EXPR_INSTR_INVOKE: {
+        const ExprCallee* callee = &this->callees.data[instr->b];
+        x_sprintf(out, "invoke '%s' r%d (%d slots)",
+                  callee->function->function.name.string, instr->a,
+                  callee->frame.length);
+      } break;
+      default:
+        x_sprintf(out, "unknown op %d", instr->op);
+    }
+    outstream_putc('\n', out);
+  }
+}
@@ -0,0 +1,105 @@
+#ifndef SRC_CALCULATOR_EXPR_PROGRAM_H_
+#define SRC_CALCULATOR_EXPR_PROGRAM_H_
+
+#include "../parser/expr.h"
+#include "../parser/expr_cse.h"
+#include "../parser/operators_fns.h"
+#include "../util/better_io.h"
+#include "calc_backend.h"
+#include "native_functions.h"
+
+// Flat register-based form of an Expr. Operators and native functions are
+// resolved to pointers, constant variables are computed, and variables listed
+// as slots (like x and y) are numbered, so running a program does no name
+// lookups at all. Small user functions are inlined (see expr_inline.h), the
+// others are compiled into programs of their own, called with their arguments
+// in slots. Subtrees that occur more than once are computed once per run and
+// copied from a shared register after that.
+// The program remembers the backend it was compiled against, and has to be
+// recompiled when the backend changes.
+
+#define EXPR_INSTR_NUMBER 1  // dst = number
+#define EXPR_INSTR_CONST 2   // dst = clone of consts[a]
+#define EXPR_INSTR_SLOT 3    // dst = clone of slots[a]
+#define EXPR_INSTR_LOAD 4    // dst = variable names[a], looked up at runtime
+#define EXPR_INSTR_VECTOR 5  // dst = empty vector with capacity b
+#define EXPR_INSTR_PUSH 6    // push register a into vector dst
+#define EXPR_INSTR_BINARY 7  // dst = a <operator> b
+#define EXPR_INSTR_NATIVE 8  // dst = native(a)
+#define EXPR_INSTR_CALL 9    // dst = user function names[b](a)
+#define EXPR_INSTR_COPY 10   // dst = clone of register a
+#define EXPR_INSTR_INVOKE 11  // dst = callees[b](a)
+
+typedef struct ExprInstr {
+  int op;
+  int dst;
+  int a;
+  int b;
+
+  union {
+    double number;
+
+    struct {
+      OperatorFn fn;
+      ScalarOperatorFn scalar;
+      BatchOperatorFn batch;
+    } binary;
+
+    struct {
+      NativeFnPtr fn;
+      NativeScalarFnPtr scalar;
+      NativeBatchFnPtr batch;
+    } native;
+  };
+} ExprInstr;
+
+#define VECTOR_H ExprInstr
+#include "../util/vector.h"
+
+// A user function compiled for one caller. Its slots are the arguments of the
+// function and then the slots of the caller: as in expr_calculate, a function
+// body sees the arguments of the functions that called it. A function never
+// calls itself successfully, so the program and the frame are never in use
+// twice at once, and every call reuses them
+typedef struct ExprCallee {
+  const CalcExpr* function;
+  struct ExprProgram* program;
+  int args_count;
+  vec_ExprValue frame;  // Slots of the program, empty between calls
+} ExprCallee;
+
+#define VECTOR_H ExprCallee
+#include "../util/vector.h"
+
+typedef struct ExprProgram {
+  vec_ExprInstr code;
+  vec_ExprValue consts;
+  vec_str_t names;
+  vec_ExprCallee callees;
+  vec_ExprValue registers;
+  int result;
+  int shared_count;  // Registers below the stack, kept for repeated subtrees
+  int slots_count;
+  bool is_numeric;  // Numbers and scalar shortcuts only, see expr_eval_batch
+  ExprContext ctx;
+} ExprProgram;
+
+ExprProgram expr_compile(const Expr* expr, CalcBackend* backend,
+                         const vec_str_t* slot_names);
+void expr_program_free(ExprProgram this);
+void expr_program_print(const ExprProgram* this, OutStream out);
+
+// `slots` has to hold `slots_count` numbers, ordered as `slot_names` were.
+// Inlining relies on them being numbers, see expr_inline.h
+ExprValueResult expr_program_run(ExprProgram* this, const ExprValue* slots);
+
+// Runs the program for `count` points at once. `slots[i]` is an array of
+// `count` values of slot i (x values, y values, ...), results go to `out`.
+// Numeric programs run instruction by instruction over chunks of points,
+// using SIMD kernels where operators and natives have them, others run point
+// by point. Points whose result is an error or not a number
+// get NaN. Returns the count of such points
+int expr_eval_batch(ExprProgram* this, const double* const* slots, int count,
+                    double* out);
+
+#endif  // SRC_CALCULATOR_EXPR_PROGRAM_H_
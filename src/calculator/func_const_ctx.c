@@ -11,8 +11,9 @@ static bool fctx_is_function(FuncConstCtx* this, StrSlice fun_name);
 
 // Computation
 static ExprValueResult fctx_get_variable_val(FuncConstCtx* this, StrSlice);
+static const ExprValue* fctx_get_variable_ref(FuncConstCtx* this, StrSlice);
 static ExprValueResult fctx_call_function(FuncConstCtx* this, StrSlice,
-                                          vec_ExprValue*);
+                                          vec_ExprValue);
 
 // Anasysis and compilation
 static bool fctx_is_expr_const(FuncConstCtx* this, const Expr* expr);
@@ -28,6 +29,7 @@ ExprContext func_const_ctx_context(FuncConstCtx* this) {
       .is_variable = (void*)fctx_is_variable,
       .is_function = (void*)fctx_is_function,
       .get_variable_val = (void*)fctx_get_variable_val,
+      .get_variable_ref = (void*)fctx_get_variable_ref,
       .call_function = (void*)fctx_call_function,
       .is_expr_const = (void*)fctx_is_expr_const,
       .get_expr_type = (void*)fctx_get_expr_type,
@@ -66,12 +68,22 @@ static ExprValueResult fctx_get_variable_val(FuncConstCtx* this,
 
   return this->parent.vtable->get_variable_val(this->parent.data, var_name);
 }
+static const ExprValue* fctx_get_variable_ref(FuncConstCtx* this,
+                                              StrSlice var_name) {
+  if (fctx_has_value(this, var_name) or
+      not this->parent.vtable->get_variable_ref)
+    return null;
+
+  return this->parent.vtable->get_variable_ref(this->parent.data, var_name);
+}
 static ExprValueResult fctx_call_function(FuncConstCtx* this, StrSlice fun_name,
-                                          vec_ExprValue* used_args) {
-  if (fctx_has_value(this, fun_name))
+                                          vec_ExprValue used_args) {
+  if (fctx_has_value(this, fun_name)) {
+    vec_ExprValue_free(used_args);
     return ExprValueErr(null, str_owned("'%$slice' is not a function, but a "
                                         "parent function argument instead",
                                         fun_name));
+  }
 
   return this->parent.vtable->call_function(this->parent.data, fun_name,
                                             used_args);
@@ -88,22 +100,25 @@ static bool pure_fctx_is_expr_const(FuncConstCtx* this, const Expr* expr) {
   if (expr->type is EXPR_NUMBER) {
     return true;
   } else if (expr->type is EXPR_VARIABLE) {
-    if (fctx_has_value(this, str_slice_from_str_t(&expr->variable.name))) {
+    if (fctx_has_value(this, expr_symbol_slice(expr->variable.name))) {
       return this->are_const;
+    } else if (this->are_only_literals_const) {
+      return false;
     } else {
       return this->parent.vtable->is_expr_const(this->parent.data, expr);
     }
   } else if (expr->type is EXPR_FUNCTION) {
-    if (fctx_has_value(this, str_slice_from_str_t(&expr->function.name)))
+    StrSlice name = expr_symbol_slice(expr->function.name);
+    if (fctx_has_value(this, name))
       return false;
     else {
-      StrSlice name = str_slice_from_str_t(&expr->function.name);
       bool is_arg_const =
           pure_fctx_is_expr_const(this, expr->function.argument);
       if (calculator_get_native_function(name))
         return is_arg_const;
       else
-        return fctx_get_function_info(this, name).is_const and is_arg_const;
+        return not this->are_only_literals_const and
+               fctx_get_function_info(this, name).is_const and is_arg_const;
     }
   } else if (expr->type is EXPR_VECTOR) {
     for (int i = 0; i < expr->vector.arguments.length; i++)
@@ -8,6 +8,9 @@ typedef struct FuncConstCtx {
   ExprContext parent;
   vec_str_t* used_args;
   bool are_const;
+  // Names of the parent are not const either, only numbers and native
+  // functions of them are. Nothing the user can edit is folded then
+  bool are_only_literals_const;
 } FuncConstCtx;
 
 ExprContext func_const_ctx_context(FuncConstCtx* this);
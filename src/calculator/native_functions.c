@@ -1,9 +1,14 @@
 #include "native_functions.h"
 
 #include <float.h>
+#include <limits.h>
 #include <math.h>
+#include <string.h>
 
 #include "../util/allocator.h"
+#include "../util/perfect_hash.h"
+#include "../util/simd_math.h"
+#include "native_functions_hash.h"
 
 static ExprValueResult calculator_func_cos(vec_ExprValue args);
 static ExprValueResult calculator_func_sin(vec_ExprValue args);
@@ -28,16 +33,28 @@ static ExprValueResult calculator_func_max(vec_ExprValue args);
         calculator_func_max,                                              \
   }
 
-NativeFnPtr calculator_get_native_function(StrSlice name) {
-  const char* const names[] = NATIVE_FUNCTION_NAMES;
-  NativeFnPtr const functions[] = FUNCTIONS;
-
-  assert_m(LEN(names) == LEN(functions));
-  for (int i = 0; i < (int)LEN(names); i++) {
-    if (str_slice_eq_ccp(name, names[i])) return functions[i];
-  }
+static const char* const NAMES[] = NATIVE_FUNCTION_NAMES;
+static const NativeFnPtr FUNCTIONS_TABLE[] = FUNCTIONS;
+_Static_assert(LEN(FUNCTIONS_TABLE) == LEN(NAMES),
+               "FUNCTIONS has to follow NATIVE_FUNCTION_NAMES");
+
+// Index in NATIVE_FUNCTION_NAMES or -1. One probe into the generated table,
+// then one compare
+static int native_function_index(StrSlice name) {
+  uint32_t hash =
+      perfect_hash(NATIVE_FUNCTIONS_HASH_SEED, name.start, name.length);
+  int i = NATIVE_FUNCTIONS_HASH_TABLE[hash & NATIVE_FUNCTIONS_HASH_MASK];
+  if (i < 0) return -1;
+
+  const char* text = NAMES[i];
+  if (strncmp(name.start, text, name.length) is 0 and text[name.length] is 0)
+    return i;
+  return -1;
+}
 
-  return null;
+NativeFnPtr calculator_get_native_function(StrSlice name) {
+  int i = native_function_index(name);
+  return i < 0 ? null : FUNCTIONS_TABLE[i];
 }
 
 static double basic_cos(double a) { return cos(a); }
@@ -50,37 +67,87 @@ static double basic_sqrt(double a) { return sqrt(a); }
 static double basic_ln(double a) { return log(a); }
 static double basic_log(double a) { return log(a) / log(10.0); }
 
-static vec_ExprValue template_unary_function_base(vec_ExprValue args,
-                                                  double (*fn)(double)) {
+#define SCALAR_FUNCTIONS                                                    \
+  {                                                                         \
+    basic_cos, basic_sin, basic_tan, basic_acos, basic_asin, basic_atan,    \
+        basic_sqrt, basic_ln, basic_log, null, null, null, null,            \
+  }
+
+static const NativeScalarFnPtr SCALAR_FUNCTIONS_TABLE[] = SCALAR_FUNCTIONS;
+_Static_assert(LEN(SCALAR_FUNCTIONS_TABLE) == LEN(NAMES),
+               "SCALAR_FUNCTIONS has to follow NATIVE_FUNCTION_NAMES");
+
+NativeScalarFnPtr calculator_get_native_scalar_function(StrSlice name) {
+  int i = native_function_index(name);
+  return i < 0 ? null : SCALAR_FUNCTIONS_TABLE[i];
+}
+
+#define BATCH_FUNCTIONS                                                    \
+  {                                                                        \
+    simd_cos, simd_sin, null, null, null, null, simd_sqrt, simd_ln,        \
+        simd_log10, null, null, null, null,                                \
+  }
+
+static const NativeBatchFnPtr BATCH_FUNCTIONS_TABLE[] = BATCH_FUNCTIONS;
+_Static_assert(LEN(BATCH_FUNCTIONS_TABLE) == LEN(NAMES),
+               "BATCH_FUNCTIONS has to follow NATIVE_FUNCTION_NAMES");
+
+NativeBatchFnPtr calculator_get_native_batch_function(StrSlice name) {
+  int i = native_function_index(name);
+  return i < 0 ? null : BATCH_FUNCTIONS_TABLE[i];
+}
+
+// Vectors of numbers go through `batch` in place, others element by element.
+// Returns the length of a vector too long to store, or 0
+static int template_unary_function_base(ExprVec* vec, double (*fn)(double),
+                                        NativeBatchFnPtr batch) {
   assert_m(fn);
+  if (not expr_vec_can_store(vec->length)) return vec->length;
 
-  for (int arg = 0; arg < args.length; arg++) {
-    ExprValue* item = &args.data[arg];
-
-    if (item->type is EXPR_VALUE_NONE) {
-      // nothing to do
-    } else if (item->type is EXPR_VALUE_NUMBER) {
-      item->number = fn(item->number);
-    } else if (item->type is EXPR_VALUE_VEC) {
-      item->vec = template_unary_function_base(item->vec, fn);
-    } else {
-      panic("Unknown ExprValue type");
+  double* numbers = expr_vec_numbers_mut(vec);
+  if (numbers and batch and vec->length >= 2) {
+    batch(numbers, numbers, vec->length);
+  } else if (numbers) {
+    for (int i = 0; i < vec->length; i++) numbers[i] = fn(numbers[i]);
+  } else {
+    ExprValue* items = expr_vec_items_mut(vec);
+    for (int i = 0; i < vec->length; i++) {
+      ExprValue* item = &items[i];
+
+      if (item->type is EXPR_VALUE_NONE) {
+        // nothing to do
+      } else if (item->type is EXPR_VALUE_NUMBER) {
+        item->number = fn(item->number);
+      } else if (item->type is EXPR_VALUE_VEC) {
+        int too_long = template_unary_function_base(&item->vec, fn, batch);
+        if (too_long) return too_long;
+      } else {
+        panic("Unknown ExprValue type");
+      }
     }
   }
 
-  return args;
+  return 0;
 }
 
 static ExprValueResult template_unary_function(vec_ExprValue args,
-                                               double (*fn)(double)) {
-  vec_ExprValue values = template_unary_function_base(args, fn);
+                                               double (*fn)(double),
+                                               NativeBatchFnPtr batch) {
+  ExprVec values = expr_vec_from_values(args);
+  int too_long = template_unary_function_base(&values, fn, batch);
+  if (too_long) {
+    expr_vec_free(values);
+    return expr_vec_too_long(too_long);
+  }
+
   ExprValue result;
   if (values.length is 0) {
     result = (ExprValue){.type = EXPR_VALUE_NONE};
-    vec_ExprValue_free(values);
+    expr_vec_free(values);
   } else if (values.length is 1) {
-    result = vec_ExprValue_popget(&values);
-    vec_ExprValue_free(values);
+    ExprValue item = expr_vec_at(&values, 0);
+    result = expr_value_clone(&item);
+    expr_vec_free(values);
   } else {
     result = (ExprValue){.type = EXPR_VALUE_VEC, .vec = values};
   }
@@ -92,47 +159,66 @@ static ExprValueResult template_unary_function(vec_ExprValue args,
 }
 
 ExprValueResult calculator_func_cos(vec_ExprValue args) {
-  return template_unary_function(args, basic_cos);
+  return template_unary_function(args, basic_cos, simd_cos);
 }
 ExprValueResult calculator_func_sin(vec_ExprValue args) {
-  return template_unary_function(args, basic_sin);
+  return template_unary_function(args, basic_sin, simd_sin);
 }
 ExprValueResult calculator_func_tan(vec_ExprValue args) {
-  return template_unary_function(args, basic_tan);
+  return template_unary_function(args, basic_tan, null);
 }
 ExprValueResult calculator_func_acos(vec_ExprValue args) {
-  return template_unary_function(args, basic_acos);
+  return template_unary_function(args, basic_acos, null);
 }
 ExprValueResult calculator_func_asin(vec_ExprValue args) {
-  return template_unary_function(args, basic_asin);
+  return template_unary_function(args, basic_asin, null);
 }
 ExprValueResult calculator_func_atan(vec_ExprValue args) {
-  return template_unary_function(args, basic_atan);
+  return template_unary_function(args, basic_atan, null);
 }
 ExprValueResult calculator_func_sqrt(vec_ExprValue args) {
-  return template_unary_function(args, basic_sqrt);
+  return template_unary_function(args, basic_sqrt, simd_sqrt);
 }
 ExprValueResult calculator_func_ln(vec_ExprValue args) {
-  return template_unary_function(args, basic_ln);
+  return template_unary_function(args, basic_ln, simd_ln);
 }
 ExprValueResult calculator_func_log(vec_ExprValue args) {
-  return template_unary_function(args, basic_log);
+  return template_unary_function(args, basic_log, simd_log10);
+}
+
+// Ranges, each starting where the previous one ends, are joined lazily
+static bool join_is_range(const vec_ExprValue* args) {
+  for (int i = 0; i < args->length; i++) {
+    const ExprValue* arg = &args->data[i];
+    if (arg->type is_not EXPR_VALUE_VEC or arg->vec.kind is_not EXPR_VEC_RANGE)
+      return false;
+
+    const ExprVec* prev = i > 0 ? &args->data[i - 1].vec : null;
+    if (prev and arg->vec.start != prev->start + prev->length) return false;
+  }
+  return true;
 }
 
 ExprValueResult calculator_func_join(vec_ExprValue args) {
-  vec_ExprValue values = vec_ExprValue_create();
+  long long length = 0;
+  for (int i = 0; i < args.length; i++)
+    length += args.data[i].type is EXPR_VALUE_VEC ? args.data[i].vec.length : 1;
+
+  // A single vector is returned as it is
+  bool is_stored = not join_is_range(&args) and args.length > 1;
+  if (is_stored ? not expr_vec_can_store(length) : length > INT_MAX) {
+    vec_ExprValue_free(args);
+    return expr_vec_too_long(length);
+  }
+
+  ExprVec values = expr_vec_create();
 
   for (int i = 0; i < args.length; i++) {
     ExprValue arg = args.data[i];
-    if (arg.type is EXPR_VALUE_VEC) {
-      for (int j = 0; j < arg.vec.length; j++) {
-        vec_ExprValue_push(&values, arg.vec.data[j]);
-      }
-      arg.vec.length = 0;
-      expr_value_free(arg);
-    } else {
-      vec_ExprValue_push(&values, arg);
-    }
+    if (arg.type is EXPR_VALUE_VEC)
+      expr_vec_append(&values, arg.vec);
+    else
+      expr_vec_push(&values, arg);
   }
   args.length = 0;  // All elements extracted
   vec_ExprValue_free(args);
@@ -146,7 +232,7 @@ ExprValueResult calculator_func_join(vec_ExprValue args) {
 #define EPSILON 0.0001
 
 static long long check_num_integer(double number, ExprValueResult* res) {
-  int result = 0;
+  long long result = 0;
   if (fabs(round(number) - number) > EPSILON) {
     (*res) = Err(
         str_owned("Slice error: number %lf is not an integer (error of +-" STR(
@@ -158,9 +244,10 @@ static long long check_num_integer(double number, ExprValueResult* res) {
   return result;
 }
 
-static ExprValueResult slice_base(vec_ExprValue indices, vec_ExprValue* data);
+static ExprValueResult slice_base(const ExprVec* indices, const ExprVec* data);
+// Does not take ownership of `index`
 static ExprValueResult slice_process_index(ExprValue index,
-                                           vec_ExprValue* data) {
+                                           const ExprVec* data) {
   ExprValueResult result = {.is_ok = true};
   if (index.type is EXPR_VALUE_NONE) {
     // none index -> none data
@@ -170,7 +257,8 @@ static ExprValueResult slice_process_index(ExprValue index,
 
     if (result.is_ok) {
       if (number >= 0 and number < (long long)data->length) {
-        result.ok = expr_value_clone(&data->data[number]);
+        ExprValue item = expr_vec_at(data, number);
+        result.ok = expr_value_clone(&item);
       } else {
         result =
             Err(str_owned("Index %lld is out of bounds for vector of size %d",
@@ -178,32 +266,43 @@ static ExprValueResult slice_process_index(ExprValue index,
       }
     }
   } else if (index.type is EXPR_VALUE_VEC) {
-    result = slice_base(index.vec, data);
-    index.type = EXPR_VALUE_NONE;
-    // no need to free
+    result = slice_base(&index.vec, data);
   } else {
     panic("Unknown ExprValue type");
   }
-  expr_value_free(index);
 
   return result;
 }
 
-static ExprValueResult slice_base(vec_ExprValue indices, vec_ExprValue* data) {
+static ExprValueResult slice_base(const ExprVec* indices, const ExprVec* data) {
   ExprValueResult res = {.is_ok = true};
-  for (int i = 0; i < indices.length and res.is_ok; i++) {
-    res = slice_process_index(indices.data[i], data);
 
-    if (res.is_ok)
-      indices.data[i] = res.ok;
-    else
-      indices.data[i].type = EXPR_VALUE_NONE;
+  // Consecutive indices take a part of `data` at once
+  if (indices->kind is EXPR_VEC_RANGE and indices->length > 0) {
+    long long first = check_num_integer(indices->start, &res);
+    long long last = first + indices->length - 1;
+    if (res.is_ok and first >= 0 and last < (long long)data->length) {
+      ExprVec part = expr_vec_slice(data, first, indices->length);
+      return (ExprValueResult){.is_ok = true,
+                               .ok = {.type = EXPR_VALUE_VEC, .vec = part}};
+    }
+    if (not res.is_ok) return res;
+  }
+  if (not expr_vec_can_store(indices->length))
+    return expr_vec_too_long(indices->length);
+
+  ExprVec values = expr_vec_with_capacity(indices->length);
+
+  for (int i = 0; i < indices->length and res.is_ok; i++) {
+    res = slice_process_index(expr_vec_at(indices, i), data);
+
+    if (res.is_ok) expr_vec_push(&values, res.ok);
   }
 
   if (res.is_ok)
-    res.ok = (ExprValue){.type = EXPR_VALUE_VEC, .vec = indices};
+    res.ok = (ExprValue){.type = EXPR_VALUE_VEC, .vec = values};
   else
-    vec_ExprValue_free(indices);
+    expr_vec_free(values);
 
   return res;
 }
@@ -220,94 +319,71 @@ ExprValueResult calculator_func_slice(vec_ExprValue args) {
     result =
         Err(str_literal("Function 'slice': second argument is not a vector"));
   } else {
-    vec_ExprValue indices = vec_ExprValue_popget(&args).vec;
-    vec_ExprValue data = vec_ExprValue_popget(&args).vec;
-    vec_ExprValue_free(args);
-    result = slice_base(indices, &data);
-    vec_ExprValue_free(data);
+    result = slice_base(&args.data[1].vec, &args.data[0].vec);
   }
+  vec_ExprValue_free(args);
   return result;
 }
 
-void push_min_value(double val, double* min, bool* is_init) {
-  if (*is_init)
-    (*min) = (*min) < val ? (*min) : val;
-  else {
-    (*min) = val;
+static void push_min_max_value(double val, bool is_max, double* result,
+                               bool* is_init) {
+  if (not(*is_init)) {
+    (*result) = val;
     (*is_init) = true;
+  } else if (is_max) {
+    (*result) = (*result) > val ? (*result) : val;
+  } else {
+    (*result) = (*result) < val ? (*result) : val;
   }
 }
 
-ExprValueResult calculator_func_min(vec_ExprValue args) {
-  double min = 0.0;
-  bool has_value = false;
-
-  for (int i = 0; i < args.length; i++) {
-    ExprValue arg = args.data[i];
-
-    if (arg.type is EXPR_VALUE_NONE) {
-      // skip
-    } else if (arg.type is EXPR_VALUE_NUMBER) {
-      push_min_value(arg.number, &min, &has_value);
-    } else if (arg.type is EXPR_VALUE_VEC) {
-      ExprValueResult res = calculator_func_min(arg.vec);
-      assert_m(res.is_ok);
-      ExprValue value = res.ok;
-      if (value.type is EXPR_VALUE_NUMBER) {
-        push_min_value(value.number, &min, &has_value);
+// Does not take ownership of `arg`, so nested vectors can be walked in place
+static void min_max_base(const ExprValue* arg, bool is_max, double* result,
+                         bool* has_value) {
+  if (arg->type is EXPR_VALUE_NONE) {
+    // skip
+  } else if (arg->type is EXPR_VALUE_NUMBER) {
+    push_min_max_value(arg->number, is_max, result, has_value);
+  } else if (arg->type is EXPR_VALUE_VEC and arg->vec.kind is EXPR_VEC_RANGE) {
+    if (arg->vec.length > 0) {
+      push_min_max_value(arg->vec.start, is_max, result, has_value);
+      push_min_max_value(arg->vec.start + (arg->vec.length - 1), is_max, result,
+                         has_value);
+    }
+  } else if (arg->type is EXPR_VALUE_VEC) {
+    const double* numbers = expr_vec_numbers(&arg->vec);
+    for (int i = 0; i < arg->vec.length; i++) {
+      if (numbers) {
+        push_min_max_value(numbers[i], is_max, result, has_value);
       } else {
-        assert_m(value.type is EXPR_VALUE_NONE);
+        ExprValue item = expr_vec_at(&arg->vec, i);
+        min_max_base(&item, is_max, result, has_value);
       }
-    } else {
-      panic("Unknown ExprValue type");
     }
+  } else {
+    panic("Unknown ExprValue type");
   }
+}
+
+static ExprValueResult template_min_max(vec_ExprValue args, bool is_max) {
+  double result = 0.0;
+  bool has_value = false;
+
+  for (int i = 0; i < args.length; i++)
+    min_max_base(&args.data[i], is_max, &result, &has_value);
+  vec_ExprValue_free(args);
 
-  debugln("Calculated min: %lf %d", min, has_value);
   return (ExprValueResult){
       .is_ok = true,
       .ok = {.type = has_value ? EXPR_VALUE_NUMBER : EXPR_VALUE_NONE,
-             .number = min},
+             .number = result},
   };
 }
 
-void push_max_value(double val, double* max, bool* is_init) {
-  if (*is_init)
-    (*max) = (*max) > val ? (*max) : val;
-  else {
-    (*max) = val;
-    (*is_init) = true;
-  }
+ExprValueResult calculator_func_min(vec_ExprValue args) {
+  return template_min_max(args, false);
 }
 
 ExprValueResult calculator_func_max(vec_ExprValue args) {
-  double max = 0.0;
-  bool has_value = false;
-
-  for (int i = 0; i < args.length; i++) {
-    ExprValue arg = args.data[i];
-
-    if (arg.type is EXPR_VALUE_NONE) {
-      // skip
-    } else if (arg.type is EXPR_VALUE_NUMBER) {
-      push_max_value(arg.number, &max, &has_value);
-    } else if (arg.type is EXPR_VALUE_VEC) {
-      ExprValueResult res = calculator_func_max(arg.vec);
-      assert_m(res.is_ok);
-      ExprValue value = res.ok;
-      if (value.type is EXPR_VALUE_NUMBER) {
-        push_max_value(value.number, &max, &has_value);
-      } else {
-        assert_m(value.type is EXPR_VALUE_NONE);
-      }
-    } else {
-      panic("Unknown ExprValue type");
-    }
-  }
-
-  return (ExprValueResult){
-      .is_ok = true,
-      .ok = {.type = has_value ? EXPR_VALUE_NUMBER : EXPR_VALUE_NONE,
-             .number = max},
-  };
-}
\ No newline at end of file
+  return template_min_max(args, true);
+}
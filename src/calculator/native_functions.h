@@ -3,6 +3,8 @@
 
 #include "../parser/expr_value.h"
 
+// The lookup table of the getters below is generated from this list, run
+// `make perfect_hash` after adding a function
 #define NATIVE_FUNCTION_NAMES                                                 \
   {                                                                           \
     "cos", "sin", "tan", "acos", "asin", "atan", "sqrt", "ln", "log", "join", \
@@ -12,6 +14,16 @@
 typedef ExprValueResult (*NativeFnPtr)(vec_ExprValue);
 
 NativeFnPtr calculator_get_native_function(StrSlice name);
+
+// Number-only shortcut of a unary math native (cos, sin, ..., log). Gives the
+// same result as the NativeFnPtr called with a single number argument
+typedef double (*NativeScalarFnPtr)(double);
+NativeScalarFnPtr calculator_get_native_scalar_function(StrSlice name);
+
+// Array form of the scalar shortcut for cos, sin, sqrt, ln and log. Runs on
+// SIMD kernels, which agree with the scalar one up to a couple of ulp
+typedef void (*NativeBatchFnPtr)(const double* a, double* out, int count);
+NativeBatchFnPtr calculator_get_native_batch_function(StrSlice name);
 /*
 ExprValueResult calculator_func_cos(vec_ExprValue args);
 ExprValueResult calculator_func_sin(vec_ExprValue args);
@@ -0,0 +1,14 @@
+// Generated by tools/perfect_hash_gen.c from NATIVE_FUNCTION_NAMES.
+// Do not edit, run `make perfect_hash` to update
+#ifndef SRC_CALCULATOR_NATIVE_FUNCTIONS_HASH_H_
+#define SRC_CALCULATOR_NATIVE_FUNCTIONS_HASH_H_
+
+#define NATIVE_FUNCTIONS_HASH_SEED 5u
+#define NATIVE_FUNCTIONS_HASH_MASK 31
+
+static const signed char NATIVE_FUNCTIONS_HASH_TABLE[] = {
+    3, 4, -1, -1, -1, -1, 7, -1, -1, 8, 9, -1, -1, 6, 11, -1,
+    0, 12, 5, -1, -1, -1, -1, -1, 1, 2, -1, -1, -1, 10, -1, -1,
+};
+
+#endif  // SRC_CALCULATOR_NATIVE_FUNCTIONS_HASH_H_
@@ -5,6 +5,7 @@
 #include <string.h>
 
 #include "../calculator/func_const_ctx.h"
+#include "../parser/expr_cse.h"
 #include "../util/allocator.h"
 
 static StrResult function_to_glsl(ExprContext ctx, GlslContext* glsl,
@@ -15,11 +16,141 @@ static StrResult variable_to_glsl(ExprContext ctx, GlslContext* glsl,
                                   const Expr* expr, const vec_str_t* used_args);
 
 static str_t non_const_types_err_msg(ExprValue value, const Expr* expr);
+static StrResult const_to_glsl(ExprContext ctx, GlslContext* glsl,
+                               const Expr* expr, bool is_lifted);
+static StrResult compile_expression(ExprContext ctx, GlslContext* glsl,
+                                    const Expr* expr,
+                                    const vec_str_t* used_args);
+
+// Repeated subtrees of a function body are declared as locals cse_<id>
+struct GlslBody {
+  ExprCse cse;
+  bool* is_declared;
+  StringStream locals;
+};
+
+typedef struct GlslSharingCtx {
+  ExprContext ctx;        // Of the body
+  ExprContext const_ctx;  // Arguments are not const
+  const vec_str_t* used_args;
+} GlslSharingCtx;
+
+// Names are not folded, their values become uniforms when compiled
+static Expr optimize(ExprContext ctx, const Expr* expr,
+                     const vec_str_t* used_args) {
+  FuncConstCtx fctx = {
+      .parent = ctx,
+      .used_args = (vec_str_t*)used_args,
+      .are_const = false,
+      .are_only_literals_const = true,
+  };
+  return expr_optimize(expr_clone(expr), func_const_ctx_context(&fctx));
+}
+
+// Constants are uniforms or numbers, arguments and x, y are read directly
+static bool is_worth_sharing(void* data, const Expr* expr) {
+  GlslSharingCtx* this = (GlslSharingCtx*)data;
+  ExprContext const_ctx = this->const_ctx;
+  if (const_ctx.vtable->is_expr_const(const_ctx.data, expr)) return false;
+  if (expr->type is EXPR_FUNCTION or expr->type is EXPR_BINARY_OP) return true;
+  if (expr->type is_not EXPR_VARIABLE) return false;
+
+  const char* name = expr_symbol_text(expr->variable.name);
+  for (int i = 0; i < this->used_args->length; i++)
+    if (strcmp(this->used_args->data[i].string, name) is 0) return false;
+  return this->ctx.vtable->is_variable(this->ctx.data,
+                                       str_slice_from_string(name));
+}
 
 StrResult glsl_compile_expression(ExprContext ctx, GlslContext* glsl,
                                   const Expr* expr,
                                   const vec_str_t* used_args) {
   assert_m(expr);
+  Expr optimized = optimize(ctx, expr, used_args);
+
+  // A single expression has nowhere to declare locals
+  GlslBody* outer = glsl->body;
+  glsl->body = null;
+  StrResult result = compile_expression(ctx, glsl, &optimized, used_args);
+  glsl->body = outer;
+
+  expr_free(optimized);
+  return result;
+}
+
+StrResult glsl_compile_function_body(ExprContext ctx, GlslContext* glsl,
+                                     const Expr* expr,
+                                     const vec_str_t* used_args) {
+  assert_m(expr);
+  Expr optimized = optimize(ctx, expr, used_args);
+
+  FuncConstCtx fctx = {
+      .parent = ctx,
+      .used_args = (vec_str_t*)used_args,
+      .are_const = false,
+  };
+  GlslSharingCtx sharing = {
+      .ctx = ctx,
+      .const_ctx = func_const_ctx_context(&fctx),
+      .used_args = used_args,
+  };
+  GlslBody body = {
+      .cse = expr_cse_create(),
+      .is_declared = null,
+      .locals = string_stream_create(),
+  };
+  expr_cse_count(&body.cse, &optimized, is_worth_sharing, &sharing);
+  if (body.cse.shared_count > 0) {
+    body.is_declared = (bool*)MALLOC(sizeof(bool) * body.cse.shared_count);
+    assert_alloc(body.is_declared);
+    memset(body.is_declared, 0, sizeof(bool) * body.cse.shared_count);
+  }
+
+  // Functions compiled on the way get bodies of their own
+  GlslBody* outer = glsl->body;
+  glsl->body = &body;
+  StrResult code = compile_expression(ctx, glsl, &optimized, used_args);
+  glsl->body = outer;
+
+  str_t locals = string_stream_to_str_t(body.locals);
+  StrResult result = code;
+  if (code.is_ok) {
+    result = StrOk(str_owned("%sreturn %s;", locals.string, code.data.string));
+    str_free(code.data);
+  }
+
+  str_free(locals);
+  FREE(body.is_declared);
+  expr_cse_free(body.cse);
+  expr_free(optimized);
+  return result;
+}
+
+// Repeated subtrees are computed into a local on the first use
+static StrResult compile_shared(ExprContext ctx, GlslContext* glsl,
+                                const Expr* expr, const vec_str_t* used_args,
+                                StrResult (*compile)(ExprContext, GlslContext*,
+                                                     const Expr*,
+                                                     const vec_str_t*)) {
+  GlslBody* body = glsl->body;
+  int shared = body ? expr_cse_shared_id(&body->cse, expr) : -1;
+  if (shared < 0) return compile(ctx, glsl, expr, used_args);
+  if (body->is_declared[shared]) return StrOk(str_owned("cse_%d", shared));
+
+  StrResult code = compile(ctx, glsl, expr, used_args);
+  if (not code.is_ok) return code;
+
+  OutStream os = string_stream_stream(&body->locals);
+  x_sprintf(os, "float cse_%d = %s;\n", shared, code.data.string);
+  body->is_declared[shared] = true;
+  str_free(code.data);
+  return StrOk(str_owned("cse_%d", shared));
+}
+
+static StrResult compile_expression(ExprContext ctx, GlslContext* glsl,
+                                    const Expr* expr,
+                                    const vec_str_t* used_args) {
+  assert_m(expr);
   // debugln("Compiling '%$expr'", *expr);
   FuncConstCtx fctx = {
       .parent = ctx,
@@ -28,19 +159,8 @@ StrResult glsl_compile_expression(ExprContext ctx, GlslContext* glsl,
   };
   ExprContext local_ctx = func_const_ctx_context(&fctx);
   if (local_ctx.vtable->is_expr_const(local_ctx.data, expr)) {
-    // Calculate and insert as-is
-    ExprValueResult res = expr_calculate(expr, local_ctx);
-    if (not res.is_ok) return StrErr(res.err_text);
-    ExprValue value = res.ok;
-
-    if (value.type != EXPR_VALUE_NUMBER) {
-      return StrErr(non_const_types_err_msg(value, expr));
-    } else {
-      str_t result = isnan(value.number) ? str_literal("nan")
-                                         : str_owned("%.10lf", value.number);
-      expr_value_free(value);
-      return StrOk(result);
-    }
+    // Numbers the user typed stay in the text, the rest depends on names
+    return const_to_glsl(local_ctx, glsl, expr, expr->type is_not EXPR_NUMBER);
   } else {
     // Convert to GLSL expression
     if (expr->type is EXPR_VECTOR) {
@@ -55,11 +175,14 @@ StrResult glsl_compile_expression(ExprContext ctx, GlslContext* glsl,
                            ? str_literal("nan")
                            : str_owned("%lf", expr->number.value));
         case EXPR_VARIABLE:
-          return variable_to_glsl(local_ctx, glsl, expr, used_args);
+          return compile_shared(local_ctx, glsl, expr, used_args,
+                                variable_to_glsl);
         case EXPR_FUNCTION:
-          return function_to_glsl(local_ctx, glsl, expr, used_args);
+          return compile_shared(local_ctx, glsl, expr, used_args,
+                                function_to_glsl);
         case EXPR_BINARY_OP:
-          return operator_to_glsl(local_ctx, glsl, expr, used_args);
+          return compile_shared(local_ctx, glsl, expr, used_args,
+                                operator_to_glsl);
         default:
           panic("Invalid expr type");
       }
@@ -69,11 +192,29 @@ StrResult glsl_compile_expression(ExprContext ctx, GlslContext* glsl,
 
 // HELPERS
 
+// Calculated here. A lifted value is passed as a uniform, so a new value of
+// the names it depends on keeps the source the same
+static StrResult const_to_glsl(ExprContext ctx, GlslContext* glsl,
+                               const Expr* expr, bool is_lifted) {
+  ExprValueResult res = expr_calculate(expr, ctx);
+  if (not res.is_ok) return StrErr(res.err_text);
+  ExprValue value = res.ok;
+  if (value.type != EXPR_VALUE_NUMBER)
+    return StrErr(non_const_types_err_msg(value, expr));
+
+  double number = value.number;
+  expr_value_free(value);
+  if (isnan(number)) return StrOk(str_literal("nan"));
+  if (is_lifted) return StrOk(glsl_context_add_uniform(glsl, number));
+  return StrOk(str_owned("%.10lf", number));
+}
+
 // =====
 // VARIABLE TO GLSL
 // =====
 
-static StrResult variable_to_glsl_calculate_const(const char* var_name,
+static StrResult variable_to_glsl_calculate_const(GlslContext* glsl,
+                                                  const char* var_name,
                                                   ExprVariableInfo info);
 static StrResult variable_to_glsl_turn_to_fn(GlslContext* glsl,
                                              const char* var_name,
@@ -82,9 +223,9 @@ static StrResult variable_to_glsl_turn_to_fn(GlslContext* glsl,
 static StrResult variable_to_glsl(ExprContext ctx, GlslContext* glsl,
                                   const Expr* expr,
                                   const vec_str_t* used_args) {
-  const char* var_name = expr->variable.name.string;
+  const char* var_name = expr_symbol_text(expr->variable.name);
   // debugln("Glsl var '%s'", var_name);
-  StrSlice var_name_slice = str_slice_from_str_t(&expr->variable.name);
+  StrSlice var_name_slice = expr_symbol_slice(expr->variable.name);
 
   StrResult result;
 
@@ -108,7 +249,7 @@ static StrResult variable_to_glsl(ExprContext ctx, GlslContext* glsl,
     if (info.is_const) {
       // Calculate and insert value
       debugln("Const");
-      result = variable_to_glsl_calculate_const(var_name, info);
+      result = variable_to_glsl_calculate_const(glsl, var_name, info);
     } else if (info.expression) {
       // Turn into var_ function of x, y
       debugln("Non const");
@@ -127,7 +268,8 @@ static StrResult variable_to_glsl(ExprContext ctx, GlslContext* glsl,
   return result;
 }
 
-static StrResult variable_to_glsl_calculate_const(const char* var_name,
+static StrResult variable_to_glsl_calculate_const(GlslContext* glsl,
+                                                  const char* var_name,
                                                   ExprVariableInfo info) {
   ExprValueResult value;
 
@@ -140,8 +282,8 @@ static StrResult variable_to_glsl_calculate_const(const char* var_name,
 
   StrResult result;
   if (value.is_ok) {
-    if (info.value->type is EXPR_VALUE_NUMBER)
-      result = StrOk(str_owned("%$expr_value", value.ok));
+    if (value.ok.type is EXPR_VALUE_NUMBER)
+      result = StrOk(glsl_context_add_uniform(glsl, value.ok.number));
     else
       result = StrErr(str_owned(
           "Non-number constants (%s = %$expr_value) cannot be used in plots",
@@ -165,17 +307,16 @@ static StrResult variable_to_glsl_turn_to_fn(GlslContext* glsl,
     str_free(glsl_var_fn_name);
   } else {
     vec_str_t args = vec_str_t_create();
-    StrResult code = glsl_compile_expression(info.correct_context, glsl,
-                                             info.expression, &args);
+    StrResult code = glsl_compile_function_body(info.correct_context, glsl,
+                                                info.expression, &args);
 
     if (code.is_ok) {
       result = StrOk(str_owned("%s(pos, step)", glsl_var_fn_name.string));
       GlslFunction fn = {
           .name = glsl_var_fn_name,
           .args = args,
-          .code = str_owned("return %s;", code.data.string),
+          .code = code.data,
       };
-      str_free(code.data);
       glsl_context_add_function(glsl, fn);
     } else {
       str_free(glsl_var_fn_name);
@@ -220,15 +361,15 @@ static StrResult function_to_glsl(ExprContext ctx, GlslContext* glsl,
   StrResult argument = glsl_compile_fn_args_values(
       ctx, glsl, expr->function.argument, used_args);
 
+  const char* fn_name = expr_symbol_text(expr->function.name);
   if (not argument.is_ok) {
     result = argument;
   } else {
-    if (is_func_glsl_native(expr->function.name.string)) {
-      result = StrOk(
-          call_native_function(expr->function.name.string,
-                               argument.data.string + 2));  // +2 to skip comma
+    if (is_func_glsl_native(fn_name)) {
+      result = StrOk(call_native_function(
+          fn_name, argument.data.string + 2));  // +2 to skip comma
     } else {
-      str_t shader_func_name = str_owned("func_%s", expr->function.name.string);
+      str_t shader_func_name = str_owned("func_%s", fn_name);
 
       if (not glsl_context_get_function(glsl, shader_func_name.string))
         result = compile_function_to_glsl(ctx, glsl, expr);
@@ -259,7 +400,7 @@ static StrResult glsl_compile_fn_args_values(ExprContext ctx, GlslContext* glsl,
 
     for (int i = 0; i < args_expr->length and result.is_ok; i++) {
       StrResult local_res =
-          glsl_compile_expression(ctx, glsl, &args_expr->data[i], used_args);
+          compile_expression(ctx, glsl, &args_expr->data[i], used_args);
       if (not local_res.is_ok) {
         result = local_res;
       } else {
@@ -269,7 +410,7 @@ static StrResult glsl_compile_fn_args_values(ExprContext ctx, GlslContext* glsl,
     }
   } else {
     StrResult local_res =
-        glsl_compile_expression(ctx, glsl, fn_argument, used_args);
+        compile_expression(ctx, glsl, fn_argument, used_args);
     if (not local_res.is_ok)
       result = local_res;
     else {
@@ -291,25 +432,24 @@ static StrResult glsl_compile_fn_args_values(ExprContext ctx, GlslContext* glsl,
 static StrResult compile_function_to_glsl(ExprContext ctx, GlslContext* glsl,
                                           const Expr* expr) {
   ExprFunctionInfo info = ctx.vtable->get_function_info(
-      ctx.data, str_slice_from_str_t(&expr->function.name));
+      ctx.data, expr_symbol_slice(expr->function.name));
 
+  const char* fn_name = expr_symbol_text(expr->function.name);
   StrResult result;
   if (not info.expression) {
-    result = StrErr(
-        str_owned("Function '%s' not found", expr->function.name.string));
+    result = StrErr(str_owned("Function '%s' not found", fn_name));
   } else {
-    StrResult code = glsl_compile_expression(info.correct_context, glsl,
-                                             info.expression, info.args_names);
+    StrResult code = glsl_compile_function_body(
+        info.correct_context, glsl, info.expression, info.args_names);
     if (not code.is_ok) {
       result = StrErr(code.data);
     } else {
       GlslFunction func = {
           .args = vec_str_t_clone(info.args_names),
-          .code = str_owned("return %s;", code.data.string),
-          .name = str_owned("func_%s", expr->function.name.string)};
+          .code = code.data,
+          .name = str_owned("func_%s", fn_name)};
 
       glsl_context_add_function(glsl, func);
-      str_free(code.data);
 
       result = StrOk(str_literal("-"));
     }
@@ -324,10 +464,10 @@ static StrResult ftgl_check_correctness(ExprContext ctx, GlslContext* glsl,
   unused(glsl);
   unused(used_args);
   assert_m(expr->type is EXPR_FUNCTION);
-  int required_args = get_func_args_count(ctx, expr->function.name.string);
+  const char* fn_name = expr_symbol_text(expr->function.name);
+  int required_args = get_func_args_count(ctx, fn_name);
   if (required_args < 0)
-    return StrErr(
-        str_owned("Function '%s' cannot be found", expr->function.name.string));
+    return StrErr(str_owned("Function '%s' cannot be found", fn_name));
 
   int fn_args_count;
   if (expr->function.argument->type != EXPR_VECTOR) {
@@ -339,7 +479,7 @@ static StrResult ftgl_check_correctness(ExprContext ctx, GlslContext* glsl,
   if (fn_args_count != required_args)
     return StrErr(str_owned(
         "Function '%s' accepts %d arguments, but %d args were provided.",
-        expr->function.name.string, required_args, fn_args_count));
+        fn_name, required_args, fn_args_count));
 
   return StrOk(str_literal("Ok"));
 }
@@ -395,7 +535,6 @@ static str_t non_const_types_err_msg(ExprValue value, const Expr* expr) {
 }
 
 // + - * / ^ > < >= <= == = !=
-#define cmp(a, b) strcmp((a), (b)) is 0
 
 #define TemplateOperator(fn_name, ...)                                    \
   static StrResult fn_name##_operator(ExprContext ctx, GlslContext* glsl, \
@@ -403,11 +542,11 @@ static str_t non_const_types_err_msg(ExprValue value, const Expr* expr) {
                                       const vec_str_t* used_args) {       \
     assert_m(expr->type is EXPR_BINARY_OP);                               \
                                                                           \
-    StrResult left_r = glsl_compile_expression(                           \
+    StrResult left_r = compile_expression(                                \
         ctx, glsl, expr->binary_operator.lhs, used_args);                 \
     if (not left_r.is_ok) return left_r;                                  \
                                                                           \
-    StrResult right_r = glsl_compile_expression(                          \
+    StrResult right_r = compile_expression(                               \
         ctx, glsl, expr->binary_operator.rhs, used_args);                 \
     if (not right_r.is_ok) {                                              \
       str_result_free(left_r);                                            \
@@ -415,7 +554,7 @@ static str_t non_const_types_err_msg(ExprValue value, const Expr* expr) {
     }                                                                     \
     const char* left = left_r.data.string;                                \
     const char* right = right_r.data.string;                              \
-    const char* name = expr->binary_operator.name.string;                 \
+    const char* name = expr_operator_name(expr->binary_operator.op);      \
     unused(name);                                                         \
     unused(left);                                                         \
     unused(right);                                                        \
@@ -441,23 +580,30 @@ static StrResult operator_to_glsl(ExprContext this, GlslContext* glsl,
                                   const vec_str_t* used_args) {
   assert_m(expr->type is EXPR_BINARY_OP);
 
-  const char* op_name = expr->binary_operator.name.string;
-
-  if (cmp(op_name, "+") or cmp(op_name, "-") or cmp(op_name, "*") or
-      cmp(op_name, "/")) {
-    return classic_operator(this, glsl, expr, used_args);
-  } else if (cmp(op_name, "^")) {
-    return powf_operator(this, glsl, expr, used_args);
-  } else if (cmp(op_name, "<") or cmp(op_name, ">") or cmp(op_name, "<=") or
-             cmp(op_name, ">=")) {
-    return comparsion_operator(this, glsl, expr, used_args);
-  } else if (cmp(op_name, "==") or cmp(op_name, "!=") or cmp(op_name, "=")) {
-    return equality_operator(this, glsl, expr, used_args);
-  } else if (cmp(op_name, "%") or cmp(op_name, "mod")) {
-    return mod_operator(this, glsl, expr, used_args);
-  } else {
-    return StrErr(
-        str_owned("Operator '%s' cannot used in plot-expression", op_name));
+  ExprOperator op = expr->binary_operator.op;
+  switch (op) {
+    case EXPR_OP_ADD:
+    case EXPR_OP_SUB:
+    case EXPR_OP_MUL:
+    case EXPR_OP_DIV:
+      return classic_operator(this, glsl, expr, used_args);
+    case EXPR_OP_POW:
+      return powf_operator(this, glsl, expr, used_args);
+    case EXPR_OP_LT:
+    case EXPR_OP_GT:
+    case EXPR_OP_LTE:
+    case EXPR_OP_GTE:
+      return comparsion_operator(this, glsl, expr, used_args);
+    case EXPR_OP_EQ:
+    case EXPR_OP_NEQ:
+    case EXPR_OP_EQUATION:
+      return equality_operator(this, glsl, expr, used_args);
+    case EXPR_OP_MOD:
+    case EXPR_OP_MOD_WORD:
+      return mod_operator(this, glsl, expr, used_args);
+    default:
+      return StrErr(str_owned("Operator '%s' cannot used in plot-expression",
+                              expr_operator_name(op)));
   }
 }
 
@@ -468,11 +614,14 @@ static StrResult powf_operator(ExprContext ctx, GlslContext* glsl,
   assert_m(expr->type is EXPR_BINARY_OP);
 
   StrResult left_r =
-      glsl_compile_expression(ctx, glsl, expr->binary_operator.lhs, used_args);
+      compile_expression(ctx, glsl, expr->binary_operator.lhs, used_args);
   if (not left_r.is_ok) return left_r;
 
-  StrResult right_r =
-      glsl_compile_expression(ctx, glsl, expr->binary_operator.rhs, used_args);
+  // Integer powers are unrolled, so constant exponents are never uniforms
+  const Expr* rhs = expr->binary_operator.rhs;
+  StrResult right_r = ctx.vtable->is_expr_const(ctx.data, rhs)
+                          ? const_to_glsl(ctx, glsl, rhs, false)
+                          : compile_expression(ctx, glsl, rhs, used_args);
   if (not right_r.is_ok) {
     str_result_free(left_r);
     return right_r;
@@ -541,35 +690,33 @@ static str_t eq_function_text(const char* fn_name, const char* used_args_text,
 static StrResult equality_operator(ExprContext ctx, GlslContext* glsl,
                                    const Expr* expr,
                                    const vec_str_t* used_args) {
-  const char* op_name = expr->binary_operator.name.string;
+  ExprOperator op = expr->binary_operator.op;
   bool eq_or_neq;
-  if (cmp(op_name, "==") or cmp(op_name, "="))
+  if (op is EXPR_OP_EQ or op is EXPR_OP_EQUATION)
     eq_or_neq = true;
-  else if (cmp(op_name, "!="))
+  else if (op is EXPR_OP_NEQ)
     eq_or_neq = false;
   else
     panic("Invalid eq operator");
 
-  StrResult left_r =
-      glsl_compile_expression(ctx, glsl, expr->binary_operator.lhs, used_args);
-  if (not left_r.is_ok) return left_r;
-
-  StrResult right_r =
-      glsl_compile_expression(ctx, glsl, expr->binary_operator.rhs, used_args);
-  if (not right_r.is_ok) {
-    str_result_free(left_r);
-    return right_r;
-  }
+  // The difference is sampled at other points, so it is a function of its
+  // own, with its own locals. Both sides are borrowed
+  Expr difference = {
+      .type = EXPR_BINARY_OP,
+      .binary_operator = {.op = EXPR_OP_SUB,
+                          .lhs = expr->binary_operator.lhs,
+                          .rhs = expr->binary_operator.rhs},
+  };
+  StrResult code =
+      glsl_compile_function_body(ctx, glsl, &difference, used_args);
+  if (not code.is_ok) return code;
 
   str_t expr_function_name = glsl_context_get_unique_fn_name(glsl);
   GlslFunction fn = {
       .name = str_clone(&expr_function_name),
       .args = vec_str_t_clone(used_args),
-      .code = str_owned("return (%s) - (%s);", left_r.data.string,
-                        right_r.data.string),
+      .code = code.data,
   };
-  str_result_free(left_r);
-  str_result_free(right_r);
   glsl_context_add_function(glsl, fn);
 
   str_t args_text = glsl_args_vals_to_string(used_args);
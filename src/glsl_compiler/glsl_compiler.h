@@ -9,7 +9,19 @@
 #include "glsl_context.h"
 #include "glsl_function.h"
 
+// Constants that depend on names are not in the code: they are read from
+// uniforms, which are added to `glsl->uniforms` with their values. Editing
+// a value then gives the same code and only a new binding table. Numbers
+// written as such and exponents stay in the code
+
+// GLSL expression with the value of `expr`, functions it calls are added to
+// `glsl`
 StrResult glsl_compile_expression(ExprContext calc, GlslContext* glsl,
                                   const Expr* expr, const vec_str_t* used_args);
+// Statements of a GLSL function that returns the value of `expr`. Repeated
+// subexpressions are computed once into locals
+StrResult glsl_compile_function_body(ExprContext calc, GlslContext* glsl,
+                                     const Expr* expr,
+                                     const vec_str_t* used_args);
 
 #endif  // SRC_CALCULATOR_GLSL_RENDERER_H_
\ No newline at end of file
@@ -7,11 +7,14 @@
 GlslContext glsl_context_create() {
   return (GlslContext){
       .functions = vec_GlslFunction_create(),
+      .uniforms = vec_GlslUniform_create(),
+      .body = null,
   };
 }
 
 void glsl_context_free(GlslContext this) {
   vec_GlslFunction_free(this.functions);
+  vec_GlslUniform_free(this.uniforms);
 }
 
 str_t glsl_context_get_unique_fn_name(GlslContext* this) {
@@ -53,3 +56,18 @@ GlslFunction* glsl_context_get_function(GlslContext* this,
 
   return null;
 }
+
+str_t glsl_context_add_uniform(GlslContext* this, double value) {
+  // Named by order, so the source does not depend on values
+  str_t name = str_owned("u_const_%d", this->uniforms.length);
+  vec_GlslUniform_push(&this->uniforms,
+                       (GlslUniform){.name = str_clone(&name), .value = value});
+  return name;
+}
+
+void glsl_context_print_uniforms(GlslContext* this, OutStream out) {
+  for (int i = 0; i < this->uniforms.length; i++) {
+    glsl_uniform_print(&this->uniforms.data[i], out);
+    outstream_puts("\n", out);
+  }
+}
@@ -2,9 +2,15 @@
 #define SRC_GLSL_COMPILER_GLSL_CONTEXT_H_
 
 #include "glsl_function.h"
+#include "glsl_uniform.h"
+
+// Function body being compiled, see glsl_compile_function_body
+typedef struct GlslBody GlslBody;
 
 typedef struct GlslContext {
   vec_GlslFunction functions;
+  vec_GlslUniform uniforms;  // Constants the code reads, see glsl_compiler.h
+  GlslBody* body;            // null outside of function bodies
 } GlslContext;
 
 GlslContext glsl_context_create();
@@ -15,4 +21,9 @@ void glsl_context_print_all_functions(GlslContext* this, OutStream out);
 void glsl_context_add_function(GlslContext* this, GlslFunction fn);
 GlslFunction* glsl_context_get_function(GlslContext* this, const char* fn_name);
 
+// Name of a new uniform with `value`
+str_t glsl_context_add_uniform(GlslContext* this, double value);
+// Declarations of the uniforms, they go before the functions
+void glsl_context_print_uniforms(GlslContext* this, OutStream out);
+
 #endif  // SRC_GLSL_COMPILER_GLSL_CONTEXT_H_
\ No newline at end of file
@@ -0,0 +1,58 @@
+#include "glsl_uniform.h"
+
+#include <stdio.h>
+
+#include "../util/allocator.h"
+
+#define VECTOR_C GlslUniform
+#define VECTOR_ITEM_DESTRUCTOR glsl_uniform_free
+#define VECTOR_ITEM_CLONE glsl_uniform_clone
+#include "../util/vector.h"  // vec_GlslUniform
+
+#define MAX_NAME 64
+
+void glsl_uniform_free(GlslUniform this) { str_free(this.name); }
+
+GlslUniform glsl_uniform_clone(const GlslUniform* this) {
+  return (GlslUniform){
+      .name = str_clone(&this->name),
+      .value = this->value,
+  };
+}
+
+void glsl_uniform_print(const GlslUniform* this, OutStream out) {
+  x_sprintf(out, "uniform float %s;", this->name.string);
+}
+
+str_t glsl_uniforms_to_text(const vec_GlslUniform* uniforms) {
+  StringStream stream = string_stream_create();
+  OutStream os = string_stream_stream(&stream);
+
+  for (int i = 0; i < uniforms->length; i++) {
+    // x_printf has no %g, and 17 digits are what a double needs
+    char value[32];
+    snprintf(value, sizeof(value), "%.17g", uniforms->data[i].value);
+    x_sprintf(os, "%s %s\n", uniforms->data[i].name.string, value);
+  }
+  return string_stream_to_str_t(stream);
+}
+
+bool glsl_uniforms_from_text(const char* text, vec_GlslUniform* uniforms) {
+  int length = uniforms->length;
+
+  char name[MAX_NAME];
+  double value;
+  int read;
+  while (sscanf(text, " %63s %lf%n", name, &value, &read) is 2) {
+    GlslUniform uniform = {.name = str_owned("%s", name), .value = value};
+    vec_GlslUniform_push(uniforms, uniform);
+    text += read;
+  }
+
+  // Stopped before the end
+  while (*text is ' ' or *text is '\n') text++;
+  if (*text is '\0') return true;
+
+  while (uniforms->length > length) vec_GlslUniform_popfree(uniforms);
+  return false;
+}
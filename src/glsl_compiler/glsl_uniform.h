@@ -0,0 +1,30 @@
+#ifndef SRC_GLSL_COMPILER_GLSL_UNIFORM_H_
+#define SRC_GLSL_COMPILER_GLSL_UNIFORM_H_
+
+#include <stdbool.h>
+
+#include "../util/better_io.h"
+#include "../util/better_string.h"
+
+// Constant the generated code reads from a uniform, so that a new value
+// keeps the source the same
+typedef struct GlslUniform {
+  str_t name;
+  double value;
+} GlslUniform;
+void glsl_uniform_free(GlslUniform this);
+GlslUniform glsl_uniform_clone(const GlslUniform* this);
+
+// Declaration of the uniform
+void glsl_uniform_print(const GlslUniform* this, OutStream out);
+
+#define VECTOR_H GlslUniform
+#include "../util/vector.h"  // vec_GlslUniform
+
+// Binding table, a line `<name> <value>` for each. Values are exact
+str_t glsl_uniforms_to_text(const vec_GlslUniform* uniforms);
+// Appends what glsl_uniforms_to_text gave. False and nothing appended if
+// `text` is not that
+bool glsl_uniforms_from_text(const char* text, vec_GlslUniform* uniforms);
+
+#endif  // SRC_GLSL_COMPILER_GLSL_UNIFORM_H_
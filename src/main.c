@@ -9,6 +9,8 @@
 #include <nuklear_style.c>
 
 #include "app.h"
+#include "calculator/calc_parse_cache.h"
+#include "parser/expr_symbols.h"
 #include "util/allocator.h"
 #include "util/prettify_c.h"
 
@@ -89,6 +91,12 @@ int main() {
   debugln("Terminating GLFW");
   glfwTerminate();
 
+  // Cached parses use interned names, so they go first
+  calc_parse_cache_free();
+  calc_backend_frames_free();
+  // Names interned while parsing live until the very end
+  expr_symbols_free();
+
   debugln("Done. Stopping the program");
   my_allocator_dump_short();
   return 0;
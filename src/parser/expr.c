@@ -1,6 +1,8 @@
 
 #include "expr.h"
 
+#include <string.h>
+
 #include "../util/allocator.h"
 
 #define VECTOR_C Expr
@@ -26,10 +28,9 @@ void expr_free(Expr this) {
   if (this.type is EXPR_NUMBER) {
     // Number does not OWN any resources to free
   } else if (this.type is EXPR_VARIABLE) {
-    str_free(this.variable.name);
+    // Names are interned symbols
 
   } else if (this.type is EXPR_FUNCTION) {
-    str_free(this.function.name);
     if (this.function.argument) {
       expr_free(*this.function.argument);
       FREE(this.function.argument);
@@ -39,8 +40,6 @@ void expr_free(Expr this) {
     vec_Expr_free(this.vector.arguments);
 
   } else if (this.type is EXPR_BINARY_OP) {
-    str_free(this.binary_operator.name);
-
     if (this.binary_operator.lhs) expr_free(*this.binary_operator.lhs);
     if (this.binary_operator.rhs) expr_free(*this.binary_operator.rhs);
     FREE(this.binary_operator.lhs);
@@ -65,9 +64,9 @@ void expr_print(const Expr* this, OutStream out) {
     x_sprintf(out, "%.1lf", this->number.value);
 
   } else if (this->type is EXPR_VARIABLE) {
-    x_sprintf(out, "%s", this->variable.name.string);
+    x_sprintf(out, "%s", expr_symbol_text(this->variable.name));
   } else if (this->type is EXPR_FUNCTION) {
-    x_sprintf(out, "<%s> ", this->function.name.string);
+    x_sprintf(out, "<%s> ", expr_symbol_text(this->function.name));
     expr_print(this->function.argument, out);
 
   } else if (this->type is EXPR_VECTOR) {
@@ -92,14 +91,14 @@ static void expr_print_binary_op(const Expr* this, OutStream out) {
   outstream_putc('(', out);
   expr_print(this->binary_operator.lhs, out);
 
-  if (strcmp(this->binary_operator.name.string, "[]") is 0) {
+  if (this->binary_operator.op is EXPR_OP_INDEX) {
     // Indexing[operator]
     outstream_putc('[', out);
     expr_print(this->binary_operator.rhs, out);
     outstream_putc(']', out);
   } else {
     // Regular + operator
-    x_sprintf(out, " %s ", this->binary_operator.name.string);
+    x_sprintf(out, " %s ", expr_operator_name(this->binary_operator.op));
     expr_print(this->binary_operator.rhs, out);
   }
 
@@ -115,20 +114,14 @@ Expr expr_clone(const Expr* this) {
   assert_m(this);
 
   Expr result;
-  if (this->type is EXPR_NUMBER) {
+  if (this->type is EXPR_NUMBER or this->type is EXPR_VARIABLE) {
     result = *this;
 
-  } else if (this->type is EXPR_VARIABLE) {
-    result = (Expr){
-        .type = EXPR_VARIABLE,
-        .variable.name = str_clone(&this->variable.name),
-    };
-
   } else if (this->type is EXPR_FUNCTION) {
     result = (Expr){.type = EXPR_FUNCTION,
                     .function = {.argument = expr_move_to_heap(
                                      expr_clone(this->function.argument)),
-                                 .name = str_clone(&this->function.name)}};
+                                 .name = this->function.name}};
 
   } else if (this->type is EXPR_VECTOR) {
     result = (Expr){
@@ -140,7 +133,7 @@ Expr expr_clone(const Expr* this) {
     result = (Expr){
         .type = EXPR_BINARY_OP,
         .binary_operator = {
-            .name = str_clone(&this->binary_operator.name),
+            .op = this->binary_operator.op,
             .lhs = expr_move_to_heap(expr_clone(this->binary_operator.lhs)),
             .rhs = expr_move_to_heap(expr_clone(this->binary_operator.rhs)),
         }};
@@ -152,6 +145,99 @@ Expr expr_clone(const Expr* this) {
   return result;
 }
 
+// =====
+// =
+// = expr_hash, expr_equal
+// =
+// =====
+static uint32_t hash_bytes(uint32_t hash, const void* data, size_t size) {
+  const unsigned char* bytes = (const unsigned char*)data;
+  for (size_t i = 0; i < size; i++) {
+    hash ^= bytes[i];
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+uint32_t expr_hash_node(const Expr* this, ExprHashFn child_hash, void* data) {
+  assert_m(this and child_hash);
+  uint32_t hash = hash_bytes(2166136261u, &this->type, sizeof(this->type));
+
+  if (this->type is EXPR_NUMBER) {
+    hash = hash_bytes(hash, &this->number.value, sizeof(double));
+
+  } else if (this->type is EXPR_VARIABLE) {
+    hash = hash_bytes(hash, &this->variable.name, sizeof(ExprSymbol));
+
+  } else if (this->type is EXPR_FUNCTION) {
+    hash = hash_bytes(hash, &this->function.name, sizeof(ExprSymbol));
+    uint32_t argument = child_hash(data, this->function.argument);
+    hash = hash_bytes(hash, &argument, sizeof(argument));
+
+  } else if (this->type is EXPR_VECTOR) {
+    const vec_Expr* items = &this->vector.arguments;
+    for (int i = 0; i < items->length; i++) {
+      uint32_t item = child_hash(data, &items->data[i]);
+      hash = hash_bytes(hash, &item, sizeof(item));
+    }
+
+  } else if (this->type is EXPR_BINARY_OP) {
+    hash = hash_bytes(hash, &this->binary_operator.op, sizeof(ExprOperator));
+    uint32_t lhs = child_hash(data, this->binary_operator.lhs);
+    uint32_t rhs = child_hash(data, this->binary_operator.rhs);
+    hash = hash_bytes(hash, &lhs, sizeof(lhs));
+    hash = hash_bytes(hash, &rhs, sizeof(rhs));
+
+  } else {
+    panic("Invalid expr type");
+  }
+
+  return hash;
+}
+
+static uint32_t hash_child(void* data, const Expr* child) {
+  unused(data);
+  return expr_hash(child);
+}
+
+uint32_t expr_hash(const Expr* this) {
+  return expr_hash_node(this, hash_child, null);
+}
+
+bool expr_equal(const Expr* a, const Expr* b) {
+  assert_m(a and b);
+  if (a->type is_not b->type) return false;
+
+  if (a->type is EXPR_NUMBER) {
+    // Bitwise, so 0.0 and -0.0 differ and NaN equals itself
+    return memcmp(&a->number.value, &b->number.value, sizeof(double)) is 0;
+
+  } else if (a->type is EXPR_VARIABLE) {
+    return a->variable.name is b->variable.name;
+
+  } else if (a->type is EXPR_FUNCTION) {
+    return a->function.name is b->function.name and
+           expr_equal(a->function.argument, b->function.argument);
+
+  } else if (a->type is EXPR_VECTOR) {
+    const vec_Expr* a_items = &a->vector.arguments;
+    const vec_Expr* b_items = &b->vector.arguments;
+    if (a_items->length is_not b_items->length) return false;
+
+    for (int i = 0; i < a_items->length; i++)
+      if (not expr_equal(&a_items->data[i], &b_items->data[i])) return false;
+    return true;
+
+  } else if (a->type is EXPR_BINARY_OP) {
+    return a->binary_operator.op is b->binary_operator.op and
+           expr_equal(a->binary_operator.lhs, b->binary_operator.lhs) and
+           expr_equal(a->binary_operator.rhs, b->binary_operator.rhs);
+
+  } else {
+    panic("Invalid expr type");
+  }
+}
+
 // =====
 // =
 // = expr_move_to_heap
@@ -1,9 +1,13 @@
 #ifndef SRC_PARSER_EXPR_H_
 #define SRC_PARSER_EXPR_H_
 
+#include <stdint.h>
+
 #include "../util/better_io.h"
 #include "../util/better_string.h"
+#include "expr_symbols.h"
 #include "expr_value.h"
+#include "operators_fns.h"
 #include "token_tree.h"
 
 typedef struct Expr Expr;
@@ -27,11 +31,11 @@ typedef struct ExprNumber {
 } ExprNumber;
 
 typedef struct ExprVariable {
-  str_t name;
+  ExprSymbol name;
 } ExprVariable;
 
 typedef struct ExprFunction {
-  str_t name;
+  ExprSymbol name;
   Expr* argument;
 } ExprFunction;
 
@@ -40,7 +44,7 @@ typedef struct ExprVector {
 } ExprVector;
 
 typedef struct ExprBinaryOp {
-  str_t name;
+  ExprOperator op;
   Expr* lhs;
   Expr* rhs;
 } ExprBinaryOp;
@@ -96,7 +100,11 @@ typedef struct ExprContextVtable {
 
   // Computation
   ExprValueResult (*get_variable_val)(void*, StrSlice);
-  ExprValueResult (*call_function)(void*, StrSlice, vec_ExprValue*);
+  // Stored value of a variable without a copy, null if there is none (it has
+  // to be calculated). Valid while the context is not changed. Optional
+  const ExprValue* (*get_variable_ref)(void*, StrSlice);
+  // Takes ownership of the arguments
+  ExprValueResult (*call_function)(void*, StrSlice, vec_ExprValue);
 
   // Anasysis and compilation
   bool (*is_expr_const)(void* this, const Expr* expr);
@@ -135,9 +143,19 @@ void expr_print(const Expr* this, OutStream out);
 Expr expr_clone(const Expr* this);
 Expr* expr_move_to_heap(Expr value);
 const char* expr_type_text(int type);
+// Structural: same node types, symbols, operators and numbers all the way down
+uint32_t expr_hash(const Expr* this);
+// expr_hash of `this` from the hashes of its children, so that a whole tree
+// can be hashed bottom-up once
+typedef uint32_t (*ExprHashFn)(void* data, const Expr* child);
+uint32_t expr_hash_node(const Expr* this, ExprHashFn child_hash, void* data);
+bool expr_equal(const Expr* a, const Expr* b);
 
 // -- Parsing
+// Straight from the tokens in one pass, see expr_parse_direct.c
 ExprResult expr_parse_string(const char* text, ExprContext ctx);
+// The same through token_tree_parse, which calc_expr_parse builds on
+ExprResult expr_parse_string_tree(const char* text, ExprContext ctx);
 ExprResult expr_parse_token_tree(TokenTree tree, ExprContext ctx);
 ExprResult expr_parse_tokens(vec_TokenTree tokens, char bracket,
                              ExprContext ctx);
@@ -145,6 +163,13 @@ ExprResult expr_parse_tokens(vec_TokenTree tokens, char bracket,
 // -- Computation
 ExprValueResult expr_calculate(const Expr* this, ExprContext ctx);
 
+// -- Optimization
+// Folds subtrees that are const in `ctx` and give numbers, simplifies x + 0,
+// x * 1, x / 1, x ^ 1 and squares of variables, moves constants to the right
+// of + and * and merges them in chains. Takes ownership of `this`. Constants
+// of `ctx` are inlined, so the result is valid while `ctx` is not changed
+Expr expr_optimize(Expr this, ExprContext ctx);
+
 /*
 Maybe later:
 vec_str_t expr_get_used_variables(const Expr* this);
@@ -32,8 +32,8 @@ ExprValueResult expr_calculate(const Expr* this, ExprContext ctx) {
     return OkNum(this->number.value);
 
   } else if (this->type is EXPR_VARIABLE) {
-    return ctx.vtable->get_variable_val(
-        ctx.data, str_slice_from_str_t(&this->variable.name));
+    return ctx.vtable->get_variable_val(ctx.data,
+                                        expr_symbol_slice(this->variable.name));
 
   } else if (this->type is EXPR_FUNCTION) {
     return expr_calculate_function(&this->function, ctx);
@@ -53,30 +53,12 @@ static ExprValueResult expr_calculate_function(const ExprFunction* this,
                                                ExprContext ctx) {
   assert_m(this);
   // FUNCTION
-  StrSlice function_name = str_slice_from_str_t(&this->name);
+  StrSlice function_name = expr_symbol_slice(this->name);
   ExprValueResult res = expr_calculate(this->argument, ctx);
   if (not res.is_ok) return res;
 
-  vec_ExprValue args;
-
-  if (res.ok.type is EXPR_VALUE_NUMBER) {
-    args = vec_ExprValue_create();
-    vec_ExprValue_push(&args, res.ok);
-
-  } else if (res.ok.type is EXPR_VALUE_VEC) {
-    args = res.ok.vec;
-
-  } else if (res.ok.type is EXPR_VALUE_NONE) {
-    args = vec_ExprValue_create();
-
-  } else {
-    panic("Unknown ExprValue type");
-  }
-
-  ExprValueResult call_res =
-      ctx.vtable->call_function(ctx.data, function_name, &args);
-  vec_ExprValue_free(args);
-  return call_res;
+  vec_ExprValue args = expr_value_into_args(res.ok);
+  return ctx.vtable->call_function(ctx.data, function_name, args);
 }
 
 static ExprValueResult expr_calculate_vector(const ExprVector* this,
@@ -84,13 +66,13 @@ static ExprValueResult expr_calculate_vector(const ExprVector* this,
   assert_m(this);
   // VECTOR
   const vec_Expr* args_expr = &this->arguments;
-  vec_ExprValue args = vec_ExprValue_create();
+  ExprVec args = expr_vec_with_capacity(args_expr->length);
 
   ExprValueResult res = {.is_ok = true};
   for (int i = 0; i < args_expr->length and res.is_ok; i++) {
     res = expr_calculate(&args_expr->data[i], ctx);
 
-    if (res.is_ok) vec_ExprValue_push(&args, res.ok);
+    if (res.is_ok) expr_vec_push(&args, res.ok);
   }
 
   if (res.is_ok) {
@@ -100,15 +82,62 @@ static ExprValueResult expr_calculate_vector(const ExprVector* this,
                                 .vec = args,
                             }};
   } else {
-    vec_ExprValue_free(args);
+    expr_vec_free(args);
+  }
+
+  return res;
+}
+
+// Stored value of a variable expression, null for anything else
+static const ExprValue* expr_borrow(const Expr* this, ExprContext ctx) {
+  if (this->type is_not EXPR_VARIABLE or not ctx.vtable->get_variable_ref)
+    return null;
+
+  return ctx.vtable->get_variable_ref(ctx.data,
+                                      expr_symbol_slice(this->variable.name));
+}
+
+// Points `operand` to the stored value of a variable, or calculates the value
+// into `owned`
+static ExprValueResult expr_calculate_operand(const Expr* this, ExprContext ctx,
+                                              ExprValue* owned,
+                                              const ExprValue** operand) {
+  *operand = expr_borrow(this, ctx);
+  if (*operand) return (ExprValueResult){.is_ok = true};
+
+  ExprValueResult res = expr_calculate(this, ctx);
+  if (res.is_ok) {
+    *owned = res.ok;
+    *operand = owned;
   }
+  return res;
+}
+
+// Operands that are stored variables are only borrowed
+static ExprValueResult expr_calculate_binary_op_ref(const ExprBinaryOp* this,
+                                                    RefOperatorFn operator,
+                                                    ExprContext ctx) {
+  ExprValue a, b;
+  const ExprValue* a_ptr = null;
+  const ExprValue* b_ptr = null;
 
+  ExprValueResult res = expr_calculate_operand(this->lhs, ctx, &a, &a_ptr);
+  if (res.is_ok) res = expr_calculate_operand(this->rhs, ctx, &b, &b_ptr);
+  if (res.is_ok) res = operator(a_ptr, b_ptr);
+
+  if (a_ptr is &a) expr_value_free(a);
+  if (b_ptr is &b) expr_value_free(b);
   return res;
 }
 
 static ExprValueResult expr_calculate_binary_op(const ExprBinaryOp* this,
                                                 ExprContext ctx) {
   assert_m(this);
+  RefOperatorFn ref_operator = expr_operator_ref_fn(this->op);
+  if (ref_operator and (this->lhs->type is EXPR_VARIABLE or
+                        this->rhs->type is EXPR_VARIABLE))
+    return expr_calculate_binary_op_ref(this, ref_operator, ctx);
+
   // BINARY OPERATOR
   ExprValueResult res = expr_calculate(this->lhs, ctx);
   if (res.is_ok) {
@@ -117,7 +146,7 @@ static ExprValueResult expr_calculate_binary_op(const ExprBinaryOp* this,
     res = expr_calculate(this->rhs, ctx);
     if (res.is_ok) {
       ExprValue b = res.ok;
-      OperatorFn operator= expr_get_operator_fn(this->name.string);
+      OperatorFn operator= expr_operator_fn(this->op);
       assert_m(operator);
 
       res = operator(a, b);
@@ -0,0 +1,193 @@
+#include "expr_cse.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include "../util/allocator.h"
+#include "../util/prettify_c.h"
+
+#define EXPR_CSE_MIN_CAPACITY 16
+
+// =====
+// =
+// = BASICS
+// =
+// =====
+ExprCse expr_cse_create() {
+  return (ExprCse){
+      .table = null,
+      .capacity = 0,
+      .count = 0,
+      .shared_count = 0,
+      .ids_given = 0,
+      .hashes = null,
+      .hashes_capacity = 0,
+      .hashes_count = 0,
+  };
+}
+
+void expr_cse_free(ExprCse this) {
+  FREE(this.table);
+  FREE(this.hashes);
+}
+
+// =====
+// =
+// = TABLE
+// =
+// =====
+static ExprCseEntry* expr_cse_probe(const ExprCse* this, const Expr* expr,
+                                    uint32_t hash) {
+  uint32_t mask = (uint32_t)this->capacity - 1;
+  for (uint32_t i = hash & mask;; i = (i + 1) & mask) {
+    ExprCseEntry* item = &this->table[i];
+    if (not item->expr or item->expr is expr or
+        (item->hash == hash and expr_equal(item->expr, expr)))
+      return item;
+  }
+}
+
+static void expr_cse_grow(ExprCse* this) {
+  ExprCse old = *this;
+  this->capacity = old.capacity ? old.capacity * 2 : EXPR_CSE_MIN_CAPACITY;
+  this->table = MALLOC(sizeof(ExprCseEntry) * this->capacity);
+  assert_alloc(this->table);
+  memset(this->table, 0, sizeof(ExprCseEntry) * this->capacity);
+
+  for (int i = 0; i < old.capacity; i++) {
+    if (not old.table[i].expr) continue;
+    *expr_cse_probe(this, old.table[i].expr, old.table[i].hash) = old.table[i];
+  }
+  FREE(old.table);
+}
+
+// =====
+// =
+// = NODE HASHES
+// =
+// =====
+static ExprCseNodeHash* expr_cse_node_probe(const ExprCse* this,
+                                            const Expr* expr) {
+  uint32_t mask = (uint32_t)this->hashes_capacity - 1;
+  uint32_t start = (uint32_t)((uintptr_t)expr >> 3) * 2654435761u;
+  for (uint32_t i = start & mask;; i = (i + 1) & mask) {
+    ExprCseNodeHash* item = &this->hashes[i];
+    if (not item->expr or item->expr is expr) return item;
+  }
+}
+
+static void expr_cse_node_grow(ExprCse* this) {
+  ExprCse old = *this;
+  this->hashes_capacity =
+      old.hashes_capacity ? old.hashes_capacity * 2 : EXPR_CSE_MIN_CAPACITY;
+  this->hashes = MALLOC(sizeof(ExprCseNodeHash) * this->hashes_capacity);
+  assert_alloc(this->hashes);
+  memset(this->hashes, 0, sizeof(ExprCseNodeHash) * this->hashes_capacity);
+
+  for (int i = 0; i < old.hashes_capacity; i++) {
+    if (not old.hashes[i].expr) continue;
+    *expr_cse_node_probe(this, old.hashes[i].expr) = old.hashes[i];
+  }
+  FREE(old.hashes);
+}
+
+// expr_hash of a node that was hashed by expr_cse_hash_tree
+static uint32_t expr_cse_node_hash(void* data, const Expr* expr) {
+  ExprCse* this = (ExprCse*)data;
+  if (this->hashes_count > 0) {
+    ExprCseNodeHash* item = expr_cse_node_probe(this, expr);
+    if (item->expr) return item->hash;
+  }
+  return expr_hash(expr);
+}
+
+// Children first, so each node is hashed from the hashes of its children
+static void expr_cse_hash_tree(ExprCse* this, const Expr* expr) {
+  if (expr->type is EXPR_FUNCTION) {
+    expr_cse_hash_tree(this, expr->function.argument);
+
+  } else if (expr->type is EXPR_VECTOR) {
+    const vec_Expr* items = &expr->vector.arguments;
+    for (int i = 0; i < items->length; i++)
+      expr_cse_hash_tree(this, &items->data[i]);
+
+  } else if (expr->type is EXPR_BINARY_OP) {
+    expr_cse_hash_tree(this, expr->binary_operator.lhs);
+    expr_cse_hash_tree(this, expr->binary_operator.rhs);
+  }
+
+  if ((this->hashes_count + 1) * 4 > this->hashes_capacity * 3)
+    expr_cse_node_grow(this);
+
+  uint32_t hash = expr_hash_node(expr, expr_cse_node_hash, this);
+  ExprCseNodeHash* item = expr_cse_node_probe(this, expr);
+  if (not item->expr) this->hashes_count++;
+  *item = (ExprCseNodeHash){.expr = expr, .hash = hash};
+}
+
+// =====
+// =
+// = expr_cse_count
+// =
+// =====
+static void expr_cse_count_node(ExprCse* this, const Expr* expr,
+                                ExprCseCandidateFn is_candidate, void* data);
+
+static void expr_cse_count_children(ExprCse* this, const Expr* expr,
+                                    ExprCseCandidateFn is_candidate,
+                                    void* data) {
+  if (expr->type is EXPR_FUNCTION) {
+    expr_cse_count_node(this, expr->function.argument, is_candidate, data);
+
+  } else if (expr->type is EXPR_VECTOR) {
+    const vec_Expr* items = &expr->vector.arguments;
+    for (int i = 0; i < items->length; i++)
+      expr_cse_count_node(this, &items->data[i], is_candidate, data);
+
+  } else if (expr->type is EXPR_BINARY_OP) {
+    expr_cse_count_node(this, expr->binary_operator.lhs, is_candidate, data);
+    expr_cse_count_node(this, expr->binary_operator.rhs, is_candidate, data);
+  }
+}
+
+static void expr_cse_count_node(ExprCse* this, const Expr* expr,
+                                ExprCseCandidateFn is_candidate, void* data) {
+  if (not is_candidate(data, expr)) {
+    expr_cse_count_children(this, expr, is_candidate, data);
+    return;
+  }
+
+  // Keep load under 3/4 so probes stay short and always find an empty cell
+  if ((this->count + 1) * 4 > this->capacity * 3) expr_cse_grow(this);
+
+  uint32_t hash = expr_cse_node_hash(this, expr);
+  ExprCseEntry* item = expr_cse_probe(this, expr, hash);
+  if (item->expr) {
+    if (item->count is 1) this->shared_count++;
+    item->count++;
+    return;
+  }
+
+  *item = (ExprCseEntry){.expr = expr, .hash = hash, .count = 1, .id = -1};
+  this->count++;
+  expr_cse_count_children(this, expr, is_candidate, data);
+}
+
+void expr_cse_count(ExprCse* this, const Expr* expr,
+                    ExprCseCandidateFn is_candidate, void* data) {
+  assert_m(expr and is_candidate);
+  expr_cse_hash_tree(this, expr);
+  expr_cse_count_node(this, expr, is_candidate, data);
+}
+
+int expr_cse_shared_id(ExprCse* this, const Expr* expr) {
+  assert_m(expr);
+  if (this->shared_count is 0) return -1;
+
+  ExprCseEntry* item =
+      expr_cse_probe(this, expr, expr_cse_node_hash(this, expr));
+  if (not item->expr or item->count < 2) return -1;
+
+  if (item->id < 0) item->id = this->ids_given++;
+  return item->id;
+}
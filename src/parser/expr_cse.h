@@ -0,0 +1,56 @@
+#ifndef SRC_PARSER_EXPR_CSE_H_
+#define SRC_PARSER_EXPR_CSE_H_
+
+#include <stdint.h>
+
+#include "expr.h"
+
+// Common subexpressions of a set of Exprs. Every candidate subtree is counted
+// by structure (expr_hash and expr_equal), and the ones that occur more than
+// once get ids, so a compiler can compute them once and reuse the result.
+// Inside a repeated subtree nothing more is counted: its parts are computed
+// once with it. Exprs are borrowed and have to outlive the ExprCse.
+//
+//   ExprCse cse = expr_cse_create();
+//   expr_cse_count(&cse, expr, is_candidate, data);
+//   ... compile, asking expr_cse_shared_id(&cse, node) on the way
+//   expr_cse_free(cse);
+
+typedef bool (*ExprCseCandidateFn)(void* data, const Expr* expr);
+
+typedef struct ExprCseEntry {
+  const Expr* expr;  // First occurrence
+  uint32_t hash;
+  int count;
+  int id;  // -1 until it is asked for
+} ExprCseEntry;
+
+// Hash of a node of the counted trees, by its address
+typedef struct ExprCseNodeHash {
+  const Expr* expr;
+  uint32_t hash;
+} ExprCseNodeHash;
+
+typedef struct ExprCse {
+  ExprCseEntry* table;
+  int capacity;
+  int count;
+  int shared_count;  // Entries with count > 1
+  int ids_given;
+
+  // Every node is hashed once, bottom-up, rather than at each ancestor
+  ExprCseNodeHash* hashes;
+  int hashes_capacity;
+  int hashes_count;
+} ExprCse;
+
+ExprCse expr_cse_create();
+void expr_cse_free(ExprCse this);
+
+void expr_cse_count(ExprCse* this, const Expr* expr,
+                    ExprCseCandidateFn is_candidate, void* data);
+// Ids go from 0 to shared_count - 1 in the order of the first request, -1 is
+// returned for subtrees that occur once or were not counted
+int expr_cse_shared_id(ExprCse* this, const Expr* expr);
+
+#endif  // SRC_PARSER_EXPR_CSE_H_
@@ -0,0 +1,158 @@
+#include <math.h>
+
+#include "../util/allocator.h"
+#include "../util/prettify_c.h"
+#include "expr.h"
+
+// =====
+// =
+// = Helpers
+// =
+// =====
+static bool is_number(const Expr* this, double value) {
+  return this->type is EXPR_NUMBER and this->number.value == value;
+}
+
+static bool is_operator(const Expr* this, ExprOperator op) {
+  return this->type is EXPR_BINARY_OP and this->binary_operator.op is op;
+}
+
+// Numbers and vectors of them, nothing to look up
+static bool is_literal(const Expr* this) {
+  if (this->type is EXPR_NUMBER) return true;
+  if (this->type is_not EXPR_VECTOR) return false;
+
+  for (int i = 0; i < this->vector.arguments.length; i++)
+    if (not is_literal(&this->vector.arguments.data[i])) return false;
+  return true;
+}
+
+static Expr number(double value) {
+  return (Expr){.type = EXPR_NUMBER, .number.value = value};
+}
+
+// Powers of two of at least 1 in magnitude. Multiplying by them is exact up
+// to an overflow, and x * a * b overflows exactly when x * (a * b) does
+static bool can_merge_factors(double a, double b) {
+  int a_exp, b_exp;
+  return fabs(frexp(a, &a_exp)) == 0.5 and a_exp >= 1 and
+         fabs(frexp(b, &b_exp)) == 0.5 and b_exp >= 1 and isfinite(a * b);
+}
+
+// One operand of a binary operator, the rest is freed
+static Expr take_operand(Expr this, bool is_lhs) {
+  Expr* operand = is_lhs ? this.binary_operator.lhs : this.binary_operator.rhs;
+  Expr result = *operand;
+  *operand = number(0.0);
+
+  expr_free(this);
+  return result;
+}
+
+// =====
+// =
+// = Folding
+// =
+// =====
+static bool can_fold(const Expr* this, ExprContext ctx) {
+  switch (this->type) {
+    case EXPR_VARIABLE:
+      return ctx.vtable->is_expr_const(ctx.data, this);
+    case EXPR_FUNCTION:
+      return is_literal(this->function.argument) and
+             ctx.vtable->is_expr_const(ctx.data, this);
+    case EXPR_BINARY_OP:
+      return is_literal(this->binary_operator.lhs) and
+             is_literal(this->binary_operator.rhs);
+    default:
+      return false;
+  }
+}
+
+// Only numbers are folded. Errors are left to be reported by the evaluation
+static Expr fold(Expr this, ExprContext ctx) {
+  if (not can_fold(&this, ctx)) return this;
+
+  ExprValueResult res = expr_calculate(&this, ctx);
+  if (res.is_ok and res.ok.type is EXPR_VALUE_NUMBER) {
+    expr_free(this);
+    return number(res.ok.number);
+  }
+
+  expr_value_result_free(res);
+  return this;
+}
+
+// =====
+// =
+// = Identities
+// =
+// =====
+static Expr simplify_binary_op(Expr this) {
+  ExprBinaryOp* op = &this.binary_operator;
+  bool is_add = is_operator(&this, EXPR_OP_ADD);
+  bool is_mul = is_operator(&this, EXPR_OP_MUL);
+
+  // Constants go to the right of + and *, and x - c is x + (-c)
+  if ((is_add or is_mul) and op->lhs->type is EXPR_NUMBER and
+      op->rhs->type is_not EXPR_NUMBER)
+    SWAP(Expr*, op->lhs, op->rhs);
+  if (is_operator(&this, EXPR_OP_SUB) and op->rhs->type is EXPR_NUMBER) {
+    op->op = EXPR_OP_ADD;
+    op->rhs->number.value = -op->rhs->number.value;
+    is_add = true;
+  }
+
+  // (x * a) * b is x * (a * b) only when that rounds the same, sums of
+  // constants are never merged
+  if (is_mul and op->rhs->type is EXPR_NUMBER and
+      is_operator(op->lhs, EXPR_OP_MUL) and
+      op->lhs->binary_operator.rhs->type is EXPR_NUMBER and
+      can_merge_factors(op->lhs->binary_operator.rhs->number.value,
+                        op->rhs->number.value)) {
+    op->rhs->number.value *= op->lhs->binary_operator.rhs->number.value;
+    *op->lhs = take_operand(*op->lhs, true);
+  }
+
+  if ((is_add and is_number(op->rhs, 0.0)) or
+      (is_mul and is_number(op->rhs, 1.0)) or
+      (is_operator(&this, EXPR_OP_DIV) and is_number(op->rhs, 1.0)) or
+      (is_operator(&this, EXPR_OP_POW) and is_number(op->rhs, 1.0)))
+    return take_operand(this, true);
+
+  // Squares of variables are multiplied, other bases would be computed twice
+  if (is_operator(&this, EXPR_OP_POW) and is_number(op->rhs, 2.0) and
+      op->lhs->type is EXPR_VARIABLE) {
+    op->op = EXPR_OP_MUL;
+    expr_free(*op->rhs);
+    *op->rhs = expr_clone(op->lhs);
+  }
+
+  return this;
+}
+
+// =====
+// =
+// = expr_optimize
+// =
+// =====
+Expr expr_optimize(Expr this, ExprContext ctx) {
+  assert_m(ctx.vtable and ctx.vtable->is_expr_const);
+
+  if (this.type is EXPR_FUNCTION) {
+    *this.function.argument = expr_optimize(*this.function.argument, ctx);
+
+  } else if (this.type is EXPR_VECTOR) {
+    vec_Expr* items = &this.vector.arguments;
+    for (int i = 0; i < items->length; i++)
+      items->data[i] = expr_optimize(items->data[i], ctx);
+
+  } else if (this.type is EXPR_BINARY_OP) {
+    *this.binary_operator.lhs = expr_optimize(*this.binary_operator.lhs, ctx);
+    *this.binary_operator.rhs = expr_optimize(*this.binary_operator.rhs, ctx);
+  }
+
+  this = fold(this, ctx);
+  if (this.type is EXPR_BINARY_OP) this = simplify_binary_op(this);
+  return this;
+}
@@ -6,10 +6,10 @@
 
 // =====
 // =
-// = expr_parse_string
+// = expr_parse_string_tree
 // =
 // =====
-ExprResult expr_parse_string(const char* text, ExprContext ctx) {
+ExprResult expr_parse_string_tree(const char* text, ExprContext ctx) {
   assert_m(text);
   assert_m(ctx.vtable and ctx.vtable->is_function and ctx.vtable->is_variable);
 
@@ -17,16 +17,30 @@ ExprResult expr_parse_string(const char* text, ExprContext ctx) {
       .data = ctx.data,
       .is_function = ctx.vtable->is_function,
   };
-  TokenTreeResult res = token_tree_parse(text, token_tree_ctx);
 
+  // Tokens and trees are temporaries, only the result is copied out
+  static MyArena arena = MY_ARENA_INIT;
+  my_arena_begin(&arena);
+
+  ExprResult result;
+  TokenTreeResult res = token_tree_parse(text, token_tree_ctx);
   if (not res.is_ok)
-    return (ExprResult){
+    result = (ExprResult){
         .is_ok = false,
         .err_text = res.err.text,
         .err_pos = res.err.text_pos,
     };
+  else
+    result = expr_parse_token_tree(res.ok, ctx);
+
+  my_arena_end(&arena);
+  if (result.is_ok)
+    result.ok = expr_clone(&result.ok);
+  else
+    result.err_text = str_clone(&result.err_text);
+  my_arena_reset(&arena);
 
-  return expr_parse_token_tree(res.ok, ctx);
+  return result;
 }
 
 // =====
@@ -115,10 +129,6 @@ static ExprResult parser_map_vecvec_to_vec(vec_vec_Expr total_exprs,
 
     } else if (exprs->length > 1) {
       // Multiple
-      debugln("Multiple unrelated expressions right next to each other:");
-      for (int i = 0; i < exprs->length; i++)
-        debugln("\t\tExpression %d: '%$expr'", i + 1, exprs->data[i]);
-
       result = ExprErr(str_literal(
           "Multiple unrelated expressions right next to each other"));
 
@@ -183,7 +193,7 @@ static ExprResult check_for_errors(Expr* this) {
 
   } else if (this->type is EXPR_BINARY_OP) {
     // Recursively
-    const char* name = this->binary_operator.name.string;
+    const char* name = expr_operator_name(this->binary_operator.op);
 
     if (this->binary_operator.lhs is null) {
       result = ExprErr(str_owned("Incomplete operator '%s' to the left", name));
@@ -375,7 +385,7 @@ static ExprResult expr_parse_single_ident(Token ident, ExprContext ctx) {
     };
   } else {
     result.ok.type = EXPR_VARIABLE;
-    result.ok.variable.name = str_slice_to_owned(ident.data.ident_text);
+    result.ok.variable.name = expr_symbol_intern(ident.data.ident_text);
   }
 
   return result;
@@ -450,7 +460,7 @@ static ExprResult expr_push_operator(vec_Expr* current_pos, Expr value,
       return (ExprResult){
           .is_ok = false,
           .err_text = str_owned("Incomplete operator '%s' (to the left)",
-                                value.binary_operator.name.string),
+                                expr_operator_name(value.binary_operator.op)),
           .err_pos = err_pos,
       };
     } else {
@@ -482,7 +492,7 @@ static ExprResult parser_collect_function(TokenTree item, ExprContext ctx,
   // Like 'x sin x' or 'sin'
   Expr expr = (Expr){.type = EXPR_FUNCTION,
                      .function = {
-                         .name = str_slice_to_owned(item.token.data.ident_text),
+                         .name = expr_symbol_intern(item.token.data.ident_text),
                          .argument = null,  // This pointer will be filled later
                      }};
   expr_push_to_left(current_pos, expr);
@@ -515,7 +525,7 @@ static ExprResult parser_collect_indexing(TokenTree item, ExprContext ctx,
           {
               .lhs = null,
               .rhs = null,  // This pointer will be filled later
-              .name = str_owned("[]"),
+              .op = EXPR_OP_INDEX,
           },
   };
 
@@ -556,7 +566,7 @@ static ExprResult parser_collect_implicit_mul(TokenTree item, ExprContext ctx,
           {
               .lhs = null,
               .rhs = null,
-              .name = str_owned("*"),
+              .op = EXPR_OP_MUL,
           },
   };
 
@@ -588,7 +598,7 @@ static ExprResult parser_collect_implicit_sub(TokenTree item, ExprContext ctx,
                   .type = EXPR_NUMBER,
                   .number.value = -item.token.data.number_number,
               }),
-              .name = str_owned("-"),
+              .op = EXPR_OP_SUB,
           },
   };
 
@@ -622,7 +632,7 @@ static ExprResult parser_collect_unary_operator(TokenTree item, ExprContext ctx,
                   .number.value = 0.0,
               }),
               .rhs = null,  // This pointer will be filled later
-              .name = str_slice_to_owned(item.token.data.operator_text),
+              .op = expr_operator_from_slice(item.token.data.operator_text),
           },
   };
   expr_push_operator(current_pos, operator, item.token.start_pos);
@@ -658,7 +668,7 @@ static ExprResult parser_collect_operator(TokenTree item, ExprContext ctx,
           {
               .lhs = null,
               .rhs = null,  // This pointer will be filled later
-              .name = str_slice_to_owned(item.token.data.operator_text),
+              .op = expr_operator_from_slice(item.token.data.operator_text),
           },
   };
 
@@ -0,0 +1,444 @@
+#include "../util/allocator.h"
+#include "../util/prettify_c.h"
+#include "expr.h"
+
+// Parses the tokens of the text straight into Expr, in one pass. The result
+// is the same as the one of token_tree_parse with expr_parse_token_tree, see
+// test/test_expr_parse.c, which compares the two:
+//
+//   list     = segment {',' segment} [',']  one segment is itself, more a vector
+//   segment  = level 1 .. level 7, each of them `operand {op operand}`
+//   operand  = item {item}                   see parse_operand
+//
+// Levels, lowest first: = := += -= *= /= %= ^=, comparisons, + -, / % mod, *,
+// ranges, ^. All of them go from left to right. A sign in front of level 3
+// is 0 + x or 0 - x, as in -x ^ 2 = 0 - (x ^ 2).
+
+#define LEVELS_COUNT 7
+#define LEVEL_SIGNS 3
+
+static const signed char OPERATOR_LEVELS[EXPR_OPERATORS_COUNT] = {
+    [EXPR_OP_EQUATION] = 1,   [EXPR_OP_ASSIGN] = 1,
+    [EXPR_OP_ADD_ASSIGN] = 1, [EXPR_OP_SUB_ASSIGN] = 1,
+    [EXPR_OP_MUL_ASSIGN] = 1, [EXPR_OP_DIV_ASSIGN] = 1,
+    [EXPR_OP_MOD_ASSIGN] = 1, [EXPR_OP_POW_ASSIGN] = 1,
+    [EXPR_OP_EQ] = 2,         [EXPR_OP_NEQ] = 2,
+    [EXPR_OP_LTE] = 2,        [EXPR_OP_GTE] = 2,
+    [EXPR_OP_LT] = 2,         [EXPR_OP_GT] = 2,
+    [EXPR_OP_ADD] = 3,        [EXPR_OP_SUB] = 3,
+    [EXPR_OP_DIV] = 4,        [EXPR_OP_MOD] = 4,
+    [EXPR_OP_MOD_WORD] = 4,   [EXPR_OP_MUL] = 5,
+    [EXPR_OP_RANGE] = 6,      [EXPR_OP_RANGE_INCLUDED] = 6,
+    [EXPR_OP_POW] = 7,
+};
+
+typedef struct Parser {
+  const Token* tokens;
+  int length;
+  // Per token: index of the closing bracket of an opening one (length if it
+  // is never closed), ExprOperator of an operator
+  const int* closing;
+  const signed char* operators;
+  ExprContext ctx;
+
+  int pos;
+  int end;  // Of the innermost brackets
+} Parser;
+
+#define ParseErr(text, pos) \
+  (ExprResult) { .is_ok = false, .err_text = (text), .err_pos = (pos) }
+
+// =====
+// =
+// = Tokens
+// =
+// =====
+static bool is_opening_bracket(char c) {
+  return c is '(' or c is '[' or c is '{';
+}
+
+static char flip_bracket(char c) {
+  return c is ')' ? '(' : c is ']' ? '[' : c is '}' ? '{' : '\0';
+}
+
+static const Token* peek(const Parser* this) {
+  return this->pos < this->end ? &this->tokens[this->pos] : null;
+}
+
+static bool is_opening(const Token* token) {
+  return token and token->type is TOKEN_BRACKET and
+         is_opening_bracket(token->data.bracket_symbol);
+}
+
+static int level_of(const Parser* this, const Token* token) {
+  if (not token or token->type is_not TOKEN_OPERATOR) return 0;
+  return OPERATOR_LEVELS[this->operators[token - this->tokens]];
+}
+
+static bool is_sign(const Parser* this, const Token* token) {
+  return level_of(this, token) is LEVEL_SIGNS;
+}
+
+static bool is_function(const Parser* this, const Token* token) {
+  return token->type is TOKEN_IDENT and
+         this->ctx.vtable->is_function(this->ctx.data, token->data.ident_text);
+}
+
+// Numbers, names and brackets, everything that operands are made of
+static bool starts_item(const Token* token) {
+  return token and (token->type is TOKEN_NUMBER or
+                    token->type is TOKEN_IDENT or is_opening(token));
+}
+
+// Matches the brackets and looks the operators up, once for all tokens
+static ExprResult link_tokens(Parser* this, int* closing,
+                              signed char* operators) {
+  int* opened = (int*)MALLOC(sizeof(int) * (this->length + 1));
+  int depth = 0;
+  ExprResult result = {.is_ok = true};
+
+  for (int i = 0; i < this->length and result.is_ok; i++) {
+    const Token* token = &this->tokens[i];
+    operators[i] = EXPR_OP_NONE;
+
+    if (token->type is TOKEN_OPERATOR) {
+      operators[i] = expr_operator_from_slice(token->data.operator_text);
+      if (operators[i] is EXPR_OP_NONE or operators[i] is EXPR_OP_INDEX)
+        result = ParseErr(str_literal("Unknown operator"), token->start_pos);
+
+    } else if (is_opening(token)) {
+      opened[depth++] = i;
+      closing[i] = this->length;
+
+    } else if (token->type is TOKEN_BRACKET) {
+      if (depth is 0)
+        result = ParseErr(str_literal("Unexpected closing bracket"),
+                          token->start_pos);
+      else if (this->tokens[opened[depth - 1]].data.bracket_symbol is_not
+               flip_bracket(token->data.bracket_symbol))
+        result = ParseErr(str_literal("Closing bracket does not match"),
+                          token->start_pos);
+      else
+        closing[opened[--depth]] = i;
+    }
+  }
+
+  FREE(opened);
+  this->closing = closing;
+  this->operators = operators;
+  return result;
+}
+
+// =====
+// =
+// = Lists
+// =
+// =====
+static ExprResult parse_level(Parser* this, int level, bool groups);
+
+// Function grouping of token_tree_parse happens on the outermost tokens only:
+// `x sin x` is x * sin(x), `1 + x sin x` is an error. It goes on into the
+// arguments of the grouped functions and into brackets that wrap everything,
+// but not into [], which token_tree_simplify keeps. That is, while the list
+// has no operators and no commas, except for one at the end
+static bool list_groups_functions(const Parser* this, int* items) {
+  *items = 0;
+  for (int i = this->pos; i < this->end; i++) {
+    const Token* token = &this->tokens[i];
+    if (token->type is TOKEN_OPERATOR) return false;
+    if (token->type is TOKEN_COMMA and i + 1 < this->end) return false;
+
+    if (starts_item(token)) (*items)++;
+    if (is_opening(token)) i = this->closing[i];
+  }
+  return true;
+}
+
+static ExprResult parse_list(Parser* this, int end, bool groups);
+
+// The brackets at pos, with what is inside
+static ExprResult parse_brackets(Parser* this, bool groups) {
+  int closing = this->closing[this->pos];
+  this->pos++;
+
+  ExprResult result = parse_list(this, closing, groups);
+  this->pos = closing < this->length ? closing + 1 : closing;
+  return result;
+}
+
+static ExprResult parse_list(Parser* this, int end, bool groups) {
+  int outer_end = this->end;
+  this->end = end;
+
+  int items = 0;
+  if (groups) groups = list_groups_functions(this, &items);
+
+  ExprResult result = {.is_ok = true};
+  const Token* token = peek(this);
+  if (groups and items is 1 and is_opening(token) and
+      token->data.bracket_symbol is_not '[') {
+    // Wrapping brackets, as in ((x sin x)). A comma can follow
+    result = parse_brackets(this, true);
+    this->pos = end;
+    this->end = outer_end;
+    return result;
+  }
+
+  vec_Expr values = vec_Expr_create();
+  do {
+    token = peek(this);
+    if (not token or token->type is TOKEN_COMMA) {
+      result = ParseErr(str_literal("Empty expressions are not allowed"),
+                        token ? token->start_pos : null);
+      break;
+    }
+
+    result = parse_level(this, 1, groups);
+    if (not result.is_ok) break;
+    vec_Expr_push(&values, result.ok);
+
+    // Only commas end segments, operators belong to level 1 and lower
+    token = peek(this);
+    assert_m(not token or token->type is TOKEN_COMMA);
+    this->pos++;
+  } while (this->pos < this->end);
+  this->end = outer_end;
+
+  if (not result.is_ok) {
+    vec_Expr_free(values);
+    return result;
+  }
+
+  this->pos = end;
+  if (values.length is 1) {
+    result.ok = vec_Expr_popget(&values);
+    vec_Expr_free(values);
+  } else {
+    result.ok = (Expr){.type = EXPR_VECTOR, .vector.arguments = values};
+  }
+  return result;
+}
+
+// =====
+// =
+// = Levels
+// =
+// =====
+static ExprResult parse_operand(Parser* this, bool groups);
+
+static Expr binary_op(ExprOperator op, Expr lhs, Expr rhs) {
+  return (Expr){
+      .type = EXPR_BINARY_OP,
+      .binary_operator =
+          {
+              .op = op,
+              .lhs = expr_move_to_heap(lhs),
+              .rhs = expr_move_to_heap(rhs),
+          },
+  };
+}
+
+// A sign is allowed at the start of level 3 and the levels below it
+static bool starts_level(const Parser* this, int level) {
+  const Token* token = peek(this);
+  return starts_item(token) or
+         (level <= LEVEL_SIGNS and is_sign(this, token));
+}
+
+static ExprResult parse_level(Parser* this, int level, bool groups) {
+  if (level > LEVELS_COUNT) return parse_operand(this, groups);
+
+  ExprResult lhs;
+  if (level is LEVEL_SIGNS and is_sign(this, peek(this)))
+    lhs = (ExprResult){.is_ok = true,
+                       .ok = {.type = EXPR_NUMBER, .number.value = 0.0}};
+  else
+    lhs = parse_level(this, level + 1, groups);
+
+  while (lhs.is_ok and level_of(this, peek(this)) is level) {
+    const Token* token = peek(this);
+    ExprOperator op = this->operators[this->pos];
+    this->pos++;
+
+    ExprResult rhs =
+        starts_level(this, level + 1)
+            ? parse_level(this, level + 1, groups)
+            : ParseErr(str_owned("Incomplete operator '%s' to the right",
+                                 expr_operator_name(op)),
+                       token->start_pos);
+    if (not rhs.is_ok) {
+      expr_free(lhs.ok);
+      return rhs;
+    }
+    lhs.ok = binary_op(op, lhs.ok, rhs.ok);
+  }
+
+  return lhs;
+}
+
+// =====
+// =
+// = Operands
+// =
+// =====
+static ExprResult parse_token(Parser* this) {
+  const Token* token = &this->tokens[this->pos++];
+  ExprResult result = {.is_ok = true};
+
+  if (token->type is TOKEN_NUMBER) {
+    result.ok = (Expr){.type = EXPR_NUMBER,
+                       .number.value = token->data.number_number};
+  } else {
+    result.ok = (Expr){
+        .type = EXPR_VARIABLE,
+        .variable.name = expr_symbol_intern(token->data.ident_text),
+    };
+  }
+  return result;
+}
+
+// A function with the item after it, as in `sin x`, `sin(x)`, `sin cos x`
+static ExprResult parse_function(Parser* this, bool groups) {
+  const Token* name = &this->tokens[this->pos++];
+  const Token* token = peek(this);
+
+  ExprResult argument;
+  if (not starts_item(token) or (token->type is TOKEN_NUMBER and
+                                 token->data.number_number < 0))
+    argument = ParseErr(str_literal("Function with no arguments"),
+                        name->start_pos);
+  else if (is_function(this, token))
+    argument = parse_function(this, groups);
+  else if (is_opening(token))
+    argument = parse_brackets(this, groups);
+  else
+    argument = parse_token(this);
+
+  if (not argument.is_ok) return argument;
+
+  Expr function = {
+      .type = EXPR_FUNCTION,
+      .function =
+          {
+              .name = expr_symbol_intern(name->data.ident_text),
+              .argument = expr_move_to_heap(argument.ok),
+          },
+  };
+  return (ExprResult){.is_ok = true, .ok = function};
+}
+
+// The first item of an operand
+static ExprResult parse_item(Parser* this, bool groups) {
+  const Token* token = peek(this);
+  if (is_function(this, token)) return parse_function(this, groups);
+  if (is_opening(token)) return parse_brackets(this, false);
+  return parse_token(this);
+}
+
+// An item after `prev`, which is complete
+static ExprResult parse_next_item(Parser* this, Expr prev, bool groups) {
+  const Token* token = peek(this);
+  ExprOperator op = EXPR_OP_MUL;
+  ExprResult rhs;
+
+  if (is_function(this, token)) {
+    // Only grouped functions are multiplied, as in `x sin x`
+    rhs = groups ? parse_function(this, groups)
+                 : ParseErr(str_literal("Multiple unrelated expressions "
+                                        "right next to each other"),
+                            token->start_pos);
+
+  } else if (is_opening(token)) {
+    if (token->data.bracket_symbol is '[') op = EXPR_OP_INDEX;
+    rhs = parse_brackets(this, false);
+
+  } else if (token->type is TOKEN_NUMBER and token->data.number_number < 0) {
+    // x -1 is x - 1, the sign belongs to the number token
+    op = EXPR_OP_SUB;
+    rhs = parse_token(this);
+    rhs.ok.number.value = -rhs.ok.number.value;
+
+  } else if (token->type is TOKEN_NUMBER and
+             (prev.type is EXPR_VARIABLE or prev.type is EXPR_FUNCTION)) {
+    // `x 2` is not 2 x
+    rhs = ParseErr(str_literal("Multiple unrelated expressions right next "
+                               "to each other"),
+                   token->start_pos);
+
+  } else {
+    rhs = parse_token(this);
+  }
+
+  if (not rhs.is_ok) {
+    expr_free(prev);
+    return rhs;
+  }
+  return (ExprResult){.is_ok = true, .ok = binary_op(op, prev, rhs.ok)};
+}
+
+// Items right next to each other: a function takes the item after it, []
+// after an item index it, a negative number is subtracted, the rest of the
+// items are multiplied. All from left to right, so `2 x[1]` is (2 x)[1]
+static ExprResult parse_operand(Parser* this, bool groups) {
+  const Token* token = peek(this);
+  if (not starts_item(token)) {
+    // Only operators get here, commas and ends are checked before
+    return ParseErr(
+        str_owned("Incomplete operator '%$slice' to the left",
+                  token->data.operator_text),
+        token->start_pos);
+  }
+
+  ExprResult result = parse_item(this, groups);
+  while (result.is_ok and starts_item(peek(this)))
+    result = parse_next_item(this, result.ok, groups);
+  return result;
+}
+
+// =====
+// =
+// = expr_parse_string
+// =
+// =====
+ExprResult expr_parse_string(const char* text, ExprContext ctx) {
+  assert_m(text);
+  assert_m(ctx.vtable and ctx.vtable->is_function and ctx.vtable->is_variable);
+
+  // Tokens and partial results are temporaries, only the result is copied out
+  static MyArena arena = MY_ARENA_INIT;
+  my_arena_begin(&arena);
+
+  vec_Token tokens = vec_Token_create();
+  TokenizeResult tokenized = tk_tokenize(text, &tokens, false);
+
+  ExprResult result;
+  if (not tokenized.is_ok) {
+    result = ParseErr(tokenized.err_text, tokenized.err_pos);
+  } else {
+    Parser parser = {
+        .tokens = tokens.data,
+        .length = tokens.length,
+        .ctx = ctx,
+        .pos = 0,
+        .end = tokens.length,
+    };
+    int* closing = (int*)MALLOC(sizeof(int) * (tokens.length + 1));
+    signed char* operators = (signed char*)MALLOC(tokens.length + 1);
+
+    result = link_tokens(&parser, closing, operators);
+    if (result.is_ok) result = parse_list(&parser, tokens.length, true);
+
+    FREE(closing);
+    FREE(operators);
+  }
+  vec_Token_free(tokens);
+
+  my_arena_end(&arena);
+  if (result.is_ok)
+    result.ok = expr_clone(&result.ok);
+  else
+    result.err_text = str_clone(&result.err_text);
+  my_arena_reset(&arena);
+
+  return result;
+}
@@ -0,0 +1,137 @@
+#include "expr_symbols.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include "../util/allocator.h"
+#include "../util/prettify_c.h"
+
+#define EXPR_SYMBOLS_MIN_CAPACITY 64
+
+typedef struct ExprSymbolText {
+  const char* text;
+  int length;
+  uint32_t hash;
+} ExprSymbolText;
+
+static struct {
+  ExprSymbolText* texts;  // Indexed by symbol
+  int count;
+  int texts_capacity;
+  int* table;  // Symbol + 1, 0 for empty cells
+  int capacity;
+} symbols = {null, 0, 0, null, 0};
+
+static uint32_t expr_symbols_hash(StrSlice name) {
+  // FNV-1a
+  uint32_t hash = 2166136261u;
+  for (int i = 0; i < name.length; i++) {
+    hash ^= (unsigned char)name.start[i];
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+static int* expr_symbols_probe(StrSlice name, uint32_t hash) {
+  uint32_t mask = (uint32_t)symbols.capacity - 1;
+  for (uint32_t i = hash & mask;; i = (i + 1) & mask) {
+    int* cell = &symbols.table[i];
+    if (*cell is 0) return cell;
+
+    const ExprSymbolText* item = &symbols.texts[*cell - 1];
+    if (item->hash == hash and item->length is name.length and
+        strncmp(item->text, name.start, name.length) is 0)
+      return cell;
+  }
+}
+
+// Symbols outlive any arena scope they are interned in
+static void expr_symbols_grow() {
+  int* old = symbols.table;
+  int old_capacity = symbols.capacity;
+  symbols.capacity =
+      old_capacity ? old_capacity * 2 : EXPR_SYMBOLS_MIN_CAPACITY;
+
+  my_arena_pause();
+  symbols.table = (int*)MALLOC(sizeof(int) * symbols.capacity);
+  my_arena_resume();
+  assert_alloc(symbols.table);
+  memset(symbols.table, 0, sizeof(int) * symbols.capacity);
+
+  for (int i = 0; i < old_capacity; i++) {
+    if (old[i] is 0) continue;
+    const ExprSymbolText* item = &symbols.texts[old[i] - 1];
+    StrSlice name = {.start = item->text, .length = item->length};
+    *expr_symbols_probe(name, item->hash) = old[i];
+  }
+  FREE(old);
+}
+
+static ExprSymbol expr_symbols_add(StrSlice name, uint32_t hash) {
+  my_arena_pause();
+  if (symbols.count is symbols.texts_capacity) {
+    symbols.texts_capacity = symbols.texts_capacity
+                                 ? symbols.texts_capacity * 2
+                                 : EXPR_SYMBOLS_MIN_CAPACITY;
+    symbols.texts = (ExprSymbolText*)REALLOC(
+        symbols.texts, sizeof(ExprSymbolText) * symbols.texts_capacity);
+    assert_alloc(symbols.texts);
+  }
+  char* text = (char*)MALLOC(name.length + 1);
+  my_arena_resume();
+  assert_alloc(text);
+  memcpy(text, name.start, name.length);
+  text[name.length] = '\0';
+
+  symbols.texts[symbols.count] = (ExprSymbolText){
+      .text = text,
+      .length = name.length,
+      .hash = hash,
+  };
+  return symbols.count++;
+}
+
+// =====
+// =
+// = Interning
+// =
+// =====
+ExprSymbol expr_symbol_intern(StrSlice name) {
+  // Keep load under 3/4 so probes stay short and always find an empty cell
+  if ((symbols.count + 1) * 4 > symbols.capacity * 3) expr_symbols_grow();
+
+  uint32_t hash = expr_symbols_hash(name);
+  int* cell = expr_symbols_probe(name, hash);
+  if (*cell is 0) *cell = expr_symbols_add(name, hash) + 1;
+  return *cell - 1;
+}
+
+ExprSymbol expr_symbol_intern_string(const char* name) {
+  return expr_symbol_intern(str_slice_from_string(name));
+}
+
+const char* expr_symbol_text(ExprSymbol this) {
+  assert_m(this >= 0 and this < symbols.count);
+  return symbols.texts[this].text;
+}
+
+StrSlice expr_symbol_slice(ExprSymbol this) {
+  assert_m(this >= 0 and this < symbols.count);
+  return (StrSlice){
+      .start = symbols.texts[this].text,
+      .length = symbols.texts[this].length,
+  };
+}
+
+int expr_symbols_count() { return symbols.count; }
+
+void expr_symbols_free() {
+  for (int i = 0; i < symbols.count; i++) FREE((void*)symbols.texts[i].text);
+  FREE(symbols.texts);
+  FREE(symbols.table);
+  symbols.texts = null;
+  symbols.table = null;
+  symbols.count = 0;
+  symbols.texts_capacity = 0;
+  symbols.capacity = 0;
+}
@@ -0,0 +1,26 @@
+#ifndef SRC_PARSER_EXPR_SYMBOLS_H_
+#define SRC_PARSER_EXPR_SYMBOLS_H_
+
+#include "../util/better_string.h"
+
+// Global interner of variable and function names. Every distinct name is
+// stored once and gets a number, which is what Exprs keep: equal names have
+// equal symbols, so names are compared as integers and copied for free.
+// Texts stay valid until expr_symbols_free, which is called at exit.
+//
+//   ExprSymbol sin = expr_symbol_intern(str_slice_from_string("sin"));
+//   expr->function.name == sin;  // Instead of strcmp
+//   x_sprintf(out, "%s", expr_symbol_text(sin));
+
+typedef int ExprSymbol;
+
+ExprSymbol expr_symbol_intern(StrSlice name);
+ExprSymbol expr_symbol_intern_string(const char* name);
+const char* expr_symbol_text(ExprSymbol this);
+StrSlice expr_symbol_slice(ExprSymbol this);
+// Count of symbols so far. Symbols go from 0 to it, so they can index arrays
+int expr_symbols_count();
+
+void expr_symbols_free();
+
+#endif  // SRC_PARSER_EXPR_SYMBOLS_H_
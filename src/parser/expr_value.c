@@ -1,6 +1,8 @@
 
 #include "expr_value.h"
 
+#include <string.h>
+
 #include "../util/allocator.h"
 
 #define VECTOR_C ExprValue
@@ -17,7 +19,7 @@ void expr_value_free(ExprValue this) {
   if (this.type is EXPR_VALUE_NUMBER) {
     // nothing
   } else if (this.type is EXPR_VALUE_VEC) {
-    vec_ExprValue_free(this.vec);
+    expr_vec_free(this.vec);
   } else if (this.type is EXPR_VALUE_NONE) {
     // nothing
   } else {
@@ -30,6 +32,10 @@ void expr_value_free(ExprValue this) {
 // = expr_value_clone
 // =
 // =====
+static size_t vec_copies = 0;
+
+size_t expr_value_vec_copies() { return vec_copies; }
+
 ExprValue expr_value_clone(const ExprValue* source) {
   ExprValue res;
   res.type = source->type;
@@ -37,7 +43,7 @@ ExprValue expr_value_clone(const ExprValue* source) {
   if (res.type is EXPR_VALUE_NUMBER) {
     res.number = source->number;
   } else if (res.type is EXPR_VALUE_VEC) {
-    res.vec = vec_ExprValue_create_copy(source->vec.data, source->vec.length);
+    res.vec = expr_vec_clone(&source->vec);
   } else if (res.type is EXPR_VALUE_NONE) {
     // do nothing
   } else {
@@ -47,11 +53,44 @@ ExprValue expr_value_clone(const ExprValue* source) {
   return res;
 }
 
+void expr_value_result_free(ExprValueResult this) {
+  if (this.is_ok)
+    expr_value_free(this.ok);
+  else
+    str_free(this.err_text);
+}
+
+ExprValueResult expr_value_result_clone(const ExprValueResult* source) {
+  if (source->is_ok)
+    return ExprValueOk(expr_value_clone(&source->ok));
+  else
+    return ExprValueErr(source->err_pos, str_clone(&source->err_text));
+}
+
+static ExprVec expr_vec_copy(const ExprVec* source, bool is_deep);
+
+ExprValue expr_value_deep_clone(const ExprValue* source) {
+  if (source->type is_not EXPR_VALUE_VEC) return *source;
+
+  return (ExprValue){.type = EXPR_VALUE_VEC,
+                     .vec = expr_vec_copy(&source->vec, true)};
+}
+
+ExprValueResult expr_value_result_deep_clone(const ExprValueResult* source) {
+  if (source->is_ok)
+    return ExprValueOk(expr_value_deep_clone(&source->ok));
+  else
+    return ExprValueErr(source->err_pos, str_clone(&source->err_text));
+}
+
 // =====
 // =
 // = expr_value_print
 // =
 // =====
+// Longer vectors are printed as their first elements and the last one
+#define PRINT_MAX_ELEMENTS 32
+
 void expr_value_print(const ExprValue* this, OutStream stream) {
   if (this->type is EXPR_VALUE_NUMBER) {
     x_sprintf(stream, "%.2lf", this->number);
@@ -60,8 +99,14 @@ void expr_value_print(const ExprValue* this, OutStream stream) {
     outstream_putc('[', stream);
     for (int i = 0; i < this->vec.length; i++) {
       if (i > 0) outstream_puts(", ", stream);
+      if (i is PRINT_MAX_ELEMENTS - 1 and
+          this->vec.length > PRINT_MAX_ELEMENTS) {
+        outstream_puts("..., ", stream);
+        i = this->vec.length - 1;
+      }
 
-      expr_value_print(&this->vec.data[i], stream);
+      ExprValue item = expr_vec_at(&this->vec, i);
+      expr_value_print(&item, stream);
     }
     outstream_putc(']', stream);
 
@@ -73,6 +118,80 @@ void expr_value_print(const ExprValue* this, OutStream stream) {
   }
 }
 
+// =====
+// =
+// = expr_value_hash, expr_value_equal
+// =
+// =====
+static uint32_t hash_bytes(uint32_t hash, const void* data, size_t size) {
+  const unsigned char* bytes = (const unsigned char*)data;
+  for (size_t i = 0; i < size; i++) {
+    hash ^= bytes[i];
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+// Longer vectors are hashed by this many elements spread over them, so a
+// range hashes without walking it and the same as its stored copy
+#define HASH_MAX_ELEMENTS 16
+
+static uint32_t hash_value(uint32_t hash, const ExprValue* this) {
+  hash = hash_bytes(hash, &this->type, sizeof(this->type));
+
+  if (this->type is EXPR_VALUE_NUMBER) {
+    hash = hash_bytes(hash, &this->number, sizeof(double));
+  } else if (this->type is EXPR_VALUE_VEC) {
+    int length = this->vec.length;
+    hash = hash_bytes(hash, &length, sizeof(int));
+    int count = length < HASH_MAX_ELEMENTS ? length : HASH_MAX_ELEMENTS;
+    for (int k = 0; k < count; k++) {
+      int i = count is length
+                  ? k
+                  : (int)((long long)k * (length - 1) / (count - 1));
+      ExprValue item = expr_vec_at(&this->vec, i);
+      hash = hash_value(hash, &item);
+    }
+  } else if (this->type is_not EXPR_VALUE_NONE) {
+    panic("Unknown ExprValue type");
+  }
+  return hash;
+}
+
+uint32_t expr_value_hash(const ExprValue* this) {
+  return hash_value(2166136261u, this);
+}
+
+bool expr_value_equal(const ExprValue* a, const ExprValue* b) {
+  if (a->type is_not b->type) return false;
+
+  if (a->type is EXPR_VALUE_NUMBER) {
+    // Bitwise, same as expr_equal
+    return memcmp(&a->number, &b->number, sizeof(double)) is 0;
+
+  } else if (a->type is EXPR_VALUE_VEC) {
+    if (a->vec.length is_not b->vec.length) return false;
+    // Elements of ranges follow from the first one. Otherwise one of the
+    // vectors is stored, which bounds its length
+    if (a->vec.kind is EXPR_VEC_RANGE and b->vec.kind is EXPR_VEC_RANGE)
+      return a->vec.length is 0 or
+             memcmp(&a->vec.start, &b->vec.start, sizeof(double)) is 0;
+
+    for (int i = 0; i < a->vec.length; i++) {
+      ExprValue a_item = expr_vec_at(&a->vec, i);
+      ExprValue b_item = expr_vec_at(&b->vec, i);
+      if (not expr_value_equal(&a_item, &b_item)) return false;
+    }
+    return true;
+
+  } else if (a->type is EXPR_VALUE_NONE) {
+    return true;
+
+  } else {
+    panic("Unknown ExprValue type");
+  }
+}
+
 // =====
 // =
 // = expr_value_type_text
@@ -90,3 +209,346 @@ const char* expr_value_type_text(int type) {
       panic("Unknown ExprValue type");
   }
 }
+
+// =====
+// =
+// = ExprVec
+// =
+// =====
+#define Number(value) \
+  (ExprValue) { .type = EXPR_VALUE_NUMBER, .number = (value) }
+
+// Heap storage starts with a count of the vectors that share it. `numbers`
+// and `items` point right after the count
+#define HEAP_HEADER sizeof(size_t)
+
+static void* heap_alloc(size_t size) {
+  size_t* block = (size_t*)MALLOC(HEAP_HEADER + size);
+  assert_alloc(block);
+  *block = 1;
+  return block + 1;
+}
+
+static size_t* heap_refs(const void* data) { return (size_t*)data - 1; }
+
+static void* heap_realloc(void* data, size_t size) {
+  size_t* block = (size_t*)REALLOC(heap_refs(data), HEAP_HEADER + size);
+  assert_alloc(block);
+  return block + 1;
+}
+
+static bool has_heap(const ExprVec* this) {
+  return this->kind is EXPR_VEC_PACKED or this->kind is EXPR_VEC_BOXED;
+}
+
+ExprVec expr_vec_create() {
+  return (ExprVec){.kind = EXPR_VEC_SMALL, .length = 0};
+}
+
+ExprVec expr_vec_with_capacity(int capacity) {
+  if (capacity <= EXPR_VEC_SMALL_CAPACITY) return expr_vec_create();
+
+  return (ExprVec){
+      .kind = EXPR_VEC_PACKED,
+      .length = 0,
+      .numbers = (double*)heap_alloc(sizeof(double) * capacity),
+      .capacity = capacity,
+  };
+}
+
+ExprVec expr_vec_create_numbers(int length) {
+  ExprVec result = expr_vec_with_capacity(length);
+  result.length = length;
+  return result;
+}
+
+ExprVec expr_vec_from_numbers(const double* numbers, int length) {
+  ExprVec result = expr_vec_create_numbers(length);
+  if (length > 0)
+    memcpy(expr_vec_numbers_mut(&result), numbers, sizeof(double) * length);
+  return result;
+}
+
+ExprVec expr_vec_range(double start, int length) {
+  return (ExprVec){.kind = EXPR_VEC_RANGE, .length = length, .start = start};
+}
+
+ExprVec expr_vec_from_values(vec_ExprValue values) {
+  ExprVec result = expr_vec_with_capacity(values.length);
+  for (int i = 0; i < values.length; i++) expr_vec_push(&result, values.data[i]);
+
+  values.length = 0;  // All elements moved
+  vec_ExprValue_free(values);
+  return result;
+}
+
+vec_ExprValue expr_vec_into_values(ExprVec this) {
+  vec_ExprValue result = vec_ExprValue_with_capacity(this.length);
+  for (int i = 0; i < this.length; i++) {
+    ExprValue item = expr_vec_at(&this, i);
+    vec_ExprValue_push(&result, expr_value_clone(&item));
+  }
+
+  expr_vec_free(this);
+  return result;
+}
+
+vec_ExprValue expr_value_into_args(ExprValue this) {
+  vec_ExprValue args;
+
+  if (this.type is EXPR_VALUE_NUMBER or
+      (this.type is EXPR_VALUE_VEC and this.vec.kind is EXPR_VEC_RANGE)) {
+    args = vec_ExprValue_with_capacity(1);
+    vec_ExprValue_push(&args, this);
+
+  } else if (this.type is EXPR_VALUE_VEC) {
+    args = expr_vec_into_values(this.vec);
+
+  } else if (this.type is EXPR_VALUE_NONE) {
+    args = vec_ExprValue_create();
+
+  } else {
+    panic("Unknown ExprValue type");
+  }
+
+  return args;
+}
+
+bool expr_vec_can_store(long long length) {
+  return length <= EXPR_VEC_MAX_STORED;
+}
+
+ExprValueResult expr_vec_too_long(long long length) {
+  return ExprValueErr(null, str_owned("Vector of %lld elements is too long "
+                                      "to store (at most %d)",
+                                      length, EXPR_VEC_MAX_STORED));
+}
+
+void expr_vec_free(ExprVec this) {
+  if (not has_heap(&this)) return;
+
+  size_t* refs = heap_refs(this.numbers);
+  if (--(*refs) > 0) return;
+
+  if (this.kind is EXPR_VEC_BOXED)
+    for (int i = 0; i < this.length; i++) expr_value_free(this.items[i]);
+  FREE(refs);
+}
+
+ExprVec expr_vec_clone(const ExprVec* source) {
+  if (has_heap(source)) (*heap_refs(source->numbers))++;
+  return *source;
+}
+
+// Storage of its own, nested vectors are shared unless `is_deep`
+static ExprVec expr_vec_copy(const ExprVec* source, bool is_deep) {
+  if (not has_heap(source)) return *source;
+  vec_copies++;
+
+  ExprVec result = *source;
+  result.capacity = source->length > 0 ? source->length : 1;
+
+  if (source->kind is EXPR_VEC_PACKED) {
+    result.numbers = (double*)heap_alloc(sizeof(double) * result.capacity);
+    memcpy(result.numbers, source->numbers, sizeof(double) * source->length);
+  } else {
+    result.items = (ExprValue*)heap_alloc(sizeof(ExprValue) * result.capacity);
+    for (int i = 0; i < source->length; i++)
+      result.items[i] = is_deep ? expr_value_deep_clone(&source->items[i])
+                                : expr_value_clone(&source->items[i]);
+  }
+  return result;
+}
+
+// Copy on write: called before any change of the elements. Ranges get
+// their numbers stored
+static void expr_vec_make_unique(ExprVec* this) {
+  if (this->kind is EXPR_VEC_RANGE) {
+    assert_m(expr_vec_can_store(this->length));
+    ExprVec numbers = expr_vec_create_numbers(this->length);
+    expr_vec_read_numbers(this, 0, this->length,
+                          (double*)expr_vec_numbers(&numbers));
+    *this = numbers;
+    return;
+  }
+
+  if (not has_heap(this) or *heap_refs(this->numbers) is 1) return;
+
+  ExprVec copy = expr_vec_copy(this, false);
+  expr_vec_free(*this);
+  *this = copy;
+}
+
+// Converts numbers to ExprValues, for an element that is not a number
+static void expr_vec_box(ExprVec* this, int capacity) {
+  ExprValue* items = (ExprValue*)heap_alloc(sizeof(ExprValue) * capacity);
+  const double* numbers = expr_vec_numbers(this);
+  for (int i = 0; i < this->length; i++) items[i] = Number(numbers[i]);
+
+  expr_vec_free(*this);
+  this->kind = EXPR_VEC_BOXED;
+  this->items = items;
+  this->capacity = capacity;
+}
+
+static void expr_vec_reserve(ExprVec* this, int length) {
+  if (this->kind is EXPR_VEC_SMALL) {
+    if (length <= EXPR_VEC_SMALL_CAPACITY) return;
+
+    int capacity = length > 8 ? length : 8;
+    double* numbers = (double*)heap_alloc(sizeof(double) * capacity);
+    memcpy(numbers, this->small, sizeof(double) * this->length);
+    this->kind = EXPR_VEC_PACKED;
+    this->numbers = numbers;
+    this->capacity = capacity;
+    return;
+  }
+
+  if (length <= this->capacity) return;
+
+  int capacity = this->capacity * 2 > length ? this->capacity * 2 : length;
+  if (this->kind is EXPR_VEC_PACKED)
+    this->numbers =
+        (double*)heap_realloc(this->numbers, sizeof(double) * capacity);
+  else
+    this->items =
+        (ExprValue*)heap_realloc(this->items, sizeof(ExprValue) * capacity);
+  this->capacity = capacity;
+}
+
+void expr_vec_push(ExprVec* this, ExprValue item) {
+  if (item.type is EXPR_VALUE_NUMBER) {
+    expr_vec_push_number(this, item.number);
+    return;
+  }
+
+  expr_vec_make_unique(this);
+  if (this->kind is_not EXPR_VEC_BOXED)
+    expr_vec_box(this, this->length < 4 ? 4 : this->length * 2);
+
+  expr_vec_reserve(this, this->length + 1);
+  this->items[this->length++] = item;
+}
+
+void expr_vec_push_number(ExprVec* this, double number) {
+  expr_vec_make_unique(this);
+  expr_vec_reserve(this, this->length + 1);
+
+  if (this->kind is EXPR_VEC_BOXED)
+    this->items[this->length++] = Number(number);
+  else
+    expr_vec_numbers_mut(this)[this->length++] = number;
+}
+
+void expr_vec_append(ExprVec* this, ExprVec other) {
+  // Ranges stay lazy while nothing else is joined
+  if (this->kind is EXPR_VEC_SMALL and this->length is 0) {
+    *this = other;
+    return;
+  }
+  if (this->kind is EXPR_VEC_RANGE and other.kind is EXPR_VEC_RANGE and
+      other.start == this->start + this->length) {
+    this->length += other.length;
+    return;
+  }
+
+  expr_vec_make_unique(this);
+
+  if (this->kind is_not EXPR_VEC_BOXED and expr_vec_is_numbers(&other)) {
+    expr_vec_reserve(this, this->length + other.length);
+    double* out = expr_vec_numbers_mut(this) + this->length;
+    const double* numbers = expr_vec_read_numbers(&other, 0, other.length, out);
+    if (numbers != out and other.length > 0)
+      memcpy(out, numbers, sizeof(double) * other.length);
+    this->length += other.length;
+    expr_vec_free(other);
+    return;
+  }
+
+  if (this->kind is_not EXPR_VEC_BOXED)
+    expr_vec_box(this, this->length + other.length);
+  expr_vec_reserve(this, this->length + other.length);
+
+  // `other` may be shared, so elements are cloned rather than moved
+  for (int i = 0; i < other.length; i++) {
+    ExprValue item = expr_vec_at(&other, i);
+    this->items[this->length++] = expr_value_clone(&item);
+  }
+  expr_vec_free(other);
+}
+
+ExprValue expr_vec_at(const ExprVec* this, int index) {
+  assert_m(index >= 0 and index < this->length);
+
+  switch (this->kind) {
+    case EXPR_VEC_SMALL:
+      return Number(this->small[index]);
+    case EXPR_VEC_PACKED:
+      return Number(this->numbers[index]);
+    case EXPR_VEC_BOXED:
+      return this->items[index];
+    case EXPR_VEC_RANGE:
+      return Number(this->start + index);
+    default:
+      panic("Unknown ExprVec kind");
+  }
+}
+
+const double* expr_vec_numbers(const ExprVec* this) {
+  switch (this->kind) {
+    case EXPR_VEC_SMALL:
+      return this->small;
+    case EXPR_VEC_PACKED:
+      return this->numbers;
+    default:
+      return null;
+  }
+}
+
+bool expr_vec_is_numbers(const ExprVec* this) {
+  return this->kind is_not EXPR_VEC_BOXED;
+}
+
+const double* expr_vec_read_numbers(const ExprVec* this, int start, int count,
+                                    double* buffer) {
+  assert_m(start >= 0 and count >= 0 and start + count <= this->length);
+
+  if (this->kind is EXPR_VEC_RANGE) {
+    for (int i = 0; i < count; i++) buffer[i] = this->start + (start + i);
+    return buffer;
+  }
+
+  const double* numbers = expr_vec_numbers(this);
+  assert_m(numbers);
+  return numbers + start;
+}
+
+ExprVec expr_vec_slice(const ExprVec* this, int start, int length) {
+  assert_m(start >= 0 and length >= 0 and start + length <= this->length);
+
+  if (this->kind is EXPR_VEC_RANGE)
+    return expr_vec_range(this->start + start, length);
+  if (this->kind is_not EXPR_VEC_BOXED)
+    return expr_vec_from_numbers(expr_vec_numbers(this) + start, length);
+
+  ExprVec result = expr_vec_with_capacity(length);
+  for (int i = start; i < start + length; i++)
+    expr_vec_push(&result, expr_value_clone(&this->items[i]));
+  return result;
+}
+
+double* expr_vec_numbers_mut(ExprVec* this) {
+  if (this->kind is EXPR_VEC_BOXED) return null;
+
+  expr_vec_make_unique(this);
+  return (double*)expr_vec_numbers(this);
+}
+
+ExprValue* expr_vec_items_mut(ExprVec* this) {
+  if (this->kind is_not EXPR_VEC_BOXED) return null;
+
+  expr_vec_make_unique(this);
+  return this->items;
+}
+
+#undef Number
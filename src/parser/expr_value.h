@@ -1,6 +1,8 @@
 #ifndef SRC_PARSER_EXPR_VALUE_H_
 #define SRC_PARSER_EXPR_VALUE_H_
 
+#include <stdint.h>
+
 #include "../util/better_io.h"
 #include "../util/better_string.h"
 
@@ -10,6 +12,35 @@ typedef struct ExprValue ExprValue;
 #define VECTOR_H ExprValue
 #include "../util/vector.h"
 
+// ===== ExprVec
+// Elements of a vector value. Vectors of numbers are stored as plain doubles,
+// short ones right inside the value. Only vectors holding vectors or Nones
+// keep every element as an ExprValue. Ranges keep only the first number.
+#define EXPR_VEC_SMALL 0   // Up to EXPR_VEC_SMALL_CAPACITY numbers, no heap
+#define EXPR_VEC_PACKED 1  // Numbers in the heap
+#define EXPR_VEC_BOXED 2   // ExprValues in the heap
+#define EXPR_VEC_RANGE 3   // start, start + 1, ..., no heap
+#define EXPR_VEC_SMALL_CAPACITY 3
+// Ranges hold up to INT_MAX elements, but vectors made of them are stored,
+// so their length is checked against this first
+#define EXPR_VEC_MAX_STORED (1 << 23)
+
+typedef struct ExprVec {
+  int kind;
+  int length;
+  union {
+    double small[EXPR_VEC_SMALL_CAPACITY];
+    struct {
+      union {
+        double* numbers;   // EXPR_VEC_PACKED
+        ExprValue* items;  // EXPR_VEC_BOXED
+      };
+      int capacity;
+    };
+    double start;  // EXPR_VEC_RANGE
+  };
+} ExprVec;
+
 #define EXPR_VALUE_NUMBER 0
 #define EXPR_VALUE_VEC 1
 #define EXPR_VALUE_NONE 3
@@ -17,15 +48,69 @@ struct ExprValue {
   int type;
   union {
     double number;
-    vec_ExprValue vec;
+    ExprVec vec;
   };
 };
 
 void expr_value_free(ExprValue this);
+// Vectors are shared, the storage is copied on the first write
 ExprValue expr_value_clone(const ExprValue* source);
+// Copy with storage of its own, for values leaving an arena scope
+ExprValue expr_value_deep_clone(const ExprValue* source);
+// Count of vector storage copies since the start, for tests and benchmarks
+size_t expr_value_vec_copies();
 void expr_value_print(const ExprValue* this, OutStream stream);
+// By elements, whatever the storage of vectors is. Numbers are compared
+// bitwise, so NaN equals itself. Both take constant time for ranges
+uint32_t expr_value_hash(const ExprValue* this);
+bool expr_value_equal(const ExprValue* a, const ExprValue* b);
 const char* expr_value_type_text(int type);
 
+ExprVec expr_vec_create();
+// Room for `capacity` numbers without reallocation
+ExprVec expr_vec_with_capacity(int capacity);
+// `length` numbers, uninitialized, to be written via expr_vec_numbers_mut
+ExprVec expr_vec_create_numbers(int length);
+ExprVec expr_vec_from_numbers(const double* numbers, int length);
+ExprVec expr_vec_range(double start, int length);
+// Takes ownership of `values`, vectors of numbers get packed
+ExprVec expr_vec_from_values(vec_ExprValue values);
+// Takes ownership of `this`, every element becomes an ExprValue
+vec_ExprValue expr_vec_into_values(ExprVec this);
+// Arguments of a function call from the value of its argument list. Vectors
+// are spread, except ranges: native functions treat a vector argument the
+// same as its elements, and calc_backend_call_function spreads it for user
+// functions. Takes ownership of `this`
+vec_ExprValue expr_value_into_args(ExprValue this);
+void expr_vec_free(ExprVec this);
+// Shares the storage with `source`
+ExprVec expr_vec_clone(const ExprVec* source);
+
+// Takes ownership of `item`
+void expr_vec_push(ExprVec* this, ExprValue item);
+void expr_vec_push_number(ExprVec* this, double number);
+// Takes ownership of `other`
+void expr_vec_append(ExprVec* this, ExprVec other);
+
+// The element without copying: nested vectors are shared with `this`, so the
+// result must not be freed and does not outlive `this`
+ExprValue expr_vec_at(const ExprVec* this, int index);
+// Null if some element is not a number, or for a range
+const double* expr_vec_numbers(const ExprVec* this);
+// Every element is a number, stored or not
+bool expr_vec_is_numbers(const ExprVec* this);
+// Numbers [start, start + count) of a vector for which expr_vec_is_numbers,
+// written to `buffer` if they are not stored
+const double* expr_vec_read_numbers(const ExprVec* this, int start, int count,
+                                    double* buffer);
+// Elements [start, start + length), a range stays a range
+ExprVec expr_vec_slice(const ExprVec* this, int start, int length);
+// Writable elements, copied first if the storage is shared (or a range).
+// Storing a range needs expr_vec_can_store of its length
+double* expr_vec_numbers_mut(ExprVec* this);
+// Null if the vector is not boxed
+ExprValue* expr_vec_items_mut(ExprVec* this);
+
 typedef struct ExprValueResult {
   bool is_ok;
 
@@ -43,4 +128,12 @@ typedef struct ExprValueResult {
 #define ExprValueErr(pos, text) \
   (ExprValueResult) { .is_ok = false, .err_pos = (pos), .err_text = (text) }
 
+// Whether `length` elements may be stored, see EXPR_VEC_MAX_STORED
+bool expr_vec_can_store(long long length);
+ExprValueResult expr_vec_too_long(long long length);
+
+void expr_value_result_free(ExprValueResult this);
+ExprValueResult expr_value_result_clone(const ExprValueResult* source);
+ExprValueResult expr_value_result_deep_clone(const ExprValueResult* source);
+
 #endif  // SRC_PARSER_EXPR_VALUE_H_
\ No newline at end of file
@@ -1,9 +1,13 @@
 #include "operators_fns.h"
 
+#include <limits.h>
 #include <math.h>
 #include <string.h>
 
+#include "../util/perfect_hash.h"
 #include "../util/prettify_c.h"
+#include "../util/simd_math.h"
+#include "operators_hash.h"
 
 #define OPERATORS_FUNCS                                                   \
   {                                                                       \
@@ -24,32 +28,42 @@
         expr_operator_index,                                              \
   }
 
+static const char* const OPERATORS_NAMES[] = EXPR_OPERATORS_NAMES;
+
+_Static_assert(LEN(OPERATORS_NAMES) == EXPR_OPERATORS_COUNT,
+               "OPERATORS_NAMES has to follow ExprOperator");
+
+// One probe into the generated table, then one compare
+ExprOperator expr_operator_from_slice(StrSlice name) {
+  uint32_t hash = perfect_hash(OPERATORS_HASH_SEED, name.start, name.length);
+  int i = OPERATORS_HASH_TABLE[hash & OPERATORS_HASH_MASK];
+  if (i < 0) return EXPR_OP_NONE;
+
+  const char* text = OPERATORS_NAMES[i];
+  if (strncmp(name.start, text, name.length) is 0 and text[name.length] is 0)
+    return (ExprOperator)i;
+  return EXPR_OP_NONE;
+}
+
+const char* expr_operator_name(ExprOperator op) {
+  assert_m(op >= 0 and op < EXPR_OPERATORS_COUNT);
+  return OPERATORS_NAMES[op];
+}
+
+static const OperatorFn OPERATORS_FN_TABLE[] = OPERATORS_FUNCS;
+_Static_assert(LEN(OPERATORS_FN_TABLE) == EXPR_OPERATORS_COUNT,
+               "OPERATORS_FUNCS has to follow ExprOperator");
+
+OperatorFn expr_operator_fn(ExprOperator op) {
+  return op is EXPR_OP_NONE ? null : OPERATORS_FN_TABLE[op];
+}
+
 OperatorFn expr_get_operator_fn_slice(StrSlice name) {
-  const char* const operators[] = {
-      "mod",                                       // Mod
-      "..",  "..=",                                // Range
-      ":=",  "+=",  "-=", "*=", "/=", "%=", "^=",  // Procedures
-      "==",  "!=",  "<=", ">=", "<",  ">",         // Comparsions
-      "=",   "+",   "-",  "*",  "/",  "%",  "^",   // Operators
-      "[]",
-  };
-
-  const OperatorFn funcs[] = OPERATORS_FUNCS;
-
-  int len = LEN(operators);
-  assert_m(LEN(operators) == LEN(funcs));
-
-  for (int i = 0; i < len; i++) {
-    if (name.length == (int)strlen(operators[i]) and
-        strncmp(name.start, operators[i], name.length) is 0)
-      return funcs[i];
-  }
-  return null;
+  return expr_operator_fn(expr_operator_from_slice(name));
 }
 
 OperatorFn expr_get_operator_fn(const char* name) {
-  return expr_get_operator_fn_slice(
-      (StrSlice){.start = name, .length = strlen(name)});
+  return expr_get_operator_fn_slice(str_slice_from_string(name));
 }
 
 #define Err(...)                                                        \
@@ -59,12 +73,47 @@ OperatorFn expr_get_operator_fn(const char* name) {
 #define Ok(val) \
   (ExprValueResult) { .is_ok = true, .ok = (val) }
 
-static ExprValueResult template_alg_operator(ExprValue* a, ExprValue* b,
+static ExprValueResult template_alg_operator(const ExprValue* a,
+                                             const ExprValue* b,
                                              double (*fn)(double, double),
+                                             BatchOperatorFn batch,
                                              const char* err_name);
 
-static ExprValueResult template_alg_vecvec(ExprValue* a, ExprValue* b,
+// Numbers of ranges and broadcasts of a number are read in chunks on the stack
+#define ALG_BATCH_CHUNK 64
+
+// Vector of numbers op vector of numbers (or number, if `b` is null)
+static ExprVec alg_numbers(double (*fn)(double, double), BatchOperatorFn batch,
+                           const ExprVec* a, const ExprVec* b, double b_number,
+                           bool is_inverted) {
+  ExprVec result = expr_vec_create_numbers(a->length);
+  double* out = expr_vec_numbers_mut(&result);
+
+  double a_buffer[ALG_BATCH_CHUNK], b_buffer[ALG_BATCH_CHUNK];
+  if (not b)
+    for (int k = 0; k < ALG_BATCH_CHUNK; k++) b_buffer[k] = b_number;
+
+  for (int start = 0; start < a->length; start += ALG_BATCH_CHUNK) {
+    int n = a->length - start < ALG_BATCH_CHUNK ? a->length - start
+                                                : ALG_BATCH_CHUNK;
+    const double* x = expr_vec_read_numbers(a, start, n, a_buffer);
+    const double* y = b ? expr_vec_read_numbers(b, start, n, b_buffer)
+                        : b_buffer;
+    if (is_inverted) SWAP(const double*, x, y);
+
+    if (batch)
+      batch(x, y, out + start, n);
+    else
+      for (int i = 0; i < n; i++) out[start + i] = fn(x[i], y[i]);
+  }
+
+  return result;
+}
+
+static ExprValueResult template_alg_vecvec(const ExprValue* a,
+                                           const ExprValue* b,
                                            double (*fn)(double, double),
+                                           BatchOperatorFn batch,
                                            const char* err_name) {
   //.
   assert_m(a->type is EXPR_VALUE_VEC and b->type is EXPR_VALUE_VEC);
@@ -73,16 +122,25 @@ static ExprValueResult template_alg_vecvec(ExprValue* a, ExprValue* b,
     return Err(
         "Elements of vectors of different lengths (%d vs %d) cannot be %s",
         a->vec.length, b->vec.length, err_name);
+  if (not expr_vec_can_store(a->vec.length))
+    return expr_vec_too_long(a->vec.length);
+
+  if (expr_vec_is_numbers(&a->vec) and expr_vec_is_numbers(&b->vec)) {
+    ExprValue v = {.type = EXPR_VALUE_VEC,
+                   .vec = alg_numbers(fn, batch, &a->vec, &b->vec, 0.0, false)};
+    return Ok(v);
+  }
 
   ExprValueResult result = {.is_ok = true};
 
-  vec_ExprValue values = vec_ExprValue_with_capacity(a->vec.length);
+  ExprVec values = expr_vec_with_capacity(a->vec.length);
 
   for (int i = 0; i < a->vec.length and result.is_ok; i++) {
-    result =
-        template_alg_operator(&a->vec.data[i], &b->vec.data[i], fn, err_name);
+    ExprValue a_item = expr_vec_at(&a->vec, i);
+    ExprValue b_item = expr_vec_at(&b->vec, i);
+    result = template_alg_operator(&a_item, &b_item, fn, batch, err_name);
 
-    if (result.is_ok) vec_ExprValue_push(&values, result.ok);
+    if (result.is_ok) expr_vec_push(&values, result.ok);
   }
 
   if (result.is_ok)
@@ -91,35 +149,47 @@ static ExprValueResult template_alg_vecvec(ExprValue* a, ExprValue* b,
         .vec = values,
     };
   else
-    vec_ExprValue_free(values);
+    expr_vec_free(values);
 
   return result;
 }
 
-static ExprValueResult template_alg_vecnum(ExprValue* a, ExprValue* b,
+static ExprValueResult template_alg_vecnum(const ExprValue* a,
+                                           const ExprValue* b,
                                            double (*fn)(double, double),
+                                           BatchOperatorFn batch,
                                            const char* err_name) {
-  ExprValue* vec = a;
-  ExprValue* number = b;
+  const ExprValue* vec = a;
+  const ExprValue* number = b;
   bool is_inverted = false;
 
   if (vec->type is EXPR_VALUE_NUMBER) {
-    SWAP(ExprValue*, vec, number);
+    SWAP(const ExprValue*, vec, number);
     is_inverted = true;
   }
 
   assert_m(vec->type is EXPR_VALUE_VEC and number->type is EXPR_VALUE_NUMBER);
+  if (not expr_vec_can_store(vec->vec.length))
+    return expr_vec_too_long(vec->vec.length);
+
+  if (expr_vec_is_numbers(&vec->vec)) {
+    ExprValue v = {.type = EXPR_VALUE_VEC,
+                   .vec = alg_numbers(fn, batch, &vec->vec, null,
+                                      number->number, is_inverted)};
+    return Ok(v);
+  }
 
   ExprValueResult result = {.is_ok = true};
-  vec_ExprValue values = vec_ExprValue_with_capacity(vec->vec.length);
+  ExprVec values = expr_vec_with_capacity(vec->vec.length);
 
   for (int i = 0; i < vec->vec.length and result.is_ok; i++) {
+    ExprValue item = expr_vec_at(&vec->vec, i);
     if (not is_inverted)
-      result = template_alg_operator(&vec->vec.data[i], number, fn, err_name);
+      result = template_alg_operator(&item, number, fn, batch, err_name);
     else
-      result = template_alg_operator(number, &vec->vec.data[i], fn, err_name);
+      result = template_alg_operator(number, &item, fn, batch, err_name);
 
-    if (result.is_ok) vec_ExprValue_push(&values, result.ok);
+    if (result.is_ok) expr_vec_push(&values, result.ok);
   }
 
   if (result.is_ok)
@@ -128,12 +198,14 @@ static ExprValueResult template_alg_vecnum(ExprValue* a, ExprValue* b,
         .vec = values,
     };
   else
-    vec_ExprValue_free(values);
+    expr_vec_free(values);
 
   return result;
 }
-static ExprValueResult template_alg_operator(ExprValue* a, ExprValue* b,
+static ExprValueResult template_alg_operator(const ExprValue* a,
+                                             const ExprValue* b,
                                              double (*fn)(double, double),
+                                             BatchOperatorFn batch,
                                              const char* err_name) {
   //.
   ExprValueResult result = {.is_ok = true};
@@ -144,60 +216,73 @@ static ExprValueResult template_alg_operator(ExprValue* a, ExprValue* b,
                    .number = fn(a->number, b->number)};
     result = Ok(v);
   } else if (a->type is EXPR_VALUE_VEC and b->type is EXPR_VALUE_VEC) {
-    result = template_alg_vecvec(a, b, fn, err_name);
+    result = template_alg_vecvec(a, b, fn, batch, err_name);
   } else {
-    result = template_alg_vecnum(a, b, fn, err_name);
+    result = template_alg_vecnum(a, b, fn, batch, err_name);
   }
 
   return result;
 }
 
-#define AlgOperator(name, err_name, action)                         \
-  static double expr_operator_##name##_lambda(double a, double b) { \
-    return action;                                                  \
-  }                                                                 \
-  ExprValueResult expr_operator_##name(ExprValue a, ExprValue b) {  \
-    ExprValueResult res = template_alg_operator(                    \
-        &a, &b, expr_operator_##name##_lambda, err_name);           \
-    expr_value_free(a);                                             \
-    expr_value_free(b);                                             \
-    return res;                                                     \
+#define AlgOperator(name, err_name, batch, action)                        \
+  static double expr_operator_##name##_lambda(double a, double b) {       \
+    return action;                                                        \
+  }                                                                       \
+  static ExprValueResult expr_operator_##name##_ref(const ExprValue* a,   \
+                                                    const ExprValue* b) { \
+    return template_alg_operator(a, b, expr_operator_##name##_lambda,     \
+                                 batch, err_name);                        \
+  }                                                                       \
+  ExprValueResult expr_operator_##name(ExprValue a, ExprValue b) {        \
+    ExprValueResult res = expr_operator_##name##_ref(&a, &b);             \
+    expr_value_free(a);                                                   \
+    expr_value_free(b);                                                   \
+    return res;                                                           \
   }
 
-AlgOperator(add, "added", a + b) AlgOperator(sub, "subtracted", a - b)
-    AlgOperator(mul, "multiply", a* b) AlgOperator(div, "divide", a / b)
-        AlgOperator(mod, "mod-ded", fmod(a, b))
-            AlgOperator(pow, "exponentiated", pow(a, b))
+AlgOperator(add, "added", simd_add, a + b)
+    AlgOperator(sub, "subtracted", simd_sub, a - b)
+        AlgOperator(mul, "multiply", simd_mul, a* b)
+            AlgOperator(div, "divide", simd_div, a / b)
+                AlgOperator(mod, "mod-ded", null, fmod(a, b))
+                    AlgOperator(pow, "exponentiated", null, pow(a, b))
 
                 static long long check_num_integer(double number,
                                                    ExprValueResult* res);
 
-ExprValueResult expr_operator_index(ExprValue a, ExprValue b) {
+static ExprValueResult expr_operator_index_ref(const ExprValue* a,
+                                               const ExprValue* b) {
   ExprValueResult result = {.is_ok = true};
 
-  if (a.type is EXPR_VALUE_VEC) {
-    if (b.type is EXPR_VALUE_NUMBER) {
-      long long index = check_num_integer(b.number, &result);
+  if (a->type is EXPR_VALUE_VEC) {
+    if (b->type is EXPR_VALUE_NUMBER) {
+      long long index = check_num_integer(b->number, &result);
       if (result.is_ok) {
-        if (index >= 0 and index < (long long)a.vec.length) {
+        if (index >= 0 and index < (long long)a->vec.length) {
+          ExprValue item = expr_vec_at(&a->vec, index);
           result = (ExprValueResult){
               .is_ok = true,
-              .ok = expr_value_clone(&a.vec.data[index]),
+              .ok = expr_value_clone(&item),
           };
         } else {
           result = Err("Index %lld is out of bounds for vector of length %d",
-                       index, a.vec.length);
+                       index, a->vec.length);
         }
       }
     } else {
       result = Err("Index is not a number (it is '%s' instead)",
-                   expr_value_type_text(b.type));
+                   expr_value_type_text(b->type));
     }
   } else {
     result = Err("Indexing subject is not vector (it is '%s' instead)",
-                 expr_value_type_text(a.type));
+                 expr_value_type_text(a->type));
   }
 
+  return result;
+}
+
+ExprValueResult expr_operator_index(ExprValue a, ExprValue b) {
+  ExprValueResult result = expr_operator_index_ref(&a, &b);
   expr_value_free(a);
   expr_value_free(b);
   return result;
@@ -210,22 +295,25 @@ ExprValueResult expr_operator_index(ExprValue a, ExprValue b) {
 //
 //
 // RANGES
-#define MAX_RANGE 10000
 #define Err(...)                                                        \
   (ExprValueResult) {                                                   \
     .is_ok = false, .err_pos = null, .err_text = str_owned(__VA_ARGS__) \
   }
 
 #define EPSILON 0.0001
+// Doubles hold every integer up to 2^53
+#define MAX_INTEGER 9007199254740992.0
 
 static long long check_num_integer(double number, ExprValueResult* res) {
-  int result = 0;
+  long long result = 0;
   if (fabs(round(number) - number) > EPSILON) {
     (*res) = Err("Range error: number %lf is not an integer (error of +-" STR(
                      EPSILON) " from integer value is allowed)",
                  number);
+  } else if (not(fabs(number) <= MAX_INTEGER)) {  // NaN too
+    (*res) = Err("Range error: number %lf is too large", number);
   } else {
-    result = (long)round(number);
+    result = (long long)round(number);
   }
   return result;
 }
@@ -238,19 +326,21 @@ static ExprValueResult expr_op_range_template(ExprValue a, ExprValue b,
       long long low = check_num_integer(a.number, &result);
       if (result.is_ok) {
         long long high = check_num_integer(b.number, &result);
-        if (result.is_ok) {
-          long long len = high > low ? high - low : 0;
-          vec_ExprValue vec = vec_ExprValue_with_capacity(len);
-
-          for (long long i = low; inclusive ? i <= high : i < high; i++)
-            vec_ExprValue_push(&vec, (ExprValue){.type = EXPR_VALUE_NUMBER,
-                                                 .number = (double)i});
-
-          result = (ExprValueResult){.is_ok = true,
-                                     .ok = {
-                                         .type = EXPR_VALUE_VEC,
-                                         .vec = vec,
-                                     }};
+        long long len = high > low ? high - low : 0;
+        if (inclusive and high >= low) len++;
+
+        if (not result.is_ok) {
+          // error is set
+        } else if (len > INT_MAX) {
+          result = Err("Range of %lld elements is too long", len);
+        } else {
+          // Elements are not stored, see EXPR_VEC_RANGE
+          result = (ExprValueResult){
+              .is_ok = true,
+              .ok = {
+                  .type = EXPR_VALUE_VEC,
+                  .vec = expr_vec_range((double)low, (int)len),
+              }};
         }
       }
     } else
@@ -312,7 +402,7 @@ ExprValueResult expr_operator_pow_assign(ExprValue a, ExprValue b) {
 //
 //
 // COMPARSIONS
-static bool expr_operator_eq_ptr(ExprValue* a, ExprValue* b) {
+static bool expr_operator_eq_ptr(const ExprValue* a, const ExprValue* b) {
   if (a->type != b->type) return false;
 
   if (a->type is EXPR_VALUE_NONE)
@@ -322,9 +412,24 @@ static bool expr_operator_eq_ptr(ExprValue* a, ExprValue* b) {
   else if (a->type is EXPR_VALUE_VEC) {
     if (a->vec.length != b->vec.length) return false;
 
-    for (int i = 0; i < a->vec.length; i++)
-      if (not expr_operator_eq_ptr(&a->vec.data[i], &b->vec.data[i]))
-        return false;
+    if (expr_vec_is_numbers(&a->vec) and expr_vec_is_numbers(&b->vec)) {
+      enum { CHUNK = 64 };
+      double a_buffer[CHUNK], b_buffer[CHUNK];
+      for (int start = 0; start < a->vec.length; start += CHUNK) {
+        int n = a->vec.length - start < CHUNK ? a->vec.length - start : CHUNK;
+        const double* x = expr_vec_read_numbers(&a->vec, start, n, a_buffer);
+        const double* y = expr_vec_read_numbers(&b->vec, start, n, b_buffer);
+        for (int i = 0; i < n; i++)
+          if (x[i] != y[i]) return false;
+      }
+      return true;
+    }
+
+    for (int i = 0; i < a->vec.length; i++) {
+      ExprValue a_item = expr_vec_at(&a->vec, i);
+      ExprValue b_item = expr_vec_at(&b->vec, i);
+      if (not expr_operator_eq_ptr(&a_item, &b_item)) return false;
+    }
 
     return true;
   } else {
@@ -351,29 +456,45 @@ ExprValueResult expr_operator_neq(ExprValue a, ExprValue b) {
   expr_value_free(b);
   return Number(result);
 }
+static ExprValueResult expr_operator_eq_ref(const ExprValue* a,
+                                            const ExprValue* b) {
+  return Number(expr_operator_eq_ptr(a, b));
+}
+static ExprValueResult expr_operator_neq_ref(const ExprValue* a,
+                                             const ExprValue* b) {
+  return Number(not expr_operator_eq_ptr(a, b));
+}
 
 #undef Number
 #define Number(cond) \
   (ExprValue) { .type = EXPR_VALUE_NUMBER, .number = (cond) ? 1.0 : 0.0 }
 
-ExprValue expr_comparsion_template(ExprValue* a, ExprValue* b,
-                                   bool (*fn)(double, double)) {
-  if (a->type != b->type) return Number(false);
+static ExprValueResult expr_comparsion_template(const ExprValue* a,
+                                                const ExprValue* b,
+                                                bool (*fn)(double, double)) {
+  if (a->type != b->type) return ExprValueOk(Number(false));
 
   if (a->type is EXPR_VALUE_NONE)
-    return Number(fn(0.0, 0.0));
+    return ExprValueOk(Number(fn(0.0, 0.0)));
   else if (a->type is EXPR_VALUE_NUMBER)
-    return Number(fn(a->number, b->number));
+    return ExprValueOk(Number(fn(a->number, b->number)));
   else if (a->type is EXPR_VALUE_VEC) {
-    if (a->vec.length != b->vec.length) return Number(false);
+    if (a->vec.length != b->vec.length) return ExprValueOk(Number(false));
+    if (not expr_vec_can_store(a->vec.length))
+      return expr_vec_too_long(a->vec.length);
 
-    vec_ExprValue values = vec_ExprValue_with_capacity(a->vec.length);
+    ExprVec values = expr_vec_with_capacity(a->vec.length);
     for (int i = 0; i < a->vec.length; i++) {
-      ExprValue val =
-          expr_comparsion_template(&a->vec.data[i], &b->vec.data[i], fn);
-      vec_ExprValue_push(&values, val);
+      ExprValue a_item = expr_vec_at(&a->vec, i);
+      ExprValue b_item = expr_vec_at(&b->vec, i);
+      ExprValueResult item = expr_comparsion_template(&a_item, &b_item, fn);
+      if (not item.is_ok) {
+        expr_vec_free(values);
+        return item;
+      }
+      expr_vec_push(&values, item.ok);
     }
-    return (ExprValue){.type = EXPR_VALUE_VEC, .vec = values};
+    return ExprValueOk(((ExprValue){.type = EXPR_VALUE_VEC, .vec = values}));
   } else
     panic("Unknown ExprValue type: %d", a->type);
 }
@@ -382,14 +503,136 @@ ExprValue expr_comparsion_template(ExprValue* a, ExprValue* b,
   static bool expr_operator_##name##_lambda(double a, double b) {        \
     return action;                                                       \
   }                                                                      \
+  static double expr_operator_##name##_scalar(double a, double b) {      \
+    return (action) ? 1.0 : 0.0;                                         \
+  }                                                                      \
+  static ExprValueResult expr_operator_##name##_ref(const ExprValue* a,  \
+                                                    const ExprValue* b) {\
+    return expr_comparsion_template(a, b, expr_operator_##name##_lambda);\
+  }                                                                      \
   ExprValueResult expr_operator_##name(ExprValue a, ExprValue b) {       \
-    ExprValue result =                                                   \
-        expr_comparsion_template(&a, &b, expr_operator_##name##_lambda); \
+    ExprValueResult result = expr_operator_##name##_ref(&a, &b);         \
     expr_value_free(a);                                                  \
     expr_value_free(b);                                                  \
-    return (ExprValueResult){.is_ok = true, .ok = result};               \
+    return result;                                                       \
   }
 
 Comparsion(lte, a <= b) Comparsion(gte, a >= b) Comparsion(lt, a < b)
     Comparsion(gt, a > b)
-#undef Number
\ No newline at end of file
+#undef Number
+
+//
+//
+//
+//
+// SCALAR SHORTCUTS
+static double expr_operator_eq_scalar(double a, double b) {
+  return a == b ? 1.0 : 0.0;
+}
+static double expr_operator_neq_scalar(double a, double b) {
+  return a != b ? 1.0 : 0.0;
+}
+static double expr_operator_assign_scalar(double a, double b) {
+  unused(a);
+  return b;
+}
+
+#define OPERATORS_SCALAR_FUNCS                                               \
+  {                                                                          \
+    expr_operator_mod_lambda, null, null,                                    \
+                                                                             \
+        expr_operator_assign_scalar, expr_operator_assign_scalar,            \
+        expr_operator_assign_scalar, expr_operator_assign_scalar,            \
+        expr_operator_assign_scalar, expr_operator_assign_scalar,            \
+        expr_operator_assign_scalar,                                         \
+                                                                             \
+        expr_operator_eq_scalar, expr_operator_neq_scalar,                   \
+        expr_operator_lte_scalar, expr_operator_gte_scalar,                  \
+        expr_operator_lt_scalar, expr_operator_gt_scalar,                    \
+                                                                             \
+        expr_operator_eq_scalar, expr_operator_add_lambda,                   \
+        expr_operator_sub_lambda, expr_operator_mul_lambda,                  \
+        expr_operator_div_lambda, expr_operator_mod_lambda,                  \
+        expr_operator_pow_lambda,                                            \
+                                                                             \
+        null,                                                                \
+  }
+
+static const ScalarOperatorFn OPERATORS_SCALAR_TABLE[] =
+    OPERATORS_SCALAR_FUNCS;
+_Static_assert(LEN(OPERATORS_SCALAR_TABLE) == EXPR_OPERATORS_COUNT,
+               "OPERATORS_SCALAR_FUNCS has to follow ExprOperator");
+
+ScalarOperatorFn expr_operator_scalar_fn(ExprOperator op) {
+  return op is EXPR_OP_NONE ? null : OPERATORS_SCALAR_TABLE[op];
+}
+
+ScalarOperatorFn expr_get_operator_scalar_fn_slice(StrSlice name) {
+  return expr_operator_scalar_fn(expr_operator_from_slice(name));
+}
+
+ScalarOperatorFn expr_get_operator_scalar_fn(const char* name) {
+  return expr_get_operator_scalar_fn_slice(str_slice_from_string(name));
+}
+
+#define OPERATORS_BATCH_FUNCS                                              \
+  {                                                                        \
+    null, null, null,                                                      \
+                                                                           \
+        null, null, null, null, null, null, null,                          \
+                                                                           \
+        null, null, null, null, null, null,                                \
+                                                                           \
+        null, simd_add, simd_sub, simd_mul, simd_div, null, null,          \
+                                                                           \
+        null,                                                              \
+  }
+
+static const BatchOperatorFn OPERATORS_BATCH_TABLE[] =
+    OPERATORS_BATCH_FUNCS;
+_Static_assert(LEN(OPERATORS_BATCH_TABLE) == EXPR_OPERATORS_COUNT,
+               "OPERATORS_BATCH_FUNCS has to follow ExprOperator");
+
+BatchOperatorFn expr_operator_batch_fn(ExprOperator op) {
+  return op is EXPR_OP_NONE ? null : OPERATORS_BATCH_TABLE[op];
+}
+
+BatchOperatorFn expr_get_operator_batch_fn_slice(StrSlice name) {
+  return expr_operator_batch_fn(expr_operator_from_slice(name));
+}
+
+BatchOperatorFn expr_get_operator_batch_fn(const char* name) {
+  return expr_get_operator_batch_fn_slice(str_slice_from_string(name));
+}
+
+#define OPERATORS_REF_FUNCS                                                \
+  {                                                                        \
+    expr_operator_mod_ref, null, null,                                     \
+                                                                           \
+        null, null, null, null, null, null, null,                          \
+                                                                           \
+        expr_operator_eq_ref, expr_operator_neq_ref, expr_operator_lte_ref, \
+        expr_operator_gte_ref, expr_operator_lt_ref, expr_operator_gt_ref, \
+                                                                           \
+        expr_operator_eq_ref, expr_operator_add_ref, expr_operator_sub_ref, \
+        expr_operator_mul_ref, expr_operator_div_ref, expr_operator_mod_ref, \
+        expr_operator_pow_ref,                                             \
+                                                                           \
+        expr_operator_index_ref,                                           \
+  }
+
+static const RefOperatorFn OPERATORS_REF_TABLE[] = OPERATORS_REF_FUNCS;
+_Static_assert(LEN(OPERATORS_REF_TABLE) == EXPR_OPERATORS_COUNT,
+               "OPERATORS_REF_FUNCS has to follow ExprOperator");
+
+RefOperatorFn expr_operator_ref_fn(ExprOperator op) {
+  return op is EXPR_OP_NONE ? null : OPERATORS_REF_TABLE[op];
+}
+
+RefOperatorFn expr_get_operator_ref_fn_slice(StrSlice name) {
+  return expr_operator_ref_fn(expr_operator_from_slice(name));
+}
+
+RefOperatorFn expr_get_operator_ref_fn(const char* name) {
+  return expr_get_operator_ref_fn_slice(str_slice_from_string(name));
+}
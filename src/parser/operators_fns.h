@@ -3,10 +3,78 @@
 
 #include "expr_value.h"
 
+// Operators of the AST, in the order of the operator tables
+typedef enum ExprOperator {
+  EXPR_OP_NONE = -1,
+  EXPR_OP_MOD_WORD,  // mod
+  EXPR_OP_RANGE,
+  EXPR_OP_RANGE_INCLUDED,
+  EXPR_OP_ASSIGN,
+  EXPR_OP_ADD_ASSIGN,
+  EXPR_OP_SUB_ASSIGN,
+  EXPR_OP_MUL_ASSIGN,
+  EXPR_OP_DIV_ASSIGN,
+  EXPR_OP_MOD_ASSIGN,
+  EXPR_OP_POW_ASSIGN,
+  EXPR_OP_EQ,
+  EXPR_OP_NEQ,
+  EXPR_OP_LTE,
+  EXPR_OP_GTE,
+  EXPR_OP_LT,
+  EXPR_OP_GT,
+  EXPR_OP_EQUATION,  // =
+  EXPR_OP_ADD,
+  EXPR_OP_SUB,
+  EXPR_OP_MUL,
+  EXPR_OP_DIV,
+  EXPR_OP_MOD,
+  EXPR_OP_POW,
+  EXPR_OP_INDEX,  // a[b]
+  EXPR_OPERATORS_COUNT,
+} ExprOperator;
+
+// Texts of ExprOperator. The lookup table of expr_operator_from_slice is
+// generated from this list, run `make perfect_hash` after changing it
+#define EXPR_OPERATORS_NAMES                                                \
+  {                                                                         \
+    "mod", "..", "..=", ":=", "+=", "-=", "*=", "/=", "%=", "^=", "==",     \
+        "!=", "<=", ">=", "<", ">", "=", "+", "-", "*", "/", "%", "^",      \
+        "[]",                                                               \
+  }
+
+// EXPR_OP_NONE for names that are not operators
+ExprOperator expr_operator_from_slice(StrSlice name);
+const char* expr_operator_name(ExprOperator op);
+
+// Getters by ExprOperator are table lookups, the ones by name look the
+// operator up first. All give null for EXPR_OP_NONE and unknown names
 typedef ExprValueResult (*OperatorFn)(ExprValue, ExprValue);
+OperatorFn expr_operator_fn(ExprOperator op);
 OperatorFn expr_get_operator_fn(const char* name);
 OperatorFn expr_get_operator_fn_slice(StrSlice name);
 
+// Number-only shortcut of an operator. Gives the same result as the full
+// OperatorFn when both operands are numbers, null for non-arithmetic operators
+typedef double (*ScalarOperatorFn)(double, double);
+ScalarOperatorFn expr_operator_scalar_fn(ExprOperator op);
+ScalarOperatorFn expr_get_operator_scalar_fn(const char* name);
+ScalarOperatorFn expr_get_operator_scalar_fn_slice(StrSlice name);
+
+// Array form of the scalar shortcut: out[i] = a[i] <op> b[i]. Runs on SIMD
+// kernels, null for operators that have none
+typedef void (*BatchOperatorFn)(const double* a, const double* b, double* out,
+                                int count);
+BatchOperatorFn expr_operator_batch_fn(ExprOperator op);
+BatchOperatorFn expr_get_operator_batch_fn(const char* name);
+BatchOperatorFn expr_get_operator_batch_fn_slice(StrSlice name);
+
+// Same as OperatorFn, but only borrows the operands, so stored values can take
+// part without a copy. Null for assigns and ranges
+typedef ExprValueResult (*RefOperatorFn)(const ExprValue*, const ExprValue*);
+RefOperatorFn expr_operator_ref_fn(ExprOperator op);
+RefOperatorFn expr_get_operator_ref_fn(const char* name);
+RefOperatorFn expr_get_operator_ref_fn_slice(StrSlice name);
+
 ExprValueResult expr_operator_add(ExprValue, ExprValue);
 ExprValueResult expr_operator_sub(ExprValue, ExprValue);
 ExprValueResult expr_operator_mul(ExprValue, ExprValue);
@@ -0,0 +1,16 @@
+// Generated by tools/perfect_hash_gen.c from EXPR_OPERATORS_NAMES.
+// Do not edit, run `make perfect_hash` to update
+#ifndef SRC_PARSER_OPERATORS_HASH_H_
+#define SRC_PARSER_OPERATORS_HASH_H_
+
+#define OPERATORS_HASH_SEED 104u
+#define OPERATORS_HASH_MASK 63
+
+static const signed char OPERATORS_HASH_TABLE[] = {
+    -1, -1, -1, -1, 10, 22, 13, 4, -1, -1, -1, 18, 5, -1, 19, 14,
+    -1, 7, -1, 21, -1, -1, -1, -1, -1, -1, -1, -1, 3, -1, -1, 0,
+    8, -1, 23, -1, -1, 15, -1, 1, -1, -1, -1, -1, 12, 20, -1, -1,
+    -1, -1, 11, -1, 9, 6, -1, -1, -1, 17, 2, -1, 16, -1, -1, -1,
+};
+
+#endif  // SRC_PARSER_OPERATORS_HASH_H_
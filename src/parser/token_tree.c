@@ -213,22 +213,23 @@ typedef struct OpsSlice {
   int length;
 } OpsSlice;
 
-static TokenTreeResult group_by_brackets(vec_Token tokens);
+static TokenTreeResult group_by_brackets(const vec_Token* tokens);
 static TokenTree group_by_commas(TokenTree tree);
 static TokenTree split_by(TokenTree tree, OpsSlice operators);
 static TokenTree group_by_functions(TokenTree tree, TtContext ctx);
 
 TokenTreeResult token_tree_parse(const char* text, TtContext ctx) {
   vec_Token tokens = vec_Token_create();
-
-  // Collect all tokens into vector
-  TokenResult next_token = tk_next_token(text);
-  while (next_token.has_token) {
-    vec_Token_push(&tokens, next_token.token);
-    next_token = tk_next_token(next_token.next_token_pos);
+  TokenizeResult tokenized = tk_tokenize(text, &tokens, ctx.check_symbols);
+  if (not tokenized.is_ok) {
+    vec_Token_free(tokens);
+    return (TokenTreeResult){.is_ok = false,
+                             .err.text = tokenized.err_text,
+                             .err.text_pos = tokenized.err_pos};
   }
 
-  TokenTreeResult result = group_by_brackets(tokens);
+  TokenTreeResult result = group_by_brackets(&tokens);
+  vec_Token_free(tokens);
   if (result.is_ok) {
     TokenTree tree = group_by_commas(result.ok);
     tree = token_tree_simplify(tree);
@@ -271,7 +272,7 @@ static void gbb_opening_bracket(Token token, vec_char* stack_brackets,
                                 vec_void_ptr* stack,
                                 vec_TokenTree* current_pos);
 
-static TokenTreeResult group_by_brackets(vec_Token tokens) {
+static TokenTreeResult group_by_brackets(const vec_Token* tokens) {
   vec_TokenTree tree = vec_TokenTree_create();
   vec_void_ptr stack = vec_void_ptr_create();
   vec_char stack_brackets = vec_char_create();
@@ -279,7 +280,8 @@ static TokenTreeResult group_by_brackets(vec_Token tokens) {
   vec_void_ptr_push(&stack, &tree);
   TokenTreeResult result = {.is_ok = true};
 
-  foreach_extract(Token token, tokens, result.is_ok, {
+  for (int i = 0; i < tokens->length and result.is_ok; i++) {
+    Token token = tokens->data[i];
     vec_TokenTree* current_pos = (vec_TokenTree*)stack.data[stack.length - 1];
 
     if (token.type is TOKEN_BRACKET) {
@@ -290,8 +292,7 @@ static TokenTreeResult group_by_brackets(vec_Token tokens) {
     } else {
       vec_TokenTree_push(current_pos, token_tree_from_token(token));
     }
-  });
-  vec_Token_free(tokens);
+  }
 
   vec_void_ptr_free(stack);
   vec_char_free(stack_brackets);
@@ -39,6 +39,7 @@ typedef struct TokenTreeResult {
 typedef struct TtContext {
   void* data;
   bool (*is_function)(void*, StrSlice);
+  bool check_symbols;  // See tk_tokenize
 } TtContext;
 
 // =====
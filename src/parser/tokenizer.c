@@ -4,6 +4,7 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "../util/allocator.h"
@@ -14,32 +15,195 @@
 #include "../util/vector.h"  // vec_Token
 
 // =====
-// HELPER FUNCTIONS
-static bool is_letter(char c);
-static bool is_digit(char c);
-static bool is_bracket(char c);
-static char next_char_skip_spaces(const char* text);
+// =
+// = Character classes
+// =
+// =====
+#define CC_SPACE 1
+#define CC_LETTER 2
+#define CC_DIGIT 4
+#define CC_BRACKET 8
+#define CC_ALLOWED 16  // See tk_is_symbol_allowed
+
+#define ASCII_MAX 127
+
+// Ranges are a GCC extension, as is everything else the Makefile builds with
+#define A CC_ALLOWED
+static const unsigned char CHAR_CLASSES[256] = {
+    [' '] = CC_SPACE | A,
+    ['a' ... 'z'] = CC_LETTER | A,
+    ['A' ... 'Z'] = CC_LETTER | A,
+    ['_'] = CC_LETTER | A,
+    ['0' ... '9'] = CC_DIGIT | A,
+    ['('] = CC_BRACKET | A,
+    [')'] = CC_BRACKET | A,
+    ['['] = CC_BRACKET | A,
+    [']'] = CC_BRACKET | A,
+    ['{'] = CC_BRACKET | A,
+    ['}'] = CC_BRACKET | A,
+    ['.'] = A,
+    [','] = A,
+    ['!'] = A,
+    ['='] = A,
+    ['<'] = A,
+    ['>'] = A,
+    ['+'] = A,
+    ['-'] = A,
+    ['*'] = A,
+    ['/'] = A,
+    ['^'] = A,
+    ['%'] = A,
+};
+#undef A
+
+static bool has_class(char c, int cls) {
+  return CHAR_CLASSES[(unsigned char)c] & cls;
+}
+
+static const char* skip_spaces(const char* string) {
+  while (has_class(*string, CC_SPACE)) string++;
+  return string;
+}
 
 // =====
 // =
-// = tk_next_token
+// = scan_token
 // =
 // =====
+static const char* scan_token(const char* string, Token* token);
 
 // >-<helper functions>-<
-static const char* skip_spaces(const char* string);
-static bool check_operator(const char* string, struct TokenResult* result);
-
-static TokenResult scan_comma(const char* string, TokenResult result);
-static TokenResult scan_bracket(const char* string, TokenResult result);
-static TokenResult scan_ident(const char* string, TokenResult result);
-static TokenResult scan_number(const char* string, TokenResult result);
-static double read_num_non_scientific(const char* string, int* offset);
-static bool has_double_dot_after_digits(const char* string);
+static const char* scan_operator(const char* string, int length,
+                                 Token* token);
+static const char* scan_ident(const char* string, Token* token);
+static const char* scan_number(const char* string, Token* token);
+static bool starts_number(const char* string);
 
 // >-<function itself>-<
+// The token at `string`, which has no spaces in front. Returns the end of the
+// token, or null if no token starts with this symbol. The first symbol picks
+// the kind of the token, only operators look one or two symbols further
+static const char* scan_token(const char* string, Token* token) {
+  *token = (Token){.type = TOKEN_NUMBER, .start_pos = string};
+  char c = string[0];
+
+  if (has_class(c, CC_LETTER)) {
+    // Before idents, so `modx` is `mod x`
+    if (strncmp(string, "mod", 3) is 0) return scan_operator(string, 3, token);
+    return scan_ident(string, token);
+  }
+  if (has_class(c, CC_DIGIT)) return scan_number(string, token);
+  if (has_class(c, CC_BRACKET)) {
+    token->type = TOKEN_BRACKET;
+    token->data.bracket_symbol = c;
+    return string + 1;
+  }
+
+  switch (c) {
+    case ',':
+      token->type = TOKEN_COMMA;
+      return string + 1;
+    case '.':
+      if (string[1] is_not '.') return scan_number(string, token);
+      return scan_operator(string, string[2] is '=' ? 3 : 2, token);
+    case '-':
+      // Minus in front of a number is its sign
+      if (starts_number(skip_spaces(string + 1)))
+        return scan_number(string, token);
+      // fall through
+    case '+':
+    case '*':
+    case '/':
+    case '%':
+    case '^':
+    case '=':
+    case '<':
+    case '>':
+      return scan_operator(string, string[1] is '=' ? 2 : 1, token);
+    case ':':
+    case '!':
+      return string[1] is '=' ? scan_operator(string, 2, token) : null;
+    default:
+      return null;
+  }
+}
+
+static const char* scan_operator(const char* string, int length,
+                                 Token* token) {
+  token->type = TOKEN_OPERATOR;
+  token->data.operator_text = (StrSlice){string, length};
+  return string + length;
+}
+
+static const char* scan_ident(const char* string, Token* token) {
+  const char* end = string;
+  while (has_class(*end, CC_LETTER | CC_DIGIT)) end++;
+
+  token->type = TOKEN_IDENT;
+  token->data.ident_text = (StrSlice){string, (ptrdiff_t)(end - string)};
+  return end;
+}
+
+static bool starts_number(const char* string) {
+  return has_class(string[0], CC_DIGIT) or
+         (string[0] is '.' and string[1] is_not '.');
+}
+
+static const char* skip_digits(const char* string) {
+  while (has_class(*string, CC_DIGIT)) string++;
+  return string;
+}
+
+// Converts the text between start and end, which strtod fully accepts
+static double parse_number(const char* start, const char* end) {
+  char buffer[64];
+  int length = end - start;
+  if (length < (int)sizeof(buffer)) {
+    memcpy(buffer, start, length);
+    buffer[length] = '\0';
+    return strtod(buffer, null);
+  }
+
+  str_t copy = str_owned("%.*s", length, start);
+  double number = strtod(copy.string, null);
+  str_free(copy);
+  return number;
+}
+
+// [-] digits [. digits] [e [+-] digits], where `.` alone is 0
+static const char* scan_number(const char* string, Token* token) {
+  bool is_negative = string[0] is '-';
+  const char* start = is_negative ? skip_spaces(string + 1) : string;
+
+  const char* end = skip_digits(start);
+  bool has_digits = end > start;
+
+  // Dots after an integer are a range, as in 1..5
+  bool is_range = has_digits and end[0] is '.' and end[1] is '.';
+  if (not is_range and end[0] is '.') {
+    const char* fraction = end + 1;
+    end = skip_digits(fraction);
+    has_digits = has_digits or end > fraction;
+  }
+
+  if (has_digits and (end[0] is 'e' or end[0] is 'E')) {
+    const char* exponent = end + 1;
+    if (exponent[0] is '+' or exponent[0] is '-') exponent++;
+    if (has_class(exponent[0], CC_DIGIT)) end = skip_digits(exponent);
+  }
+
+  double number = has_digits ? parse_number(start, end) : 0.0;
+  token->type = TOKEN_NUMBER;
+  token->data.number_number = is_negative ? -number : number;
+  return end;
+}
+
+// =====
+// =
+// = tk_next_token
+// =
+// =====
 struct TokenResult tk_next_token(const char* string) {
-  // ==== 1. Skip spaces
   string = skip_spaces(string);
 
   struct TokenResult result = {
@@ -47,51 +211,78 @@ struct TokenResult tk_next_token(const char* string) {
       .token = (Token){.type = TOKEN_NUMBER,
                        .start_pos = string,
                        .data.number_number = 0.0},
-      .next_token_pos = &string[1],  // Next symbol by default
+      .next_token_pos = null,
   };
-  if (not string or string[0] is '\0') {
-    result.next_token_pos = null;
-    return result;
-  }
-
-  if (string[0] is ',') return scan_comma(string, result);
-
-  if (is_bracket(string[0])) return scan_bracket(string, result);
+  if (string[0] is '\0') return result;
 
-  // ==== 4. Check if it is negative number
-  bool is_number = false;
-  char next_char = next_char_skip_spaces(&string[1]);
-  if (string[0] is '-' and (is_digit(next_char) or next_char is '.'))
-    is_number = true;
+  result.next_token_pos = scan_token(string, &result.token);
+  if (not result.next_token_pos) panic("Unsupported symbols in tokenizer");
 
-  // ==== 5. Scan for operators
-  if (not is_number and check_operator(string, &result)) return result;
+  result.has_token = true;
+  return result;
+}
 
-  if (is_letter(string[0])) {
-    // ==== 6. Check for ident
-    return scan_ident(string, result);
-  } else if (is_number or is_digit(string[0]) or string[0] is '.') {
-    // ==== 7. Check for number
-    return scan_number(string, result);
-  } else {
-    panic("Unsupported symbols in tokenizer");
+// =====
+// =
+// = tk_tokenize
+// =
+// =====
+// Each forbidden symbol once, from the first one on
+static str_t forbidden_symbols_text(const char* first) {
+  bool is_seen[256] = {false};
+  char symbols[256];
+  int count = 0;
+
+  for (const char* pos = first; *pos; pos++) {
+    unsigned char c = *pos;
+    if (has_class(c, CC_ALLOWED) or is_seen[c]) continue;
+    is_seen[c] = true;
+    symbols[count++] = c > ASCII_MAX ? '?' : c;
   }
 
-  return result;
+  return str_owned("Forbidden symbols: %.*s", count, symbols);
 }
 
-static TokenResult scan_comma(const char* string, TokenResult result) {
-  unused(string);
-  result.has_token = true;
-  result.token.type = TOKEN_COMMA;
-  return result;
-}
+TokenizeResult tk_tokenize(const char* text, vec_Token* tokens,
+                           bool check_symbols) {
+  tokens->length = 0;
+  const char* first_forbidden = null;
+  const char* first_unexpected = null;
+
+  for (const char* pos = skip_spaces(text); *pos; pos = skip_spaces(pos)) {
+    if (check_symbols and not has_class(*pos, CC_ALLOWED)) {
+      if (not first_forbidden) first_forbidden = pos;
+      pos++;
+      continue;
+    }
 
-static TokenResult scan_bracket(const char* string, TokenResult result) {
-  result.has_token = true;
-  result.token.type = TOKEN_BRACKET;
-  result.token.data.bracket_symbol = string[0];
-  return result;
+    Token token;
+    const char* end = scan_token(pos, &token);
+    if (not end) {
+      if (not first_unexpected) first_unexpected = pos;
+      end = pos + 1;
+    } else {
+      vec_Token_push(tokens, token);
+    }
+    pos = end;
+  }
+
+  if (first_forbidden)
+    return (TokenizeResult){
+        .is_ok = false,
+        .err_text = forbidden_symbols_text(first_forbidden),
+        .err_pos = first_forbidden,
+    };
+  if (first_unexpected) {
+    unsigned char c = *first_unexpected;
+    return (TokenizeResult){
+        .is_ok = false,
+        .err_text = str_owned("Unexpected symbol %c", c > ASCII_MAX ? '?' : c),
+        .err_pos = first_unexpected,
+    };
+  }
+
+  return (TokenizeResult){.is_ok = true};
 }
 
 // =====
@@ -99,11 +290,7 @@ static TokenResult scan_bracket(const char* string, TokenResult result) {
 // = tk_is_symbol_allowed
 // =
 // =====
-bool tk_is_symbol_allowed(char c) {
-  const char* allowed = " .,!=<>+-*/^%";
-
-  return is_letter(c) or is_digit(c) or is_bracket(c) or strchr(allowed, c);
-}
+bool tk_is_symbol_allowed(char c) { return has_class(c, CC_ALLOWED); }
 
 // =====
 // =
@@ -154,132 +341,3 @@ const char* token_type_text(int token_type) {
       panic("Unknown token type %d", token_type);
   }
 }
-
-// =====
-// ALL THE STATIC GARBAGE
-static const char* skip_spaces(const char* string) {
-  while (string[0] == ' ') string++;
-  return string;
-}
-
-static bool check_operator(const char* string, struct TokenResult* result) {
-  const char* const operators[] = {
-      "mod",                                      // mod
-      "..=", "..",                                // Range
-      ":=",  "+=", "-=", "*=", "/=", "%=", "^=",  // Procedures
-      "==",  "!=", "<=", ">=", "<",  ">",         // Comparsions
-      "=",   "+",  "-",  "*",  "/",  "%",  "^",   // Operators
-  };
-  const int operators_len = LEN(operators);
-
-  bool is_operator = false;
-  for (int i = 0; i < operators_len and not is_operator; i++) {
-    const char* op = operators[i];
-    int op_len = strlen(op);
-
-    if (strncmp(op, string, op_len) is 0) {
-      (*result).has_token = true;
-      (*result).token.type = TOKEN_OPERATOR;
-      (*result).token.data.operator_text = (StrSlice){string, op_len};
-      (*result).next_token_pos = string + op_len;
-      is_operator = true;
-    }
-  }
-
-  return is_operator;
-}
-
-static struct TokenResult scan_ident(const char* string,
-                                     struct TokenResult result) {
-  const char* end = string;
-  while (is_letter(*end) or is_digit(*end)) end++;
-
-  result.has_token = true;
-  result.next_token_pos = end;
-  result.token.type = TOKEN_IDENT;
-  result.token.data.ident_text = (StrSlice){string, (ptrdiff_t)(end - string)};
-  return result;
-}
-
-static double read_num_non_scientific(const char* string, int* offset) {
-  int len = 0;
-  while (string[len] != '\0' and (is_digit(string[len]) or string[len] is '.'))
-    len++;
-
-  if (len is 1 and string[0] is '.') {
-    (*offset) = 1;
-    return 0.0;
-  }
-
-  str_t part = str_owned("%.*s", len, string);
-  double number = 42.0;
-  int success = sscanf(part.string, "%lf", &number);
-  (*offset) = len;
-
-  str_free(part);
-
-  assert_m(success and (*offset) > 0);
-  return number;
-}
-
-static bool has_double_dot_after_digits(const char* string) {
-  int len = strlen(string);
-  for (int i = 0; i < len - 2 and is_digit(string[i]); i++)
-    if (string[i + 1] == '.' and string[i + 2] == '.') return true;
-
-  return false;
-}
-
-static struct TokenResult scan_number(const char* string,
-                                      struct TokenResult result) {
-  bool is_negative = false;
-
-  if (string[0] is '-') {
-    string++;  // Skip '-' symbol
-    is_negative = true;
-  }
-
-  string = skip_spaces(string);
-  bool has_double_dot = has_double_dot_after_digits(string);
-
-  int offset = 0, success = 1;
-  double number = 42.0;
-
-  if (not has_double_dot) {
-    success = sscanf(string, "%lf%n", &number, &offset);
-
-    if (not success or offset is 0) {
-      number = read_num_non_scientific(string, &offset);
-      success = 1;
-    }
-  } else {
-    // Scan as integer, since dots are for .. or ..= operators
-    long long number_l = 0;
-    success = sscanf(string, "%lld%n", &number_l, &offset);
-    number = number_l;
-  }
-
-  if (not success or offset is 0)
-    panic("Failed to parse number at: %s (this SHOULD NOT HAPPEN)\n", string);
-
-  result.has_token = true;
-  result.token.data.number_number = number * (is_negative ? -1.0 : 1.0);
-  result.next_token_pos = string + offset;
-  result.token.type = TOKEN_NUMBER;
-
-  return result;
-}
-
-static bool is_letter(char c) {
-  return (c >= 'a' and c <= 'z') or (c >= 'A' and c <= 'Z') or c == '_';
-}
-static bool is_digit(char c) { return c >= '0' and c <= '9'; }
-
-static bool is_bracket(char c) {
-  return c is '(' or c is ')' or c is '[' or c is ']' or c is '{' or c is '}';
-}
-
-static char next_char_skip_spaces(const char* text) {
-  while (text[0] is ' ') text++;
-  return text[0];
-}
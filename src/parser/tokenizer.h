@@ -41,6 +41,19 @@ typedef struct TokenResult {
 struct TokenResult tk_next_token(const char* string);
 bool tk_is_symbol_allowed(char c);
 
+typedef struct TokenizeResult {
+  bool is_ok;
+  str_t err_text;
+  const char* err_pos;
+} TokenizeResult;
+
+// All tokens of the text in one pass. `tokens` is cleared first, so one vector
+// can be reused between calls. With `check_symbols`, symbols that are not
+// tk_is_symbol_allowed are an error listing each of them once. Symbols that
+// start no token are an error either way
+TokenizeResult tk_tokenize(const char* text, vec_Token* tokens,
+                           bool check_symbols);
+
 void token_print(const Token* this, OutStream stream);
 const char* token_type_text(int token_type);
 
@@ -14,6 +14,17 @@ Suite *expr_value_suite(void);
 Suite *backend_calcs_suite(void);
 Suite *credit_deposit_suite(void);
 Suite *func_const_ctx_suite(void);
+Suite *expr_program_suite(void);
+Suite *calc_worksheet_suite(void);
+Suite *simd_math_suite(void);
+Suite *allocator_suite(void);
+Suite *expr_optimize_suite(void);
+Suite *expr_parse_suite(void);
+Suite *calc_parse_cache_suite(void);
+Suite *expr_inline_suite(void);
+Suite *calc_memo_suite(void);
+Suite *shader_cache_suite(void);
+Suite *glsl_compiler_suite(void);
 
 typedef Suite *(*SuiteFn)();
 Suite *expr_suite(void);
@@ -23,7 +34,12 @@ int main(void) {
   const SuiteFn suites[] = {tokenizer_suite,     token_tree_suite,
                             calc_backend_suite,  expr_value_suite,
                             backend_calcs_suite, credit_deposit_suite,
-                            func_const_ctx_suite};
+                            func_const_ctx_suite, expr_program_suite,
+                            calc_worksheet_suite, simd_math_suite,
+                            allocator_suite,     expr_optimize_suite,
+                            expr_parse_suite,    calc_parse_cache_suite,
+                            expr_inline_suite,   calc_memo_suite,
+                            shader_cache_suite,  glsl_compiler_suite};
   int suites_len = sizeof(suites) / sizeof(suites[0]);
 
   SRunner *sr = srunner_create(NULL);
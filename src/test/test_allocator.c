@@ -0,0 +1,232 @@
+#include <assert.h>
+#include <check.h>
+#include <string.h>
+
+#include "../calculator/calc_backend.h"
+#include "../calculator/expr_inline.h"
+#include "../calculator/expr_program.h"
+#include "../util/allocator.h"
+#include "../util/prettify_c.h"
+
+START_TEST(test_arena_scope) {
+  MyArena arena = MY_ARENA_INIT;
+  char* heap = (char*)MALLOC(16);
+
+  my_arena_begin(&arena);
+  char* a = (char*)MALLOC(10);
+  strcpy(a, "arena");
+  ck_assert(my_arena_owns(&arena, a));
+  ck_assert(not my_arena_owns(&arena, heap));
+
+  // Growing keeps the contents, heap memory stays in the heap
+  a = (char*)REALLOC(a, 100000);
+  ck_assert(my_arena_owns(&arena, a));
+  ck_assert_str_eq(a, "arena");
+  heap = (char*)REALLOC(heap, 32);
+  ck_assert(not my_arena_owns(&arena, heap));
+
+  my_arena_pause();
+  char* paused = (char*)MALLOC(8);
+  my_arena_resume();
+  ck_assert(not my_arena_owns(&arena, paused));
+
+  FREE(a);
+  my_arena_end(&arena);
+
+  // Still in use by the outer scope
+  my_arena_begin(&arena);
+  my_arena_begin(&arena);
+  my_arena_end(&arena);
+  my_arena_reset(&arena);
+  ck_assert_int_gt(arena.allocations, 0);
+  my_arena_end(&arena);
+
+  my_arena_reset(&arena);
+  ck_assert_int_eq(arena.allocations, 0);
+
+  FREE(paused);
+  FREE(heap);
+  my_arena_free(&arena);
+}
+END_TEST
+
+START_TEST(test_arena_eval_heap_allocations) {
+  CalcBackend backend = calc_backend_create();
+  str_free(calc_backend_add_expr(&backend, "a = 3"));
+  str_free(calc_backend_add_expr(&backend, "f(t) = [t, t * a][1] + min(t, a)"));
+  ExprContext ctx = calc_backend_get_context(&backend);
+
+  ExprResult expr = expr_parse_string("f(x) + sin(y)", ctx);
+  ck_assert(expr.is_ok);
+  vec_str_t slot_names = vec_str_t_create();
+  vec_str_t_push(&slot_names, str_literal("x"));
+  vec_str_t_push(&slot_names, str_literal("y"));
+  ExprProgram program = expr_compile(&expr.ok, &backend, &slot_names);
+  vec_str_t_free(slot_names);
+  ck_assert(not program.is_numeric);
+
+  enum { COUNT = 500 };
+  static double xs[COUNT], ys[COUNT], out[COUNT];
+  for (int i = 0; i < COUNT; i++) {
+    xs[i] = i * 0.1;
+    ys[i] = i * 0.2;
+  }
+  const double* slots[] = {xs, ys};
+
+  // The first run fills caches of the backend
+  expr_eval_batch(&program, slots, COUNT, out);
+  size_t before = my_allocator_heap_allocations();
+  ck_assert_int_eq(expr_eval_batch(&program, slots, COUNT, out), 0);
+  size_t heap_allocations = my_allocator_heap_allocations() - before;
+
+  // Nothing per point
+  ck_assert_int_lt(heap_allocations, 8);
+
+  ExprValue point[] = {{.type = EXPR_VALUE_NUMBER, .number = xs[10]},
+                       {.type = EXPR_VALUE_NUMBER, .number = ys[10]}};
+  ExprValueResult res = expr_program_run(&program, point);
+  ck_assert(res.is_ok);
+  ck_assert_double_eq_tol(out[10], res.ok.number, 1e-9);
+  expr_value_free(res.ok);
+
+  expr_program_free(program);
+  expr_free(expr.ok);
+  calc_backend_free(backend);
+}
+END_TEST
+
+START_TEST(test_scalar_calls_heap_allocations) {
+  CalcBackend backend = calc_backend_create();
+  // Too big to be inlined, so the calls stay calls
+  StringStream f1 = string_stream_create();
+  x_sprintf(string_stream_stream(&f1), "f1(t) = t * 2 + 1");
+  for (int i = 0; i < EXPR_INLINE_MAX_NODES / 4; i++)
+    x_sprintf(string_stream_stream(&f1), " + t * %d", i);
+  str_t f1_text = string_stream_to_str_t(f1);
+  str_free(calc_backend_add_expr(&backend, f1_text.string));
+  str_free(f1_text);
+  str_free(calc_backend_add_expr(&backend, "f2(t) = f1(t) - f1(t / 2)"));
+  str_free(calc_backend_add_expr(&backend, "f3(t, u) = f2(t) * f2(u)"));
+  ExprContext ctx = calc_backend_get_context(&backend);
+
+  ExprResult expr = expr_parse_string("f3(x, f2(x))", ctx);
+  ck_assert(expr.is_ok);
+  vec_str_t slot_names = vec_str_t_create();
+  vec_str_t_push(&slot_names, str_literal("x"));
+  ExprProgram program = expr_compile(&expr.ok, &backend, &slot_names);
+  vec_str_t_free(slot_names);
+
+  ExprValue point = {.type = EXPR_VALUE_NUMBER, .number = 0.5};
+  size_t before = my_allocator_heap_allocations();
+  for (int i = 0; i < 100; i++) {
+    ExprValueResult res = expr_program_run(&program, &point);
+    ck_assert(res.is_ok);
+  }
+  // Only the two arguments of f3 are a vector
+  ck_assert_int_le(my_allocator_heap_allocations() - before, 200);
+
+  expr_free(expr.ok);
+  expr = expr_parse_string("f2(f1(x))", ctx);
+  ck_assert(expr.is_ok);
+  expr_program_free(program);
+  slot_names = vec_str_t_create();
+  vec_str_t_push(&slot_names, str_literal("x"));
+  program = expr_compile(&expr.ok, &backend, &slot_names);
+  vec_str_t_free(slot_names);
+
+  before = my_allocator_heap_allocations();
+  for (int i = 0; i < 100; i++) {
+    ExprValueResult res = expr_program_run(&program, &point);
+    ck_assert(res.is_ok);
+  }
+  // Calls with a number do not allocate at all
+  ck_assert_int_eq(my_allocator_heap_allocations() - before, 0);
+
+  expr_program_free(program);
+  expr_free(expr.ok);
+  calc_backend_free(backend);
+}
+END_TEST
+
+#ifdef ALLOCATOR_TRACKING
+START_TEST(test_tracking_counters) {
+  my_allocator_begin_interval();
+  MyAllocatorStats before = my_allocator_stats();
+
+  enum { COUNT = 1000 };
+  static void* regions[COUNT];
+  for (int i = 0; i < COUNT; i++) regions[i] = MALLOC(i % 7 is 0 ? 4096 : 24);
+  int line = __LINE__ - 1;
+
+  MyAllocatorStats stats = my_allocator_stats();
+  ck_assert_int_eq(stats.allocations, COUNT);
+  ck_assert_int_ge(stats.peak_bytes, before.live_bytes + 143 * 4096);
+  ck_assert_int_eq(stats.histogram[5], COUNT - 143);  // 24 bytes
+  ck_assert_int_eq(stats.histogram[12], 143);         // 4096 bytes
+
+  MyAllocSite top[4];
+  ck_assert_int_ge(my_allocator_top_sites(top, LEN(top)), 1);
+  ck_assert_int_eq(top[0].line, line);
+  ck_assert_int_eq(top[0].allocations, COUNT);
+
+  // Frees in a different order than allocations
+  for (int i = 0; i < COUNT; i += 2) FREE(regions[i]);
+  for (int i = 1; i < COUNT; i += 2) FREE(regions[i]);
+
+  stats = my_allocator_stats();
+  ck_assert_int_eq(stats.frees, COUNT);
+  ck_assert_int_eq(stats.unknown_frees, 0);
+  ck_assert_int_eq(stats.live_bytes, before.live_bytes);
+  my_allocator_top_sites(top, LEN(top));
+  ck_assert_int_eq(top[0].frees, COUNT);
+
+  // Arena allocations are counted but never live in the heap
+  MyArena arena = MY_ARENA_INIT;
+  my_arena_begin(&arena);
+  MALLOC(100);
+  my_arena_end(&arena);
+  my_arena_free(&arena);
+  ck_assert_int_eq(my_allocator_stats().arena_allocations, 1);
+  ck_assert_int_eq(my_allocator_stats().live_bytes, before.live_bytes);
+}
+END_TEST
+
+START_TEST(test_tracking_many_sites) {
+  my_allocator_begin_interval();
+
+  // An early site, with more allocations than any of the later ones
+  enum { EARLY = 3, SITES = 1000 };
+  void* early[EARLY];
+  for (int i = 0; i < EARLY; i++)
+    early[i] = my_malloc_at(16, __FILE__, 1, "early_site");
+
+  // Enough sites to grow the table a few times
+  for (int i = 0; i < SITES; i++)
+    FREE(my_malloc_at(16, __FILE__, 1000 + i, "many_sites"));
+  for (int i = 0; i < EARLY; i++) FREE(early[i]);
+
+  MyAllocSite top[2];
+  ck_assert_int_eq(my_allocator_top_sites(top, LEN(top)), 2);
+  ck_assert_str_eq(top[0].func, "early_site");
+  ck_assert_int_eq(top[0].allocations, EARLY);
+  ck_assert_int_eq(top[0].frees, EARLY);
+  ck_assert_int_eq(top[1].frees, 1);
+}
+END_TEST
+#endif
+
+Suite *allocator_suite(void) {
+  TCase *tc_core = tcase_create("Core");
+  tcase_add_test(tc_core, test_arena_scope);
+  tcase_add_test(tc_core, test_arena_eval_heap_allocations);
+  tcase_add_test(tc_core, test_scalar_calls_heap_allocations);
+#ifdef ALLOCATOR_TRACKING
+  tcase_add_test(tc_core, test_tracking_counters);
+  tcase_add_test(tc_core, test_tracking_many_sites);
+#endif
+
+  Suite *s = suite_create("Allocator suite");
+  suite_add_tcase(s, tc_core);
+
+  return s;
+}
@@ -207,6 +207,245 @@ START_TEST(test_calculate_funcs3) {
   expr_value_free(res.ok);
 }
 END_TEST
+START_TEST(test_cbc_many_symbols) {
+  CalcBackend backend = calc_backend_create();
+
+  for (int i = 0; i < 100; i++) {
+    str_t text = str_owned("v%d = %d", i, i);
+    add_assert_expr(&backend, text.string);
+    str_free(text);
+  }
+  for (int i = 0; i < 20; i++) {
+    str_t text = str_owned("f%d(x) = x + v%d", i, i);
+    add_assert_expr(&backend, text.string);
+    str_free(text);
+  }
+  add_assert_expr(&backend, "g(v1) = v1 * 2");
+
+  ck_assert(calc_backend_get_variable(&backend, "v57"));
+  ck_assert(not calc_backend_get_function(&backend, "v57"));
+  ck_assert(calc_backend_get_function(&backend, "f13"));
+  ck_assert(not calc_backend_get_variable(&backend, "f13"));
+  ck_assert(not calc_backend_get_variable(&backend, "v100"));
+
+  CalcBackend clone = calc_backend_clone(&backend);
+  const char *const texts[] = {"v57 + f13(1)", "g(3)"};
+  const double values[] = {57.0 + 1.0 + 13.0, 6.0};
+
+  for (int i = 0; i < (int)LEN(texts); i++) {
+    CalcBackend *backends[] = {&backend, &clone};
+    for (int j = 0; j < (int)LEN(backends); j++) {
+      ExprContext ctx = calc_backend_get_context(backends[j]);
+      ExprResult expr = expr_parse_string(texts[i], ctx);
+      ck_assert(expr.is_ok);
+
+      ExprValueResult value = expr_calculate(&expr.ok, ctx);
+      ck_assert(value.is_ok);
+      ck_assert_int_eq(value.ok.type, EXPR_VALUE_NUMBER);
+      ck_assert_double_eq_tol(value.ok.number, values[i], EPS);
+
+      expr_free(expr.ok);
+    }
+  }
+
+  calc_backend_free(clone);
+  calc_backend_free(backend);
+}
+END_TEST
+
+START_TEST(test_cbc_const_cache) {
+  CalcBackend backend = calc_backend_create();
+  ExprContext ctx = calc_backend_get_context(&backend);
+
+  // Each definition uses the previous one twice - a full walk is 2^N
+  add_assert_expr(&backend, "v0 = 1");
+  for (int i = 1; i <= 16; i++) {
+    str_t text = str_owned("v%d = v%d - v%d", i, i - 1, i - 1);
+    add_assert_expr(&backend, text.string);
+    str_free(text);
+  }
+  ck_assert(calc_backend_is_var_const(&backend, "v16"));
+
+  // Defined later - dependents must be analyzed again
+  add_assert_expr(&backend, "b = a + 1");
+  ck_assert(not calc_backend_is_var_const(&backend, "b"));
+  add_assert_expr(&backend, "a = 2");
+  ck_assert(calc_backend_is_var_const(&backend, "b"));
+
+  Expr b_ref = {.type = EXPR_VARIABLE,
+                .variable.name = expr_symbol_intern_string("b")};
+  ck_assert_int_eq(calc_backend_get_expr_type(&backend, &b_ref),
+                   EXPR_VALUE_NUMBER);
+  ExprValueResult value = ctx.vtable->get_variable_val(ctx.data, Slice("b"));
+  ck_assert(value.is_ok);
+  ck_assert_double_eq_tol(value.ok.number, 3.0, EPS);
+  expr_value_free(value.ok);
+
+  // Cycles are not const, and do not hang
+  add_assert_expr(&backend, "c = d + 1");
+  add_assert_expr(&backend, "d = c * 2");
+  add_assert_expr(&backend, "r(x) = r(x - 1)");
+  ck_assert(not calc_backend_is_var_const(&backend, "c"));
+  ck_assert(not calc_backend_is_var_const(&backend, "d"));
+  ck_assert(not calc_backend_is_func_const(&backend, "r"));
+
+  value = ctx.vtable->get_variable_val(ctx.data, Slice("c"));
+  ck_assert(not value.is_ok);
+  str_free(value.err_text);
+
+  calc_backend_free(backend);
+}
+END_TEST
+
+START_TEST(test_cbc_value_cache) {
+  CalcBackend backend = calc_backend_create();
+  ExprContext ctx = calc_backend_get_context(&backend);
+
+  // Each level reads the previous one twice - without caching it is 2^60
+  add_assert_expr(&backend, "v0 = 3");
+  for (int i = 1; i <= 60; i++) {
+    str_t text = str_owned("v%d = (v%d + v%d) / 2", i, i - 1, i - 1);
+    add_assert_expr(&backend, text.string);
+    str_free(text);
+  }
+  ExprValueResult value = ctx.vtable->get_variable_val(ctx.data, Slice("v60"));
+  ck_assert(value.is_ok);
+  ck_assert_double_eq_tol(value.ok.number, 3.0, EPS);
+  expr_value_free(value.ok);
+
+  // Cached value has to follow later definitions
+  add_assert_expr(&backend, "p = q * 2");
+  add_assert_expr(&backend, "q = 3");
+  value = ctx.vtable->get_variable_val(ctx.data, Slice("p"));
+  ck_assert(value.is_ok);
+  ck_assert_double_eq_tol(value.ok.number, 6.0, EPS);
+  expr_value_free(value.ok);
+
+  ExprVariableInfo info =
+      ctx.vtable->get_variable_info(ctx.data, Slice("p"));
+  ck_assert(info.is_const);
+  ck_assert(info.value);
+  ck_assert_int_eq(info.value_type, EXPR_VALUE_NUMBER);
+  ck_assert_double_eq_tol(info.value->number, 6.0, EPS);
+
+  calc_backend_free(backend);
+}
+END_TEST
+
+// Vector copies of one evaluation, after the caches are filled
+static size_t copies_of(CalcBackend *backend, const char *text,
+                        double expected) {
+  ExprContext ctx = calc_backend_get_context(backend);
+  ExprResult expr = expr_parse_string(text, ctx);
+  ck_assert(expr.is_ok);
+
+  ExprValueResult res = expr_calculate(&expr.ok, ctx);
+  ck_assert(res.is_ok);
+  expr_value_free(res.ok);
+
+  size_t before = expr_value_vec_copies();
+  res = expr_calculate(&expr.ok, ctx);
+  size_t copies = expr_value_vec_copies() - before;
+
+  ck_assert(res.is_ok);
+  ck_assert_int_eq(res.ok.type, EXPR_VALUE_NUMBER);
+  ck_assert_double_eq_tol(res.ok.number, expected, EPS);
+  expr_value_free(res.ok);
+  expr_free(expr.ok);
+  return copies;
+}
+
+START_TEST(test_cbc_clone_count) {
+  CalcBackend backend = calc_backend_create();
+  add_assert_expr(&backend, "v = 0..100");
+  add_assert_expr(&backend, "f(t, k) = t[k] + t[k + 1] * t[k + 2] + max(t)");
+
+  // Stored values are borrowed by operators
+  ck_assert_int_eq(copies_of(&backend, "v[5] + v[7]", 12.0), 0);
+  ck_assert_int_eq(copies_of(&backend, "(v * 2 == v + v)", 1.0), 0);
+
+  // Arguments share the storage of `v`
+  ck_assert_int_eq(copies_of(&backend, "f(v, 0)", 101.0), 0);
+
+  calc_backend_free(backend);
+}
+END_TEST
+
+START_TEST(test_cbc_lazy_ranges) {
+  CalcBackend backend = calc_backend_create();
+  ExprContext ctx = calc_backend_get_context(&backend);
+  add_assert_expr(&backend, "v = 0..5000000");
+  add_assert_expr(&backend, "g(a, b) = a * 10 + b");
+
+  const ExprValue *v = ctx.vtable->get_variable_ref(ctx.data, Slice("v"));
+  ck_assert_ptr_nonnull(v);
+  ck_assert_int_eq(v->vec.kind, EXPR_VEC_RANGE);
+  ck_assert_int_eq(v->vec.length, 5000000);
+
+  ck_assert_int_eq(copies_of(&backend, "v[4999999]", 4999999.0), 0);
+  ck_assert_int_eq(copies_of(&backend, "max(v) - min(3..=7)", 4999996.0), 0);
+  ck_assert_int_eq(copies_of(&backend, "slice(v, 10..20)[3]", 13.0), 0);
+  ck_assert_int_eq(copies_of(&backend, "join(v, 5000000..5000002)[5000001]",
+                             5000001.0),
+                   0);
+  ck_assert_int_eq(copies_of(&backend, "(v * 2)[1000000] + (1 - v)[3]",
+                             1999998.0),
+                   0);
+  ck_assert_int_eq(copies_of(&backend, "(v == 0..5000000)", 1.0), 0);
+
+  // Stored and lazy vectors mix
+  ck_assert_int_eq(copies_of(&backend, "join([7, 8], 0..3)[3]", 1.0), 0);
+  ck_assert_int_eq(copies_of(&backend, "(0..3 + [1, 1, 1])[2]", 3.0), 0);
+  ck_assert_int_eq(copies_of(&backend, "slice([5, 6, 7, 8], 1..3)[1]", 7.0),
+                   0);
+
+  // User functions get a range spread into arguments
+  ck_assert_int_eq(copies_of(&backend, "g(3..5)", 34.0), 0);
+
+  calc_backend_free(backend);
+}
+END_TEST
+
+// Not stored, so an error rather than gigabytes of numbers
+static void assert_too_long(CalcBackend *backend, const char *text) {
+  ExprContext ctx = calc_backend_get_context(backend);
+  ExprResult expr = expr_parse_string(text, ctx);
+  ck_assert(expr.is_ok);
+
+  ExprValueResult res = expr_calculate(&expr.ok, ctx);
+  ck_assert_msg(not res.is_ok, "%s", text);
+  ck_assert_msg(strstr(res.err_text.string, "too long"), "%s: %s", text,
+                res.err_text.string);
+  str_free(res.err_text);
+  expr_free(expr.ok);
+}
+
+START_TEST(test_cbc_huge_ranges) {
+  CalcBackend backend = calc_backend_create();
+  add_assert_expr(&backend, "f(t) = t");
+  add_assert_expr(&backend, "h = 0..2000000000");
+
+  assert_too_long(&backend, "(0..2000000000) * 2");
+  assert_too_long(&backend, "1 - h");
+  assert_too_long(&backend, "f(0..2000000000)");
+  assert_too_long(&backend, "h < h");
+  assert_too_long(&backend, "sin(h)");
+  assert_too_long(&backend, "join(h, 1)");
+  assert_too_long(&backend, "join(h, h)");
+  assert_too_long(&backend, "slice(0..10, h)");
+
+  // Lazy all the way
+  ck_assert_int_eq(copies_of(&backend, "h[1999999999] - max(h)", 0.0), 0);
+  ck_assert_int_eq(copies_of(&backend, "slice(h, 5..7)[1] + min(h)", 6.0), 0);
+  ck_assert_int_eq(
+      copies_of(&backend, "join(h, 2000000000..2000000002)[2000000001]",
+                2000000001.0),
+      0);
+
+  calc_backend_free(backend);
+}
+END_TEST
+
 // Get expr type
 // Get variable info
 //
@@ -227,6 +466,12 @@ Suite *backend_calcs_suite(void) {
   tcase_add_test(tc_core, test_calculate_funcs);
   tcase_add_test(tc_core, test_calculate_funcs2);
   tcase_add_test(tc_core, test_calculate_funcs3);
+  tcase_add_test(tc_core, test_cbc_many_symbols);
+  tcase_add_test(tc_core, test_cbc_const_cache);
+  tcase_add_test(tc_core, test_cbc_value_cache);
+  tcase_add_test(tc_core, test_cbc_clone_count);
+  tcase_add_test(tc_core, test_cbc_lazy_ranges);
+  tcase_add_test(tc_core, test_cbc_huge_ranges);
 
   Suite *s = suite_create("CalcBackend calculations suite");
   suite_add_tcase(s, tc_core);
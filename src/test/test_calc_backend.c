@@ -4,6 +4,7 @@
 #include <math.h>
 
 #include "../calculator/calc_backend.h"
+#include "../calculator/native_functions.h"
 #include "../parser/expr.h"
 #include "../util/prettify_c.h"
 
@@ -54,6 +55,76 @@ START_TEST(test_cb_expr_parse_2) {
 }
 END_TEST
 
+START_TEST(test_cb_expr_symbols) {
+  CalcBackend backend = calc_backend_create();
+  ExprContext ctx = calc_backend_get_context(&backend);
+
+  ExprResult res = expr_parse_string("sin(x) + x[1] mod 2", ctx);
+  ck_assert(res.is_ok);
+  Expr expr = res.ok;
+  ck_assert_int_eq(expr.type, EXPR_BINARY_OP);
+  ck_assert_int_eq(expr.binary_operator.op, EXPR_OP_ADD);
+
+  const Expr *sin_x = expr.binary_operator.lhs;
+  const Expr *mod = expr.binary_operator.rhs;
+  const Expr *index = mod->binary_operator.lhs;
+  ck_assert_int_eq(mod->binary_operator.op, EXPR_OP_MOD_WORD);
+  ck_assert_int_eq(index->binary_operator.op, EXPR_OP_INDEX);
+
+  // Same names are same symbols, clones keep them
+  ExprSymbol x = expr_symbol_intern_string("x");
+  ck_assert_int_eq(sin_x->function.argument->variable.name, x);
+  ck_assert_int_eq(index->binary_operator.lhs->variable.name, x);
+  ck_assert_str_eq(expr_symbol_text(sin_x->function.name), "sin");
+  Expr clone = expr_clone(&expr);
+  ck_assert_int_eq(clone.binary_operator.lhs->function.name,
+                   sin_x->function.name);
+  ck_assert(expr_equal(&clone, &expr));
+  expr_free(clone);
+
+  ck_assert_int_eq(expr_operator_from_slice(str_slice_from_string("..=")),
+                   EXPR_OP_RANGE_INCLUDED);
+  ck_assert_int_eq(expr_operator_from_slice(str_slice_from_string("+-")),
+                   EXPR_OP_NONE);
+  ck_assert_str_eq(expr_operator_name(EXPR_OP_POW_ASSIGN), "^=");
+
+  expr_free(expr);
+  calc_backend_free(backend);
+}
+END_TEST
+
+START_TEST(test_cb_registry_lookups) {
+  // Stale generated tables would send names to other entries
+  const char *const operators[] = EXPR_OPERATORS_NAMES;
+  for (int i = 0; i < EXPR_OPERATORS_COUNT; i++) {
+    StrSlice name = str_slice_from_string(operators[i]);
+    ck_assert_int_eq(expr_operator_from_slice(name), i);
+  }
+
+  const char *const natives[] = NATIVE_FUNCTION_NAMES;
+  for (int i = 0; i < (int)LEN(natives); i++) {
+    StrSlice name = str_slice_from_string(natives[i]);
+    ck_assert(calculator_get_native_function(name));
+  }
+
+  // Prefixes and extensions of the names miss
+  const char *const misses[] = {"", "m", "mo", "modd", ".", "[", "]]",
+                                "co", "coss", "sinh", "x", "lo", "maxx"};
+  for (int i = 0; i < (int)LEN(misses); i++) {
+    StrSlice name = str_slice_from_string(misses[i]);
+    ck_assert_int_eq(expr_operator_from_slice(name), EXPR_OP_NONE);
+    ck_assert(not calculator_get_native_function(name));
+  }
+
+  StrSlice sqrt_name = str_slice_from_string("sqrt");
+  StrSlice join_name = str_slice_from_string("join");
+  ck_assert(calculator_get_native_scalar_function(sqrt_name)(4.0) == 2.0);
+  ck_assert(calculator_get_native_batch_function(sqrt_name));
+  ck_assert(not calculator_get_native_scalar_function(join_name));
+  ck_assert(not calculator_get_native_batch_function(join_name));
+}
+END_TEST
+
 //
 //
 
@@ -186,6 +257,8 @@ Suite *calc_backend_suite(void) {
   tcase_add_test(tc_core, test_cb_expr_err_8);
 
   tcase_add_test(tc_core, test_cb_clone);
+  tcase_add_test(tc_core, test_cb_expr_symbols);
+  tcase_add_test(tc_core, test_cb_registry_lookups);
 
   Suite *s = suite_create("Calc Backend suite");
   suite_add_tcase(s, tc_core);
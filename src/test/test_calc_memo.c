@@ -0,0 +1,243 @@
+#include <assert.h>
+#include <check.h>
+#include <math.h>
+
+#include "../calculator/calc_backend.h"
+#include "../calculator/calc_memo.h"
+#include "../calculator/calc_worksheet.h"
+#include "../parser/expr.h"
+#include "../util/prettify_c.h"
+
+#define EPS 0.000001
+
+#define Number(value) \
+  (ExprValue) { .type = EXPR_VALUE_NUMBER, .number = (value) }
+
+static vec_ExprValue number_args(double a, double b) {
+  vec_ExprValue args = vec_ExprValue_create();
+  vec_ExprValue_push(&args, Number(a));
+  vec_ExprValue_push(&args, Number(b));
+  return args;
+}
+
+static void store_sum(CalcMemo *memo, double a, double b) {
+  vec_ExprValue args = number_args(a, b);
+  ExprValueResult sum = ExprValueOk(Number(a + b));
+  calc_memo_store(memo, &args, &sum);
+  vec_ExprValue_free(args);
+}
+
+static bool has_sum(CalcMemo *memo, double a, double b) {
+  vec_ExprValue args = number_args(a, b);
+  const ExprValueResult *known = calc_memo_find(memo, &args);
+  vec_ExprValue_free(args);
+  if (known) ck_assert_double_eq_tol(known->ok.number, a + b, EPS);
+  return known;
+}
+
+START_TEST(test_memo_lru) {
+  CalcMemo *memo = calc_memo_create(3);
+  store_sum(memo, 1, 2);
+  store_sum(memo, 3, 4);
+  store_sum(memo, 5, 6);
+
+  ck_assert(has_sum(memo, 1, 2));
+  ck_assert(not has_sum(memo, 2, 1));
+  // 3, 4 is the least recently used now
+  store_sum(memo, 7, 8);
+  ck_assert(not has_sum(memo, 3, 4));
+  ck_assert(has_sum(memo, 1, 2));
+  ck_assert(has_sum(memo, 5, 6));
+  ck_assert(has_sum(memo, 7, 8));
+
+  CalcMemoStats stats = calc_memo_stats(memo);
+  ck_assert_int_eq(stats.hits, 4);
+  ck_assert_int_eq(stats.misses, 2);
+  ck_assert_int_eq(stats.length, 3);
+
+  calc_memo_free(memo);
+}
+END_TEST
+
+START_TEST(test_memo_value_keys) {
+  // Same elements, different storage
+  double numbers[] = {1, 2, 3, 4};
+  ExprValue packed = {.type = EXPR_VALUE_VEC,
+                      .vec = expr_vec_from_numbers(numbers, 4)};
+  ExprValue range = {.type = EXPR_VALUE_VEC, .vec = expr_vec_range(1, 4)};
+  ck_assert(expr_value_equal(&packed, &range));
+  ck_assert_int_eq(expr_value_hash(&packed), expr_value_hash(&range));
+
+  ExprValue shorter = {.type = EXPR_VALUE_VEC, .vec = expr_vec_range(1, 3)};
+  ck_assert(not expr_value_equal(&packed, &shorter));
+  ExprValue nan = Number(NAN);
+  ck_assert(expr_value_equal(&nan, &nan));
+
+  CalcMemo *memo = calc_memo_create(4);
+  vec_ExprValue args = vec_ExprValue_create();
+  vec_ExprValue_push(&args, packed);
+  ExprValueResult error = ExprValueErr(null, str_literal("Oops"));
+  calc_memo_store(memo, &args, &error);
+  vec_ExprValue_free(args);
+
+  // Errors are results too, and the table has copies of its own
+  args = vec_ExprValue_create();
+  vec_ExprValue_push(&args, range);
+  const ExprValueResult *known = calc_memo_find(memo, &args);
+  ck_assert(known and not known->is_ok);
+  ck_assert_str_eq(known->err_text.string, "Oops");
+  vec_ExprValue_free(args);
+
+  expr_value_free(shorter);
+  calc_memo_free(memo);
+}
+END_TEST
+
+static double calculate(CalcBackend *backend, const char *text) {
+  ExprContext ctx = calc_backend_get_context(backend);
+  ExprResult expr = expr_parse_string(text, ctx);
+  ck_assert_msg(expr.is_ok, "%s", text);
+  ExprValueResult res = calc_backend_calculate(backend, &expr.ok);
+  ck_assert_msg(res.is_ok, "%s", text);
+  ck_assert_int_eq(res.ok.type, EXPR_VALUE_NUMBER);
+
+  double number = res.ok.number;
+  expr_value_free(res.ok);
+  expr_free(expr.ok);
+  return number;
+}
+
+static CalcMemoStats stats_of(CalcBackend *backend, const char *name) {
+  return calc_backend_memo_stats(backend, str_slice_from_string(name));
+}
+
+START_TEST(test_memo_backend_calls) {
+  CalcBackend backend = calc_backend_create();
+  calc_backend_set_memo_capacity(&backend, CALC_MEMO_DEFAULT_CAPACITY);
+  str_free(calc_backend_add_expr(&backend, "a = 2"));
+  str_free(calc_backend_add_expr(&backend, "w(t) = t * a + 1"));
+  str_free(calc_backend_add_expr(&backend, "v(t) = w(t) * 10"));
+
+  ck_assert_double_eq_tol(calculate(&backend, "w(3) + w(3) + w(1)"), 17, EPS);
+  CalcMemoStats stats = stats_of(&backend, "w");
+  ck_assert_int_eq(stats.hits, 1);
+  ck_assert_int_eq(stats.misses, 2);
+
+  // Inside v, w may see names of v's caller, so only v remembers
+  ck_assert_double_eq_tol(calculate(&backend, "v(3) + v(3)"), 140, EPS);
+  ck_assert_int_eq(stats_of(&backend, "v").hits, 1);
+  ck_assert_int_eq(stats_of(&backend, "w").hits, stats.hits);
+
+  calc_backend_free(backend);
+}
+END_TEST
+
+static void update(CalcWorksheet *sheet, const char *const *lines, int count) {
+  vec_str_t texts = vec_str_t_create();
+  for (int i = 0; i < count; i++) vec_str_t_push(&texts, str_literal(lines[i]));
+  calc_worksheet_update(sheet, &texts, null, null);
+  vec_str_t_free(texts);
+}
+
+START_TEST(test_memo_worksheet) {
+  CalcWorksheet sheet = calc_worksheet_create();
+  CalcBackend *backend = &sheet.backend;
+
+  const char *v1[] = {"a = 2", "w(t) = t * a + 1", "v(t) = w(t) * 10",
+                      "b = w(3) + w(3)", "c = v(3) + v(3)"};
+  update(&sheet, v1, LEN(v1));
+  ck_assert_str_eq(sheet.lines.data[3].descr.string, "14.00");
+  ck_assert_str_eq(sheet.lines.data[4].descr.string, "140.00");
+  ck_assert_int_ge(stats_of(backend, "w").hits, 1);
+  ck_assert_int_ge(stats_of(backend, "v").hits, 1);
+
+  // Lines that w and v do not use leave the tables alone
+  const char *v2[] = {"a = 2", "w(t) = t * a + 1", "v(t) = w(t) * 10",
+                      "b = w(3) + w(3)", "c = v(3) + v(3)", "d = w(3)"};
+  size_t hits = stats_of(backend, "w").hits;
+  update(&sheet, v2, LEN(v2));
+  ck_assert_int_eq(stats_of(backend, "w").hits, hits + 1);
+
+  // Both use a, so they forget
+  const char *v3[] = {"a = 3", "w(t) = t * a + 1", "v(t) = w(t) * 10",
+                      "b = w(3) + w(3)", "c = v(3) + v(3)", "d = w(3)"};
+  update(&sheet, v3, LEN(v3));
+  ck_assert_str_eq(sheet.lines.data[3].descr.string, "20.00");
+  ck_assert_str_eq(sheet.lines.data[4].descr.string, "200.00");
+  ck_assert_str_eq(sheet.lines.data[5].descr.string, "10.00");
+
+  calc_worksheet_free(sheet);
+}
+END_TEST
+
+START_TEST(test_memo_long_ranges) {
+  // Hashed by some of the elements, the same way for any storage
+  double numbers[1000];
+  for (int i = 0; i < 1000; i++) numbers[i] = 5 + i;
+  ExprValue packed = {.type = EXPR_VALUE_VEC,
+                      .vec = expr_vec_from_numbers(numbers, 1000)};
+  ExprValue range = {.type = EXPR_VALUE_VEC, .vec = expr_vec_range(5, 1000)};
+  ck_assert(expr_value_equal(&packed, &range));
+  ck_assert_int_eq(expr_value_hash(&packed), expr_value_hash(&range));
+  expr_value_free(packed);
+
+  // Ranges are not walked
+  CalcBackend backend = calc_backend_create();
+  calc_backend_set_memo_capacity(&backend, CALC_MEMO_DEFAULT_CAPACITY);
+  str_free(calc_backend_add_expr(&backend, "w(t, k) = t[k]"));
+
+  ck_assert_double_eq_tol(
+      calculate(&backend, "w(0..2000000000, 3) + w(0..2000000000, 3) + "
+                          "w(1..2000000000, 3)"),
+      10, EPS);
+  CalcMemoStats stats = stats_of(&backend, "w");
+  ck_assert_int_eq(stats.hits, 1);
+  ck_assert_int_eq(stats.misses, 2);
+
+  calc_backend_free(backend);
+}
+END_TEST
+
+START_TEST(test_memo_opt_in) {
+  CalcBackend backend = calc_backend_create();
+  str_free(calc_backend_add_expr(&backend, "w(t) = t * 2"));
+  str_free(calc_backend_add_expr(&backend, "n(t) = t * x"));
+
+  calculate(&backend, "w(3) + w(3)");
+  ck_assert_int_eq(stats_of(&backend, "w").misses, 0);
+
+  calc_backend_set_memo_capacity(&backend, 1);
+  calculate(&backend, "w(3) + w(3) + w(4) + w(3)");
+  CalcMemoStats stats = stats_of(&backend, "w");
+  ck_assert_int_eq(stats.hits, 1);
+  ck_assert_int_eq(stats.misses, 3);
+  ck_assert_int_eq(stats.length, 1);
+
+  // Not const, so never remembered
+  ExprContext ctx = calc_backend_get_context(&backend);
+  ExprResult expr = expr_parse_string("n(2) + n(2)", ctx);
+  ck_assert(expr.is_ok);
+  ExprValueResult res = calc_backend_calculate(&backend, &expr.ok);
+  ck_assert(not res.is_ok);
+  str_free(res.err_text);
+  expr_free(expr.ok);
+  ck_assert_int_eq(stats_of(&backend, "n").misses, 0);
+
+  calc_backend_free(backend);
+}
+END_TEST
+
+Suite *calc_memo_suite(void) {
+  TCase *tc_core = tcase_create("Core");
+  tcase_add_test(tc_core, test_memo_lru);
+  tcase_add_test(tc_core, test_memo_value_keys);
+  tcase_add_test(tc_core, test_memo_backend_calls);
+  tcase_add_test(tc_core, test_memo_worksheet);
+  tcase_add_test(tc_core, test_memo_long_ranges);
+  tcase_add_test(tc_core, test_memo_opt_in);
+
+  Suite *s = suite_create("Calc memo suite");
+  suite_add_tcase(s, tc_core);
+
+  return s;
+}
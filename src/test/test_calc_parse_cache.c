@@ -0,0 +1,129 @@
+
+#include <assert.h>
+#include <check.h>
+#include <math.h>
+
+#include "../calculator/calc_backend.h"
+#include "../calculator/calc_parse_cache.h"
+#include "../parser/expr.h"
+#include "../util/prettify_c.h"
+
+#define EPS 0.000001
+
+static void free_result(CalcExprResult res) {
+  if (res.is_ok)
+    calc_expr_free(res.ok);
+  else
+    str_free(res.err_text);
+}
+
+START_TEST(test_parse_cache_same_text) {
+  CalcBackend backend = calc_backend_create();
+  ExprContext ctx = calc_backend_get_context(&backend);
+
+  CalcExprResult first = calc_expr_parse(ctx, "a = sin x + 2 y");
+  CalcParseCacheStats before = calc_parse_cache_stats();
+  // Spaces only separate tokens, so these are the same text
+  CalcExprResult again = calc_expr_parse(ctx, "a = sin x + 2 y");
+  CalcExprResult spaced = calc_expr_parse(ctx, "  a =  sin   x + 2 y ");
+  CalcParseCacheStats after = calc_parse_cache_stats();
+
+  ck_assert_int_eq(after.hits - before.hits, 2);
+  ck_assert_int_eq(after.misses, before.misses);
+
+  ck_assert(first.is_ok and again.is_ok and spaced.is_ok);
+  ck_assert_int_eq(again.ok.type, CALC_EXPR_VARIABLE);
+  ck_assert_str_eq(again.ok.variable_name.string, "a");
+  ck_assert(expr_equal(&first.ok.expression, &again.ok.expression));
+  ck_assert(expr_equal(&first.ok.expression, &spaced.ok.expression));
+  // Copies, not the cached expression itself
+  ck_assert_ptr_ne(first.ok.expression.binary_operator.lhs,
+                   again.ok.expression.binary_operator.lhs);
+
+  free_result(first);
+  free_result(again);
+  free_result(spaced);
+  calc_backend_free(backend);
+}
+END_TEST
+
+START_TEST(test_parse_cache_name_kinds) {
+  CalcBackend backend = calc_backend_create();
+  ExprContext ctx = calc_backend_get_context(&backend);
+
+  // k is not known yet, so this multiplies
+  CalcExprResult product = calc_expr_parse(ctx, "k x");
+  ck_assert(product.is_ok);
+  ck_assert_int_eq(product.ok.expression.type, EXPR_BINARY_OP);
+
+  str_free(calc_backend_add_expr(&backend, "k(t) = t"));
+  ctx = calc_backend_get_context(&backend);
+
+  // Now k is a function: same text, different parse
+  CalcParseCacheStats before = calc_parse_cache_stats();
+  CalcExprResult call = calc_expr_parse(ctx, "k x");
+  CalcParseCacheStats after = calc_parse_cache_stats();
+
+  ck_assert_int_eq(after.misses - before.misses, 1);
+  ck_assert_int_eq(after.hits, before.hits);
+  ck_assert(call.is_ok);
+  ck_assert_int_eq(call.ok.expression.type, EXPR_FUNCTION);
+
+  free_result(product);
+  free_result(call);
+  calc_backend_free(backend);
+}
+END_TEST
+
+START_TEST(test_parse_cache_error_position) {
+  CalcBackend backend = calc_backend_create();
+  ExprContext ctx = calc_backend_get_context(&backend);
+
+  const char *text = "1 + * 2";
+  const char *spaced = "   1  +   *   2";
+  CalcExprResult first = calc_expr_parse(ctx, text);
+  CalcParseCacheStats before = calc_parse_cache_stats();
+  CalcExprResult again = calc_expr_parse(ctx, spaced);
+  CalcParseCacheStats after = calc_parse_cache_stats();
+
+  ck_assert_int_eq(after.hits - before.hits, 1);
+  ck_assert(not first.is_ok and not again.is_ok);
+  ck_assert_str_eq(first.err_text.string, again.err_text.string);
+  // The position is in the text that was passed, at the same token
+  ck_assert_ptr_eq(first.err_pos, text + 4);
+  ck_assert_ptr_eq(again.err_pos, spaced + 10);
+
+  free_result(first);
+  free_result(again);
+  calc_backend_free(backend);
+}
+END_TEST
+
+START_TEST(test_parse_cache_calculate) {
+  CalcParseCacheStats before = calc_parse_cache_stats();
+  ExprValueResult first = calc_calculate_expr("x * y + 1", 2, 3);
+  ExprValueResult again = calc_calculate_expr("x * y + 1", 4, 5);
+  CalcParseCacheStats after = calc_parse_cache_stats();
+
+  ck_assert_int_ge(after.hits - before.hits, 1);
+  ck_assert(first.is_ok and again.is_ok);
+  ck_assert_double_eq_tol(first.ok.number, 7, EPS);
+  ck_assert_double_eq_tol(again.ok.number, 21, EPS);
+
+  expr_value_free(first.ok);
+  expr_value_free(again.ok);
+}
+END_TEST
+
+Suite *calc_parse_cache_suite(void) {
+  TCase *tc_core = tcase_create("Core");
+  tcase_add_test(tc_core, test_parse_cache_same_text);
+  tcase_add_test(tc_core, test_parse_cache_name_kinds);
+  tcase_add_test(tc_core, test_parse_cache_error_position);
+  tcase_add_test(tc_core, test_parse_cache_calculate);
+
+  Suite *s = suite_create("Calc parse cache suite");
+  suite_add_tcase(s, tc_core);
+
+  return s;
+}
@@ -0,0 +1,136 @@
+
+#include <assert.h>
+#include <check.h>
+#include <math.h>
+
+#include "../calculator/calc_worksheet.h"
+#include "../util/prettify_c.h"
+
+static vec_str_t make_texts(const char* const* lines, int count) {
+  vec_str_t result = vec_str_t_create();
+  for (int i = 0; i < count; i++)
+    vec_str_t_push(&result, str_literal(lines[i]));
+  return result;
+}
+
+// Worksheet results have to match adding all the lines from scratch
+static void assert_same_as_fresh(CalcWorksheet* sheet, const vec_str_t* texts) {
+  CalcBackend fresh = calc_backend_create();
+
+  ck_assert_int_eq(sheet->lines.length, texts->length);
+  for (int i = 0; i < texts->length; i++) {
+    CalcLine* line = &sheet->lines.data[i];
+    ck_assert_str_eq(line->text.string, texts->data[i].string);
+
+    bool is_blank = true;
+    for (int j = 0; texts->data[i].string[j] != '\0'; j++)
+      if (texts->data[i].string[j] != ' ') is_blank = false;
+
+    if (is_blank) {
+      ck_assert_str_eq(line->descr.string, "");
+      continue;
+    }
+    str_t descr = calc_backend_add_expr(&fresh, texts->data[i].string);
+    ck_assert_str_eq(line->descr.string, descr.string);
+    str_free(descr);
+  }
+
+  ck_assert_int_eq(sheet->backend.expressions.length, fresh.expressions.length);
+  calc_backend_free(fresh);
+}
+
+static int update(CalcWorksheet* sheet, const char* const* lines, int count) {
+  vec_str_t texts = make_texts(lines, count);
+  int changed = calc_worksheet_update(sheet, &texts, null, null);
+  assert_same_as_fresh(sheet, &texts);
+  vec_str_t_free(texts);
+  return changed;
+}
+
+START_TEST(test_ws_only_dependents) {
+  CalcWorksheet sheet = calc_worksheet_create();
+
+  const char* v1[] = {"a = 2", "b = 10", "c = a * 3", "d = b + 1", "c + x"};
+  ck_assert_int_eq(update(&sheet, v1, LEN(v1)), 5);
+  ck_assert_int_eq(update(&sheet, v1, LEN(v1)), 0);
+
+  // c and the plot use a, d does not
+  const char* v2[] = {"a = 5", "b = 10", "c = a * 3", "d = b + 1", "c + x"};
+  ck_assert_int_eq(update(&sheet, v2, LEN(v2)), 3);
+  ck_assert(sheet.lines.data[0].is_changed);
+  ck_assert(not sheet.lines.data[1].is_changed);
+  ck_assert(sheet.lines.data[2].is_changed);
+  ck_assert(not sheet.lines.data[3].is_changed);
+  ck_assert(sheet.lines.data[4].is_changed);
+  ck_assert_str_eq(sheet.lines.data[2].descr.string, "15.00");
+
+  // Only the edited line
+  const char* v3[] = {"a = 5", "b = 10", "c = a * 3", "d = b + 2", "c + x"};
+  ck_assert_int_eq(update(&sheet, v3, LEN(v3)), 1);
+
+  calc_worksheet_free(sheet);
+}
+END_TEST
+
+START_TEST(test_ws_insert_remove) {
+  CalcWorksheet sheet = calc_worksheet_create();
+
+  const char* v1[] = {"f(t) = t * 2", "", "g = f(3)", "k = 7"};
+  update(&sheet, v1, LEN(v1));
+
+  const char* v2[] = {"f(t) = t * 2", "", "h = 1", "g = f(3)", "k = 7"};
+  ck_assert_int_eq(update(&sheet, v2, LEN(v2)), 1);
+
+  // f becomes a variable: g has to be parsed again
+  const char* v3[] = {"f = 4", "", "h = 1", "g = f(3)", "k = 7"};
+  update(&sheet, v3, LEN(v3));
+  ck_assert(sheet.lines.data[3].is_changed);
+  ck_assert(not sheet.lines.data[4].is_changed);
+
+  const char* v4[] = {"", "h = 1", "g = f(3)", "k = 7"};
+  update(&sheet, v4, LEN(v4));
+
+  const char* v5[] = {"k = 7"};
+  update(&sheet, v5, LEN(v5));
+
+  const char* v6[] = {"k = 7 +", "k = 8", "l = k"};
+  update(&sheet, v6, LEN(v6));
+  const char* v7[] = {"k = 7 + 1", "k = 8", "l = k"};
+  update(&sheet, v7, LEN(v7));
+  ck_assert_int_eq(update(&sheet, v7, 0), 0);
+
+  calc_worksheet_free(sheet);
+}
+END_TEST
+
+START_TEST(test_ws_many_lines) {
+  CalcWorksheet sheet = calc_worksheet_create();
+  vec_str_t texts = vec_str_t_create();
+
+  vec_str_t_push(&texts, str_owned("v0 = 1"));
+  for (int i = 1; i < 250; i++)
+    vec_str_t_push(&texts, str_owned("v%d = v%d + %d", i, i - 1, i % 3));
+  ck_assert_int_eq(calc_worksheet_update(&sheet, &texts, null, null), 250);
+
+  // Last line is the only dependent of the one before it
+  str_free(texts.data[248]);
+  texts.data[248] = str_owned("v248 = 0");
+  ck_assert_int_eq(calc_worksheet_update(&sheet, &texts, null, null), 2);
+  assert_same_as_fresh(&sheet, &texts);
+
+  vec_str_t_free(texts);
+  calc_worksheet_free(sheet);
+}
+END_TEST
+
+Suite *calc_worksheet_suite(void) {
+  TCase *tc_core = tcase_create("Core");
+  tcase_add_test(tc_core, test_ws_only_dependents);
+  tcase_add_test(tc_core, test_ws_insert_remove);
+  tcase_add_test(tc_core, test_ws_many_lines);
+
+  Suite *s = suite_create("CalcWorksheet suite");
+  suite_add_tcase(s, tc_core);
+
+  return s;
+}
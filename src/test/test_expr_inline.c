@@ -0,0 +1,179 @@
+#include <assert.h>
+#include <check.h>
+#include <math.h>
+
+#include "../calculator/calc_backend.h"
+#include "../calculator/expr_inline.h"
+#include "../calculator/expr_program.h"
+#include "../parser/expr.h"
+#include "../util/prettify_c.h"
+
+#define EPS 0.000001
+
+// The slot of these tests. No function here has a u in its name
+#define SLOT "u"
+
+static ExprProgram compile_with_slot(CalcBackend *backend, const Expr *expr) {
+  vec_str_t slot_names = vec_str_t_create();
+  vec_str_t_push(&slot_names, str_literal(SLOT));
+  ExprProgram program = expr_compile(expr, backend, &slot_names);
+  vec_str_t_free(slot_names);
+  return program;
+}
+
+static void check_inlined(CalcBackend *backend, const char *text,
+                          const char *expected) {
+  ExprContext ctx = calc_backend_get_context(backend);
+  ExprResult expr = expr_parse_string(text, ctx);
+  ck_assert_msg(expr.is_ok, "%s", text);
+
+  vec_str_t slot_names = vec_str_t_create();
+  vec_str_t_push(&slot_names, str_literal(SLOT));
+  Expr inlined = expr_inline(&expr.ok, backend, &slot_names, false);
+  vec_str_t_free(slot_names);
+
+  str_t printed = str_owned("%$expr", inlined);
+  ck_assert_msg(strcmp(printed.string, expected) is 0, "'%s': got %s", text,
+                printed.string);
+
+  str_free(printed);
+  expr_free(inlined);
+  expr_free(expr.ok);
+}
+
+static int count_invokes(const ExprProgram *program) {
+  int count = 0;
+  for (int i = 0; i < program->code.length; i++)
+    if (program->code.data[i].op is EXPR_INSTR_INVOKE) count++;
+  return count;
+}
+
+// Runs the program for a few values of the slot, and compares with
+// expr_calculate of the text where the slot is replaced with the value
+static void check_inline_results(CalcBackend *backend, const char *text,
+                                 int expected_invokes) {
+  ExprContext ctx = calc_backend_get_context(backend);
+  ExprResult expr = expr_parse_string(text, ctx);
+  ck_assert_msg(expr.is_ok, "%s", text);
+  ExprProgram program = compile_with_slot(backend, &expr.ok);
+  ck_assert_int_eq(count_invokes(&program), expected_invokes);
+
+  for (double u = -1.5; u <= 2.0; u += 0.5) {
+    StringStream replaced = string_stream_create();
+    OutStream out = string_stream_stream(&replaced);
+    for (const char *c = text; *c; c++) {
+      if (*c is SLOT[0])
+        x_sprintf(out, "(%f)", u);
+      else
+        x_sprintf(out, "%c", *c);
+    }
+    str_t number_text = string_stream_to_str_t(replaced);
+    ExprResult number_expr = expr_parse_string(number_text.string, ctx);
+    ck_assert_msg(number_expr.is_ok, "%s", number_text.string);
+
+    ExprValue slot = {.type = EXPR_VALUE_NUMBER, .number = u};
+    ExprValueResult expected = expr_calculate(&number_expr.ok, ctx);
+    ExprValueResult got = expr_program_run(&program, &slot);
+    ck_assert_msg(expected.is_ok is got.is_ok, "%s", number_text.string);
+    if (expected.is_ok) {
+      ck_assert_int_eq(expected.ok.type, EXPR_VALUE_NUMBER);
+      ck_assert_int_eq(got.ok.type, EXPR_VALUE_NUMBER);
+      ck_assert_double_eq_tol(expected.ok.number, got.ok.number, EPS);
+      expr_value_free(expected.ok);
+    } else {
+      str_free(expected.err_text);
+      str_free(got.err_text);
+    }
+
+    expr_free(number_expr.ok);
+    str_free(number_text);
+  }
+
+  expr_program_free(program);
+  expr_free(expr.ok);
+}
+
+START_TEST(test_inline_bodies) {
+  CalcBackend backend = calc_backend_create();
+  str_free(calc_backend_add_expr(&backend, "w(t) = t * e^t"));
+  str_free(calc_backend_add_expr(&backend, "m(a, b, c) = a * b - c"));
+  str_free(calc_backend_add_expr(&backend, "d(a, b) = a"));
+  str_free(calc_backend_add_expr(&backend, "v = [1, 2]"));
+
+  check_inlined(&backend, "w(u + 1) + 2",
+                "(((u + 1.0) * (e ^ (u + 1.0))) + 2.0)");
+  check_inlined(&backend, "m(u, 2, w(u))", "((u * 2.0) - (u * (e ^ u)))");
+  // Numbers are never errors, so an unused one is dropped
+  check_inlined(&backend, "d(1, sin u)", "1.0");
+
+  // Vectors are split by the call, so those calls stay
+  check_inlined(&backend, "w(v * u)", "<w> (v * u)");
+  check_inlined(&backend, "m(u, [1, 2])", "<m> [u, [1.0, 2.0]]");
+
+  calc_backend_free(backend);
+}
+END_TEST
+
+START_TEST(test_inline_scope) {
+  CalcBackend backend = calc_backend_create();
+  // Functions see the arguments of their callers
+  str_free(calc_backend_add_expr(&backend, "g(t) = x * t"));
+  str_free(calc_backend_add_expr(&backend, "h(x) = g(2) + x"));
+  str_free(calc_backend_add_expr(&backend, "k(x, y) = h(y) * x"));
+  str_free(calc_backend_add_expr(&backend, "s(t) = u * t"));
+
+  check_inlined(&backend, "k(2, u)", "(((u * 2.0) + u) * 2.0)");
+  check_inline_results(&backend, "k(2, u) + h(u - 1)", 0);
+  // No caller gives g an x here, so it is unknown either way
+  check_inline_results(&backend, "g(u)", 0);
+  // Slots are x and y of a point, which a body does not see
+  check_inlined(&backend, "s(2)", "<s> 2.0");
+  check_inline_results(&backend, "s(2) + u", 1);
+
+  calc_backend_free(backend);
+}
+END_TEST
+
+START_TEST(test_inline_budget) {
+  CalcBackend backend = calc_backend_create();
+  str_free(calc_backend_add_expr(&backend, "q(t) = t + t + t"));
+  str_free(calc_backend_add_expr(&backend, "q2(t) = q(q(t))"));
+  str_free(calc_backend_add_expr(&backend, "q3(t) = q2(q2(t))"));
+  str_free(calc_backend_add_expr(&backend, "q4(t) = q3(q3(t))"));
+
+  // q2 is small, q3 grows too big once its calls are inlined
+  check_inline_results(&backend, "q2(u)", 0);
+  check_inline_results(&backend, "q3(u)", 1);
+  check_inline_results(&backend, "q4(u) + q3(u)", 2);
+
+  // All the calls of one expression together have a budget too
+  StringStream text = string_stream_create();
+  OutStream out = string_stream_stream(&text);
+  int calls = EXPR_INLINE_MAX_GROWTH / 8;
+  for (int i = 0; i < calls; i++) x_sprintf(out, i ? " + q2(u)" : "q2(u)");
+  str_t sum = string_stream_to_str_t(text);
+  ExprContext ctx = calc_backend_get_context(&backend);
+  ExprResult expr = expr_parse_string(sum.string, ctx);
+  ck_assert(expr.is_ok);
+  ExprProgram program = compile_with_slot(&backend, &expr.ok);
+  ck_assert_int_gt(count_invokes(&program), 0);
+  ck_assert_int_lt(count_invokes(&program), calls);
+
+  expr_program_free(program);
+  expr_free(expr.ok);
+  str_free(sum);
+  calc_backend_free(backend);
+}
+END_TEST
+
+Suite *expr_inline_suite(void) {
+  TCase *tc_core = tcase_create("Core");
+  tcase_add_test(tc_core, test_inline_bodies);
+  tcase_add_test(tc_core, test_inline_scope);
+  tcase_add_test(tc_core, test_inline_budget);
+
+  Suite *s = suite_create("Expr inline suite");
+  suite_add_tcase(s, tc_core);
+
+  return s;
+}
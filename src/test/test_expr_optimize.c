@@ -0,0 +1,75 @@
+#include <assert.h>
+#include <check.h>
+#include <math.h>
+
+#include "../calculator/calc_backend.h"
+#include "../parser/expr.h"
+#include "../util/prettify_c.h"
+
+static void check_optimized(CalcBackend *backend, const char *text,
+                            const char *expected) {
+  ExprContext ctx = calc_backend_get_context(backend);
+  ExprResult expr = expr_parse_string(text, ctx);
+  ck_assert_msg(expr.is_ok, "%s", text);
+
+  Expr optimized = expr_optimize(expr.ok, ctx);
+  str_t printed = str_owned("%$expr", optimized);
+  ck_assert_msg(strcmp(printed.string, expected) is 0, "'%s': got %s", text,
+                printed.string);
+
+  str_free(printed);
+  expr_free(optimized);
+}
+
+START_TEST(test_optimize_folding) {
+  CalcBackend backend = calc_backend_create();
+  str_free(calc_backend_add_expr(&backend, "a = 2"));
+  str_free(calc_backend_add_expr(&backend, "f(t) = t * t"));
+
+  check_optimized(&backend, "1 + 2 * 3", "7.0");
+  check_optimized(&backend, "(1 + 2) * x", "(x * 3.0)");
+  check_optimized(&backend, "sin(0) + a * x", "(x * 2.0)");
+  check_optimized(&backend, "f(a + 1) + x", "(x + 9.0)");
+  check_optimized(&backend, "max(1, a, 3) - x", "(3.0 - x)");
+
+  // Not numbers, or errors to report later
+  check_optimized(&backend, "[1, a] + x", "([1.0, 2.0] + x)");
+  check_optimized(&backend, "[1, 2][5] + x", "(([1.0, 2.0][5.0]) + x)");
+  check_optimized(&backend, "f(x)", "<f> x");
+
+  calc_backend_free(backend);
+}
+END_TEST
+
+START_TEST(test_optimize_identities) {
+  CalcBackend backend = calc_backend_create();
+
+  check_optimized(&backend, "x * 1 + 0", "x");
+  check_optimized(&backend, "1 * (x / 1) ^ 1", "x");
+  check_optimized(&backend, "0 + x - 5", "(x + -5.0)");
+  check_optimized(&backend, "x ^ 2", "(x * x)");
+  check_optimized(&backend, "(x + 1) ^ 2", "((x + 1.0) ^ 2.0)");
+  check_optimized(&backend, "-x", "(0.0 - x)");
+
+  // Chains are merged only where rounding stays the same
+  check_optimized(&backend, "x - 1 + 3", "((x + -1.0) + 3.0)");
+  check_optimized(&backend, "2 * (3 * x)", "((x * 3.0) * 2.0)");
+  check_optimized(&backend, "2 * (4 * x)", "(x * 8.0)");
+  check_optimized(&backend, "x * -2 * 2 ^ 10", "(x * -2048.0)");
+  check_optimized(&backend, "x * 0.5 * 2", "((x * 0.5) * 2.0)");
+  check_optimized(&backend, "x * 0", "(x * 0.0)");
+
+  calc_backend_free(backend);
+}
+END_TEST
+
+Suite *expr_optimize_suite(void) {
+  TCase *tc_core = tcase_create("Core");
+  tcase_add_test(tc_core, test_optimize_folding);
+  tcase_add_test(tc_core, test_optimize_identities);
+
+  Suite *s = suite_create("Expr optimize suite");
+  suite_add_tcase(s, tc_core);
+
+  return s;
+}
@@ -0,0 +1,212 @@
+
+#include <assert.h>
+#include <check.h>
+#include <math.h>
+#include <string.h>
+
+#include "../calculator/calc_backend.h"
+#include "../parser/expr.h"
+#include "../util/prettify_c.h"
+
+// expr_parse_string against expr_parse_string_tree: both fail, or both give
+// the same expression
+static void check_same_parse(ExprContext ctx, const char *text) {
+  ExprResult direct = expr_parse_string(text, ctx);
+  ExprResult tree = expr_parse_string_tree(text, ctx);
+
+  ck_assert_msg(direct.is_ok == tree.is_ok, "'%s': direct %s, tree %s", text,
+                direct.is_ok ? "ok" : direct.err_text.string,
+                tree.is_ok ? "ok" : tree.err_text.string);
+  if (direct.is_ok) {
+    str_t direct_text = str_owned("%$expr", direct.ok);
+    str_t tree_text = str_owned("%$expr", tree.ok);
+    ck_assert_msg(expr_equal(&direct.ok, &tree.ok), "'%s': %s vs %s", text,
+                  direct_text.string, tree_text.string);
+    str_free(direct_text);
+    str_free(tree_text);
+
+    expr_free(direct.ok);
+    expr_free(tree.ok);
+  } else {
+    str_free(direct.err_text);
+    str_free(tree.err_text);
+  }
+}
+
+// Brackets with nothing but brackets and commas inside. The token tree
+// pipeline drops or rejects them depending on where they are, the direct
+// parser always rejects them
+static bool has_void_brackets(const char *text) {
+  vec_Token tokens = vec_Token_create();
+  tk_tokenize(text, &tokens, false);
+
+  bool is_void = false;
+  for (int i = 0; i < tokens.length and not is_void; i++) {
+    if (tokens.data[i].type is_not TOKEN_BRACKET or
+        not strchr("([{", tokens.data[i].data.bracket_symbol))
+      continue;
+
+    is_void = true;
+    for (int j = i + 1, depth = 1; j < tokens.length and depth > 0; j++) {
+      const Token *token = &tokens.data[j];
+      if (token->type is TOKEN_BRACKET)
+        depth += strchr("([{", token->data.bracket_symbol) ? 1 : -1;
+      else if (token->type is_not TOKEN_COMMA)
+        is_void = false;
+      if (not is_void) break;
+    }
+  }
+
+  vec_Token_free(tokens);
+  return is_void;
+}
+
+static unsigned next_random(unsigned *state) {
+  *state = *state * 1103515245u + 12345u;
+  return *state >> 16;
+}
+
+START_TEST(test_parse_direct_corpus) {
+  CalcBackend backend = calc_backend_create();
+  str_free(calc_backend_add_expr(&backend, "f(t) = t"));
+  ExprContext ctx = calc_backend_get_context(&backend);
+
+  const char *const examples[] = {
+      // Levels and signs
+      "2 * x - 1", "2 * x - y", "a / b * c", "2^3^2", "a = b = c",
+      "1 + 2 * 3 ^ 4 .. 5 mod 6 < 7 := 8", "3 mod 2 * 4", "1..5", "1..=x",
+      "-x", "- x ^ 2", "-1^2", "- 2 ^ 2", "+x", "x = -y", "a < -b", "-a - b",
+      "x^-1", "a--1", "x * -y", "x + + y", "- - x", "x +", "* x", "mod",
+      // Juxtaposition
+      "2 x", "(x)(y)", "x y", "1 2", "1 2 3", "2 3 x", "x 2", "x 2 3", "(x) 2",
+      "(1) 2", "[1,2] 3", "x[1] 2", "x -1", "-x -1", "x -2 * 3", "2 -1 -1",
+      "x (1, 2)", "sin(x) 2",
+      // Functions
+      "sin x ^ 2", "sin cos tan x", "sin sin x", "sin(x) cos(x)", "sin x y",
+      "sin 2 x", "sin -x", "sin -1", "sin", "f", "x sin", "sin x sin y",
+      "max(1, 2)", "sin [1,2]", "sin(1,2)", "f(x)(y)", "f(1)(2)",
+      "x = sin y ^ 2", "1 + sin x y",
+      // Functions grouped on the outermost tokens only
+      "x sin x", "x sin x,", "(x sin x)", "((x sin x))", "[x sin x]",
+      "([x sin x])", "[(x sin x)]", "1 + x sin x", "x sin x + 1",
+      "x sin x, 1", "(x sin x, 2)", "sin (x sin x)", "sin [x sin x]",
+      "sin ([x sin x])", "sin [[x sin x]]", "sin (x sin x + 1)",
+      "sin cos (x sin x)", "x sin -1", "2 sin x", "x sin cos y z",
+      // Indexing
+      "x[1]", "x[1][2]", "x[1,2]", "sin(x)[1]", "x[1]^2", "-x[1]", "2 x[1]",
+      "sin x[1]", "[1,2] [3]", "([1,2])[0]", "(2)[1]", "2[1]", "x ([1])",
+      "x [(1)]", "[1,2]{0}",
+      // Lists
+      "[5]", "[[1]]", "[[1,2]]", "[(1,2)]", "{1,2}", "sin x, cos x", "sin, x",
+      "(sin x, 2)", "[sin x]", "1,2,", "1,,2", ",1", "", "(,)",
+      // Brackets
+      "(1 + 2", "1 + 2)", "(1]", "[[1, 2]", "((1, (2",
+  };
+
+  for (int i = 0; i < (int)LEN(examples); i++)
+    check_same_parse(ctx, examples[i]);
+
+  calc_backend_free(backend);
+}
+END_TEST
+
+// Expressions that mostly parse: items, operators and balanced brackets
+static void write_expression(unsigned *state, char *text, int depth) {
+  static const char *const ITEMS[] = {"x", "y", "2", "0.5", "-1", "sin",
+                                      "f", "max"};
+  static const char *const OPERATORS[] = {
+      " + ", " - ", " * ", " / ", " ^ ", " .. ", " = ", " < ", " mod ", " "};
+  static const char *const BRACKETS[] = {"()", "[]", "{}"};
+
+  int count = 1 + next_random(state) % 3;
+  for (int i = 0; i < count; i++) {
+    if (i > 0) strcat(text, OPERATORS[next_random(state) % LEN(OPERATORS)]);
+    if (next_random(state) % 5 is 0) strcat(text, "-");
+
+    if (depth < 3 and next_random(state) % 3 is 0) {
+      const char *brackets = BRACKETS[next_random(state) % LEN(BRACKETS)];
+      strncat(text, &brackets[0], 1);
+      write_expression(state, text, depth + 1);
+      if (next_random(state) % 4 is 0) {
+        strcat(text, ", ");
+        write_expression(state, text, depth + 1);
+      }
+      strncat(text, &brackets[1], 1);
+    } else {
+      strcat(text, ITEMS[next_random(state) % LEN(ITEMS)]);
+    }
+  }
+}
+
+START_TEST(test_parse_direct_generated) {
+  CalcBackend backend = calc_backend_create();
+  str_free(calc_backend_add_expr(&backend, "f(t) = t"));
+  ExprContext ctx = calc_backend_get_context(&backend);
+
+  unsigned state = 1;
+  char text[4096];
+  for (int i = 0; i < 20000; i++) {
+    text[0] = '\0';
+    write_expression(&state, text, 0);
+    check_same_parse(ctx, text);
+  }
+
+  calc_backend_free(backend);
+}
+END_TEST
+
+// Any tokens in any order, mostly errors
+START_TEST(test_parse_direct_random_tokens) {
+  CalcBackend backend = calc_backend_create();
+  str_free(calc_backend_add_expr(&backend, "f(t) = t"));
+  ExprContext ctx = calc_backend_get_context(&backend);
+
+  static const char *const PIECES[] = {
+      "x", "y", "sin", "f", "max", "2", "0.5", "-1", "-", "(", ")", "[",
+      "]", "{", "}", ",",   "+", "-",   "*", "^", "..", "=", "mod", "<",
+  };
+
+  unsigned state = 2;
+  char text[256];
+  for (int i = 0; i < 50000; i++) {
+    text[0] = '\0';
+    int count = 1 + next_random(&state) % 10;
+    for (int j = 0; j < count; j++) {
+      strcat(text, PIECES[next_random(&state) % LEN(PIECES)]);
+      strcat(text, " ");
+    }
+    if (not has_void_brackets(text)) check_same_parse(ctx, text);
+  }
+
+  calc_backend_free(backend);
+}
+END_TEST
+
+START_TEST(test_parse_direct_empty_brackets) {
+  CalcBackend backend = calc_backend_create();
+  ExprContext ctx = calc_backend_get_context(&backend);
+
+  const char *const examples[] = {"()", "x ()", "sin () x", "x [()]",
+                                  "(x, ())"};
+  for (int i = 0; i < (int)LEN(examples); i++) {
+    ExprResult res = expr_parse_string(examples[i], ctx);
+    ck_assert_msg(not res.is_ok, "%s", examples[i]);
+    str_free(res.err_text);
+  }
+
+  calc_backend_free(backend);
+}
+END_TEST
+
+Suite *expr_parse_suite(void) {
+  TCase *tc_core = tcase_create("Core");
+  tcase_add_test(tc_core, test_parse_direct_corpus);
+  tcase_add_test(tc_core, test_parse_direct_generated);
+  tcase_add_test(tc_core, test_parse_direct_random_tokens);
+  tcase_add_test(tc_core, test_parse_direct_empty_brackets);
+
+  Suite *s = suite_create("Expr parse suite");
+  suite_add_tcase(s, tc_core);
+
+  return s;
+}
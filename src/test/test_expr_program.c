@@ -0,0 +1,406 @@
+#include <assert.h>
+#include <check.h>
+#include <math.h>
+
+#include "../calculator/calc_backend.h"
+#include "../calculator/expr_program.h"
+#include "../parser/expr.h"
+#include "../util/prettify_c.h"
+
+#define EPS 0.000001
+
+static bool values_match(const ExprValue *a, const ExprValue *b) {
+  if (a->type != b->type) return false;
+
+  if (a->type is EXPR_VALUE_NUMBER) {
+    if (isnan(a->number) or isnan(b->number))
+      return isnan(a->number) and isnan(b->number);
+    return a->number == b->number or fabs(a->number - b->number) < EPS;
+
+  } else if (a->type is EXPR_VALUE_VEC) {
+    if (a->vec.length != b->vec.length) return false;
+    for (int i = 0; i < a->vec.length; i++) {
+      ExprValue a_item = expr_vec_at(&a->vec, i);
+      ExprValue b_item = expr_vec_at(&b->vec, i);
+      if (not values_match(&a_item, &b_item)) return false;
+    }
+  }
+
+  return true;
+}
+
+static void results_match(ExprValueResult expected, ExprValueResult got) {
+  ck_assert_int_eq(expected.is_ok, got.is_ok);
+
+  if (expected.is_ok) {
+    ck_assert(values_match(&expected.ok, &got.ok));
+    expr_value_free(expected.ok);
+    expr_value_free(got.ok);
+  } else {
+    str_free(expected.err_text);
+    str_free(got.err_text);
+  }
+}
+
+// Runs the program over a grid of x and y, and compares every point with
+// `calc_calculate_expr`, which goes through `expr_calculate`
+static void check_xy_expr(const char *text) {
+  CalcBackend backend = calc_backend_create();
+  ExprContext ctx = calc_backend_get_context(&backend);
+
+  ExprResult expr = expr_parse_string(text, ctx);
+  ck_assert(expr.is_ok);
+
+  vec_str_t slot_names = vec_str_t_create();
+  vec_str_t_push(&slot_names, str_literal("x"));
+  vec_str_t_push(&slot_names, str_literal("y"));
+  ExprProgram program = expr_compile(&expr.ok, &backend, &slot_names);
+  vec_str_t_free(slot_names);
+
+  for (double x = -2.0; x <= 2.0; x += 0.75) {
+    for (double y = -1.5; y <= 1.5; y += 0.5) {
+      ExprValue slots[] = {
+          {.type = EXPR_VALUE_NUMBER, .number = x},
+          {.type = EXPR_VALUE_NUMBER, .number = y},
+      };
+      results_match(calc_calculate_expr(text, x, y),
+                    expr_program_run(&program, slots));
+    }
+  }
+
+  expr_program_free(program);
+  expr_free(expr.ok);
+  calc_backend_free(backend);
+}
+
+#define EP_XY_TEST(num, text)                           \
+  START_TEST(test_ep_xy_##num) { check_xy_expr(text); } \
+  END_TEST
+
+EP_XY_TEST(1, "x + y * 2 - x / y")
+EP_XY_TEST(2, "sin x * cos y + sqrt(x^2 + y^2) - ln 2 + log 100")
+EP_XY_TEST(3, "(x < y) + (x >= y) * 2 + (x = y) + (x != y) mod 3")
+EP_XY_TEST(4, "[x, y, x + y] * 2 + [1, 2, 3]")
+EP_XY_TEST(5, "min(x, y, 1) + max([x, y], -5)")
+EP_XY_TEST(6, "[1..5][2] + sin([x, y])[0] + pi * e")
+EP_XY_TEST(7, "[x, y] + [1, 2, 3]")
+EP_XY_TEST(8, "join([x], [y, 1], 2)")
+EP_XY_TEST(9, "x := y += 3")
+EP_XY_TEST(10, "atan(x) ^ 2 % 0.3 + tan acos asin 0.5")
+EP_XY_TEST(11, "sin cos tan (x * y) - sin cos tan (x * y) * [x * y, y]")
+
+static void check_backend_expr(CalcBackend *backend, const char *text) {
+  ExprContext ctx = calc_backend_get_context(backend);
+
+  ExprResult expr = expr_parse_string(text, ctx);
+  ck_assert(expr.is_ok);
+
+  ExprProgram program = expr_compile(&expr.ok, backend, null);
+  results_match(expr_calculate(&expr.ok, ctx),
+                expr_program_run(&program, null));
+  // Second run must start from clean registers
+  results_match(expr_calculate(&expr.ok, ctx),
+                expr_program_run(&program, null));
+
+  expr_program_free(program);
+  expr_free(expr.ok);
+}
+
+START_TEST(test_ep_backend) {
+  CalcBackend backend = calc_backend_create();
+  str_free(calc_backend_add_expr(&backend, "w(x) = x * e^x"));
+  str_free(calc_backend_add_expr(&backend, "a = 10 * w(2)"));
+  str_free(calc_backend_add_expr(&backend, "v = [1, 2, a]"));
+  str_free(calc_backend_add_expr(&backend, "f(x, y) = min(x, y) + a"));
+
+  check_backend_expr(&backend, "a + w(3) - f(1, 2)");
+  check_backend_expr(&backend, "v * w(1) + f(v, 0)");
+  check_backend_expr(&backend, "w([1, 2]) + [a, a]");
+  check_backend_expr(&backend, "unknown + 1");
+  check_backend_expr(&backend, "[1, 2][5] + a");
+  // Too long to pass, either way
+  check_backend_expr(&backend, "f(0..2000000000)");
+  check_backend_expr(&backend, "w(0..2000000000) + 1");
+
+  calc_backend_free(backend);
+}
+END_TEST
+
+START_TEST(test_ep_consts_folded) {
+  CalcBackend backend = calc_backend_create();
+  str_free(calc_backend_add_expr(&backend, "a = 2 * pi"));
+  ExprContext ctx = calc_backend_get_context(&backend);
+
+  ExprResult expr = expr_parse_string("a + e", ctx);
+  ck_assert(expr.is_ok);
+  ExprProgram program = expr_compile(&expr.ok, &backend, null);
+
+  for (int i = 0; i < program.code.length; i++)
+    ck_assert_int_ne(program.code.data[i].op, EXPR_INSTR_LOAD);
+  ck_assert_int_eq(program.names.length, 0);
+  expr_program_print(&program, DEBUG_OUT);
+
+  ExprValueResult res = expr_program_run(&program, null);
+  ck_assert(res.is_ok);
+  ck_assert_int_eq(res.ok.type, EXPR_VALUE_NUMBER);
+  ck_assert_double_eq_tol(res.ok.number, 2.0 * 3.1415926536 + 2.7182818284,
+                          EPS);
+
+  expr_program_free(program);
+  expr_free(expr.ok);
+  calc_backend_free(backend);
+}
+END_TEST
+
+// The program has to give the very same number as `expr_calculate` at `x`,
+// constants may not be regrouped
+static void check_exact_expr(const char *text, double x) {
+  CalcBackend backend = calc_backend_create();
+  ExprContext ctx = calc_backend_get_context(&backend);
+  ExprResult expr = expr_parse_string(text, ctx);
+  ck_assert(expr.is_ok);
+
+  vec_str_t slot_names = vec_str_t_create();
+  vec_str_t_push(&slot_names, str_literal("x"));
+  ExprProgram program = expr_compile(&expr.ok, &backend, &slot_names);
+  vec_str_t_free(slot_names);
+
+  ExprValueResult expected = calc_calculate_expr(text, x, 0.0);
+  ExprValue slots[] = {{.type = EXPR_VALUE_NUMBER, .number = x}};
+  ExprValueResult got = expr_program_run(&program, slots);
+  ck_assert(expected.is_ok and got.is_ok);
+  ck_assert_msg(got.ok.number == expected.ok.number or
+                    (isnan(got.ok.number) and isnan(expected.ok.number)),
+                "'%s' at %g: %.17g instead of %.17g", text, x, got.ok.number,
+                expected.ok.number);
+
+  expr_program_free(program);
+  expr_free(expr.ok);
+  calc_backend_free(backend);
+}
+
+START_TEST(test_ep_exact_constants) {
+  // Overflow and underflow in between
+  check_exact_expr("x * 1e200 * 1e200", 0.0);
+  check_exact_expr("x * 1e-200 * 1e-200", 1e300);
+  check_exact_expr("x * 2^600 * 2^600", 0.0);
+  check_exact_expr("x * 0.5 * 0.5", 5e-324);
+  check_exact_expr("x * 3 * 5", 0.1);
+  // Rounding of sums
+  check_exact_expr("x + 1 - 1", 1e-20);
+  check_exact_expr("x + 0.1 + 0.2", 1.0);
+  check_exact_expr("(x - 1e300) + 1e300", 1.0);
+  // Powers of two are merged, see test_optimize_identities
+  check_exact_expr("x * 2 * 4", 1e308);
+  check_exact_expr("x * -2 * 0.5", 3.0);
+}
+END_TEST
+
+// Batch results have to match running the program point by point
+static void check_batch_expr(CalcBackend *backend, const char *text,
+                             bool expect_numeric) {
+  ExprContext ctx = calc_backend_get_context(backend);
+  ExprResult expr = expr_parse_string(text, ctx);
+  ck_assert(expr.is_ok);
+
+  vec_str_t slot_names = vec_str_t_create();
+  vec_str_t_push(&slot_names, str_literal("x"));
+  vec_str_t_push(&slot_names, str_literal("y"));
+  ExprProgram program = expr_compile(&expr.ok, backend, &slot_names);
+  vec_str_t_free(slot_names);
+  ck_assert_int_eq(program.is_numeric, expect_numeric);
+
+  // Not a multiple of the chunk size
+  enum { COUNT = 1000 };
+  static double xs[COUNT], ys[COUNT], out[COUNT];
+  for (int i = 0; i < COUNT; i++) {
+    xs[i] = -3.0 + 0.006 * i;
+    ys[i] = 2.0 - 0.0035 * i;
+  }
+  const double *slots[] = {xs, ys};
+  int failed = expr_eval_batch(&program, slots, COUNT, out);
+
+  int expected_failed = 0;
+  for (int i = 0; i < COUNT; i++) {
+    ExprValue point[] = {
+        {.type = EXPR_VALUE_NUMBER, .number = xs[i]},
+        {.type = EXPR_VALUE_NUMBER, .number = ys[i]},
+    };
+    ExprValueResult res = expr_program_run(&program, point);
+    if (res.is_ok and res.ok.type is EXPR_VALUE_NUMBER) {
+      ExprValue got = {.type = EXPR_VALUE_NUMBER, .number = out[i]};
+      ck_assert(values_match(&res.ok, &got));
+    } else {
+      ck_assert(isnan(out[i]));
+      expected_failed++;
+    }
+    if (res.is_ok)
+      expr_value_free(res.ok);
+    else
+      str_free(res.err_text);
+  }
+  ck_assert_int_eq(failed, expected_failed);
+
+  expr_program_free(program);
+  expr_free(expr.ok);
+}
+
+START_TEST(test_ep_batch) {
+  CalcBackend backend = calc_backend_create();
+  str_free(calc_backend_add_expr(&backend, "a = 2 * pi"));
+  str_free(calc_backend_add_expr(&backend, "w(t) = t * e^t"));
+  str_free(calc_backend_add_expr(&backend, "v = [1, 2]"));
+
+  check_batch_expr(&backend, "sin(x * a) + cos(y) ^ 2 - x / y", true);
+  check_batch_expr(&backend, "sqrt(x) + ln(y) * atan(x - y) + 3 mod 2", true);
+  check_batch_expr(&backend, "x", true);
+  check_batch_expr(&backend, "w(x) + y", true);
+  check_batch_expr(&backend, "v * x", false);
+  check_batch_expr(&backend, "unknown + x", false);
+
+  calc_backend_free(backend);
+}
+END_TEST
+
+static int count_ops(const ExprProgram *program, int op) {
+  int count = 0;
+  for (int i = 0; i < program->code.length; i++)
+    if (program->code.data[i].op is op) count++;
+  return count;
+}
+
+START_TEST(test_ep_shared_subtrees) {
+  CalcBackend backend = calc_backend_create();
+  str_free(calc_backend_add_expr(&backend, "w(t) = t * e^t"));
+  str_free(calc_backend_add_expr(&backend, "v = [1, 2]"));
+  ExprContext ctx = calc_backend_get_context(&backend);
+
+  ExprResult a = expr_parse_string("sin(x * y) + 1", ctx);
+  ExprResult b = expr_parse_string("sin(x * y)", ctx);
+  ExprResult c = expr_parse_string("sin(y * x)", ctx);
+  ck_assert(a.is_ok and b.is_ok and c.is_ok);
+  ck_assert(expr_equal(a.ok.binary_operator.lhs, &b.ok));
+  ck_assert_int_eq(expr_hash(a.ok.binary_operator.lhs), expr_hash(&b.ok));
+  ck_assert(not expr_equal(&b.ok, &c.ok));
+  expr_free(a.ok);
+  expr_free(b.ok);
+  expr_free(c.ok);
+
+  vec_str_t slot_names = vec_str_t_create();
+  vec_str_t_push(&slot_names, str_literal("x"));
+  vec_str_t_push(&slot_names, str_literal("y"));
+  ExprResult expr =
+      expr_parse_string("sin cos (x * y) + sin cos (x * y) / cos(x * y)", ctx);
+  ck_assert(expr.is_ok);
+  ExprProgram program = expr_compile(&expr.ok, &backend, &slot_names);
+  vec_str_t_free(slot_names);
+  expr_program_print(&program, DEBUG_OUT);
+
+  // x * y, cos and sin once each, the rest are copies
+  ck_assert(program.is_numeric);
+  ck_assert_int_eq(program.shared_count, 2);
+  ck_assert_int_eq(count_ops(&program, EXPR_INSTR_NATIVE), 2);
+  ck_assert_int_eq(count_ops(&program, EXPR_INSTR_BINARY), 3);
+  expr_program_free(program);
+  expr_free(expr.ok);
+
+  // A deep chain, every node hashed once
+  StringStream chain = string_stream_create();
+  OutStream chain_out = string_stream_stream(&chain);
+  for (int i = 0; i < 2000; i++) outstream_puts("sin(x * y) + ", chain_out);
+  outstream_puts("x", chain_out);
+  str_t chain_text = string_stream_to_str_t(chain);
+  expr = expr_parse_string(chain_text.string, ctx);
+  ck_assert(expr.is_ok);
+  slot_names = vec_str_t_create();
+  vec_str_t_push(&slot_names, str_literal("x"));
+  vec_str_t_push(&slot_names, str_literal("y"));
+  program = expr_compile(&expr.ok, &backend, &slot_names);
+  vec_str_t_free(slot_names);
+  ck_assert_int_eq(program.shared_count, 1);
+  ck_assert_int_eq(count_ops(&program, EXPR_INSTR_NATIVE), 1);
+  expr_program_free(program);
+  expr_free(expr.ok);
+  str_free(chain_text);
+
+  check_batch_expr(&backend, "sin(x * y) + cos(x * y) / sin(x * y)", true);
+  check_batch_expr(&backend, "w(x) - w(x) * w(y)", true);
+  // Registers below the stack are cleared between runs too
+  check_backend_expr(&backend, "w(v) + w(v) * 2");
+
+  calc_backend_free(backend);
+}
+END_TEST
+
+START_TEST(test_ep_calls) {
+  CalcBackend backend = calc_backend_create();
+  str_free(calc_backend_add_expr(&backend, "f1(t) = 2t + 1"));
+  str_free(calc_backend_add_expr(&backend, "f2(t) = f1(t) * f1(t + 1)"));
+  str_free(calc_backend_add_expr(&backend, "f3(t) = f2(t) - f1(t) / t"));
+  str_free(calc_backend_add_expr(&backend, "f4(t) = f3(f3(t))"));
+  str_free(calc_backend_add_expr(&backend, "m(a, b, c) = a * b - c"));
+  // Functions see the arguments of their callers
+  str_free(calc_backend_add_expr(&backend, "g(t) = x * t"));
+  str_free(calc_backend_add_expr(&backend, "h(x) = g(2) + x"));
+  str_free(calc_backend_add_expr(&backend, "k(x, y) = h(y) * x"));
+  str_free(calc_backend_add_expr(&backend, "v = [2, 5]"));
+
+  check_backend_expr(&backend, "f4(3) + f4(f1(2))");
+  check_backend_expr(&backend, "f4([1, 2])");
+  check_backend_expr(&backend, "m(1, 2, 3) + m([4, 5, 6]) + m(1..3)");
+  check_backend_expr(&backend, "m(1, 2, 3, 4)");
+  check_backend_expr(&backend, "m(1)");
+  check_backend_expr(&backend, "h(3) + k(2, 5)");
+  check_backend_expr(&backend, "h([1, 2])");
+  check_backend_expr(&backend, "g(1)");
+
+  // Every call is resolved when compiling. f4 is too big to be inlined, and
+  // k gets a vector
+  ExprContext ctx = calc_backend_get_context(&backend);
+  ExprResult expr = expr_parse_string("f4(x) + k(v * x)", ctx);
+  ck_assert(expr.is_ok);
+  vec_str_t slot_names = vec_str_t_create();
+  vec_str_t_push(&slot_names, str_literal("x"));
+  ExprProgram program = expr_compile(&expr.ok, &backend, &slot_names);
+  vec_str_t_free(slot_names);
+  ck_assert_int_eq(count_ops(&program, EXPR_INSTR_CALL), 0);
+  ck_assert_int_eq(count_ops(&program, EXPR_INSTR_INVOKE), 2);
+  // f4 calls f3 twice through one callee, with its frame reused
+  ExprProgram *f4 = program.callees.data[0].program;
+  ck_assert_int_eq(f4->callees.length, 1);
+  ck_assert_int_eq(count_ops(f4, EXPR_INSTR_INVOKE), 2);
+  // h sees x and y of k after its own x
+  ExprProgram *h = program.callees.data[1].program->callees.data[0].program;
+  ck_assert_int_eq(h->slots_count, 3);
+
+  expr_program_free(program);
+  expr_free(expr.ok);
+  calc_backend_free(backend);
+}
+END_TEST
+
+Suite *expr_program_suite(void) {
+  TCase *tc_core = tcase_create("Expr Program");
+  tcase_add_test(tc_core, test_ep_xy_1);
+  tcase_add_test(tc_core, test_ep_xy_2);
+  tcase_add_test(tc_core, test_ep_xy_3);
+  tcase_add_test(tc_core, test_ep_xy_4);
+  tcase_add_test(tc_core, test_ep_xy_5);
+  tcase_add_test(tc_core, test_ep_xy_6);
+  tcase_add_test(tc_core, test_ep_xy_7);
+  tcase_add_test(tc_core, test_ep_xy_8);
+  tcase_add_test(tc_core, test_ep_xy_9);
+  tcase_add_test(tc_core, test_ep_xy_10);
+  tcase_add_test(tc_core, test_ep_xy_11);
+  tcase_add_test(tc_core, test_ep_backend);
+  tcase_add_test(tc_core, test_ep_consts_folded);
+  tcase_add_test(tc_core, test_ep_batch);
+  tcase_add_test(tc_core, test_ep_exact_constants);
+  tcase_add_test(tc_core, test_ep_shared_subtrees);
+  tcase_add_test(tc_core, test_ep_calls);
+
+  Suite *s = suite_create("Expr Program suite");
+  suite_add_tcase(s, tc_core);
+
+  return s;
+}
@@ -14,7 +14,7 @@ START_TEST(test_expr_value_free) {
   ExprValue val_num = {.type = EXPR_VALUE_NUMBER, .number = 42.0};
   ExprValue arr[] = {val_num, val_none};
   ExprValue val_vec = {.type = EXPR_VALUE_VEC,
-                       .vec = vec_ExprValue_create_copy(arr, 2)};
+                       .vec = expr_vec_from_values(vec_ExprValue_create_copy(arr, 2))};
 
   expr_value_free(val_none);
   expr_value_free(val_num);
@@ -27,7 +27,7 @@ START_TEST(test_expr_value_clone) {
   ExprValue val_num = {.type = EXPR_VALUE_NUMBER, .number = 42.0};
   ExprValue arr[] = {val_num, val_none};
   ExprValue val_vec = {.type = EXPR_VALUE_VEC,
-                       .vec = vec_ExprValue_create_copy(arr, 2)};
+                       .vec = expr_vec_from_values(vec_ExprValue_create_copy(arr, 2))};
 
   ExprValue copy = expr_value_clone(&val_none);
   expr_value_free(copy);
@@ -50,7 +50,7 @@ START_TEST(test_expr_value_print) {
   ExprValue val_num = {.type = EXPR_VALUE_NUMBER, .number = 42.0};
   ExprValue arr[] = {val_num, val_none};
   ExprValue val_vec = {.type = EXPR_VALUE_VEC,
-                       .vec = vec_ExprValue_create_copy(arr, 2)};
+                       .vec = expr_vec_from_values(vec_ExprValue_create_copy(arr, 2))};
 
   x_sprintf(os, "%$expr_value %$expr_value %$expr_value", val_none, val_num,
             val_vec);
@@ -62,12 +62,23 @@ START_TEST(test_expr_value_print) {
 }
 END_TEST
 
+START_TEST(test_expr_value_print_long) {
+  ExprValue range = {.type = EXPR_VALUE_VEC,
+                     .vec = expr_vec_range(0.0, 2000000000)};
+  str_t text = str_owned("%$expr_value", range);
+  ck_assert(strstr(text.string, "[0.00, 1.00, "));
+  ck_assert(strstr(text.string, ", 30.00, ..., 1999999999.00]"));
+  ck_assert(not strstr(text.string, "31.00"));
+  str_free(text);
+}
+END_TEST
+
 START_TEST(test_expr_value_type_text) {
   ExprValue val_none = {.type = EXPR_VALUE_NONE};
   ExprValue val_num = {.type = EXPR_VALUE_NUMBER, .number = 42.0};
   ExprValue arr[] = {val_num, val_none};
   ExprValue val_vec = {.type = EXPR_VALUE_VEC,
-                       .vec = vec_ExprValue_create_copy(arr, 2)};
+                       .vec = expr_vec_from_values(vec_ExprValue_create_copy(arr, 2))};
 
   ck_assert_str_eq(expr_value_type_text(val_none.type), "None");
   ck_assert_str_eq(expr_value_type_text(val_num.type), "Number");
@@ -79,12 +90,85 @@ START_TEST(test_expr_value_type_text) {
 }
 END_TEST
 
+START_TEST(test_expr_vec_storage) {
+  ExprVec vec = expr_vec_create();
+  for (int i = 0; i < EXPR_VEC_SMALL_CAPACITY; i++)
+    expr_vec_push_number(&vec, i);
+  ck_assert_int_eq(vec.kind, EXPR_VEC_SMALL);
+
+  // Longer vectors of numbers stay packed
+  for (int i = EXPR_VEC_SMALL_CAPACITY; i < 100; i++)
+    expr_vec_push(&vec, (ExprValue){.type = EXPR_VALUE_NUMBER, .number = i});
+  ck_assert_int_eq(vec.kind, EXPR_VEC_PACKED);
+  ck_assert_ptr_nonnull(expr_vec_numbers(&vec));
+  ck_assert_double_eq(expr_vec_numbers(&vec)[99], 99.0);
+
+  ExprVec copy = expr_vec_clone(&vec);
+  expr_vec_append(&vec, copy);
+  ck_assert_int_eq(vec.kind, EXPR_VEC_PACKED);
+  ck_assert_int_eq(vec.length, 200);
+  ck_assert_double_eq(expr_vec_at(&vec, 150).number, 50.0);
+
+  // Anything but a number boxes every element
+  ExprVec nested = expr_vec_from_numbers((double[]){1.0, 2.0}, 2);
+  expr_vec_push(&vec, (ExprValue){.type = EXPR_VALUE_VEC, .vec = nested});
+  ck_assert_int_eq(vec.kind, EXPR_VEC_BOXED);
+  ck_assert_ptr_null(expr_vec_numbers(&vec));
+  ck_assert_int_eq(vec.length, 201);
+  ck_assert_double_eq(expr_vec_at(&vec, 42).number, 42.0);
+  ck_assert_int_eq(expr_vec_at(&vec, 200).type, EXPR_VALUE_VEC);
+
+  vec_ExprValue values = expr_vec_into_values(vec);
+  ck_assert_int_eq(values.length, 201);
+  vec_ExprValue_free(values);
+}
+END_TEST
+
+START_TEST(test_expr_vec_sharing) {
+  double numbers[] = {1.0, 2.0, 3.0, 4.0, 5.0};
+  ExprVec vec = expr_vec_from_numbers(numbers, LEN(numbers));
+  size_t before = expr_value_vec_copies();
+
+  ExprVec shared = expr_vec_clone(&vec);
+  ck_assert_ptr_eq(expr_vec_numbers(&shared), expr_vec_numbers(&vec));
+  ck_assert_int_eq(expr_value_vec_copies(), before);
+
+  // The first write copies, the original stays intact
+  expr_vec_numbers_mut(&shared)[0] = 10.0;
+  expr_vec_push_number(&shared, 6.0);
+  ck_assert_int_eq(expr_value_vec_copies(), before + 1);
+  ck_assert_double_eq(expr_vec_at(&vec, 0).number, 1.0);
+  ck_assert_int_eq(vec.length, 5);
+  ck_assert_double_eq(expr_vec_at(&shared, 0).number, 10.0);
+  ck_assert_int_eq(shared.length, 6);
+
+  // Nested vectors are shared by boxed copies, deep clones own everything
+  ExprVec boxed = expr_vec_create();
+  expr_vec_push(&boxed, (ExprValue){.type = EXPR_VALUE_VEC, .vec = vec});
+  ExprValue outer = {.type = EXPR_VALUE_VEC, .vec = boxed};
+  ExprValue deep = expr_value_deep_clone(&outer);
+  ck_assert_ptr_ne(expr_vec_numbers(&deep.vec.items[0].vec),
+                   expr_vec_numbers(&boxed.items[0].vec));
+  ExprValue* items = expr_vec_items_mut(&outer.vec);
+  expr_value_free(items[0]);
+  items[0] = (ExprValue){.type = EXPR_VALUE_NONE};
+  ck_assert_int_eq(deep.vec.items[0].type, EXPR_VALUE_VEC);
+  expr_value_free(deep);
+
+  expr_vec_free(shared);
+  expr_value_free(outer);
+}
+END_TEST
+
 Suite *expr_value_suite(void) {
   TCase *tc_core = tcase_create("ExprValue");
   tcase_add_test(tc_core, test_expr_value_free);
   tcase_add_test(tc_core, test_expr_value_clone);
   tcase_add_test(tc_core, test_expr_value_print);
+  tcase_add_test(tc_core, test_expr_value_print_long);
   tcase_add_test(tc_core, test_expr_value_type_text);
+  tcase_add_test(tc_core, test_expr_vec_storage);
+  tcase_add_test(tc_core, test_expr_vec_sharing);
 
   Suite *s = suite_create("ExprValue suite");
   suite_add_tcase(s, tc_core);
@@ -0,0 +1,122 @@
+#include <check.h>
+
+#include "../calculator/calc_backend.h"
+#include "../glsl_compiler/glsl_compiler.h"
+#include "../parser/expr.h"
+#include "../util/prettify_c.h"
+
+// Body of the plot and the binding table of its uniforms
+typedef struct Compiled {
+  str_t body;
+  str_t uniforms;
+} Compiled;
+
+static Compiled compile(const char *const *defs, int count, const char *plot) {
+  CalcBackend backend = calc_backend_create();
+  for (int i = 0; i < count; i++)
+    str_free(calc_backend_add_expr(&backend, defs[i]));
+
+  ExprContext ctx = calc_backend_get_context(&backend);
+  ExprResult expr = expr_parse_string(plot, ctx);
+  ck_assert_msg(expr.is_ok, "%s", plot);
+
+  GlslContext glsl = glsl_context_create();
+  vec_str_t used_args = vec_str_t_create();
+  StrResult code =
+      glsl_compile_function_body(ctx, &glsl, &expr.ok, &used_args);
+  ck_assert_msg(code.is_ok, "%s", code.data.string);
+
+  Compiled result = {
+      .body = code.data,
+      .uniforms = glsl_uniforms_to_text(&glsl.uniforms),
+  };
+  vec_str_t_free(used_args);
+  glsl_context_free(glsl);
+  expr_free(expr.ok);
+  calc_backend_free(backend);
+  return result;
+}
+
+static void compiled_free(Compiled this) {
+  str_free(this.body);
+  str_free(this.uniforms);
+}
+
+START_TEST(test_glsl_lifts_constants) {
+  const char *v1[] = {"a = 2", "b = a * 3"};
+  const char *v2[] = {"a = 2.5", "b = a * 3"};
+  Compiled c1 = compile(v1, LEN(v1), "x * a + y * b");
+  Compiled c2 = compile(v2, LEN(v2), "x * a + y * b");
+
+  ck_assert_str_eq(c1.body.string,
+                   "return ((pos.x * u_const_0) + (pos.y * u_const_1));");
+  ck_assert_str_eq(c1.uniforms.string, "u_const_0 2\nu_const_1 6\n");
+  // Only the values differ
+  ck_assert_str_eq(c2.body.string, c1.body.string);
+  ck_assert_str_eq(c2.uniforms.string, "u_const_0 2.5\nu_const_1 7.5\n");
+
+  compiled_free(c1);
+  compiled_free(c2);
+}
+END_TEST
+
+START_TEST(test_glsl_keeps_literals) {
+  const char *defs[] = {"n = 3", "f(t) = t * n"};
+
+  // Numbers as written, and exponents to unroll powers
+  Compiled c = compile(defs, LEN(defs), "x * 2 + y ^ n");
+  ck_assert_str_eq(c.body.string,
+                   "return ((pos.x * 2.0000000000) + "
+                   "(1.0*pos.y*pos.y*pos.y));");
+  ck_assert_str_eq(c.uniforms.string, "");
+  compiled_free(c);
+
+  // Constants of functions are uniforms too
+  c = compile(defs, LEN(defs), "f(x)");
+  ck_assert_str_eq(c.body.string, "return func_f(pos, step, pos.x);");
+  ck_assert_str_eq(c.uniforms.string, "u_const_0 3\n");
+  compiled_free(c);
+}
+END_TEST
+
+START_TEST(test_glsl_uniforms_text) {
+  vec_GlslUniform uniforms = vec_GlslUniform_create();
+  vec_GlslUniform_push(&uniforms, (GlslUniform){.name = str_literal("u_a"),
+                                                .value = 0.1});
+  vec_GlslUniform_push(&uniforms, (GlslUniform){.name = str_literal("u_b"),
+                                                .value = -1e300});
+
+  str_t text = glsl_uniforms_to_text(&uniforms);
+  ck_assert_str_eq(text.string,
+                   "u_a 0.10000000000000001\n"
+                   "u_b -1.0000000000000001e+300\n");
+
+  // Values come back exactly
+  vec_GlslUniform parsed = vec_GlslUniform_create();
+  ck_assert(glsl_uniforms_from_text(text.string, &parsed));
+  ck_assert_int_eq(parsed.length, 2);
+  ck_assert_str_eq(parsed.data[1].name.string, "u_b");
+  ck_assert(parsed.data[0].value == 0.1);
+  ck_assert(parsed.data[1].value == -1e300);
+
+  // Nothing is appended from a broken table
+  ck_assert(not glsl_uniforms_from_text("u_c 1\nu_d oops\n", &parsed));
+  ck_assert_int_eq(parsed.length, 2);
+
+  str_free(text);
+  vec_GlslUniform_free(parsed);
+  vec_GlslUniform_free(uniforms);
+}
+END_TEST
+
+Suite *glsl_compiler_suite(void) {
+  TCase *tc_core = tcase_create("Core");
+  tcase_add_test(tc_core, test_glsl_lifts_constants);
+  tcase_add_test(tc_core, test_glsl_keeps_literals);
+  tcase_add_test(tc_core, test_glsl_uniforms_text);
+
+  Suite *s = suite_create("GLSL compiler suite");
+  suite_add_tcase(s, tc_core);
+
+  return s;
+}
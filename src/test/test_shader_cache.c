@@ -0,0 +1,139 @@
+#include <check.h>
+#include <stdio.h>
+
+#include "../util/prettify_c.h"
+#include "../util/shader_cache.h"
+
+#define TEST_DIR "test_shader_cache.tmp"
+
+typedef struct Evicted {
+  unsigned int programs[8];
+  int length;
+} Evicted;
+
+static void record_evicted(void *data, unsigned int program) {
+  Evicted *evicted = (Evicted *)data;
+  evicted->programs[evicted->length++] = program;
+}
+
+START_TEST(test_shader_cache_lru) {
+  Evicted evicted = {0};
+  ShaderCache cache = shader_cache_create(3, record_evicted, &evicted);
+  shader_cache_add(&cache, "void a() {}", 1);
+  shader_cache_add(&cache, "void b() {}", 2);
+  shader_cache_add(&cache, "void c() {}", 3);
+
+  ck_assert_int_eq(shader_cache_find(&cache, "void a() {}"), 1);
+  ck_assert_int_eq(shader_cache_find(&cache, "void d() {}"), 0);
+  // b is the least recently used now
+  shader_cache_add(&cache, "void d() {}", 4);
+  ck_assert_int_eq(evicted.length, 1);
+  ck_assert_int_eq(evicted.programs[0], 2);
+  ck_assert_int_eq(shader_cache_find(&cache, "void b() {}"), 0);
+  ck_assert_int_eq(shader_cache_find(&cache, "void c() {}"), 3);
+  ck_assert_int_eq(shader_cache_find(&cache, "void d() {}"), 4);
+
+  ck_assert_int_eq(cache.hits, 3);
+  ck_assert_int_eq(cache.misses, 2);
+
+  // Whatever is left goes on free
+  shader_cache_free(cache);
+  ck_assert_int_eq(evicted.length, 4);
+}
+END_TEST
+
+START_TEST(test_shader_cache_many) {
+  Evicted evicted = {0};
+  ShaderCache cache = shader_cache_create(64, null, null);
+  char source[32];
+  for (int i = 0; i < 64; i++) {
+    sprintf(source, "float f%d;", i);
+    shader_cache_add(&cache, source, i + 1);
+  }
+  for (int i = 0; i < 64; i++) {
+    sprintf(source, "float f%d;", i);
+    ck_assert_int_eq(shader_cache_find(&cache, source), i + 1);
+  }
+  ck_assert_int_eq(cache.misses, 0);
+  // Digests are of the whole text
+  ck_assert(shader_cache_digest("float f1;") is_not
+            shader_cache_digest("float f1; "));
+  shader_cache_free(cache);
+  ck_assert_int_eq(evicted.length, 0);
+}
+END_TEST
+
+static void write_file(const char *path, const char *text) {
+  FILE *file = fopen(path, "wb");
+  ck_assert(file);
+  fputs(text, file);
+  fclose(file);
+}
+
+static str_t source_path(const char *key) {
+  char name[32];
+  snprintf(name, sizeof(name), "%016llx.frag",
+           (unsigned long long)shader_cache_digest(key));
+  return str_owned(TEST_DIR "/%s", name);
+}
+
+static bool exists(const char *path) {
+  FILE *file = fopen(path, "rb");
+  if (file) fclose(file);
+  return file;
+}
+
+START_TEST(test_shader_sources_on_disk) {
+  str_t path_a = source_path("a");
+  str_t path_b = source_path("b");
+  str_t path_c = source_path("c");
+
+  ShaderSourceCache sources = shader_source_cache_open(TEST_DIR);
+  str_t source;
+  ck_assert(not shader_source_cache_load(&sources, "a", &source));
+  shader_source_cache_store(&sources, "a", "void main() { a(); }");
+  shader_source_cache_store(&sources, "b", "void main() { b(); }");
+  shader_source_cache_store(&sources, "c", "void main() { c(); }");
+  shader_source_cache_close(sources);
+
+  // Next run
+  sources = shader_source_cache_open(TEST_DIR);
+  ck_assert(shader_source_cache_load(&sources, "a", &source));
+  ck_assert_str_eq(source.string, "void main() { a(); }");
+  str_free(source);
+  // Changed since, by someone else
+  write_file(path_b.string, "void main() { B(); }");
+  ck_assert(not shader_source_cache_load(&sources, "b", &source));
+  shader_source_cache_close(sources);
+
+  // Neither b nor c was used
+  ck_assert(exists(path_a.string));
+  ck_assert(not exists(path_b.string));
+  ck_assert(not exists(path_c.string));
+
+  sources = shader_source_cache_open(TEST_DIR);
+  ck_assert(not shader_source_cache_load(&sources, "c", &source));
+  ck_assert(shader_source_cache_load(&sources, "a", &source));
+  str_free(source);
+  shader_source_cache_close(sources);
+
+  remove(path_a.string);
+  remove(TEST_DIR "/index.txt");
+  remove(TEST_DIR);
+  str_free(path_a);
+  str_free(path_b);
+  str_free(path_c);
+}
+END_TEST
+
+Suite *shader_cache_suite(void) {
+  TCase *tc_core = tcase_create("Core");
+  tcase_add_test(tc_core, test_shader_cache_lru);
+  tcase_add_test(tc_core, test_shader_cache_many);
+  tcase_add_test(tc_core, test_shader_sources_on_disk);
+
+  Suite *s = suite_create("Shader cache suite");
+  suite_add_tcase(s, tc_core);
+
+  return s;
+}
@@ -0,0 +1,140 @@
+#include <assert.h>
+#include <check.h>
+#include <float.h>
+#include <math.h>
+
+#include "../util/prettify_c.h"
+#include "../util/simd_math.h"
+
+#define MAX_ULP 4.0
+#define COUNT 4099  // Not a multiple of any vector width
+
+static double libm_log10(double a) { return log(a) / log(10.0); }
+
+static double ulp_distance(double got, double expected) {
+  if (got == expected) return 0.0;
+  double ulp = nextafter(fabs(expected), INFINITY) - fabs(expected);
+  return fabs(got - expected) / ulp;
+}
+
+static void check_unary(SimdUnaryFn fn, double (*libm)(double),
+                        const double* in, int count) {
+  static double out[COUNT];
+  fn(in, out, count);
+
+  for (int i = 0; i < count; i++) {
+    double expected = libm(in[i]);
+    if (isnan(expected)) {
+      ck_assert_msg(isnan(out[i]), "%.17g: got %.17g, expected NaN", in[i],
+                    out[i]);
+    } else {
+      // Results near zero are compared absolutely
+      bool is_close = ulp_distance(out[i], expected) <= MAX_ULP or
+                      fabs(out[i] - expected) <= 1e-15;
+      ck_assert_msg(is_close, "%.17g: got %.17g, expected %.17g", in[i],
+                    out[i], expected);
+      ck_assert_int_eq(signbit(out[i]) != 0, signbit(expected) != 0);
+    }
+  }
+}
+
+static void check_all_unary(const double* in, int count, bool is_positive) {
+  check_unary(simd_sin, sin, in, count);
+  check_unary(simd_cos, cos, in, count);
+  check_unary(simd_sqrt, sqrt, in, count);
+  if (is_positive) {
+    check_unary(simd_ln, log, in, count);
+    check_unary(simd_log10, libm_log10, in, count);
+  }
+}
+
+START_TEST(test_simd_unary_libm) {
+  static double in[COUNT];
+
+  for (int level = SIMD_LEVEL_SCALAR; level <= SIMD_LEVEL_AVX2; level++) {
+    simd_set_level((SimdLevel)level);
+
+    for (int i = 0; i < COUNT; i++) in[i] = (i - COUNT / 2) * 0.0173 + 1e-4;
+    check_all_unary(in, COUNT, false);
+
+    for (int i = 0; i < COUNT; i++) in[i] = (i - COUNT / 2) * 24419.3;
+    check_all_unary(in, COUNT, false);
+
+    for (int i = 0; i < COUNT; i++) in[i] = exp((i - COUNT / 2) * 0.3);
+    check_all_unary(in, COUNT, true);
+
+    for (int i = 0; i < COUNT; i++) in[i] = 1.0 + (i - COUNT / 2) * 1e-7;
+    check_all_unary(in, COUNT, true);
+
+    // Every tail length
+    for (int count = 0; count < 9; count++) check_all_unary(in, count, true);
+  }
+
+  simd_set_level(simd_supported_level());
+}
+END_TEST
+
+START_TEST(test_simd_special_values) {
+  double in[] = {0.0,     -0.0,     1.0,      -1.0,      NAN,    INFINITY,
+                 -INFINITY, 1e300,  DBL_MIN,  DBL_TRUE_MIN, 3e-310, DBL_MAX,
+                 1e8,     -1e8,     1.5e8,    1e20,      -1e-9,  1e-12,
+                 3.14159265358979, 1.5707963267948966, -4.71238898038469};
+
+  for (int level = SIMD_LEVEL_SCALAR; level <= SIMD_LEVEL_AVX2; level++) {
+    simd_set_level((SimdLevel)level);
+    for (int start = 0; start < 4; start++) {
+      check_unary(simd_sin, sin, in + start, LEN(in) - start);
+      check_unary(simd_cos, cos, in + start, LEN(in) - start);
+      check_unary(simd_sqrt, sqrt, in + start, LEN(in) - start);
+      check_unary(simd_ln, log, in + start, LEN(in) - start);
+      check_unary(simd_log10, libm_log10, in + start, LEN(in) - start);
+    }
+  }
+
+  simd_set_level(simd_supported_level());
+}
+END_TEST
+
+START_TEST(test_simd_arithmetic) {
+  static double a[COUNT], b[COUNT], out[COUNT];
+  for (int i = 0; i < COUNT; i++) {
+    a[i] = sin(i) * 1000.0;
+    b[i] = (i % 7) - 3.0;
+  }
+
+  for (int level = SIMD_LEVEL_SCALAR; level <= SIMD_LEVEL_AVX2; level++) {
+    simd_set_level((SimdLevel)level);
+
+    for (int count = COUNT - 3; count <= COUNT; count++) {
+      simd_add(a, b, out, count);
+      for (int i = 0; i < count; i++) ck_assert(out[i] == a[i] + b[i]);
+      simd_sub(a, b, out, count);
+      for (int i = 0; i < count; i++) ck_assert(out[i] == a[i] - b[i]);
+      simd_mul(a, b, out, count);
+      for (int i = 0; i < count; i++) ck_assert(out[i] == a[i] * b[i]);
+      simd_div(a, b, out, count);
+      for (int i = 0; i < count; i++)
+        ck_assert(out[i] == a[i] / b[i] or (isnan(out[i]) and b[i] == 0.0));
+    }
+
+    // In place
+    for (int i = 0; i < COUNT; i++) out[i] = a[i];
+    simd_mul(out, out, out, COUNT);
+    for (int i = 0; i < COUNT; i++) ck_assert(out[i] == a[i] * a[i]);
+  }
+
+  simd_set_level(simd_supported_level());
+}
+END_TEST
+
+Suite *simd_math_suite(void) {
+  TCase *tc_core = tcase_create("Core");
+  tcase_add_test(tc_core, test_simd_unary_libm);
+  tcase_add_test(tc_core, test_simd_special_values);
+  tcase_add_test(tc_core, test_simd_arithmetic);
+
+  Suite *s = suite_create("SIMD math suite");
+  suite_add_tcase(s, tc_core);
+
+  return s;
+}
@@ -2,6 +2,7 @@
 #include <assert.h>
 #include <check.h>
 #include <math.h>
+#include <stdio.h>
 #include <string.h>
 
 #include "../calculator/calc_backend.h"
@@ -85,6 +86,107 @@ START_TEST(test_tokenizer_symbols) {
 }
 END_TEST
 
+START_TEST(test_tokenize_whole_text) {
+  const char *const examples[] = {
+      "sin(x) + [1..=5][2] ^ 2 mod 7",
+      "f(a, b) := a += -b *= - 2.5e3 /= .5",
+      "  1..5, 1.5..2, x-1, x - -1, modx, 15ea, 1e+, 1.e2  ",
+      "a == b != c <= d >= e < f > g % h",
+  };
+
+  // Same tokens as one by one
+  vec_Token tokens = vec_Token_create();
+  for (int i = 0; i < (int)LEN(examples); i++) {
+    TokenizeResult res = tk_tokenize(examples[i], &tokens, false);
+    ck_assert(res.is_ok);
+
+    TokenResult next = tk_next_token(examples[i]);
+    for (int j = 0; j < tokens.length; j++) {
+      ck_assert(next.has_token);
+      ck_assert_int_eq(tokens.data[j].type, next.token.type);
+      ck_assert_ptr_eq(tokens.data[j].start_pos, next.token.start_pos);
+      next = tk_next_token(next.next_token_pos);
+    }
+    ck_assert(not next.has_token);
+  }
+
+  // The vector is reused, numbers are read whole
+  tk_tokenize("1..5 - 2.5e3 .", &tokens, true);
+  ck_assert_int_eq(tokens.length, 5);
+  ck_assert_double_eq(tokens.data[0].data.number_number, 1.0);
+  ck_assert_int_eq(tokens.data[1].type, TOKEN_OPERATOR);
+  ck_assert_double_eq(tokens.data[2].data.number_number, 5.0);
+  ck_assert_double_eq(tokens.data[3].data.number_number, -2500.0);
+  ck_assert_double_eq(tokens.data[4].data.number_number, 0.0);
+
+  vec_Token_free(tokens);
+}
+END_TEST
+
+// Numbers as %g, other tokens as written, separated by spaces
+static void tokens_text(const char *text, char *out, size_t size) {
+  vec_Token tokens = vec_Token_create();
+  TokenizeResult res = tk_tokenize(text, &tokens, true);
+  ck_assert(res.is_ok);
+
+  size_t length = 0;
+  for (int i = 0; i < tokens.length; i++) {
+    const Token *token = &tokens.data[i];
+    const char *space = i > 0 ? " " : "";
+    if (token->type is TOKEN_NUMBER)
+      length += snprintf(out + length, size - length, "%s%g", space,
+                         token->data.number_number);
+    else if (token->type is TOKEN_IDENT)
+      length += snprintf(out + length, size - length, "%s%.*s", space,
+                         token->data.ident_text.length,
+                         token->data.ident_text.start);
+    else if (token->type is TOKEN_OPERATOR)
+      length += snprintf(out + length, size - length, "%s%.*s", space,
+                         token->data.operator_text.length,
+                         token->data.operator_text.start);
+    ck_assert(length < size);
+  }
+  vec_Token_free(tokens);
+}
+
+START_TEST(test_tokenize_dangling_exponent) {
+  // An `e` without digits after it is not part of the number
+  const char *const examples[][2] = {
+      {"2e", "2 e"},     {"2e+x", "2 e + x"}, {"2ex", "2 ex"},
+      {"2e-", "2 e -"},  {"1e-2", "0.01"},    {"1E+2x", "100 x"},
+  };
+
+  char text[64];
+  for (int i = 0; i < (int)LEN(examples); i++) {
+    tokens_text(examples[i][0], text, sizeof(text));
+    ck_assert_str_eq(text, examples[i][1]);
+  }
+}
+END_TEST
+
+START_TEST(test_tokenize_forbidden_symbols) {
+  vec_Token tokens = vec_Token_create();
+  const char *text = "a $ b # $ := 1";
+
+  TokenizeResult res = tk_tokenize(text, &tokens, true);
+  ck_assert(not res.is_ok);
+  ck_assert_str_eq(res.err_text.string, "Forbidden symbols: $#:");
+  ck_assert_ptr_eq(res.err_pos, &text[2]);
+  str_free(res.err_text);
+
+  // `:=` is fine without the check, symbols that start no token are not
+  res = tk_tokenize("x := 1", &tokens, false);
+  ck_assert(res.is_ok);
+  ck_assert_int_eq(tokens.length, 3);
+  res = tk_tokenize("x ! 1", &tokens, false);
+  ck_assert(not res.is_ok);
+  ck_assert_str_eq(res.err_text.string, "Unexpected symbol !");
+  str_free(res.err_text);
+
+  vec_Token_free(tokens);
+}
+END_TEST
+
 #define TokenIdent(literal)                   \
   (Token) {                                   \
     .type = TOKEN_IDENT, .data.ident_text = { \
@@ -132,6 +234,9 @@ Suite *tokenizer_suite(void) {
   tcase_add_test(tc_core, test_token_types_texts);
   tcase_add_test(tc_core, test_token_print_ident);
   tcase_add_test(tc_core, test_tokenizer_symbols);
+  tcase_add_test(tc_core, test_tokenize_whole_text);
+  tcase_add_test(tc_core, test_tokenize_dangling_exponent);
+  tcase_add_test(tc_core, test_tokenize_forbidden_symbols);
 
   Suite *s = suite_create("Tokenizer suite");
   suite_add_tcase(s, tc_core);
@@ -0,0 +1,95 @@
+// Cost of user function calls in ns, over chains of functions where each one
+// calls the one before it: `make bench_calls`. Each chain is run through
+// expr_calculate, which takes a frame per call, and through a compiled
+// program, which calls compiled functions with their arguments in slots.
+#include <stdio.h>
+#include <time.h>
+
+#include "../calculator/calc_backend.h"
+#include "../calculator/expr_program.h"
+#include "../util/allocator.h"
+#include "../util/prettify_c.h"
+
+#define MAX_DEPTH 64
+#define MIN_SECONDS 0.5
+
+static const int DEPTHS[] = {1, 4, 16, 64};
+
+static double seconds_since(clock_t start) {
+  return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+static void bench_calculate(CalcBackend* backend, const Expr* expr,
+                            int depth) {
+  int runs = 0;
+  clock_t start = clock();
+  while (seconds_since(start) < MIN_SECONDS) {
+    for (int i = 0; i < 1000; i++) {
+      ExprValueResult res = calc_backend_calculate(backend, expr);
+      if (not res.is_ok) panic("%s", res.err_text.string);
+      expr_value_free(res.ok);
+    }
+    runs += 1000;
+  }
+  printf("  calculate: %.1f ns/call\n",
+         seconds_since(start) * 1e9 / runs / depth);
+}
+
+static void bench_program(CalcBackend* backend, const Expr* expr, int depth) {
+  vec_str_t slot_names = vec_str_t_create();
+  vec_str_t_push(&slot_names, str_literal("x"));
+  ExprProgram program = expr_compile(expr, backend, &slot_names);
+  vec_str_t_free(slot_names);
+
+  ExprValue point = {.type = EXPR_VALUE_NUMBER, .number = 1.5};
+  size_t allocations = my_allocator_heap_allocations();
+  int runs = 0;
+  clock_t start = clock();
+  while (seconds_since(start) < MIN_SECONDS) {
+    for (int i = 0; i < 1000; i++) {
+      ExprValueResult res = expr_program_run(&program, &point);
+      if (not res.is_ok) panic("%s", res.err_text.string);
+    }
+    runs += 1000;
+  }
+  double seconds = seconds_since(start);
+  allocations = my_allocator_heap_allocations() - allocations;
+
+  printf("  program:   %.1f ns/call, %.2f heap allocations/call\n",
+         seconds * 1e9 / runs / depth, (double)allocations / runs / depth);
+  expr_program_free(program);
+}
+
+int main() {
+  CalcBackend backend = calc_backend_create();
+  str_free(calc_backend_add_expr(&backend, "g1(t) = t * 0.5 + 1"));
+  for (int i = 2; i <= MAX_DEPTH; i++) {
+    str_t text = str_owned("g%d(t) = g%d(t) * 0.5 + t", i, i - 1);
+    str_free(calc_backend_add_expr(&backend, text.string));
+    str_free(text);
+  }
+  ExprContext ctx = calc_backend_get_context(&backend);
+
+  for (int i = 0; i < (int)LEN(DEPTHS); i++) {
+    printf("depth %d:\n", DEPTHS[i]);
+
+    // Programs take x as a slot, expr_calculate gets the number right away
+    str_t number_text = str_owned("g%d(1.5)", DEPTHS[i]);
+    str_t slot_text = str_owned("g%d(x)", DEPTHS[i]);
+    ExprResult with_number = expr_parse_string(number_text.string, ctx);
+    ExprResult with_slot = expr_parse_string(slot_text.string, ctx);
+    if (not with_number.is_ok or not with_slot.is_ok) panic("Parse failed");
+
+    bench_calculate(&backend, &with_number.ok, DEPTHS[i]);
+    bench_program(&backend, &with_slot.ok, DEPTHS[i]);
+
+    expr_free(with_number.ok);
+    expr_free(with_slot.ok);
+    str_free(number_text);
+    str_free(slot_text);
+  }
+
+  calc_backend_free(backend);
+  calc_backend_frames_free();
+  return 0;
+}
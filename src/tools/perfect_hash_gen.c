@@ -0,0 +1,111 @@
+// Generates the perfect hash tables of the fixed name registries, see
+// util/perfect_hash.h. Run from src/ with `make perfect_hash` after adding an
+// operator or a native function. To add a registry, put its names into a
+// macro and add a line to REGISTRIES.
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../calculator/native_functions.h"
+#include "../parser/operators_fns.h"
+#include "../util/perfect_hash.h"
+#include "../util/prettify_c.h"
+
+#define MAX_NAMES 64
+#define MAX_SEED (1u << 24)
+
+typedef struct Registry {
+  const char* path;    // Relative to src/
+  const char* prefix;  // Of the generated macros and table
+  const char* names_macro;
+  const char* const* names;
+  int count;
+} Registry;
+
+static const char* const OPERATORS[] = EXPR_OPERATORS_NAMES;
+static const char* const NATIVES[] = NATIVE_FUNCTION_NAMES;
+
+#define REGISTRY(path, prefix, names_macro, names) \
+  { path, prefix, #names_macro, names, LEN(names) }
+
+static const Registry REGISTRIES[] = {
+    REGISTRY("parser/operators_hash.h", "OPERATORS_HASH", EXPR_OPERATORS_NAMES,
+             OPERATORS),
+    REGISTRY("calculator/native_functions_hash.h", "NATIVE_FUNCTIONS_HASH",
+             NATIVE_FUNCTION_NAMES, NATIVES),
+};
+
+// Fills table with indices of the names, -1 for empty slots. Returns 0 if
+// some names collide with this seed
+static int try_seed(const Registry* registry, unsigned seed, int size,
+                    signed char* table) {
+  memset(table, -1, size);
+  for (int i = 0; i < registry->count; i++) {
+    const char* name = registry->names[i];
+    int slot = perfect_hash(seed, name, strlen(name)) & (size - 1);
+    if (table[slot] >= 0) return 0;
+    table[slot] = i;
+  }
+  return 1;
+}
+
+// Seeds for the smallest power of 2 at least twice the count of the names
+static int generate(const Registry* registry) {
+  static signed char table[MAX_NAMES * 8];
+  if (registry->count > MAX_NAMES) {
+    fprintf(stderr, "%s: too many names\n", registry->path);
+    return 0;
+  }
+
+  int size = 1;
+  while (size < registry->count * 2) size *= 2;
+
+  unsigned seed = 0;
+  for (; size <= MAX_NAMES * 8; size *= 2) {
+    for (seed = 0; seed < MAX_SEED; seed++)
+      if (try_seed(registry, seed, size, table)) break;
+    if (seed < MAX_SEED) break;
+  }
+  if (size > MAX_NAMES * 8) {
+    fprintf(stderr, "%s: no seed found\n", registry->path);
+    return 0;
+  }
+
+  FILE* file = fopen(registry->path, "w");
+  if (not file) {
+    fprintf(stderr, "%s: failed to open\n", registry->path);
+    return 0;
+  }
+
+  // SRC_PARSER_OPERATORS_HASH_H_ for parser/operators_hash.h
+  char guard[128] = "SRC_";
+  for (int i = 0; registry->path[i] and i < 100; i++) {
+    char c = registry->path[i];
+    guard[4 + i] = c is '/' or c is '.' ? '_' : toupper(c);
+  }
+  strcat(guard, "_");
+
+  fprintf(file,
+          "// Generated by tools/perfect_hash_gen.c from %s.\n"
+          "// Do not edit, run `make perfect_hash` to update\n"
+          "#ifndef %s\n#define %s\n\n"
+          "#define %s_SEED %uu\n"
+          "#define %s_MASK %d\n\n"
+          "static const signed char %s_TABLE[] = {",
+          registry->names_macro, guard, guard, registry->prefix, seed,
+          registry->prefix, size - 1, registry->prefix);
+  for (int i = 0; i < size; i++)
+    fprintf(file, "%s%d,", i % 16 is 0 ? "\n    " : " ", table[i]);
+  fprintf(file, "\n};\n\n#endif  // %s\n", guard);
+  fclose(file);
+
+  printf("%s: %d names, %d slots, seed %u\n", registry->path, registry->count,
+         size, seed);
+  return 1;
+}
+
+int main() {
+  for (int i = 0; i < (int)LEN(REGISTRIES); i++)
+    if (not generate(&REGISTRIES[i])) return 1;
+  return 0;
+}
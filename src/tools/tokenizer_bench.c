@@ -0,0 +1,106 @@
+// Throughput of tk_tokenize in MB/s. `make bench_tokenizer` runs it over
+// generated expressions, `./tokenizer_bench file...` over files, where line
+// breaks and tabs count as spaces.
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "../parser/tokenizer.h"
+#include "../util/allocator.h"
+#include "../util/prettify_c.h"
+
+#define GENERATED_BYTES (16 << 20)
+#define MIN_SECONDS 1.0
+
+static const char* const PIECES[] = {
+    "sin(x)",   "cos(t * 2)", "f_12(a, b)", "[1..=5][2]", "3.25e-3",
+    "- 4.5",    "y ^ 2",      "x mod 7",    "max(1, x)",  "(a + b)",
+    "a == b",   "c <= 10",    "123456",     ".5",         "g(h(1))",
+};
+static const char* const OPERATORS[] = {" + ", " - ", " * ", " / ", " % "};
+
+// Definitions like `f_3(x) = sin(x) * 3.25e-3 + ...`, joined with commas
+static char* generate(size_t size) {
+  char* text = (char*)MALLOC(size + 256);
+  size_t length = 0;
+  unsigned state = 12345;
+
+  while (length < size) {
+    int count = 2 + length % 7;
+    length += sprintf(&text[length], "f_%u(x) = ", state % 100);
+    for (int i = 0; i < count; i++) {
+      state = state * 1103515245u + 12345u;
+      if (i > 0) length += sprintf(&text[length], "%s", OPERATORS[state % 5]);
+      length += sprintf(&text[length], "%s", PIECES[(state >> 8) % 15]);
+    }
+    length += sprintf(&text[length], ", ");
+  }
+
+  return text;
+}
+
+static char* read_file(const char* path) {
+  FILE* file = fopen(path, "rb");
+  if (not file) return null;
+
+  fseek(file, 0, SEEK_END);
+  long size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+
+  char* text = (char*)MALLOC(size + 1);
+  size_t read = fread(text, 1, size, file);
+  text[read] = '\0';
+  fclose(file);
+
+  for (size_t i = 0; i < read; i++)
+    if (text[i] is '\n' or text[i] is '\r' or text[i] is '\t') text[i] = ' ';
+  return text;
+}
+
+static void bench(const char* name, const char* text, bool check_symbols) {
+  vec_Token tokens = vec_Token_create();
+  size_t bytes = strlen(text);
+
+  // The first run grows the vector
+  TokenizeResult res = tk_tokenize(text, &tokens, check_symbols);
+  int runs = 0;
+  clock_t start = clock();
+  double seconds = 0.0;
+  while (res.is_ok and seconds < MIN_SECONDS) {
+    res = tk_tokenize(text, &tokens, check_symbols);
+    runs++;
+    seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+  }
+
+  if (not res.is_ok) {
+    printf("%s: %s\n", name, res.err_text.string);
+    str_free(res.err_text);
+  } else {
+    printf("%s%s: %.1f MB/s, %.1f M tokens/s (%d tokens)\n", name,
+           check_symbols ? " (checked)" : "",
+           bytes * runs / seconds / (1 << 20),
+           (double)tokens.length * runs / seconds / 1e6, tokens.length);
+  }
+  vec_Token_free(tokens);
+}
+
+int main(int argc, char** argv) {
+  if (argc <= 1) {
+    char* text = generate(GENERATED_BYTES);
+    bench("generated", text, false);
+    bench("generated", text, true);
+    FREE(text);
+  }
+
+  for (int i = 1; i < argc; i++) {
+    char* text = read_file(argv[i]);
+    if (not text) {
+      printf("%s: failed to read\n", argv[i]);
+      return 1;
+    }
+    bench(argv[i], text, true);
+    FREE(text);
+  }
+
+  return 0;
+}
@@ -11,10 +11,6 @@
 #include "../util/prettify_c.h"
 #include "icon_load.h"
 
-#define VECTOR_C NamedShader
-#define VECTOR_ITEM_DESTRUCTOR named_shader_free
-#include "../util/vector.h"  // vec_NamedShader
-
 #define VECTOR_C Plot
 #include "../util/vector.h"  // vec_Plot
 
@@ -26,9 +22,9 @@
 #define SIDEBAR_WIDTH 500
 #define SSAA 2
 
-void named_shader_free(NamedShader ns) {
-  str_free(ns.name);
-  gl_program_free(ns.shader);
+static void delete_program(void* data, unsigned int program) {
+  (void)data;
+  gl_program_free((GlProgram){.program = program});
 }
 
 static Mesh create_square_mesh();
@@ -71,7 +67,11 @@ GraphingTab* graphing_tab_create(int screen_w, int screen_h) {
           gl_program_from_sh_and_f(&common_vert, GL_FRAGMENT_SHADER,
                                    "assets/shaders/post_processing.frag"),
       .plots = vec_Plot_create(),
+      .worksheet = calc_worksheet_create(),
       .plot_exprs_base = read_file_to_str("assets/shaders/function.frag"),
+      .shaders =
+          shader_cache_create(GRAPHING_MAX_SHADERS, delete_program, null),
+      .plot_sources = shader_source_cache_open(GRAPHING_SOURCES_DIR),
   };
 
   FILE* exprs = fopen("assets/cache/exprs.txt", "r");
@@ -130,30 +130,25 @@ void graphing_tab_free(GraphingTab* this) {
   gl_program_free(this->grid_shader);
   gl_program_free(this->post_proc_shader);
 
+  calc_worksheet_free(this->worksheet);
   str_free(this->plot_exprs_base);
-  vec_NamedShader_free(this->shaders_pool);
+  shader_cache_free(this->shaders);
+  shader_source_cache_close(this->plot_sources);
   vec_Plot_free(this->plots);
 
   FREE(this);
   debugln("Graphing tab - freeing done");
 }
 
-void graphing_tab_add_shader(GraphingTab* this, str_t name, GlProgram shader) {
-  assert_m(graphing_tab_get_shader(this, name.string) is 0);
-  if (this->shaders_pool.length >= GRAPHING_MAX_SHADERS) {
-    debugln("Warning: shader pool overflow, deleting oldest shader");
-    vec_NamedShader_delete_fast(&this->shaders_pool,
-                                0);  // Delete the oldest shader
-  }
-  vec_NamedShader_push(&this->shaders_pool,
-                       (NamedShader){.name = name, .shader = shader});
+// Once the cache is full, the least recently used program is deleted. Plots
+// find their programs on every update, so theirs are the newest ones
+void graphing_tab_add_shader(GraphingTab* this, const char* source,
+                             GlProgram shader) {
+  shader_cache_add(&this->shaders, source, shader.program);
 }
-GLuint graphing_tab_get_shader(GraphingTab* this, const char* name) {
-  for (int i = 0; i < this->shaders_pool.length; i++) {
-    if (strcmp(name, this->shaders_pool.data[i].name.string) is 0)
-      return this->shaders_pool.data[i].shader.program;
-  }
-  return 0;
+
+GLuint graphing_tab_get_shader(GraphingTab* this, const char* source) {
+  return shader_cache_find(&this->shaders, source);
 }
 
 static void draw_plot(GraphingTab* this, GLFWwindow* window);
@@ -266,6 +261,15 @@ static void swap_framebuffers(GraphingTab* this);
 static void swap_bind_bind(GraphingTab* this, GLFWwindow* window,
                            GLuint program);
 
+// Constants of the plot, its program may be shared with plots of other values
+static void bind_plot_uniforms(GLuint program,
+                               const vec_GlslUniform* uniforms) {
+  for (int i = 0; i < uniforms->length; i++) {
+    int loc = glGetUniformLocation(program, uniforms->data[i].name.string);
+    glUniform1f(loc, (float)uniforms->data[i].value);
+  }
+}
+
 static void draw_plot(GraphingTab* this, GLFWwindow* window) {
   int width, height;
   glfwGetFramebufferSize(window, &width, &height);
@@ -286,6 +290,8 @@ static void draw_plot(GraphingTab* this, GLFWwindow* window) {
     struct nk_colorf color = this->expressions.data[plot.expr_id].color;
     glUniform4f(loc, color.r, color.g, color.b,
                 color.a);  // Отправляем цвет в шейдер (в униформу u_color)
+    bind_plot_uniforms(plot.shader_id,
+                       &this->expressions.data[plot.expr_id].plot_uniforms);
     mesh_draw(this->square_mesh);  //  Рисуем на весь экран
   }
 
@@ -5,8 +5,10 @@
 #define GLFW_INCLUDE_NONE
 #include <GLFW/glfw3.h>
 
+#include "../calculator/calc_worksheet.h"
 #include "../nuklear_flags.h"
 #include "../util/camera.h"
+#include "../util/shader_cache.h"
 #include "framebuffer.h"
 #include "mesh.h"
 #include "shader_loader.h"
@@ -20,16 +22,8 @@
 #define MULTISAMPLES 4
 
 #define GRAPHING_MAX_SHADERS 10000
-
-typedef struct NamedShader {
-  str_t name;
-  GlProgram shader;
-} NamedShader;
-
-void named_shader_free(NamedShader ns);
-
-#define VECTOR_H NamedShader
-#include "../util/vector.h"
+// Generated plot shaders, kept between runs next to exprs.txt
+#define GRAPHING_SOURCES_DIR "assets/cache/shaders"
 
 typedef struct Plot {
   GLuint shader_id;
@@ -59,8 +53,10 @@ typedef struct GraphingTab {
   GlProgram grid_shader;
   GlProgram post_proc_shader;
 
+  CalcWorksheet worksheet;
   str_t plot_exprs_base;
-  vec_NamedShader shaders_pool;
+  ShaderCache shaders;
+  ShaderSourceCache plot_sources;
   vec_Plot plots;
 } GraphingTab;
 
@@ -69,8 +65,9 @@ GLuint load_shader(const char* frag_path, const char* vert_path);
 void graphing_tab_resize(GraphingTab* this, int screen_w, int screen_h);
 
 void graphing_tab_free(GraphingTab*);
-void graphing_tab_add_shader(GraphingTab*, str_t name, GlProgram shader);
-GLuint graphing_tab_get_shader(GraphingTab*, const char* name);
+void graphing_tab_add_shader(GraphingTab*, const char* source,
+                             GlProgram shader);
+GLuint graphing_tab_get_shader(GraphingTab*, const char* source);
 void graphing_tab_update(GraphingTab* this);
 void graphing_tab_update_calc(GraphingTab* this);
 void graphing_tab_draw(GraphingTab* this, struct nk_context* ctx,
@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "../calculator/calc_backend.h"
 #include "../glsl_compiler/glsl_compiler.h"
@@ -13,110 +14,161 @@ static str_t copy_from_nk_textedit(struct nk_text_edit* textedit) {
   return str_owned("%.*s", length, text);
 }
 
-void graphing_tab_update_calc(GraphingTab* this) {
-  CalcBackend calc = calc_backend_create();
-
-  vec_Plot_free(this->plots);
-  this->plots = vec_Plot_create();
-
-  // 1. Delete old shaders. (TODO: add shaders caching to not recompile those
-  // every time)
-  GlslContext glsl = glsl_context_create();
-
-  for (int i = 0; i < this->expressions.length; i++) {
-    ui_expr* item = &this->expressions.data[i];
-    bool are_only_spaces = true;
-    const char* nk_buffer = nk_str_get_const(&item->textedit.string);
-    int length = nk_str_len(&item->textedit.string);
+// Bump when the generated code changes, so sources on disk are not reused
+#define PLOT_SOURCES_VERSION 2
+
+// What the source of a line is generated from: the base shader and the lines
+// up to this one, which are all that the line sees
+static str_t plot_source_key(GraphingTab* this, int line_index) {
+  StringStream key = string_stream_create();
+  OutStream stream = string_stream_stream(&key);
+
+  x_sprintf(stream, "%d\n", PLOT_SOURCES_VERSION);
+  outstream_puts(this->plot_exprs_base.string, stream);
+  for (int i = 0; i <= line_index; i++) {
+    struct nk_str* text = &this->expressions.data[i].textedit.string;
+    outstream_puts("\n", stream);
+    outstream_put_slice(nk_str_get_const(text), nk_str_len(text), stream);
+  }
+  return string_stream_to_str_t(key);
+}
 
-    for (int i = 0; i < length and are_only_spaces; i++)
-      if (nk_buffer[i] is_not ' ') are_only_spaces = false;
+// The binding table is stored next to the source, under a key of its own
+static str_t plot_uniforms_key(const str_t* key) {
+  return str_owned("%s\nuniforms", key->string);
+}
 
-    if (are_only_spaces) {
-      str_free(item->descr_text);
-      item->descr_text = str_literal("");
-      continue;
-    }
+// Source and uniforms of the line generated by an earlier run
+static bool load_plot(GraphingTab* this, const str_t* key, ui_expr* item) {
+  str_t uniforms_key = plot_uniforms_key(key);
+  str_t uniforms, source;
+  bool is_loaded = false;
+  if (shader_source_cache_load(&this->plot_sources, uniforms_key.string,
+                               &uniforms)) {
+    is_loaded =
+        glsl_uniforms_from_text(uniforms.string, &item->plot_uniforms) and
+        shader_source_cache_load(&this->plot_sources, key->string, &source);
+    str_free(uniforms);
+  }
+  str_free(uniforms_key);
+  if (not is_loaded) {
+    vec_GlslUniform_free(item->plot_uniforms);
+    item->plot_uniforms = vec_GlslUniform_create();
+    return false;
+  }
 
-    str_t buffer = copy_from_nk_textedit(&item->textedit);
+  str_free(item->plot_source);
+  item->plot_source = source;
+  return true;
+}
 
-    // ADD ITEM
-    // debugln("Adding expr: %s", buffer.string);
-    // debug_push();
+static void store_plot(GraphingTab* this, const str_t* key,
+                       const ui_expr* item) {
+  str_t uniforms_key = plot_uniforms_key(key);
+  str_t uniforms = glsl_uniforms_to_text(&item->plot_uniforms);
+  shader_source_cache_store(&this->plot_sources, key->string,
+                            item->plot_source.string);
+  shader_source_cache_store(&this->plot_sources, uniforms_key.string,
+                            uniforms.string);
+  str_free(uniforms);
+  str_free(uniforms_key);
+}
 
-    int prev_length = calc.expressions.length;
-    str_t message = calc_backend_add_expr(&calc, buffer.string);
+// Called by the worksheet for every line it recalculated
+static void graphing_tab_on_line(GraphingTab* this, CalcBackend* calc,
+                                 int line_index, CalcLine* line) {
+  ui_expr* item = &this->expressions.data[line_index];
+  str_free(item->descr_text);
+  item->descr_text = str_clone(&line->descr);
+  str_free(item->plot_source);
+  item->plot_source = str_literal("");
+  vec_GlslUniform_free(item->plot_uniforms);
+  item->plot_uniforms = vec_GlslUniform_create();
+
+  CalcExpr* last_expr =
+      line->expr_index >= 0 ? &calc->expressions.data[line->expr_index] : null;
+  if (not last_expr or last_expr->type is_not CALC_EXPR_PLOT) return;
+
+  // Generated by an earlier run
+  str_t key = plot_source_key(this, line_index);
+  if (load_plot(this, &key, item)) {
+    str_free(key);
+    return;
+  }
 
-    // debug_pop();
-    //    debugln("Adding done (%s).", message.string);
-    str_free(buffer);
+  debugln("Adding a plot");
+  // Every plot gets its own context, so it can be recompiled alone
+  GlslContext glsl = glsl_context_create();
+  ExprContext ctx = calc_backend_get_context(calc);
+  vec_str_t used_args = vec_str_t_create();
+  StrResult code = glsl_compile_function_body(
+      ctx, &glsl, &last_expr->expression, &used_args);
+  vec_str_t_free(used_args);
+
+  if (code.is_ok) {
+    StringStream string_stream = string_stream_create();
+    OutStream stream = string_stream_stream(&string_stream);
+
+    outstream_puts(this->plot_exprs_base.string, stream);
+    outstream_puts("\n", stream);
+    glsl_context_print_uniforms(&glsl, stream);
+    outstream_puts("\n", stream);
+    glsl_context_print_all_functions(&glsl, stream);
+
+    outstream_puts("\n\nfloat function(vec2 pos, vec2 step) {\n", stream);
+    outstream_puts(code.data.string, stream);
+    outstream_puts("\n}\n", stream);
+
+    str_free(code.data);
+    item->plot_source = string_stream_to_str_t(string_stream);
+    item->plot_uniforms = vec_GlslUniform_clone(&glsl.uniforms);
+    store_plot(this, &key, item);
+  } else {
+    debugln("Failed to compile to GLSL cuz: %s", code.data.string);
     str_free(item->descr_text);
-    item->descr_text = message;
+    item->descr_text = code.data;
+  }
+  glsl_context_free(glsl);
+  str_free(key);
+}
 
-    CalcExpr* last_expr = calc_backend_last_expr(&calc);
+static GLuint graphing_tab_shader_from_source(GraphingTab* this,
+                                              const str_t* shader_src) {
+  GLuint shader = graphing_tab_get_shader(this, shader_src->string);
+  if (not shader) {
+    Shader sh_compiled =
+        shader_from_source(GL_FRAGMENT_SHADER, shader_src->string);
+    GlProgram pr_compiled =
+        gl_program_from_2_shaders(&this->common_vert, &sh_compiled);
+    shader_free(sh_compiled);
+
+    graphing_tab_add_shader(this, shader_src->string, pr_compiled);
+    shader = pr_compiled.program;
+  }
+  return shader;
+}
 
-    if (last_expr and prev_length != calc.expressions.length) {
-      // debugln("Successfully CalcExpr '%$calc_expr' of type %s",
-      // &last_expr->expression, calc_expr_type_text(last_expr->type));
+void graphing_tab_update_calc(GraphingTab* this) {
+  vec_str_t texts = vec_str_t_with_capacity(this->expressions.length);
+  for (int i = 0; i < this->expressions.length; i++)
+    vec_str_t_push(&texts,
+                   copy_from_nk_textedit(&this->expressions.data[i].textedit));
 
-      if (last_expr->type is CALC_EXPR_PLOT) {
-        debugln("Adding a plot");
-        // debugln("0. Compile to glsl");
+  // Only edited lines and lines that depend on them are recalculated
+  calc_worksheet_update(&this->worksheet, &texts,
+                        (CalcLineCallback)graphing_tab_on_line, this);
+  vec_str_t_free(texts);
 
-        ExprContext ctx = calc_backend_get_context(&calc);
-        vec_str_t used_args = vec_str_t_create();
-        StrResult code = glsl_compile_expression(
-            ctx, &glsl, &last_expr->expression, &used_args);
-        vec_str_t_free(used_args);
+  vec_Plot_free(this->plots);
+  this->plots = vec_Plot_create();
 
-        if (code.is_ok) {
-          // debugln("1. Combine into full shader code");
-          StringStream string_stream = string_stream_create();
-          OutStream stream = string_stream_stream(&string_stream);
-
-          outstream_puts(this->plot_exprs_base.string, stream);
-          outstream_puts("\n", stream);
-          glsl_context_print_all_functions(&glsl, stream);
-
-          outstream_puts("\n\nfloat function(vec2 pos, vec2 step) {\n return ",
-                         stream);
-          outstream_puts(code.data.string, stream);
-          outstream_puts(";\n}\n", stream);
-
-          str_free(code.data);
-          str_t shader_src = string_stream_to_str_t(string_stream);
-
-          // debugln("2. Check if already exists");
-          GLuint shader = graphing_tab_get_shader(this, shader_src.string);
-          if (shader) {
-            str_free(shader_src);
-          } else {
-            // debugln("3. Compile and add the shader");
-
-            Shader sh_compiled =
-                shader_from_source(GL_FRAGMENT_SHADER, shader_src.string);
-            GlProgram pr_compiled =
-                gl_program_from_2_shaders(&this->common_vert, &sh_compiled);
-            shader_free(sh_compiled);
-
-            debugln("Compiled shader for expr: '%$expr'",
-                    last_expr->expression);
-            graphing_tab_add_shader(this, shader_src, pr_compiled);
-            shader = pr_compiled.program;
-          }
-          vec_Plot_push(&this->plots,
-                        (Plot){.expr_id = i, .shader_id = shader});
-        } else {
-          debugln("Failed to compile to GLSL cuz: %s", code.data.string);
-          str_free(item->descr_text);
-          item->descr_text = code.data;
-        }
-      }
-    }
-  }
+  for (int i = 0; i < this->expressions.length; i++) {
+    ui_expr* item = &this->expressions.data[i];
+    if (strlen(item->plot_source.string) is 0) continue;
 
-  glsl_context_free(glsl);
-  calc_backend_free(calc);
+    GLuint shader = graphing_tab_shader_from_source(this, &item->plot_source);
+    vec_Plot_push(&this->plots, (Plot){.expr_id = i, .shader_id = shader});
+  }
 }
 
 void ui_expr_update(GraphingTab* gt, ui_expr_t* this) {
@@ -128,16 +180,10 @@ void ui_expr_update(GraphingTab* gt, ui_expr_t* this) {
   bool len_changed = this->prev_length != nk_str_len(&this->textedit.string);
 
   if (unfocused or buf_changed or len_changed) {
-    // debugc("\n");
-    // debugln("Dump before...");
-    // my_allocator_dump_short();
-    // debugc("\n");
-
+    // Reports allocations of each update with ALLOCATOR_TRACKING
+    my_allocator_begin_interval();
     graphing_tab_update_calc(gt);
-
-    // debugc("\n");
-    // debugln("Dump after...");
-    // my_allocator_dump_short();
+    my_allocator_dump();
   }
 
   this->prev_length = nk_str_len(&this->textedit.string);
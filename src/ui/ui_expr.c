@@ -17,6 +17,8 @@ ui_expr_t ui_expr_create(const char* text) {
       .color = {.r = 0.8, .g = 0.2, .b = 0.1, .a = 1.0},
       .prev_active = false,
       .descr_text = str_literal("Faz balls"),
+      .plot_source = str_literal(""),
+      .plot_uniforms = vec_GlslUniform_create(),
   };
 
   nk_textedit_init_default(&this.textedit);
@@ -38,4 +40,6 @@ ui_expr_t ui_expr_create(const char* text) {
 void ui_expr_free(ui_expr_t this) {
   nk_textedit_free(&this.textedit);
   str_free(this.descr_text);
+  str_free(this.plot_source);
+  vec_GlslUniform_free(this.plot_uniforms);
 }
@@ -1,6 +1,7 @@
 #ifndef SRC_UI_EXPR_H_
 #define SRC_UI_EXPR_H_
 
+#include "../glsl_compiler/glsl_uniform.h"
 #include "../nuklear_flags.h"
 #include "../util/better_string.h"
 
@@ -14,6 +15,8 @@ typedef struct ui_expr {
   const char* prev_buffer;
 
   str_t descr_text;
+  str_t plot_source;  // Fragment shader of the line, empty if it is no plot
+  vec_GlslUniform plot_uniforms;  // Values the shader reads
 } ui_expr_t;
 ui_expr_t ui_expr_create(const char* text);
 void ui_expr_free(ui_expr_t this);
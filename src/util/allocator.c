@@ -1,6 +1,7 @@
 #include "allocator.h"
 
 #include <stdlib.h>
+#include <string.h>
 
 #include "prettify_c.h"
 
@@ -10,104 +11,466 @@
 #define VECTOR_C MemRegion
 #include "vector.h"
 
-// static vec_MemRegion regions = {.data = null, .capacity = 0, .length = 0};
+static size_t heap_allocations = 0;
 
-void my_allocator_free() {
-  return;
+size_t my_allocator_heap_allocations() { return heap_allocations; }
+
+// =====
+// =
+// = Arenas
+// =
+// =====
+struct MyArenaBlock {
+  MyArenaBlock* next;
+  size_t size;  // Usable bytes after the block header
+  size_t used;
+};
+
+// Every allocation is prefixed with its size, for my_realloc
+#define ARENA_ALIGN 16
+#define ARENA_HEADER ARENA_ALIGN
+#define ARENA_MIN_BLOCK (64 * 1024)
+#define ARENA_MAX_DEPTH 64
+
+// Scopes, innermost last. Null stands for a paused scope
+static MyArena* active[ARENA_MAX_DEPTH];
+static int active_count = 0;
+static MyArena* live_arenas = null;
+
+#define BLOCK_HEADER \
+  (ARENA_ALIGN * ((sizeof(MyArenaBlock) + ARENA_ALIGN - 1) / ARENA_ALIGN))
+
+static char* block_data(const MyArenaBlock* block) {
+  return (char*)block + BLOCK_HEADER;
+}
+
+static MyArena* current_arena() {
+  return active_count > 0 ? active[active_count - 1] : null;
+}
+
+static void push_active(MyArena* arena) {
+  if (active_count >= ARENA_MAX_DEPTH)
+    panic("Arena scopes are nested deeper than %d", ARENA_MAX_DEPTH);
+  active[active_count++] = arena;
+}
+
+static void pop_active(MyArena* arena) {
+  if (active_count is 0 or active[active_count - 1] is_not arena)
+    panic("Arena scopes are not closed in order");
+  active_count--;
+}
 
-  /*
-    for (int i = 0; i < regions.length; i++) {
-      debugln("Non freed allocation at %p for %d bytes. Freeing forcibly...",
-              regions.data[i].ptr, (int)regions.data[i].size);
-      free(regions.data[i].ptr);
+void my_arena_begin(MyArena* this) { push_active(this); }
+void my_arena_end(MyArena* this) { pop_active(this); }
+void my_arena_pause() { push_active(null); }
+void my_arena_resume() { pop_active(null); }
+
+static void* arena_alloc(MyArena* this, size_t size) {
+  size_t needed = ARENA_HEADER + (size + ARENA_ALIGN - 1) / ARENA_ALIGN *
+                                     ARENA_ALIGN;
+  MyArenaBlock* block = this->blocks;
+
+  if (not block or block->used + needed > block->size) {
+    size_t block_size = block ? block->size * 2 : ARENA_MIN_BLOCK;
+    if (block_size < needed) block_size = needed;
+
+    MyArenaBlock* new_block =
+        (MyArenaBlock*)malloc(BLOCK_HEADER + block_size);
+    if (not new_block) panic("Arena block allocation failed");
+    *new_block = (MyArenaBlock){.next = block, .size = block_size, .used = 0};
+
+    if (not this->blocks) {
+      this->next_live = live_arenas;
+      live_arenas = this;
     }
-    vec_MemRegion_free(regions);
-    regions = vec_MemRegion_create();
-  */
+    this->blocks = block = new_block;
+  }
+
+  char* mem = block_data(block) + block->used;
+  block->used += needed;
+  this->allocations++;
+
+  *(size_t*)mem = size;
+  return mem + ARENA_HEADER;
 }
 
-void* my_malloc(size_t size) {
-  return malloc(size);
+bool my_arena_owns(const MyArena* this, const void* mem) {
+  for (MyArenaBlock* block = this->blocks; block; block = block->next) {
+    const char* data = block_data(block);
+    if ((const char*)mem >= data and (const char*)mem < data + block->used)
+      return true;
+  }
+  return false;
+}
 
-  /*
-    MemRegion r = {
-        .ptr = malloc(size),
-        .size = size,
-    };
-    vec_MemRegion_push(&regions, r);
-    // debugln("Alloc for %ld at %p", (long)r.size, r.ptr);
-    return r.ptr;
-  */
+static MyArena* arena_of(const void* mem) {
+  for (MyArena* arena = live_arenas; arena; arena = arena->next_live)
+    if (my_arena_owns(arena, mem)) return arena;
+  return null;
 }
 
-void* my_realloc(void* mem, size_t size) {
-  return realloc(mem, size);
-
-  /*
-    if (mem) {
-      for (int i = 0; i < regions.length; i++) {
-        if (regions.data[i].ptr == mem) {
-          void* new_mem = realloc(mem, size);
-          // debugln("Realloc %p with %ld bytes into %p with %ld bytes",
-          // regions.data[i].ptr, (long)regions.data[i].size, new_mem,
-          // (long)size);
-          regions.data[i].ptr = new_mem;
-          regions.data[i].size = size;
-          return new_mem;
-        }
-      }
-
-      panic("Unknown realloc pointer: %p", mem);
-    } else {
-      return my_malloc(size);
+static bool is_active(const MyArena* this) {
+  for (int i = 0; i < active_count; i++)
+    if (active[i] is this) return true;
+  return false;
+}
+
+static void unlink_live(MyArena* this) {
+  for (MyArena** link = &live_arenas; *link; link = &(*link)->next_live) {
+    if (*link is this) {
+      *link = this->next_live;
+      break;
     }
-  */
+  }
+  this->next_live = null;
 }
-void my_free(void* mem) {
-  return free(mem);
-
-  /*
-    if (not mem) return;
-
-    for (int i = 0; i < regions.length; i++) {
-      if (regions.data[i].ptr == mem) {
-        // debugln("Free of %p", mem);
-        free(mem);
-        vec_MemRegion_delete_fast(&regions, i);
-        return;
-      }
+
+void my_arena_reset(MyArena* this) {
+  if (is_active(this) or not this->blocks) return;
+
+  // The newest block is the biggest one, it is kept for the next round
+  MyArenaBlock* block = this->blocks->next;
+  while (block) {
+    MyArenaBlock* next = block->next;
+    free(block);
+    block = next;
+  }
+  this->blocks->next = null;
+  this->blocks->used = 0;
+  this->allocations = 0;
+}
+
+void my_arena_free(MyArena* this) {
+  if (is_active(this)) panic("Freeing an arena that is in use");
+
+  MyArenaBlock* block = this->blocks;
+  while (block) {
+    MyArenaBlock* next = block->next;
+    free(block);
+    block = next;
+  }
+  if (this->blocks) unlink_live(this);
+  this->blocks = null;
+  this->allocations = 0;
+}
+
+// =====
+// =
+// = Tracking
+// =
+// =====
+#ifdef ALLOCATOR_TRACKING
+
+// Both hash tables are open addressing with linear probing, sized to powers
+// of two and kept under 1/2 load. They use plain malloc, so they never track
+// themselves.
+//
+// Sites are appended to `sites` and never move, so regions keep their index.
+// `site_slots` only has indices into it, -1 in empty cells
+static MyAllocSite* sites = null;
+static int sites_capacity = 0;
+static int sites_count = 0;
+
+static int* site_slots = null;
+static int site_slots_capacity = 0;
+
+static MemRegion* regions = null;  // Null `ptr` is an empty cell
+static int regions_capacity = 0;
+static int regions_count = 0;
+
+static MyAllocatorStats stats = {0};
+
+static uint32_t hash_ptr(const void* ptr) {
+  uint64_t x = (uint64_t)(uintptr_t)ptr;
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccdULL;
+  x ^= x >> 33;
+  return (uint32_t)x;
+}
+
+static uint32_t hash_site(const char* func, int line) {
+  return hash_ptr(func) ^ ((uint32_t)line * 2654435761u);
+}
+
+static int histogram_bucket(size_t size) {
+  int bucket = 0;
+  while (size > 1 and bucket < MY_ALLOC_HISTOGRAM_BUCKETS - 1) {
+    size = (size + 1) / 2;
+    bucket++;
+  }
+  return bucket;
+}
+
+static void grow_sites() {
+  sites_capacity = sites_capacity ? sites_capacity * 2 : 128;
+  sites = (MyAllocSite*)realloc(sites, sizeof(MyAllocSite) * sites_capacity);
+  if (not sites) panic("Failed to allocate memory");
+
+  // Slots are rebuilt from the sites, the indices stay the same
+  free(site_slots);
+  site_slots_capacity = sites_capacity * 2;
+  site_slots = (int*)malloc(sizeof(int) * site_slots_capacity);
+  if (not site_slots) panic("Failed to allocate memory");
+  for (int i = 0; i < site_slots_capacity; i++) site_slots[i] = -1;
+
+  uint32_t mask = (uint32_t)site_slots_capacity - 1;
+  for (int i = 0; i < sites_count; i++) {
+    uint32_t j = hash_site(sites[i].func, sites[i].line) & mask;
+    while (site_slots[j] >= 0) j = (j + 1) & mask;
+    site_slots[j] = i;
+  }
+}
+
+// Sites are told apart by function and line, so every vector type gets its
+// own sites for the lines of vector.h
+static int site_index(const char* file, int line, const char* func) {
+  if (sites_count is sites_capacity) grow_sites();
+
+  uint32_t mask = (uint32_t)site_slots_capacity - 1;
+  uint32_t i = hash_site(func, line) & mask;
+  while (site_slots[i] >= 0) {
+    MyAllocSite* site = &sites[site_slots[i]];
+    if (site->func == func and site->line == line) return site_slots[i];
+    i = (i + 1) & mask;
+  }
+
+  site_slots[i] = sites_count;
+  sites[sites_count] = (MyAllocSite){.file = file, .func = func, .line = line};
+  return sites_count++;
+}
+
+static void grow_regions() {
+  MemRegion* old = regions;
+  int old_capacity = regions_capacity;
+
+  regions_capacity = old_capacity ? old_capacity * 2 : 4096;
+  regions = (MemRegion*)calloc(regions_capacity, sizeof(MemRegion));
+  if (not regions) panic("Failed to allocate memory");
+
+  uint32_t mask = (uint32_t)regions_capacity - 1;
+  for (int i = 0; i < old_capacity; i++) {
+    if (not old[i].ptr) continue;
+    uint32_t j = hash_ptr(old[i].ptr) & mask;
+    while (regions[j].ptr) j = (j + 1) & mask;
+    regions[j] = old[i];
+  }
+  free(old);
+}
+
+static void track_alloc(void* ptr, size_t size, const char* file, int line,
+                        const char* func) {
+  if (not ptr) return;
+  if ((regions_count + 1) * 2 > regions_capacity) grow_regions();
+
+  int site = site_index(file, line, func);
+  sites[site].allocations++;
+  sites[site].bytes += size;
+
+  uint32_t mask = (uint32_t)regions_capacity - 1;
+  uint32_t i = hash_ptr(ptr) & mask;
+  while (regions[i].ptr) i = (i + 1) & mask;
+  regions[i] = (MemRegion){.ptr = ptr, .size = size, .site = site};
+  regions_count++;
+
+  stats.allocations++;
+  stats.live_bytes += size;
+  if (stats.live_bytes > stats.peak_bytes) stats.peak_bytes = stats.live_bytes;
+  stats.histogram[histogram_bucket(size)]++;
+}
+
+static void track_free(void* ptr) {
+  if (not ptr or not regions) return;
+
+  uint32_t mask = (uint32_t)regions_capacity - 1;
+  uint32_t i = hash_ptr(ptr) & mask;
+  while (regions[i].ptr and regions[i].ptr is_not ptr) i = (i + 1) & mask;
+  if (not regions[i].ptr) {
+    stats.unknown_frees++;
+    return;
+  }
+
+  MemRegion region = regions[i];
+  sites[region.site].frees++;
+  stats.frees++;
+  stats.live_bytes -= region.size;
+
+  // Backward shift deletion: no tombstones, probes stay short
+  regions[i].ptr = null;
+  regions_count--;
+  for (uint32_t j = (i + 1) & mask; regions[j].ptr; j = (j + 1) & mask) {
+    uint32_t home = hash_ptr(regions[j].ptr) & mask;
+    bool can_move = (j > i) ? (home <= i or home > j) : (home <= i and home > j);
+    if (can_move) {
+      regions[i] = regions[j];
+      regions[j].ptr = null;
+      i = j;
     }
+  }
+}
 
-    debugln("Unknown free pointer: %p", mem);
-    free(mem);
-  */
+static void track_arena_alloc(size_t size, const char* file, int line,
+                              const char* func) {
+  int site = site_index(file, line, func);
+  sites[site].allocations++;
+  sites[site].bytes += size;
+  stats.arena_allocations++;
+  stats.histogram[histogram_bucket(size)]++;
 }
 
-void my_allocator_dump() {
-  return;
+MyAllocatorStats my_allocator_stats() { return stats; }
+
+void my_allocator_begin_interval() {
+  for (int i = 0; i < sites_count; i++) {
+    sites[i].allocations = 0;
+    sites[i].bytes = 0;
+    sites[i].frees = 0;
+  }
+
+  size_t live_bytes = stats.live_bytes;
+  stats = (MyAllocatorStats){.live_bytes = live_bytes, .peak_bytes = live_bytes};
+}
 
-  /*
-    debugln("Allocator has %d active memory regions (cap %d):", regions.length,
-            regions.capacity);
+int my_allocator_top_sites(MyAllocSite* out, int max_count) {
+  int count = 0;
+  for (int i = 0; i < sites_count; i++) {
+    if (sites[i].allocations is 0) continue;
 
-    for (int i = 0; i < regions.length; i++) {
-      debugc("Ptr: %p | Size: %d\n", regions.data[i].ptr,
-             (int)regions.data[i].size);
+    // Insertion into the sorted `out`, most allocations first
+    int pos = count < max_count ? count : max_count;
+    while (pos > 0 and out[pos - 1].allocations < sites[i].allocations) {
+      if (pos < max_count) out[pos] = out[pos - 1];
+      pos--;
     }
+    if (pos < max_count) out[pos] = sites[i];
+    if (count < max_count) count++;
+  }
+  return count;
+}
+
+#define DUMP_SITES 16
 
-    debugln("Allocator dump done");
-  */
+void my_allocator_dump() {
+  MyAllocSite top[DUMP_SITES];
+  int count = my_allocator_top_sites(top, DUMP_SITES);
+  MyAllocatorStats s = stats;
+
+  my_allocator_dump_short();
+  debugln("Sizes (up to 2^i bytes):");
+  for (int i = 0; i < MY_ALLOC_HISTOGRAM_BUCKETS; i++)
+    if (s.histogram[i]) debugc("  2^%d: %ld\n", i, (long)s.histogram[i]);
+
+  debugln("Top allocation sites:");
+  for (int i = 0; i < count; i++)
+    debugc("  %6ld allocs %8ld bytes %6ld frees  %s:%d (%s)\n",
+           (long)top[i].allocations, (long)top[i].bytes, (long)top[i].frees,
+           top[i].file, top[i].line, top[i].func);
 }
 
 void my_allocator_dump_short() {
-  return;
-  /*
-    size_t sum_size = 0;
+  MyAllocatorStats s = stats;
+  debugln(
+      "Allocator: %ld allocations (+%ld in arenas), %ld frees, %d live "
+      "regions, %ld live bytes, %ld peak bytes",
+      (long)s.allocations, (long)s.arena_allocations, (long)s.frees,
+      regions_count, (long)s.live_bytes, (long)s.peak_bytes);
+}
 
-    for (int i = 0; i < regions.length; i++) sum_size += regions.data[i].size;
+void my_allocator_free() {
+  if (regions_count > 0)
+    debugln("Allocator: %d regions were never freed", regions_count);
 
-    debugln(
-        "Allocator has %d(/%d) active memory regions for the total size of %ld",
-        regions.length, regions.capacity, (long)sum_size);
-  */
-}
\ No newline at end of file
+  free(regions);
+  free(sites);
+  free(site_slots);
+  regions = null;
+  sites = null;
+  site_slots = null;
+  regions_capacity = regions_count = 0;
+  sites_capacity = sites_count = site_slots_capacity = 0;
+}
+
+#else  // ALLOCATOR_TRACKING
+
+static void track_alloc(void* ptr, size_t size, const char* file, int line,
+                        const char* func) {
+  unused(ptr);
+  unused(size);
+  unused(file);
+  unused(line);
+  unused(func);
+}
+
+static void track_free(void* ptr) { unused(ptr); }
+
+static void track_arena_alloc(size_t size, const char* file, int line,
+                              const char* func) {
+  unused(size);
+  unused(file);
+  unused(line);
+  unused(func);
+}
+
+MyAllocatorStats my_allocator_stats() { return (MyAllocatorStats){0}; }
+void my_allocator_begin_interval() {}
+int my_allocator_top_sites(MyAllocSite* out, int max_count) {
+  unused(out);
+  unused(max_count);
+  return 0;
+}
+void my_allocator_dump() {}
+void my_allocator_dump_short() {}
+void my_allocator_free() {}
+
+#endif  // ALLOCATOR_TRACKING
+
+// =====
+// =
+// = my_malloc
+// =
+// =====
+void* my_malloc_at(size_t size, const char* file, int line, const char* func) {
+  MyArena* arena = current_arena();
+  if (arena) {
+    track_arena_alloc(size, file, line, func);
+    return arena_alloc(arena, size);
+  }
+
+  heap_allocations++;
+  void* mem = malloc(size);
+  track_alloc(mem, size, file, line, func);
+  return mem;
+}
+
+void* my_realloc_at(void* mem, size_t size, const char* file, int line,
+                    const char* func) {
+  if (not mem) return my_malloc_at(size, file, line, func);
+
+  // Arena memory moves to wherever allocations go now, heap memory stays in
+  // the heap: it may outlive the current scope
+  if (live_arenas and arena_of(mem)) {
+    size_t old_size = *(size_t*)((char*)mem - ARENA_HEADER);
+    if (size <= old_size) return mem;
+
+    void* new_mem = my_malloc_at(size, file, line, func);
+    memcpy(new_mem, mem, old_size);
+    return new_mem;
+  }
+
+  heap_allocations++;
+  track_free(mem);
+  void* new_mem = realloc(mem, size);
+  track_alloc(new_mem, size, file, line, func);
+  return new_mem;
+}
+
+void my_free(void* mem) {
+  if (live_arenas and mem and arena_of(mem)) return;
+  track_free(mem);
+  free(mem);
+}
+
+void* my_malloc(size_t size) { return my_malloc_at(size, "?", 0, "?"); }
+
+void* my_realloc(void* mem, size_t size) {
+  return my_realloc_at(mem, size, "?", 0, "?");
+}
@@ -1,12 +1,14 @@
 #ifndef SRC_UTIL_ALLOCATOR_H_
 #define SRC_UTIL_ALLOCATOR_H_
 
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
 
 typedef struct MemRegion {
   void* ptr;
   size_t size;
+  int site;  // Index in the site table of ALLOCATOR_TRACKING
 } MemRegion;
 
 #define VECTOR_H MemRegion
@@ -20,15 +22,114 @@ void* my_malloc(size_t size);
 void* my_realloc(void* mem, size_t size);
 void my_free(void* mem);
 
+// Same, remembering the call site when built with ALLOCATOR_TRACKING
+void* my_malloc_at(size_t size, const char* file, int line, const char* func);
+void* my_realloc_at(void* mem, size_t size, const char* file, int line,
+                    const char* func);
+
+// Count of my_malloc (and growing my_realloc) calls that went to the heap
+size_t my_allocator_heap_allocations();
+
+// =====
+// =
+// = Arenas
+// =
+// =====
+// Bump allocator behind my_malloc. Between my_arena_begin and my_arena_end
+// every my_malloc takes memory from the arena, and my_free of arena memory
+// does nothing. my_arena_reset then gives everything back at once. Memory
+// allocated outside of the scope stays in the heap and is freed as usual.
+//
+// Nothing allocated inside the scope may outlive the reset: results are
+// copied out after my_arena_end. Caches filled during the scope have to be
+// filled inside my_arena_pause / my_arena_resume.
+//
+//   my_arena_begin(&arena);
+//   ExprValueResult res = expr_calculate(...);
+//   my_arena_end(&arena);
+//   ExprValueResult copy = clone(&res);
+//   my_arena_reset(&arena);
+
+typedef struct MyArenaBlock MyArenaBlock;
+
+typedef struct MyArena {
+  MyArenaBlock* blocks;  // Newest first, allocations come from the first one
+  struct MyArena* next_live;  // Arenas that own blocks, for my_free
+  size_t allocations;         // Since the last reset
+} MyArena;
+
+#define MY_ARENA_INIT \
+  { .blocks = null, .next_live = null, .allocations = 0 }
+
+// Arena scopes nest, the innermost one gets the allocations
+void my_arena_begin(MyArena* this);
+void my_arena_end(MyArena* this);
+// Heap allocations until the matching my_arena_resume
+void my_arena_pause();
+void my_arena_resume();
+
+// Does nothing while the arena is still in use by an enclosing scope
+void my_arena_reset(MyArena* this);
+void my_arena_free(MyArena* this);
+bool my_arena_owns(const MyArena* this, const void* mem);
+
+// =====
+// =
+// = Tracking
+// =
+// =====
+// Built with -D ALLOCATOR_TRACKING (`make ALLOCATOR_TRACKING=1`) every heap
+// region is kept in a hash table with its size and call site, and the counters
+// below are maintained. Without it these functions do nothing and MALLOC is a
+// plain call to my_malloc.
+//
+//   my_allocator_begin_interval();
+//   graphing_tab_update_calc(gt);
+//   my_allocator_dump();  // What the update allocated and where
+
+// Sizes up to 2^i bytes go to bucket i
+#define MY_ALLOC_HISTOGRAM_BUCKETS 32
+
+typedef struct MyAllocSite {
+  const char* file;
+  const char* func;
+  int line;
+  size_t allocations;  // Heap and arena, since the interval start
+  size_t bytes;
+  size_t frees;  // Of regions allocated here, arenas excluded
+} MyAllocSite;
+
+typedef struct MyAllocatorStats {
+  size_t allocations;  // Heap, since the interval start
+  size_t arena_allocations;
+  size_t frees;
+  size_t unknown_frees;  // Pointers that were not allocated with my_malloc
+  size_t live_bytes;     // In the heap, since the program start
+  size_t peak_bytes;     // Largest live_bytes in the interval
+  size_t histogram[MY_ALLOC_HISTOGRAM_BUCKETS];
+} MyAllocatorStats;
+
+MyAllocatorStats my_allocator_stats();
+// Resets counters of the sites and the stats, live bytes are kept
+void my_allocator_begin_interval();
+// The sites with most allocations in the interval, returns how many
+int my_allocator_top_sites(MyAllocSite* out, int max_count);
+
 void my_allocator_dump();
-void my_allocator_free();
 void my_allocator_dump_short();
+void my_allocator_free();
 
+#ifdef ALLOCATOR_TRACKING
+#define MALLOC(size) my_malloc_at(size, __FILE__, __LINE__, __func__)
+#define REALLOC(mem, size) \
+  my_realloc_at(mem, size, __FILE__, __LINE__, __func__)
+#else
 #define MALLOC my_malloc
 #define REALLOC my_realloc
+#endif
 #define FREE my_free
-#define VECTOR_MALLOC_FN my_malloc
-#define VECTOR_REALLOC_FN my_realloc
-#define VECTOR_FREE_FN my_free
+#define VECTOR_MALLOC_FN MALLOC
+#define VECTOR_REALLOC_FN REALLOC
+#define VECTOR_FREE_FN FREE
 
-#endif  // SRC_UTIL_ALLOCATOR_H_
\ No newline at end of file
+#endif  // SRC_UTIL_ALLOCATOR_H_
@@ -146,9 +146,11 @@ static void put_string_fmt(OutStream stream, Specificator info,
   if (info.precision > 0) {
     char* string = va_arg(list->list, char*);
 
-    outstream_put_slice(string, info.precision, stream);
-    (*total_written) +=
-        info.precision is 0 ? 0 : MIN((int)strlen(string), info.precision);
+    // Up to the precision, but not past the end, as printf does
+    int len = 0;
+    while (len < info.precision and string[len]) len++;
+    outstream_put_slice(string, len, stream);
+    (*total_written) += len;
   } else if (info.precision is - 1) {
     int len = va_arg(list->list, int);
     char* string = va_arg(list->list, char*);
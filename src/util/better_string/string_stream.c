@@ -58,6 +58,7 @@ static int ss_putc(StringStream* this, int c) {
 
 static int ss_puts(StringStream* this, const char* str) {
   size_t len = strlen(str);
+  if (len is 0) return '\n';
   if ((this->length + len) > this->capacity) ss_realloc(this, len);
 
   memcpy(&this->buffer[this->length], str, sizeof(char) * len);
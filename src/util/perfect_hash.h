@@ -0,0 +1,25 @@
+#ifndef SRC_UTIL_PERFECT_HASH_H_
+#define SRC_UTIL_PERFECT_HASH_H_
+
+#include <stdint.h>
+
+// Hash of the fixed name registries (operators, native functions). The seed
+// and the table of every registry are found by tools/perfect_hash_gen.c, so
+// that each name gets its own slot and a lookup is a single probe:
+//
+//   int i = TABLE[perfect_hash(SEED, name.start, name.length) & MASK];
+//   // then one compare of name with NAMES[i], if i >= 0
+//
+// The generator and the lookups have to agree on this function, changing it
+// means running `make perfect_hash` again.
+static inline uint32_t perfect_hash(uint32_t seed, const char* text,
+                                    int length) {
+  uint32_t hash = 2166136261u ^ seed;
+  for (int i = 0; i < length; i++) {
+    hash ^= (unsigned char)text[i];
+    hash *= 16777619u;
+  }
+  return hash ^ (hash >> 16);
+}
+
+#endif  // SRC_UTIL_PERFECT_HASH_H_
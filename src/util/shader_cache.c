@@ -0,0 +1,263 @@
+#include "shader_cache.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "allocator.h"
+#include "prettify_c.h"
+
+#ifdef WIN32
+#include <direct.h>
+#define make_dir(path) _mkdir(path)
+#else
+#include <sys/stat.h>
+#define make_dir(path) mkdir(path, 0755)
+#endif
+
+#define VECTOR_C ShaderSourceFile
+#include "vector.h"
+
+#define INDEX_NAME "index.txt"
+
+uint64_t shader_cache_digest(const char* text) {
+  uint64_t hash = 14695981039346656037ull;
+  for (; *text; text++) {
+    hash ^= (unsigned char)*text;
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+// =====
+// =
+// = ShaderCache
+// =
+// =====
+static int* bucket_of(ShaderCache* this, uint64_t digest) {
+  return &this->buckets[digest & (uint64_t)(this->buckets_count - 1)];
+}
+
+static void unlink_used(ShaderCache* this, int index) {
+  ShaderCacheEntry* entry = &this->entries[index];
+  if (entry->newer >= 0)
+    this->entries[entry->newer].older = entry->older;
+  else
+    this->newest = entry->older;
+  if (entry->older >= 0)
+    this->entries[entry->older].newer = entry->newer;
+  else
+    this->oldest = entry->newer;
+}
+
+static void link_newest(ShaderCache* this, int index) {
+  ShaderCacheEntry* entry = &this->entries[index];
+  entry->newer = -1;
+  entry->older = this->newest;
+  if (this->newest >= 0) this->entries[this->newest].newer = index;
+  this->newest = index;
+  if (this->oldest < 0) this->oldest = index;
+}
+
+static void unlink_bucket(ShaderCache* this, int index) {
+  int* link = bucket_of(this, this->entries[index].digest);
+  while (*link is_not index) link = &this->entries[*link].bucket_next;
+  *link = this->entries[index].bucket_next;
+}
+
+static void evict(ShaderCache* this, int index) {
+  ShaderCacheEntry* entry = &this->entries[index];
+  if (this->on_evict) this->on_evict(this->on_evict_data, entry->program);
+  str_free(entry->source);
+}
+
+ShaderCache shader_cache_create(int capacity, ShaderEvictFn on_evict,
+                                void* on_evict_data) {
+  assert_m(capacity > 0);
+  int buckets_count = 1;
+  while (buckets_count < capacity * 2) buckets_count *= 2;
+
+  ShaderCache result = {
+      .capacity = capacity,
+      .length = 0,
+      .entries =
+          (ShaderCacheEntry*)MALLOC(sizeof(ShaderCacheEntry) * capacity),
+      .buckets = (int*)MALLOC(sizeof(int) * buckets_count),
+      .buckets_count = buckets_count,
+      .newest = -1,
+      .oldest = -1,
+      .on_evict = on_evict,
+      .on_evict_data = on_evict_data,
+  };
+  assert_alloc(result.entries);
+  assert_alloc(result.buckets);
+
+  for (int i = 0; i < buckets_count; i++) result.buckets[i] = -1;
+  return result;
+}
+
+void shader_cache_free(ShaderCache this) {
+  for (int i = 0; i < this.length; i++) evict(&this, i);
+  FREE(this.entries);
+  FREE(this.buckets);
+}
+
+unsigned int shader_cache_find(ShaderCache* this, const char* source) {
+  uint64_t digest = shader_cache_digest(source);
+
+  for (int i = *bucket_of(this, digest); i >= 0;
+       i = this->entries[i].bucket_next) {
+    ShaderCacheEntry* entry = &this->entries[i];
+    if (entry->digest is_not digest or strcmp(entry->source.string, source))
+      continue;
+
+    this->hits++;
+    unlink_used(this, i);
+    link_newest(this, i);
+    return entry->program;
+  }
+
+  this->misses++;
+  return 0;
+}
+
+void shader_cache_add(ShaderCache* this, const char* source,
+                      unsigned int program) {
+  int index;
+  if (this->length < this->capacity) {
+    index = this->length++;
+  } else {
+    index = this->oldest;
+    unlink_used(this, index);
+    unlink_bucket(this, index);
+    evict(this, index);
+  }
+
+  uint64_t digest = shader_cache_digest(source);
+  int* bucket = bucket_of(this, digest);
+  this->entries[index] = (ShaderCacheEntry){
+      .digest = digest,
+      .source = str_owned("%s", source),
+      .program = program,
+      .bucket_next = *bucket,
+  };
+  *bucket = index;
+  link_newest(this, index);
+}
+
+// =====
+// =
+// = ShaderSourceCache
+// =
+// =====
+static str_t file_path(const ShaderSourceCache* this, uint64_t key_digest) {
+  // x_printf has no hex
+  char name[32];
+  snprintf(name, sizeof(name), "%016llx.frag", (unsigned long long)key_digest);
+  return str_owned("%s/%s", this->dir.string, name);
+}
+
+static ShaderSourceFile* find_file(ShaderSourceCache* this,
+                                   uint64_t key_digest) {
+  for (int i = 0; i < this->files.length; i++)
+    if (this->files.data[i].key_digest is key_digest)
+      return &this->files.data[i];
+  return null;
+}
+
+ShaderSourceCache shader_source_cache_open(const char* dir) {
+  ShaderSourceCache result = {
+      .dir = str_owned("%s", dir),
+      .files = vec_ShaderSourceFile_create(),
+  };
+  // Fails if it exists already, which is fine
+  make_dir(dir);
+
+  str_t index_path = str_owned("%s/" INDEX_NAME, dir);
+  FILE* index = fopen(index_path.string, "r");
+  str_free(index_path);
+  if (not index) return result;
+
+  unsigned long long key, source, length;
+  while (fscanf(index, "%llx %llx %llu", &key, &source, &length) is 3) {
+    ShaderSourceFile file = {
+        .key_digest = key,
+        .source_digest = source,
+        .length = (size_t)length,
+        .is_used = false,
+    };
+    vec_ShaderSourceFile_push(&result.files, file);
+  }
+  fclose(index);
+  return result;
+}
+
+void shader_source_cache_close(ShaderSourceCache this) {
+  str_t index_path = str_owned("%s/" INDEX_NAME, this.dir.string);
+  FILE* index = fopen(index_path.string, "w");
+  str_free(index_path);
+
+  for (int i = 0; i < this.files.length; i++) {
+    ShaderSourceFile* file = &this.files.data[i];
+    if (file->is_used) {
+      if (index)
+        fprintf(index, "%016llx %016llx %llu\n",
+                (unsigned long long)file->key_digest,
+                (unsigned long long)file->source_digest,
+                (unsigned long long)file->length);
+    } else {
+      str_t path = file_path(&this, file->key_digest);
+      remove(path.string);
+      str_free(path);
+    }
+  }
+
+  if (index) fclose(index);
+  vec_ShaderSourceFile_free(this.files);
+  str_free(this.dir);
+}
+
+bool shader_source_cache_load(ShaderSourceCache* this, const char* key,
+                              str_t* source) {
+  ShaderSourceFile* file = find_file(this, shader_cache_digest(key));
+  if (not file) return false;
+
+  str_t path = file_path(this, file->key_digest);
+  str_t text = read_file_to_str(path.string);
+  str_free(path);
+
+  // Written by someone else, or not to the end
+  bool is_valid = text.string and strlen(text.string) is file->length and
+                  shader_cache_digest(text.string) is file->source_digest;
+  if (not is_valid) {
+    if (text.string) str_free(text);
+    return false;
+  }
+
+  file->is_used = true;
+  *source = text;
+  return true;
+}
+
+void shader_source_cache_store(ShaderSourceCache* this, const char* key,
+                               const char* source) {
+  uint64_t key_digest = shader_cache_digest(key);
+  str_t path = file_path(this, key_digest);
+  FILE* out = fopen(path.string, "wb");
+  str_free(path);
+  if (not out) return;
+
+  size_t length = strlen(source);
+  bool is_written = fwrite(source, 1, length, out) is length;
+  fclose(out);
+  if (not is_written) return;
+
+  ShaderSourceFile* file = find_file(this, key_digest);
+  if (not file) {
+    vec_ShaderSourceFile_push(&this->files,
+                              (ShaderSourceFile){.key_digest = key_digest});
+    file = &this->files.data[this->files.length - 1];
+  }
+  file->source_digest = shader_cache_digest(source);
+  file->length = length;
+  file->is_used = true;
+}
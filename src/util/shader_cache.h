@@ -0,0 +1,109 @@
+#ifndef SRC_UTIL_SHADER_CACHE_H_
+#define SRC_UTIL_SHADER_CACHE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "better_string.h"
+
+// Caches of generated shaders. Neither of them touches GL: programs are
+// plain ids here, and whoever made them is told when one is evicted.
+
+// 64-bit FNV-1a of the text
+uint64_t shader_cache_digest(const char* text);
+
+// =====
+// =
+// = ShaderCache
+// =
+// =====
+// Linked programs by the source they were made from, found by the digest of
+// the source. Once full, the least recently used program is evicted.
+//
+//   unsigned int program = shader_cache_find(&cache, source);
+//   if (not program) shader_cache_add(&cache, source, compile(source));
+
+typedef void (*ShaderEvictFn)(void* data, unsigned int program);
+
+typedef struct ShaderCacheEntry {
+  uint64_t digest;
+  str_t source;
+  unsigned int program;
+  int bucket_next;  // Next entry with the same bucket, -1 at the end
+  int newer;        // Use order, -1 at the ends
+  int older;
+} ShaderCacheEntry;
+
+typedef struct ShaderCache {
+  int capacity;
+  int length;
+  ShaderCacheEntry* entries;
+  int* buckets;  // First entry of each bucket, -1 if none
+  int buckets_count;
+  int newest;
+  int oldest;
+  size_t hits;
+  size_t misses;
+
+  ShaderEvictFn on_evict;
+  void* on_evict_data;
+} ShaderCache;
+
+ShaderCache shader_cache_create(int capacity, ShaderEvictFn on_evict,
+                                void* on_evict_data);
+// Evicts every program
+void shader_cache_free(ShaderCache this);
+
+// 0 if there is no program for `source`. Counts a hit or a miss
+unsigned int shader_cache_find(ShaderCache* this, const char* source);
+// `source` must not be in the cache yet. It is copied
+void shader_cache_add(ShaderCache* this, const char* source,
+                      unsigned int program);
+
+// =====
+// =
+// = ShaderSourceCache
+// =
+// =====
+// Generated sources kept on disk between runs, by the text they were
+// generated from. Every source is a file in `dir`, named by the digest of
+// its key. `dir`/index.txt lists them with the digest and length of each
+// source, which are checked on load. Files not loaded or stored during a run
+// are deleted when the cache is closed.
+//
+//   ShaderSourceCache sources = shader_source_cache_open("assets/cache/x");
+//   str_t source;
+//   if (not shader_source_cache_load(&sources, key, &source)) {
+//     source = generate(...);
+//     shader_source_cache_store(&sources, key, source.string);
+//   }
+//   shader_source_cache_close(sources);
+
+typedef struct ShaderSourceFile {
+  uint64_t key_digest;
+  uint64_t source_digest;
+  size_t length;
+  bool is_used;
+} ShaderSourceFile;
+
+#define VECTOR_H ShaderSourceFile
+#include "vector.h"
+
+typedef struct ShaderSourceCache {
+  str_t dir;
+  vec_ShaderSourceFile files;
+} ShaderSourceCache;
+
+// Creates `dir` if needed
+ShaderSourceCache shader_source_cache_open(const char* dir);
+// Writes the index
+void shader_source_cache_close(ShaderSourceCache this);
+
+// False if there is no valid file for `key`
+bool shader_source_cache_load(ShaderSourceCache* this, const char* key,
+                              str_t* source);
+void shader_source_cache_store(ShaderSourceCache* this, const char* key,
+                               const char* source);
+
+#endif  // SRC_UTIL_SHADER_CACHE_H_
@@ -0,0 +1,223 @@
+/**
+ * Vector math kernels, included by simd_math.c once per instruction set.
+ * Input macros (all undefined at the end):
+ *   SIMD_SUFFIX - appended to every function name (_sse2, _avx2)
+ *   SIMD_TARGET - function attribute enabling the instruction set
+ *   SIMD_WIDTH  - doubles per vector
+ *   vd, vi      - double and integer vector types
+ *   v_* and vi_* operations, see simd_math.c
+ *
+ * Algorithms follow Cephes: sin/cos reduce the angle to [-pi/4, pi/4] with a
+ * three-part pi/2 and evaluate the sine or cosine polynomial by quadrant; ln
+ * splits the value into mantissa and exponent and evaluates a rational
+ * approximation of log(1 + x).
+ */
+
+#include "prettify_c.h"
+
+#define SIMD_FN(name) CONCAT(name, SIMD_SUFFIX)
+
+// Angles above this lose precision in the reduction and go to libm
+#define SIMD_TRIG_MAX 1.0e8
+
+SIMD_TARGET static inline vd SIMD_FN(v_select)(vd mask, vd a, vd b) {
+  return v_or(v_and(mask, a), v_andnot(mask, b));
+}
+
+// Fills a vector from the last `count` < SIMD_WIDTH values, padding with 1.0
+// so that padding lanes never take the slow path
+SIMD_TARGET static inline vd SIMD_FN(v_load_partial)(const double* a,
+                                                     int count) {
+  double buf[SIMD_WIDTH];
+  for (int i = 0; i < SIMD_WIDTH; i++) buf[i] = i < count ? a[i] : 1.0;
+  return v_load(buf);
+}
+
+SIMD_TARGET static inline void SIMD_FN(v_store_partial)(double* out, vd v,
+                                                       int count) {
+  double buf[SIMD_WIDTH];
+  v_store(buf, v);
+  for (int i = 0; i < count; i++) out[i] = buf[i];
+}
+
+// =====
+// =
+// = Arithmetic
+// =
+// =====
+#define SIMD_BINARY_KERNEL(name, op)                                         \
+  SIMD_TARGET static void SIMD_FN(name)(const double* a, const double* b,    \
+                                        double* out, int count) {            \
+    int i = 0;                                                               \
+    for (; i + SIMD_WIDTH <= count; i += SIMD_WIDTH)                         \
+      v_store(out + i, op(v_load(a + i), v_load(b + i)));                    \
+    if (i < count)                                                           \
+      SIMD_FN(v_store_partial)                                               \
+      (out + i,                                                              \
+       op(SIMD_FN(v_load_partial)(a + i, count - i),                         \
+          SIMD_FN(v_load_partial)(b + i, count - i)),                        \
+       count - i);                                                           \
+  }
+
+SIMD_BINARY_KERNEL(simd_add, v_add)
+SIMD_BINARY_KERNEL(simd_sub, v_sub)
+SIMD_BINARY_KERNEL(simd_mul, v_mul)
+SIMD_BINARY_KERNEL(simd_div, v_div)
+
+#undef SIMD_BINARY_KERNEL
+
+// =====
+// =
+// = Unary functions
+// =
+// =====
+// Each kernel computes a vector and a mask of lanes it could not handle,
+// those lanes are recomputed with `fallback`
+#define SIMD_UNARY_KERNEL(name, kernel, fallback)                             \
+  SIMD_TARGET static inline void SIMD_FN(name##_step)(                        \
+      const double* a, double* out, int count) {                              \
+    vd x = count is SIMD_WIDTH ? v_load(a)                                    \
+                               : SIMD_FN(v_load_partial)(a, count);           \
+    vd bad;                                                                   \
+    vd y = SIMD_FN(kernel)(x, &bad);                                          \
+                                                                              \
+    double in[SIMD_WIDTH];                                                    \
+    v_store(in, x);                                                           \
+    if (count is SIMD_WIDTH)                                                  \
+      v_store(out, y);                                                        \
+    else                                                                      \
+      SIMD_FN(v_store_partial)(out, y, count);                                \
+                                                                              \
+    int bad_bits = v_movemask(bad);                                           \
+    for (int k = 0; k < count; k++)                                           \
+      if (bad_bits & (1 << k)) out[k] = fallback(in[k]);                      \
+  }                                                                           \
+  SIMD_TARGET static void SIMD_FN(name)(const double* a, double* out,         \
+                                        int count) {                          \
+    int i = 0;                                                                \
+    for (; i + SIMD_WIDTH <= count; i += SIMD_WIDTH)                          \
+      SIMD_FN(name##_step)(a + i, out + i, SIMD_WIDTH);                       \
+    if (i < count) SIMD_FN(name##_step)(a + i, out + i, count - i);           \
+  }
+
+SIMD_TARGET static inline vd SIMD_FN(v_sqrt_kernel)(vd x, vd* bad) {
+  *bad = v_set1(0.0);
+  return v_sqrt(x);
+}
+
+// Polynomials on [-pi/4, pi/4]
+SIMD_TARGET static inline vd SIMD_FN(v_sin_poly)(vd r, vd rr) {
+  vd p = v_set1(1.58962301576546568060E-10);
+  p = v_add(v_mul(p, rr), v_set1(-2.50507477628578072866E-8));
+  p = v_add(v_mul(p, rr), v_set1(2.75573136213857245213E-6));
+  p = v_add(v_mul(p, rr), v_set1(-1.98412698295895385996E-4));
+  p = v_add(v_mul(p, rr), v_set1(8.33333333332211858878E-3));
+  p = v_add(v_mul(p, rr), v_set1(-1.66666666666666307295E-1));
+  return v_add(r, v_mul(v_mul(r, rr), p));
+}
+
+SIMD_TARGET static inline vd SIMD_FN(v_cos_poly)(vd rr) {
+  vd p = v_set1(-1.13585365213876817300E-11);
+  p = v_add(v_mul(p, rr), v_set1(2.08757008419747316778E-9));
+  p = v_add(v_mul(p, rr), v_set1(-2.75573141792967388112E-7));
+  p = v_add(v_mul(p, rr), v_set1(2.48015872888517045348E-5));
+  p = v_add(v_mul(p, rr), v_set1(-1.38888888888730564116E-3));
+  p = v_add(v_mul(p, rr), v_set1(4.16666666666665929218E-2));
+  vd result = v_sub(v_set1(1.0), v_mul(v_set1(0.5), rr));
+  return v_add(result, v_mul(v_mul(rr, rr), p));
+}
+
+// sin(x) for quadrant_shift 0, cos(x) for 1
+SIMD_TARGET static inline vd SIMD_FN(v_sincos)(vd x, vd* bad,
+                                               long long quadrant_shift) {
+  vd abs_x = v_andnot(v_set1(-0.0), x);
+  *bad = v_not_le(abs_x, v_set1(SIMD_TRIG_MAX));
+
+  // Adding 1.5 * 2^52 rounds to an integer and leaves it in the low bits
+  const double magic = 6755399441055744.0;
+  vd shifted = v_add(v_mul(x, v_set1(0.63661977236758134308)), v_set1(magic));
+  vd q = v_sub(shifted, v_set1(magic));
+  vi quadrant = vi_add64(v_as_i(shifted), vi_set1(quadrant_shift));
+
+  vd r = v_sub(x, v_mul(q, v_set1(1.57079625129699707031E0)));
+  r = v_sub(r, v_mul(q, v_set1(7.54978941586159635335E-8)));
+  r = v_sub(r, v_mul(q, v_set1(5.39030285815811905290E-15)));
+  vd rr = v_mul(r, r);
+
+  // Odd quadrants take the other polynomial, quadrants 2 and 3 are negated
+  vd use_cos = v_as_d(vi_sub64(vi_set1(0), vi_and(quadrant, vi_set1(1))));
+  vd negate = v_as_d(vi_shl64(vi_shr64(vi_and(quadrant, vi_set1(2)), 1), 63));
+
+  vd result = SIMD_FN(v_select)(use_cos, SIMD_FN(v_cos_poly)(rr),
+                                SIMD_FN(v_sin_poly)(r, rr));
+  result = v_xor(result, negate);
+
+  // sin(x) rounds to x there, this also keeps the sign of -0.0
+  if (quadrant_shift is 0)
+    result = SIMD_FN(v_select)(v_lt(abs_x, v_set1(1.0e-8)), x, result);
+  return result;
+}
+
+SIMD_TARGET static inline vd SIMD_FN(v_sin_kernel)(vd x, vd* bad) {
+  return SIMD_FN(v_sincos)(x, bad, 0);
+}
+
+SIMD_TARGET static inline vd SIMD_FN(v_cos_kernel)(vd x, vd* bad) {
+  return SIMD_FN(v_sincos)(x, bad, 1);
+}
+
+SIMD_TARGET static inline vd SIMD_FN(v_ln_kernel)(vd x, vd* bad) {
+  // Positive normal numbers only
+  *bad = v_or(v_not_le(v_set1(2.2250738585072014e-308), x),
+              v_not_le(x, v_set1(1.7976931348623157e308)));
+
+  // x = m * 2^e, m in [0.5, 1)
+  vi bits = v_as_i(x);
+  vd m = v_as_d(vi_or(vi_and(bits, vi_set1(0x000FFFFFFFFFFFFFLL)),
+                      vi_set1(0x3FE0000000000000LL)));
+  vd e = v_sub(v_as_d(vi_or(vi_shr64(bits, 52), vi_set1(0x4330000000000000LL))),
+               v_set1(4503599627370496.0 + 1022.0));
+
+  vd small = v_lt(m, v_set1(0.70710678118654752440));
+  e = v_sub(e, v_and(small, v_set1(1.0)));
+  vd f = v_sub(v_add(m, v_and(small, m)), v_set1(1.0));
+  vd ff = v_mul(f, f);
+
+  vd p = v_set1(1.01875663804580931796E-4);
+  p = v_add(v_mul(p, f), v_set1(4.97494994976747001425E-1));
+  p = v_add(v_mul(p, f), v_set1(4.70579119878881725854E0));
+  p = v_add(v_mul(p, f), v_set1(1.44989225341610930846E1));
+  p = v_add(v_mul(p, f), v_set1(1.79368678507819816313E1));
+  p = v_add(v_mul(p, f), v_set1(7.70838733755885391666E0));
+
+  vd q = v_add(f, v_set1(1.12873587189167450590E1));
+  q = v_add(v_mul(q, f), v_set1(4.52279145837532221105E1));
+  q = v_add(v_mul(q, f), v_set1(8.29875266912776603211E1));
+  q = v_add(v_mul(q, f), v_set1(7.11544750618563894466E1));
+  q = v_add(v_mul(q, f), v_set1(2.31251620126765340583E1));
+
+  vd y = v_mul(f, v_div(v_mul(ff, p), q));
+  y = v_sub(y, v_mul(e, v_set1(2.121944400546905827679E-4)));
+  y = v_sub(y, v_mul(ff, v_set1(0.5)));
+  vd result = v_add(f, y);
+  return v_add(result, v_mul(e, v_set1(0.693359375)));
+}
+
+SIMD_TARGET static inline vd SIMD_FN(v_log10_kernel)(vd x, vd* bad) {
+  return v_div(SIMD_FN(v_ln_kernel)(x, bad), v_set1(2.30258509299404568402));
+}
+
+static double SIMD_FN(libm_log10)(double a) { return log(a) / log(10.0); }
+
+SIMD_UNARY_KERNEL(simd_sqrt, v_sqrt_kernel, sqrt)
+SIMD_UNARY_KERNEL(simd_sin, v_sin_kernel, sin)
+SIMD_UNARY_KERNEL(simd_cos, v_cos_kernel, cos)
+SIMD_UNARY_KERNEL(simd_ln, v_ln_kernel, log)
+SIMD_UNARY_KERNEL(simd_log10, v_log10_kernel, SIMD_FN(libm_log10))
+
+#undef SIMD_UNARY_KERNEL
+#undef SIMD_TRIG_MAX
+#undef SIMD_FN
+#undef SIMD_SUFFIX
+#undef SIMD_TARGET
+#undef SIMD_WIDTH
@@ -0,0 +1,202 @@
+#include "simd_math.h"
+
+#include <math.h>
+
+#include "prettify_c.h"
+
+// =====
+// =
+// = Scalar fallback
+// =
+// =====
+#define SCALAR_UNARY(name, action)                                      \
+  static void name##_scalar(const double* a, double* out, int count) { \
+    for (int i = 0; i < count; i++) {                                   \
+      double x = a[i];                                                  \
+      out[i] = action;                                                  \
+    }                                                                   \
+  }
+
+SCALAR_UNARY(simd_cos, cos(x))
+SCALAR_UNARY(simd_sin, sin(x))
+SCALAR_UNARY(simd_sqrt, sqrt(x))
+SCALAR_UNARY(simd_ln, log(x))
+SCALAR_UNARY(simd_log10, log(x) / log(10.0))
+
+#define SCALAR_BINARY(name, action)                                        \
+  static void name##_scalar(const double* a, const double* b, double* out, \
+                            int count) {                                   \
+    for (int i = 0; i < count; i++) out[i] = a[i] action b[i];             \
+  }
+
+SCALAR_BINARY(simd_add, +)
+SCALAR_BINARY(simd_sub, -)
+SCALAR_BINARY(simd_mul, *)
+SCALAR_BINARY(simd_div, /)
+
+#undef SCALAR_UNARY
+#undef SCALAR_BINARY
+
+// =====
+// =
+// = x86 kernels
+// =
+// =====
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SIMD_X86
+#include <immintrin.h>
+
+// SSE2
+#define SIMD_SUFFIX _sse2
+#define SIMD_TARGET __attribute__((target("sse2")))
+#define SIMD_WIDTH 2
+#define vd __m128d
+#define vi __m128i
+#define v_set1 _mm_set1_pd
+#define v_load _mm_loadu_pd
+#define v_store _mm_storeu_pd
+#define v_add _mm_add_pd
+#define v_sub _mm_sub_pd
+#define v_mul _mm_mul_pd
+#define v_div _mm_div_pd
+#define v_sqrt _mm_sqrt_pd
+#define v_and _mm_and_pd
+#define v_or _mm_or_pd
+#define v_xor _mm_xor_pd
+#define v_andnot _mm_andnot_pd  // (~a) & b
+#define v_lt _mm_cmplt_pd
+#define v_not_le _mm_cmpnle_pd  // Also true if any is NaN
+#define v_movemask _mm_movemask_pd
+#define v_as_i _mm_castpd_si128
+#define v_as_d _mm_castsi128_pd
+#define vi_set1 _mm_set1_epi64x
+#define vi_and _mm_and_si128
+#define vi_or _mm_or_si128
+#define vi_add64 _mm_add_epi64
+#define vi_sub64 _mm_sub_epi64
+#define vi_shl64 _mm_slli_epi64
+#define vi_shr64 _mm_srli_epi64
+#include "simd_kernels.h"
+
+#undef vd
+#undef vi
+#undef v_set1
+#undef v_load
+#undef v_store
+#undef v_add
+#undef v_sub
+#undef v_mul
+#undef v_div
+#undef v_sqrt
+#undef v_and
+#undef v_or
+#undef v_xor
+#undef v_andnot
+#undef v_lt
+#undef v_not_le
+#undef v_movemask
+#undef v_as_i
+#undef v_as_d
+#undef vi_set1
+#undef vi_and
+#undef vi_or
+#undef vi_add64
+#undef vi_sub64
+#undef vi_shl64
+#undef vi_shr64
+
+// AVX2
+#define SIMD_SUFFIX _avx2
+#define SIMD_TARGET __attribute__((target("avx2")))
+#define SIMD_WIDTH 4
+#define vd __m256d
+#define vi __m256i
+#define v_set1 _mm256_set1_pd
+#define v_load _mm256_loadu_pd
+#define v_store _mm256_storeu_pd
+#define v_add _mm256_add_pd
+#define v_sub _mm256_sub_pd
+#define v_mul _mm256_mul_pd
+#define v_div _mm256_div_pd
+#define v_sqrt _mm256_sqrt_pd
+#define v_and _mm256_and_pd
+#define v_or _mm256_or_pd
+#define v_xor _mm256_xor_pd
+#define v_andnot _mm256_andnot_pd
+#define v_lt(a, b) _mm256_cmp_pd(a, b, _CMP_LT_OQ)
+#define v_not_le(a, b) _mm256_cmp_pd(a, b, _CMP_NLE_UQ)
+#define v_movemask _mm256_movemask_pd
+#define v_as_i _mm256_castpd_si256
+#define v_as_d _mm256_castsi256_pd
+#define vi_set1 _mm256_set1_epi64x
+#define vi_and _mm256_and_si256
+#define vi_or _mm256_or_si256
+#define vi_add64 _mm256_add_epi64
+#define vi_sub64 _mm256_sub_epi64
+#define vi_shl64 _mm256_slli_epi64
+#define vi_shr64 _mm256_srli_epi64
+#include "simd_kernels.h"
+
+#endif  // x86
+
+// =====
+// =
+// = Dispatch
+// =
+// =====
+static int current_level = -1;  // Not detected yet
+
+SimdLevel simd_supported_level() {
+#ifdef SIMD_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) return SIMD_LEVEL_AVX2;
+  if (__builtin_cpu_supports("sse2")) return SIMD_LEVEL_SSE2;
+#endif
+  return SIMD_LEVEL_SCALAR;
+}
+
+SimdLevel simd_level() {
+  if (current_level < 0) current_level = simd_supported_level();
+  return (SimdLevel)current_level;
+}
+
+void simd_set_level(SimdLevel level) {
+  SimdLevel supported = simd_supported_level();
+  current_level = level < supported ? level : supported;
+}
+
+#ifdef SIMD_X86
+#define DISPATCH(name, ...)                                   \
+  switch (simd_level()) {                                     \
+    case SIMD_LEVEL_AVX2:                                     \
+      name##_avx2(__VA_ARGS__);                               \
+      break;                                                  \
+    case SIMD_LEVEL_SSE2:                                     \
+      name##_sse2(__VA_ARGS__);                               \
+      break;                                                  \
+    default:                                                  \
+      name##_scalar(__VA_ARGS__);                             \
+  }
+#else
+#define DISPATCH(name, ...) name##_scalar(__VA_ARGS__)
+#endif
+
+#define UNARY_DISPATCH(name)                                \
+  void name(const double* a, double* out, int count) {      \
+    DISPATCH(name, a, out, count);                          \
+  }
+#define BINARY_DISPATCH(name)                                            \
+  void name(const double* a, const double* b, double* out, int count) {  \
+    DISPATCH(name, a, b, out, count);                                    \
+  }
+
+UNARY_DISPATCH(simd_cos)
+UNARY_DISPATCH(simd_sin)
+UNARY_DISPATCH(simd_sqrt)
+UNARY_DISPATCH(simd_ln)
+UNARY_DISPATCH(simd_log10)
+
+BINARY_DISPATCH(simd_add)
+BINARY_DISPATCH(simd_sub)
+BINARY_DISPATCH(simd_mul)
+BINARY_DISPATCH(simd_div)
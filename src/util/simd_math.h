@@ -0,0 +1,38 @@
+#ifndef SRC_UTIL_SIMD_MATH_H_
+#define SRC_UTIL_SIMD_MATH_H_
+
+// Math over arrays of doubles. On x86 the kernels run 2 (SSE2) or 4 (AVX2)
+// values at once, picked at runtime by what the CPU supports. Elsewhere, and
+// for values the vector code does not handle (huge angles, non-positive or
+// subnormal logarithm arguments, NaN, inf) libm is used. Vector results are
+// within a couple of ulp of libm.
+//
+// `out` may be the same array as an input.
+
+typedef enum SimdLevel {
+  SIMD_LEVEL_SCALAR = 0,
+  SIMD_LEVEL_SSE2 = 1,
+  SIMD_LEVEL_AVX2 = 2,
+} SimdLevel;
+
+SimdLevel simd_supported_level();
+SimdLevel simd_level();
+// Clamped to what is supported. For tests and benchmarks
+void simd_set_level(SimdLevel level);
+
+typedef void (*SimdUnaryFn)(const double* a, double* out, int count);
+typedef void (*SimdBinaryFn)(const double* a, const double* b, double* out,
+                             int count);
+
+void simd_cos(const double* a, double* out, int count);
+void simd_sin(const double* a, double* out, int count);
+void simd_sqrt(const double* a, double* out, int count);
+void simd_ln(const double* a, double* out, int count);
+void simd_log10(const double* a, double* out, int count);
+
+void simd_add(const double* a, const double* b, double* out, int count);
+void simd_sub(const double* a, const double* b, double* out, int count);
+void simd_mul(const double* a, const double* b, double* out, int count);
+void simd_div(const double* a, const double* b, double* out, int count);
+
+#endif  // SRC_UTIL_SIMD_MATH_H_